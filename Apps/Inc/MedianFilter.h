@@ -1,8 +1,8 @@
 /**
  * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
  * @file MedianFilter.h
- * @brief 
- * 
+ * @brief A sliding window median filter over several channels.
+ *
  * @defgroup MedianFilter
  * @addtogroup MedianFilter
  * @{
@@ -10,10 +10,10 @@
 
 /*
  * This file implements a median filter.
- * 
- * In order to use it in another file, you must import it in 
+ *
+ * In order to use it in another file, you must import it in
  * a particular way.
- * 
+ *
  * 1. Define your data type, like so
  *    #define MEDIAN_FILTER_TYPE int
  * 2. Define your filter depth, like so
@@ -24,25 +24,37 @@
  *    #define MEDIAN_FILTER_NAME my_fifo
  * 4. Import this file
  *    #include "MedianFilter.h"
- * 
+ *
  * This file includes some defaults, but they might not work for
  * your case!
- * 
+ *
  * Also, this file undef's everything at the end, so you can import
  * multiple times if you need.
- * 
+ *
  * If MEDIAN_FILTER_NAME == my_filter, then your new data structure will be
  * called my_filter_t.
- * 
+ *
  * NOTE: importantly, this does not currently support usage from
  * header files. That is, all these types/functions are statically
  * declared, so there cannot be a non-static fifo at the moment.
+ *
+ * Depths of 3, 5 and 7 find each median with a fixed sorting network over a
+ * copy of the window on the stack. Any other depth keeps each channel's window
+ * in two heaps around its median, a max heap of the values below it and a min
+ * heap of the values above, and moves only the value that changed: every put
+ * costs O(log depth) per channel. The median is the upper one for even depths.
+ *
+ * Nothing is shared between filters, so different tasks can each use their own
+ * filter. A single filter still needs a single writer.
+ *
+ * Run make medianbench to check the filter against a sort and time it on the host.
  */
 
 // The header guard only guard the import,
-// since this file can be imported multiple times 
+// since this file can be imported multiple times
 #ifndef MEDIAN_FILTER_H
 #define MEDIAN_FILTER_H
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 #endif
@@ -77,13 +89,31 @@
 #define MF_CHANNELS MEDIAN_FILTER_CHANNELS
 #define MF_NAME     MEDIAN_FILTER_NAME
 
+// Use a sorting network for these depths (a window of one is its own median)
+#define MF_NETWORK  (MF_DEPTH == 1 || MF_DEPTH == 3 || MF_DEPTH == 5 || MF_DEPTH == 7)
+
 // Type names
 #define MEDIAN_FILTER_STRUCT_NAME CONCAT(MF_NAME, _s)
 #define MEDIAN_FILTER_TYPE_NAME CONCAT(MF_NAME, _t)
 
 // more shorthand
 #define MF_STRUCT_NAME  MEDIAN_FILTER_STRUCT_NAME
-#define MF_TYPE_NAME    MEDIAN_FILTER_TYPE_NAME 
+#define MF_TYPE_NAME    MEDIAN_FILTER_TYPE_NAME
+
+// Define some names for our functions
+#define MEDIAN      CONCAT(MF_NAME, _median)
+#define INSERT      CONCAT(MF_NAME, _insert)
+#define SWAPIFLESS  CONCAT(MF_NAME, _swapIfLess)
+#define MINSORTUP   CONCAT(MF_NAME, _minSortUp)
+#define MAXSORTUP   CONCAT(MF_NAME, _maxSortUp)
+#define MINSORTDOWN CONCAT(MF_NAME, _minSortDown)
+#define MAXSORTDOWN CONCAT(MF_NAME, _maxSortDown)
+#define INIT        CONCAT(MF_NAME, _init)
+#define GET         CONCAT(MF_NAME, _get)
+#define PUT         CONCAT(MF_NAME, _put)
+#define GETSINGLE   CONCAT(MF_NAME, _getSingle)
+
+#if MF_NETWORK
 
 // The actual structure
 typedef struct MF_STRUCT_NAME {
@@ -92,50 +122,195 @@ typedef struct MF_STRUCT_NAME {
     uint32_t index;
 } MF_TYPE_NAME;
 
-// Define some names for our functions
-#define MEDIAN      CONCAT(MF_NAME, _median)
-#define INIT        CONCAT(MF_NAME, _init)
-#define GET         CONCAT(MF_NAME, _get)
-#define PUT         CONCAT(MF_NAME, _put)
-#define GETSINGLE   CONCAT(MF_NAME, _getSingle)
+// Orders two values of the window, without branching so random data costs the same as sorted
+#define MF_SORT(a, b) do {                                      \
+        MF_TYPE lo = (window[b] < window[a]) ? window[b] : window[a]; \
+        MF_TYPE hi = (window[b] < window[a]) ? window[a] : window[b]; \
+        window[a] = lo;                                         \
+        window[b] = hi;                                         \
+    } while (0)
 
 /**
  * @brief Helper function to find the median of an array of MF_TYPE with length MF_DEPTH.
  *        DO NOT call this function directly.
- * 
+ *
  * @param channel   the channel in the median filter to find the median of
  */
 static inline MF_TYPE __attribute__((unused))
-MEDIAN (MF_TYPE *channel) {
-    static MF_TYPE sorted[MF_DEPTH];
-
-    // copy channels into temporary array
-    memcpy(sorted, channel, MF_DEPTH * sizeof(MF_TYPE));
-
-    // sort temporary array
-    for (uint32_t i = 0; i < MF_DEPTH; ++i) {
-        MF_TYPE min = sorted[i];
-        uint32_t minIdx = i;
-        for (uint32_t j = i + 1; j < MF_DEPTH; ++j) {
-            if (sorted[j] < min) {
-                min = sorted[j];
-                minIdx = j;
-            }
-        }
-        sorted[minIdx] = sorted[i];
-        sorted[i] = min;
+MEDIAN (const MF_TYPE *channel) {
+    MF_TYPE window[MF_DEPTH];
+    memcpy(window, channel, sizeof(window));
+
+#if MF_DEPTH == 1
+#elif MF_DEPTH == 3
+    MF_SORT(0, 1); MF_SORT(1, 2); MF_SORT(0, 1);
+#elif MF_DEPTH == 5
+    MF_SORT(0, 1); MF_SORT(3, 4); MF_SORT(0, 3);
+    MF_SORT(1, 4); MF_SORT(1, 2); MF_SORT(2, 3);
+    MF_SORT(1, 2);
+#else
+    MF_SORT(0, 5); MF_SORT(0, 3); MF_SORT(1, 6);
+    MF_SORT(2, 4); MF_SORT(0, 1); MF_SORT(3, 5);
+    MF_SORT(2, 6); MF_SORT(2, 3); MF_SORT(3, 6);
+    MF_SORT(4, 5); MF_SORT(1, 4); MF_SORT(1, 3);
+    MF_SORT(3, 4);
+#endif
+
+    return window[MF_DEPTH >> 1];
+}
+
+#undef MF_SORT
+
+/**
+ * @brief Helper function to replace the oldest value of a channel and find its new median.
+ *        DO NOT call this function directly.
+ *
+ * @param filter    a pointer to the median filter
+ * @param channel   the channel to update
+ * @param value     the new value
+ */
+static inline void __attribute__((unused))
+INSERT (MF_TYPE_NAME *filter, uint32_t channel, MF_TYPE value) {
+    filter->raw[channel][filter->index] = value;
+    filter->filtered[channel] = MEDIAN(filter->raw[channel]);
+}
+
+#else
+
+// Big enough to index the window
+#if MF_DEPTH <= INT8_MAX
+typedef int8_t CONCAT(MF_NAME, _index_t);
+#else
+typedef int16_t CONCAT(MF_NAME, _index_t);
+#endif
+#define MF_INDEX    CONCAT(MF_NAME, _index_t)
+
+// Sizes of the two heaps, not counting the median
+#define MF_MAXCT    (MF_DEPTH / 2)
+#define MF_MINCT    ((MF_DEPTH - 1) / 2)
+
+// The actual structure
+typedef struct MF_STRUCT_NAME {
+    MF_TYPE raw[MF_CHANNELS][MF_DEPTH];
+    // Slots of raw: heap[MF_MAXCT] is the median, max heap below it, min heap above
+    MF_INDEX heap[MF_CHANNELS][MF_DEPTH];
+    // Where each slot of raw is in heap, relative to the median
+    MF_INDEX pos[MF_CHANNELS][MF_DEPTH];
+    MF_TYPE filtered[MF_CHANNELS];
+    uint32_t index;
+} MF_TYPE_NAME;
+
+/*
+ * The heap helpers below index heap relative to the median: the max heap's
+ * root is -1 with children -2 and -3, and the min heap's root is 1 with
+ * children 2 and 3. Either way, the parent of i is i / 2.
+ */
+
+/**
+ * @brief Helper function to swap two heap entries if the first is less than the second.
+ *        DO NOT call this function directly.
+ *
+ * @return whether they were swapped
+ */
+static inline bool __attribute__((unused))
+SWAPIFLESS (const MF_TYPE *raw, MF_INDEX *heap, MF_INDEX *pos, int32_t i, int32_t j) {
+    if (!(raw[heap[i]] < raw[heap[j]])) return false;
+
+    MF_INDEX swap = heap[i];
+    heap[i] = heap[j];
+    heap[j] = swap;
+    pos[heap[i]] = (MF_INDEX)i;
+    pos[heap[j]] = (MF_INDEX)j;
+    return true;
+}
+
+/**
+ * @brief Helper function to move a min heap entry towards the median while it is smaller than its parent.
+ *        DO NOT call this function directly.
+ *
+ * @return whether it became the median
+ */
+static inline bool __attribute__((unused))
+MINSORTUP (const MF_TYPE *raw, MF_INDEX *heap, MF_INDEX *pos, int32_t i) {
+    while (i > 0 && SWAPIFLESS(raw, heap, pos, i, i / 2)) i /= 2;
+    return i == 0;
+}
+
+/**
+ * @brief Helper function to move a max heap entry towards the median while it is larger than its parent.
+ *        DO NOT call this function directly.
+ *
+ * @return whether it became the median
+ */
+static inline bool __attribute__((unused))
+MAXSORTUP (const MF_TYPE *raw, MF_INDEX *heap, MF_INDEX *pos, int32_t i) {
+    while (i < 0 && SWAPIFLESS(raw, heap, pos, i / 2, i)) i /= 2;
+    return i == 0;
+}
+
+/**
+ * @brief Helper function to move the parent of min heap entry i away from the median
+ *        while it is larger than its smallest child. DO NOT call this function directly.
+ */
+static inline void __attribute__((unused))
+MINSORTDOWN (const MF_TYPE *raw, MF_INDEX *heap, MF_INDEX *pos, int32_t i) {
+    for (; i <= MF_MINCT; i *= 2) {
+        if (i > 1 && i < MF_MINCT && raw[heap[i + 1]] < raw[heap[i]]) ++i;
+        if (!SWAPIFLESS(raw, heap, pos, i, i / 2)) break;
     }
+}
 
-    // return median
-    return sorted[MF_DEPTH >> 1];
+/**
+ * @brief Helper function to move the parent of max heap entry i away from the median
+ *        while it is smaller than its largest child. DO NOT call this function directly.
+ */
+static inline void __attribute__((unused))
+MAXSORTDOWN (const MF_TYPE *raw, MF_INDEX *heap, MF_INDEX *pos, int32_t i) {
+    for (; i >= -MF_MAXCT; i *= 2) {
+        if (i < -1 && i > -MF_MAXCT && raw[heap[i]] < raw[heap[i - 1]]) --i;
+        if (!SWAPIFLESS(raw, heap, pos, i / 2, i)) break;
+    }
 }
 
+/**
+ * @brief Helper function to replace the oldest value of a channel and find its new median.
+ *        DO NOT call this function directly.
+ *
+ * @param filter    a pointer to the median filter
+ * @param channel   the channel to update
+ * @param value     the new value
+ */
+static inline void __attribute__((unused))
+INSERT (MF_TYPE_NAME *filter, uint32_t channel, MF_TYPE value) {
+    MF_TYPE *raw = filter->raw[channel];
+    MF_INDEX *heap = filter->heap[channel] + MF_MAXCT;
+    MF_INDEX *pos = filter->pos[channel];
+    int32_t p = pos[filter->index];
+    MF_TYPE old = raw[filter->index];
+    raw[filter->index] = value;
+
+    if (p > 0) {            // replaced a value in the min heap
+        if (old < value) MINSORTDOWN(raw, heap, pos, p * 2);
+        else if (MINSORTUP(raw, heap, pos, p)) MAXSORTDOWN(raw, heap, pos, -1);
+    } else if (p < 0) {     // replaced a value in the max heap
+        if (value < old) MAXSORTDOWN(raw, heap, pos, p * 2);
+        else if (MAXSORTUP(raw, heap, pos, p)) MINSORTDOWN(raw, heap, pos, 1);
+    } else {                // replaced the median
+        if (MF_MAXCT) MAXSORTDOWN(raw, heap, pos, -1);
+        if (MF_MINCT) MINSORTDOWN(raw, heap, pos, 1);
+    }
+
+    filter->filtered[channel] = raw[heap[0]];
+}
+
+#endif
+
 /**
  * @brief Initialize a new median filter
- * 
+ *
  * If the type of the filter is myfilter_t, then this function
  * will be called myfilter_init().
- * 
+ *
  * @param filter    a pointer to the median filter to initialize
  * @param low       a value that is below the range of expected values
  * @param high      a value that is above the range of expected values
@@ -144,39 +319,47 @@ static inline void __attribute__((unused))
 INIT (MF_TYPE_NAME *filter, MF_TYPE low, MF_TYPE high) {
     // intialize the filter with alternating low and high values, so it will be stable at startup
     for (uint32_t channel = 0; channel < MF_CHANNELS; ++channel) {
-        for (uint32_t i = 0; i < MF_DEPTH - 1; ++i) {
+        for (uint32_t i = 0; i < MF_DEPTH; ++i) {
             filter->raw[channel][i] = (i & 1) ? high : low;
         }
+#if MF_NETWORK
         filter->filtered[channel] = MEDIAN(filter->raw[channel]);
+#else
+        // In ascending order every heap property holds: the low slots, then the high ones
+        uint32_t rank = 0;
+        for (uint32_t first = 0; first < 2; ++first) {
+            for (uint32_t i = first; i < MF_DEPTH; i += 2) {
+                filter->heap[channel][rank] = (MF_INDEX)i;
+                filter->pos[channel][i] = (MF_INDEX)((int32_t)rank - MF_MAXCT);
+                ++rank;
+            }
+        }
+        filter->filtered[channel] = filter->raw[channel][filter->heap[channel][MF_MAXCT]];
+#endif
     }
 
-    filter->index = MF_DEPTH - 1;
+    filter->index = 0;
 }
 
 /**
  * @brief update the median filter by giving it a new set of values for all channels
- * 
+ *
  * @param filter    a pointer to the median filter
  * @param channels  a complete set of new values for all channels to add to the median filter
- * 
+ *
  */
 static inline void __attribute__((unused))
 PUT (MF_TYPE_NAME *filter, MF_TYPE *channels) {
-    // put the new data into the filter
+    // replace the oldest value of every channel, updating its median
     for (uint32_t channel = 0; channel < MF_CHANNELS; ++channel) {
-        filter->raw[channel][filter->index] = channels[channel];
+        INSERT(filter, channel, channels[channel]);
     }
     (filter->index) = (filter->index + 1) % MF_DEPTH;
-
-    // update the list of filtered values
-    for (uint32_t channel = 0; channel < MF_CHANNELS; ++channel) {
-        filter->filtered[channel] = MEDIAN(filter->raw[channel]);
-    }
 }
 
 /**
  * @brief get a complete set of filtered values for all channels
- * 
+ *
  * @param filter    a pointer to the median filter
  * @param dest      a pointer to a buffer to store all of the filtered values
  */
@@ -187,7 +370,7 @@ GET (MF_TYPE_NAME *filter, MF_TYPE *dest) {
 
 /**
  * @brief get a filtered value for a single channel in the median filter
- * 
+ *
  * @param filter    a pointer to the median filter
  * @param channel   the channel to read
  * @return the filtered value
@@ -208,14 +391,24 @@ GETSINGLE (MF_TYPE_NAME *filter, uint32_t channel) {
 #undef MF_DEPTH
 #undef MF_CHANNELS
 #undef MF_NAME
+#undef MF_NETWORK
+#undef MF_INDEX
+#undef MF_MAXCT
+#undef MF_MINCT
 #undef MEDIAN_FILTER_STRUCT_NAME
 #undef MEDIAN_FILTER_TYPE_NAME
 #undef MF_STRUCT_NAME
 #undef MF_TYPE_NAME
 #undef MEDIAN
+#undef INSERT
+#undef SWAPIFLESS
+#undef MINSORTUP
+#undef MAXSORTUP
+#undef MINSORTDOWN
+#undef MAXSORTDOWN
 #undef INIT
 #undef GET
 #undef PUT
-#undef GETSINGLE 
+#undef GETSINGLE
 
-/* @} */
\ No newline at end of file
+/* @} */
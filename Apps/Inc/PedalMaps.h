@@ -0,0 +1,76 @@
+/**
+ * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
+ * @file PedalMaps.h
+ * @brief Lookup tables that turn a pedal percentage into a motor current setpoint.
+ *
+ * The tables are generated by Scripts/pedal_maps.py into Apps/Src/PedalMaps.c,
+ * one entry per pedal percent (0-100), in Q15 fixed point where PEDAL_MAP_ONE is 100% current.
+ * Each table exists once per throttle curve, so the curve can be switched while driving.
+ * After changing a threshold or a curve here, run make pedalmaps.
+ *
+ * @defgroup PedalMaps
+ * @addtogroup PedalMaps
+ * @{
+ */
+
+#ifndef __PEDALMAPS_H
+#define __PEDALMAPS_H
+
+#include <stdint.h>
+
+#define PEDAL_MIN 0        // percent
+#define PEDAL_MAX 100      // percent
+
+#define ACCEL_PEDAL_THRESHOLD 15 // percent
+
+#define ONEPEDAL_BRAKE_THRESHOLD 25   // percent
+#define ONEPEDAL_NEUTRAL_THRESHOLD 35 // percent
+
+#define PEDAL_MAP_SIZE (PEDAL_MAX + 1)
+#define PEDAL_MAP_ONE 32767 // full current in Q15
+
+/**
+ * Throttle curves, applied to the part of the pedal travel that accelerates.
+ * LINEAR       current follows the pedal
+ * PROGRESSIVE  current grows with the square of the pedal, for finer control at low speed
+ * AGGRESSIVE   current rises quickly at the start of the travel
+ */
+#define FOREACH_PedalCurve(CURVE) \
+        CURVE(LINEAR),      \
+        CURVE(PROGRESSIVE), \
+        CURVE(AGGRESSIVE),  \
+
+#define GENERATE_PEDAL_CURVE(CURVE) PEDAL_CURVE_##CURVE
+
+typedef enum {
+    FOREACH_PedalCurve(GENERATE_PEDAL_CURVE)
+    NUM_PEDAL_CURVES
+} PedalCurve_t;
+
+/**
+ * Forward, reverse, and accelerate cruise: nothing below ACCEL_PEDAL_THRESHOLD,
+ * then the curve up to full current at PEDAL_MAX.
+ */
+extern const int16_t PedalMap_Throttle[NUM_PEDAL_CURVES][PEDAL_MAP_SIZE];
+
+/**
+ * One pedal drive: regen falling linearly from full at PEDAL_MIN to none at
+ * ONEPEDAL_BRAKE_THRESHOLD, nothing up to ONEPEDAL_NEUTRAL_THRESHOLD,
+ * then the curve up to full current at PEDAL_MAX.
+ * Entries are magnitudes; the velocity setpoint decides whether they brake or accelerate.
+ */
+extern const int16_t PedalMap_OnePedal[NUM_PEDAL_CURVES][PEDAL_MAP_SIZE];
+
+/**
+ * @brief   Looks up the current setpoint for a pedal position
+ * @param   map one of the tables above, e.g. PedalMap_Throttle[PEDAL_CURVE_LINEAR]
+ * @param   percent the pedal position. Anything above PEDAL_MAX reads as PEDAL_MAX.
+ * @return  the setpoint, from 0.0 to 1.0
+ */
+static inline float PedalMap_Lookup(const int16_t *map, uint8_t percent){
+    return map[(percent > PEDAL_MAX) ? PEDAL_MAX : percent] / (float)PEDAL_MAP_ONE;
+}
+
+#endif
+
+/* @} */
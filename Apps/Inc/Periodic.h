@@ -0,0 +1,86 @@
+/**
+ * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
+ * @file Periodic.h
+ * @brief Runs a task loop at a fixed period and measures how well it keeps it.
+ *
+ * Each iteration is released at an absolute tick, so time spent in the loop body
+ * (including waiting on a blocking call) does not push back later releases.
+ * For every iteration, the start jitter (how late it started compared to its release)
+ * and execution time are recorded in log2 histograms. An iteration still running
+ * when the next one should have been released is a deadline overrun; the releases it
+ * missed are skipped instead of being run back to back.
+ *
+ * Usage:
+ *
+ *     static Periodic_t timing;
+ *     Periodic_Init(&timing, PERIOD_MS);
+ *     while(1){
+ *         Periodic_Wait(&timing);
+ *         ...loop body...
+ *     }
+ *
+ * A loop that must also react to events between releases uses Periodic_WaitOrSignal
+ * instead, which returns early whenever the task's own semaphore is posted
+ * (OSTaskSemPost, which interrupts may call). Those extra iterations do not move the
+ * releases, and are not timed.
+ *
+ * @defgroup Periodic
+ * @addtogroup Periodic
+ * @{
+ */
+
+#ifndef __PERIODIC_H
+#define __PERIODIC_H
+
+#include "common.h"
+#include "os.h"
+
+/**
+ * Number of histogram buckets. Bucket 0 counts times under 2 us,
+ * bucket k counts [2^k, 2^(k+1)) us, and the last bucket also counts anything longer.
+ */
+#define PERIODIC_HIST_BUCKETS 16
+
+typedef struct {
+    OS_TICK periodTicks;
+    uint32_t periodCycles;
+    OS_TICK release;            // tick the current iteration was released at
+    uint32_t expectedStart;     // cycle count the current iteration was due to start at
+    uint32_t start;             // cycle count the current iteration started at
+    bool running;               // an iteration has started
+    bool signaled;              // the last wait was ended by a signal, not a release
+    uint32_t iterations;
+    uint32_t overruns;          // iterations that ran past the next release
+    uint32_t skipped;           // releases skipped because of overruns
+    uint32_t signals;           // waits ended early by a signal
+    uint32_t maxJitterUs;
+    uint32_t maxExecUs;
+    uint32_t jitterHist[PERIODIC_HIST_BUCKETS];
+    uint32_t execHist[PERIODIC_HIST_BUCKETS];
+} Periodic_t;
+
+/**
+ * @brief   Sets up a periodic loop. The first iteration is released by the first Periodic_Wait.
+ * @param   p the loop's state
+ * @param   periodMs the period in milliseconds. Rounded down to whole ticks, at least one.
+ */
+void Periodic_Init(Periodic_t *p, uint32_t periodMs);
+
+/**
+ * @brief   Ends the current iteration and waits for the next release. Call at the top of the loop.
+ * @param   p the loop's state
+ */
+void Periodic_Wait(Periodic_t *p);
+
+/**
+ * @brief   Like Periodic_Wait, but also returns as soon as the calling task's semaphore is posted.
+ *          Call at the top of the loop, instead of Periodic_Wait.
+ * @param   p the loop's state
+ * @return  true at a release, false if a signal ended the wait first. The next call
+ *          still waits for the same release.
+ */
+bool Periodic_WaitOrSignal(Periodic_t *p);
+
+#endif
+
+/* @} */
@@ -9,15 +9,38 @@
 void SendCarCAN_Init();
 
 /**
- * @brief Wrapper to put new message in the CAN queue
+ * @brief Stores a message to be forwarded over CarCAN. Only the newest copy of each
+ *        message is kept, except for fault messages such as MOTOR_STATUS, which are
+ *        all queued. Task_SendCarCAN forwards them as its rate budget allows.
 */
 void SendCarCAN_Put(CANDATA_t message);
 
 /**
- * @brief return the space left in SendCarCAN_Q for debug purposes
+ * @brief Same as SendCarCAN_Put, but safe to call from an interrupt. Used as the
+ *        CAN gateway sink for motor controller messages.
+*/
+void SendCarCAN_PutPtr(const CANDATA_t *message);
+
+/**
+ * @brief return the number of messages waiting to be forwarded for debug purposes
 */
 #ifdef DEBUG
-uint8_t get_SendCarCAN_Q_Space(void);
+uint8_t get_SendCarCAN_Pending(void);
+
+/**
+ * @brief return the number of messages replaced by a newer copy before they were forwarded
+*/
+uint32_t get_SendCarCAN_Coalesced(void);
+
+/**
+ * @brief return the number of times forwarding waited for room in the CarCAN transmit queue
+*/
+uint32_t get_SendCarCAN_Retried(void);
+
+/**
+ * @brief return the number of fault messages lost because too many were waiting
+*/
+uint32_t get_SendCarCAN_FaultDrops(void);
 #endif
 
 #endif
\ No newline at end of file
@@ -11,12 +11,16 @@
 #define __SENDTRITIUM_H
 
 #include "common.h"
+#include "Periodic.h"
+#include "PedalMaps.h"
 
 //#define SENDTRITIUM_PRINT_MES
 
+// Timing in ms. FSM_PERIOD can be lowered as far as 10 ms; MOTOR_MSG_PERIOD
+// should stay a multiple of it. Everything counted in FSM iterations is derived from these.
 #define MOTOR_MSG_PERIOD 100 // in ms
 #define FSM_PERIOD 100 // in ms
-#define DEBOUNCE_PERIOD 2 // in units of FSM_PERIOD
+#define DEBOUNCE_PERIOD (200 / FSM_PERIOD) // in units of FSM_PERIOD
 #define MOTOR_MSG_COUNTER_THRESHOLD (MOTOR_MSG_PERIOD)/(FSM_PERIOD)
 
 #define FOREACH_Gear(GEAR) \
@@ -30,25 +34,39 @@ typedef enum GEAR_ENUM {
 } Gear_t;
 
 // State Names
+#define FOREACH_TritiumState(STATE) \
+        STATE(FORWARD_DRIVE),     \
+        STATE(NEUTRAL_DRIVE),     \
+        STATE(REVERSE_DRIVE),     \
+        STATE(RECORD_VELOCITY),   \
+        STATE(POWERED_CRUISE),    \
+        STATE(COASTING_CRUISE),   \
+        STATE(BRAKE_STATE),       \
+        STATE(ONEPEDAL),          \
+        STATE(ACCELERATE_CRUISE), \
+
 typedef enum{
-    FORWARD_DRIVE,
-    NEUTRAL_DRIVE,
-    REVERSE_DRIVE,
-    RECORD_VELOCITY,
-    POWERED_CRUISE,
-    COASTING_CRUISE,
-    BRAKE_STATE,
-    ONEPEDAL,
-    ACCELERATE_CRUISE
+    FOREACH_TritiumState(GENERATE_ENUM)
+    NUM_TRITIUM_STATES,
 } TritiumStateName_t;
 
-// State Struct for FSM
+// State Struct for FSM. Transitions between states are in a table in SendTritium.c.
 typedef struct TritiumState{
     TritiumStateName_t name;
     void (*stateHandler)(void);
-    void (*stateDecider)(void);
 } TritiumState_t;
 
+// Number of state changes kept for SendTritium_GetTrace
+#define SENDTRITIUM_TRACE_DEPTH 32
+
+// A recorded state change
+typedef struct {
+    uint32_t timestamp;     // cycle count (BSP_Cycles_Get) when the change was decided
+    uint16_t inputs;        // the FSM input predicates that caused it, one bit each
+    uint8_t from;           // TritiumStateName_t
+    uint8_t to;             // TritiumStateName_t
+} TritiumTransition_t;
+
 #ifdef SENDTRITIUM_EXPOSE_VARS
 // Inputs
 extern bool cruiseEnable;
@@ -61,7 +79,7 @@ extern uint8_t accelPedalPercent;
 
 extern Gear_t gear;
 
-extern TritiumState_t state;
+extern TritiumStateName_t state;
 extern float velocityObserved;
 extern float cruiseVelSetpoint;
 #endif
@@ -97,16 +115,48 @@ EXPOSE_SETTER(float, velocitySetpoint)
 #endif
 
 /**
- * @brief Linearly map range of integers to another range of integers, and provide the pecentage result.
- * in_min to in_max is mapped to out_min to out_max.
- * @param input input integer value
- * @param in_min minimum value of input range
- * @param in_max maximum value of input range
- * @param out_min minimum value of output range
- * @param out_max maximum value of output range
- * @returns float value from (out_min / 100.0) to (out_max / 100.0)
+ * @brief Selects the throttle curve for forward drive, accelerate cruise and one pedal drive.
+ * Reverse always uses the linear curve.
+ * @param curve the curve
+ */
+void SendTritium_SetThrottleCurve(PedalCurve_t curve);
+
+/**
+ * @brief Gets the loop timing of Task_SendTritium: jitter and execution time
+ * histograms and the number of deadline overruns
+ * @returns the task's Periodic_t
+ */
+const Periodic_t *SendTritium_GetTiming(void);
+
+// How quickly a brake press cuts motor current, measured from the debounced switch edge
+typedef struct {
+    uint32_t presses;       // presses seen by the brake interrupt
+    uint32_t cutDrops;      // zero current frames the interrupt could not queue
+    uint32_t lastCutUs;     // press to zero current MOTOR_DRIVE frame handed to MotorCAN
+    uint32_t maxCutUs;
+    uint32_t lastStateUs;   // press to entering BRAKE_STATE
+    uint32_t maxStateUs;
+} BrakeLatency_t;
+
+/**
+ * @brief Gets the brake press to motor current cut latency
+ * @returns the latest and longest latencies, in microseconds
+ */
+const BrakeLatency_t *SendTritium_GetBrakeLatency(void);
+
+/**
+ * @brief Copies the most recent state changes, oldest first
+ * @param trace where to copy them, room for SENDTRITIUM_TRACE_DEPTH entries
+ * @returns the number of entries copied
+ */
+uint8_t SendTritium_GetTrace(TritiumTransition_t *trace);
+
+/**
+ * @brief Gets the longest time one FSM iteration (state handler and transition) has taken
+ * @param state the state the iteration started in
+ * @returns the time in CPU cycles
  */
-float mapToPercent(uint8_t input, uint8_t in_min, uint8_t in_max, uint8_t out_min, uint8_t out_max);
+uint32_t SendTritium_GetMaxCycles(TritiumStateName_t state);
 
 #endif
 
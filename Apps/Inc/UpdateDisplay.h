@@ -31,7 +31,8 @@ typedef enum{
 	UPDATEDISPLAY_ERR_FIFO_PUT,     // Error putting command in fifo
 	UPDATEDISPLAY_ERR_FIFO_POP,     // Error popping command from fifo
 	UPDATEDISPLAY_ERR_PARSE_COMP,   // Error parsing component/val in SetComponent
-	UPDATEDISPLAY_ERR_DRIVER        // Driver call returned an error
+	UPDATEDISPLAY_ERR_DRIVER,       // Driver call returned an error
+	UPDATEDISPLAY_ERR_NO_RESPONSE   // Display stopped answering commands
 } UpdateDisplayError_t;
 
 /**
@@ -53,6 +54,33 @@ typedef enum{
 #define DISP_FORWARD STATE_1
 #define DISP_REVERSE STATE_2
 
+// Most bytes per second the task may write to the display (115200 baud is 11520)
+#ifndef DISPLAY_BUDGET_BYTES_PER_S
+#define DISPLAY_BUDGET_BYTES_PER_S 4000
+#endif
+
+// Most bytes the task may write at once after being idle. Must fit the
+// longest component command and a refresh.
+#ifndef DISPLAY_BUDGET_BURST
+#define DISPLAY_BUDGET_BURST 256
+#endif
+
+#if DISPLAY_BUDGET_BURST < 64
+#error "DISPLAY_BUDGET_BURST must fit at least one command and a refresh"
+#endif
+
+/**
+ * Display scheduler counters
+ */
+typedef struct{
+	uint32_t bytesPerSecond;	// display UART traffic, over about a second
+	uint32_t frames;			// writes to the display
+	uint32_t deferred;			// frames cut short by the budget
+	uint32_t displayBusy;		// frames cut short because the display's input buffer was full
+	uint32_t budgetWaits;		// ticks a fast component waited for budget
+	uint32_t maxFastLatencyMs;	// longest a fast component took to be sent after it changed
+} UpdateDisplayStats_t;
+
 /**
  * @brief Initializes UpdateDisplay application
  * @returns UpdateDisplayError_t
@@ -146,6 +174,12 @@ UpdateDisplayError_t UpdateDisplay_SetMCCurrent(int32_t val);
 
 UpdateDisplayError_t UpdateDisplay_SetBrake(bool state);
 
+/**
+ * @brief Gets the display scheduler counters, including the traffic on the display UART
+ * @returns the counters, updated by the task
+ */
+const UpdateDisplayStats_t *UpdateDisplay_GetStats(void);
+
 /**
  * @brief Clears the display message queue and sets the message counter semaphore value to 0
  * @param none
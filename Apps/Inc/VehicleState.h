@@ -0,0 +1,110 @@
+/**
+ * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
+ * @file VehicleState.h
+ * @brief A consistent snapshot of vehicle data shared between tasks.
+ *
+ * The data is split into domains, each written by exactly one task: motor feedback
+ * by ReadTritium, the driver controls and setpoints by SendTritium, and the battery
+ * by ReadCarCAN. Any task can read any domain without a mutex and always gets all
+ * of its fields from the same write.
+ *
+ * Each domain keeps two copies and a sequence number. A write updates one copy
+ * while readers are pointed at the other, then the second, bumping the sequence
+ * before each. A read copies the copy the sequence points at and tries again only
+ * if the sequence changed meanwhile, which can only happen if the writer preempted
+ * the reader. A reader that preempts the writer never waits, so a high priority
+ * task reading a lower priority task's domain cannot deadlock.
+ *
+ * @defgroup VehicleState
+ * @addtogroup VehicleState
+ * @{
+ */
+
+#ifndef __VEHICLESTATE_H
+#define __VEHICLESTATE_H
+
+#include "common.h"
+#include "SendTritium.h"
+
+// Motor feedback, written by ReadTritium
+typedef struct {
+    float rpm;
+    float velocity;             // m/s
+} VehicleMotor_t;
+
+// Driver inputs and motor setpoints, written by SendTritium once per FSM iteration
+typedef struct {
+    TritiumStateName_t state;
+    Gear_t gear;
+    uint8_t accelPedalPercent;
+    uint8_t brakePedalPercent;
+    bool cruiseEnable;
+    bool cruiseSet;
+    bool onePedalEnable;
+    bool regenEnable;
+    float currentSetpoint;
+    float velocitySetpoint;
+    float cruiseVelSetpoint;
+} VehicleControl_t;
+
+// Battery, written by ReadCarCAN
+typedef struct {
+    uint32_t stateOfCharge;     // integer percent
+    uint32_t supplementalMv;    // supplemental battery voltage in mV
+} VehicleBattery_t;
+
+// Every domain, each consistent on its own
+typedef struct {
+    VehicleMotor_t motor;
+    VehicleControl_t control;
+    VehicleBattery_t battery;
+} VehicleState_t;
+
+/**
+ * @brief   Publishes new motor feedback. Only ReadTritium may call this.
+ * @param   motor the new values
+ */
+void VehicleState_SetMotor(const VehicleMotor_t *motor);
+
+/**
+ * @brief   Publishes new controls and setpoints. Only SendTritium may call this.
+ * @param   control the new values
+ */
+void VehicleState_SetControl(const VehicleControl_t *control);
+
+/**
+ * @brief   Publishes new battery values. Only ReadCarCAN may call this.
+ * @param   battery the new values
+ */
+void VehicleState_SetBattery(const VehicleBattery_t *battery);
+
+/**
+ * @brief   Reads the latest motor feedback
+ * @param   motor where to copy it
+ * @return  the number of times the domain has been written
+ */
+uint32_t VehicleState_GetMotor(VehicleMotor_t *motor);
+
+/**
+ * @brief   Reads the latest controls and setpoints
+ * @param   control where to copy them
+ * @return  the number of times the domain has been written
+ */
+uint32_t VehicleState_GetControl(VehicleControl_t *control);
+
+/**
+ * @brief   Reads the latest battery values
+ * @param   battery where to copy them
+ * @return  the number of times the domain has been written
+ */
+uint32_t VehicleState_GetBattery(VehicleBattery_t *battery);
+
+/**
+ * @brief   Reads every domain
+ * @param   state where to copy them
+ */
+void VehicleState_Get(VehicleState_t *state);
+
+#endif
+
+/* @} */
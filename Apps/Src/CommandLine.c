@@ -9,6 +9,8 @@
 #include "Contactors.h"
 #include "Minions.h"
 #include "Pedals.h"
+#include "SendTritium.h"
+#include "BSP_Cycles.h"
 
 #define MAX_BUFFER_SIZE	128	// defined from BSP_UART_Read function
 
@@ -24,6 +26,8 @@ static bool cmd_CANbus_Send(void);
 
 static bool cmd_CANbus_Read(void);
 
+static bool cmd_CANbus_Capture(void);
+
 static bool cmd_Contactors_Get(void);
 
 static bool cmd_Contactors_Set(void);
@@ -34,16 +38,23 @@ static bool cmd_Minions_Write(void);
 
 static bool cmd_Pedals_Read(void);
 
+static bool cmd_SendTritium_Trace(void);
+
+static bool cmd_SendTritium_Curve(void);
+
 
 const struct Command cmdline_commands[] = {
 	{.name = "help", .action = cmd_help},
 	{.name = "CANbus_Send", .action = cmd_CANbus_Send},
 	{.name = "CANbus_Read", .action = cmd_CANbus_Read},
+	{.name = "CANbus_Capture", .action = cmd_CANbus_Capture},
 	{.name = "Contactors_Get", .action = cmd_Contactors_Get},
 	{.name = "Contactors_Set", .action = cmd_Contactors_Set},
 	{.name = "Minions_Read", .action = cmd_Minions_Read},
 	{.name = "Minions_Write", .action = cmd_Minions_Write},
 	{.name = "Pedals_Read", .action = cmd_Pedals_Read},
+	{.name = "SendTritium_Trace", .action = cmd_SendTritium_Trace},
+	{.name = "SendTritium_Curve", .action = cmd_SendTritium_Curve},
 	{.name = NULL, .action = NULL}
 };
 
@@ -58,7 +69,12 @@ char *help = {
 	"	CANbus_Send (non)blocking motor/car 'string' - Sends a CAN\n\r"
 	"message with the string data as is on the determined line\n\r"
 	"	CANbus_Read (non)blocking motor/car - Reads a CAN message\n\r"
-	"on the detemined line\n\r"
+	"on the detemined line, unless another task reads that line\n\r"
+	"	CANbus_Capture start/stop/clear/dump - Controls recording of\n\r"
+	"CAN frames. dump writes the recorded frames in binary (decode\n\r"
+	"with Scripts/can_replay.py)\n\r"
+	"	CANbus_Capture filter all/'hex id' on/off - Chooses which IDs\n\r"
+	"are recorded\n\r"
 	"	Contactors_Get array_c/array_p/motor_c - Gets the status of\n\r"
 	"determined contactor\n\r"
 	"	Contactors_Set array_c/array_p/motor_c on/off (non)blocking -\n\r"
@@ -70,6 +86,10 @@ char *help = {
 	"	Minions_Read 'input' - Reads the current status of the input\n\r"
 	"	Minions_Write `output` on/off - Sets the current state of the output\n\r"
 	"	Pedals_Read accel/brake - Reads the current status of the pedal\n\r"
+	"	SendTritium_Trace - Lists the latest FSM state changes and the\n\r"
+	"longest FSM iteration in each state\n\r"
+	"	SendTritium_Curve linear/progressive/aggressive - Selects the\n\r"
+	"throttle curve\n\r"
 };
 
 static inline bool isWhiteSpace(char character){
@@ -195,6 +215,12 @@ static bool cmd_CANbus_Read(void){
 		return false;
 	}
 
+	// Only one task may read each bus, and the car's tasks claim both at startup
+	if(CANbus_HasOtherReader(bus)){
+		printf("%s is already read by another task\n\r", busInput);
+		return true;
+	}
+
 	if(CANbus_Read(&msg, blocking, bus) == SUCCESS){
 		printf("msg received on %s (%s)\n\r", busInput, blockInput);
 		printf("ID: %d, Data: ", msg.ID);
@@ -207,6 +233,59 @@ static bool cmd_CANbus_Read(void){
 	return true;
 }
 
+static bool cmd_CANbus_Capture(void){
+	char *actionInput = strtok_r(NULL, " ", &save);
+	if(actionInput == NULL){
+		return false;
+	}
+
+	if(strcmp(actionInput, "start") == 0){
+		CANbus_CaptureEnable(true);
+	}
+	else if(strcmp(actionInput, "stop") == 0){
+		CANbus_CaptureEnable(false);
+	}
+	else if(strcmp(actionInput, "clear") == 0){
+		CANbus_CaptureClear();
+	}
+	else if(strcmp(actionInput, "dump") == 0){
+		uint32_t count = CANbus_CaptureDump(UART_2);
+		printf("\n\r%d frames dumped\n\r", (int)count);
+		return true;
+	}
+	else if(strcmp(actionInput, "filter") == 0){
+		char *idInput = strtok_r(NULL, " ", &save);
+		char *stateInput = strtok_r(NULL, " ", &save);
+		if(idInput == NULL || stateInput == NULL){
+			return false;
+		}
+
+		bool record;
+		if(strcmp(stateInput, "on") == 0){
+			record = true;
+		}
+		else if(strcmp(stateInput, "off") == 0){
+			record = false;
+		}
+		else{
+			return false;
+		}
+
+		if(strcmp(idInput, "all") == 0){
+			CANbus_CaptureFilterAll(record);
+		}
+		else if(CANbus_CaptureFilter((CANId_t)strtoul(idInput, NULL, 16), record) == ERROR){
+			return false;
+		}
+	}
+	else{
+		return false;
+	}
+
+	printf("capture %s\n\r", actionInput);
+	return true;
+}
+
 static bool cmd_Contactors_Get(void){
 	char *contactorInput = strtok_r(NULL, " ", &save);
 	contactor_t contactor;
@@ -347,3 +426,44 @@ static bool cmd_Pedals_Read(void){
 	printf("%s: %d\n\r", pedalInput, Pedals_Read(pedal));
 	return true;
 }
+
+static const char *TRITIUM_STATE_STRING[] = {
+	FOREACH_TritiumState(GENERATE_STRING)
+};
+
+static bool cmd_SendTritium_Trace(void){
+	static TritiumTransition_t trace[SENDTRITIUM_TRACE_DEPTH];
+	uint8_t count = SendTritium_GetTrace(trace);
+	uint32_t now = BSP_Cycles_Get();
+
+	for(uint8_t i = 0; i < count; i++){
+		printf("%d us ago: %s -> %s (inputs 0x%03x)\n\r",
+			(int)BSP_Cycles_ToMicros(now - trace[i].timestamp),
+			TRITIUM_STATE_STRING[trace[i].from], TRITIUM_STATE_STRING[trace[i].to], trace[i].inputs);
+	}
+
+	for(TritiumStateName_t state = 0; state < NUM_TRITIUM_STATES; state++){
+		printf("%s: %d cycles max\n\r", TRITIUM_STATE_STRING[state], (int)SendTritium_GetMaxCycles(state));
+	}
+	return true;
+}
+
+static const char *PEDAL_CURVE_STRING[] = {
+	FOREACH_PedalCurve(GENERATE_STRING)
+};
+
+static bool cmd_SendTritium_Curve(void){
+	char *curveInput = strtok_r(NULL, " ", &save);
+	if(curveInput == NULL){
+		return false;
+	}
+
+	for(PedalCurve_t curve = 0; curve < NUM_PEDAL_CURVES; curve++){
+		if(strcasecmp(curveInput, PEDAL_CURVE_STRING[curve]) == 0){
+			SendTritium_SetThrottleCurve(curve);
+			printf("throttle curve set to %s\n\r", PEDAL_CURVE_STRING[curve]);
+			return true;
+		}
+	}
+	return false;
+}
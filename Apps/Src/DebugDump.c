@@ -9,6 +9,8 @@
 #include <errno.h> 
 #include "Tasks.h"
 #include "SendTritium.h"
+#include "VehicleState.h"
+#include "UpdateDisplay.h"
 
 
 static const char *MINIONPIN_STRING[] = {
@@ -29,9 +31,35 @@ static const char *GEAR_STRING[] = {
 
 /*----------------------------------------------*/
 
+static const char *FILTER_TYPE_STRING[] = {"list16", "mask16", "list32", "mask32"};
+
+/**
+ * @brief Prints which IDs land in which hardware filter bank and FIFO
+ */
+static void printFilterMap(CAN_t bus, const char *name){
+    const CAN_FilterBank_t *map;
+    uint8_t banks = BSP_CAN_GetFilterMap(bus, &map);
+
+    printf("%s filters (%d banks):\n\r", name, banks);
+    for(uint8_t b = 0; b < banks; b++){
+        printf("  bank %d FIFO%d %s:", map[b].bank, map[b].fifo, FILTER_TYPE_STRING[map[b].type]);
+        for(uint8_t i = 0; i < map[b].count; i++){
+            if(map[b].type == CAN_FILTER_MASK16 || map[b].type == CAN_FILTER_MASK32){
+                printf(" 0x%03x/0x%03x", map[b].id[i], map[b].mask[i]);
+            } else {
+                printf(" 0x%03x", map[b].id[i]);
+            }
+        }
+        printf("\n\r");
+    }
+}
+
 void Task_DebugDump(void* p_arg) {
     OS_ERR err;
 
+    printFilterMap(CARCAN, "CarCAN");
+    printFilterMap(MOTORCAN, "MotorCAN");
+
     while(1){
 
         // Get pedal information
@@ -53,15 +81,41 @@ void Task_DebugDump(void* p_arg) {
             printf("%s: %s\n\r", CONTACTOR_STRING[contactor], contactorState ? "on" : "off");
         } 
 
-        // Send Tritium variables
-        printf("Cruise Enable: %s\n\r", get_cruiseEnable() ? "true" : "false");
-        printf("Cruise Set: %s\n\r", get_cruiseSet() ? "true" : "false");
-        printf("One Pedal Enable: %s\n\r", get_onePedalEnable() ? "true" : "false");
-        printf("Regen Enable: %s\n\r", get_regenEnable() ? "true" : "false");
-        printf("Pedal Brake Percent: %d\n\r", get_brakePedalPercent());
-        printf("Pedal Accel Percent: %d\n\r", get_accelPedalPercent());
-        printf("Current Gear: %s\n\r", GEAR_STRING[get_gear()]);
-        print_float("Current Setpoint: ", get_currentSetpoint());
+        // Vehicle state, each group from a single update
+        VehicleState_t vehicle;
+        VehicleState_Get(&vehicle);
+        printf("Cruise Enable: %s\n\r", vehicle.control.cruiseEnable ? "true" : "false");
+        printf("Cruise Set: %s\n\r", vehicle.control.cruiseSet ? "true" : "false");
+        printf("One Pedal Enable: %s\n\r", vehicle.control.onePedalEnable ? "true" : "false");
+        printf("Regen Enable: %s\n\r", vehicle.control.regenEnable ? "true" : "false");
+        printf("Pedal Brake Percent: %d\n\r", vehicle.control.brakePedalPercent);
+        printf("Pedal Accel Percent: %d\n\r", vehicle.control.accelPedalPercent);
+        printf("Current Gear: %s\n\r", GEAR_STRING[vehicle.control.gear]);
+        print_float("Current Setpoint: ", vehicle.control.currentSetpoint);
+        print_float("Velocity Setpoint: ", vehicle.control.velocitySetpoint);
+        print_float("Motor RPM: ", vehicle.motor.rpm);
+        print_float("Motor Velocity: ", vehicle.motor.velocity);
+        printf("SOC: %d%%, Supplemental: %d mV\n\r", (int)vehicle.battery.stateOfCharge, (int)vehicle.battery.supplementalMv);
+
+        const Periodic_t *timing = SendTritium_GetTiming();
+        printf("SendTritium: %d iterations, %d overruns, max jitter %d us, max exec %d us\n\r",
+            (int)timing->iterations, (int)timing->overruns, (int)timing->maxJitterUs, (int)timing->maxExecUs);
+
+        const BrakeLatency_t *brake = SendTritium_GetBrakeLatency();
+        printf("Brake: %d presses, current cut in %d us (max %d, %d dropped), brake state in %d us (max %d)\n\r",
+            (int)brake->presses, (int)brake->lastCutUs, (int)brake->maxCutUs, (int)brake->cutDrops,
+            (int)brake->lastStateUs, (int)brake->maxStateUs);
+
+        const UpdateDisplayStats_t *display = UpdateDisplay_GetStats();
+        printf("Display: %d bytes/s, %d frames, %d deferred, fast latency max %d ms\n\r",
+            (int)display->bytesPerSecond, (int)display->frames, (int)display->deferred,
+            (int)display->maxFastLatencyMs);
+        const DisplayStats_t *link = Display_GetStats();
+        uint32_t rejected = 0;
+        for (int e = DISPLAY_ERR_INV_INSTR; e <= DISPLAY_ERR_OTHER; e++) rejected += link->errors[e];
+        printf("Display link: %d acks, %d rejected, %d overflows, %d unanswered, %d restarts, %d busy frames, page %d\n\r",
+            (int)link->acks, (int)rejected, (int)link->errors[DISPLAY_ERR_OVERFLOW],
+            (int)link->errors[DISPLAY_ERR_NO_ACK], (int)link->restarts, (int)display->displayBusy, (int)link->page);
 
         printf("\n\r");
 
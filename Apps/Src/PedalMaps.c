@@ -0,0 +1,98 @@
+/**
+ * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
+ * @file PedalMaps.c
+ * @brief Pedal to current lookup tables.
+ *
+ * GENERATED by Scripts/pedal_maps.py from Apps/Inc/PedalMaps.h. Do not edit by hand.
+ */
+
+#include "common.h"
+#include "PedalMaps.h"
+
+#if PEDAL_MIN != 0 || PEDAL_MAX != 100 || ACCEL_PEDAL_THRESHOLD != 15 || ONEPEDAL_BRAKE_THRESHOLD != 25 || ONEPEDAL_NEUTRAL_THRESHOLD != 35 || PEDAL_MAP_ONE != 32767
+#error "PedalMaps.c is out of date, run make pedalmaps"
+#endif
+
+const int16_t PedalMap_Throttle[NUM_PEDAL_CURVES][PEDAL_MAP_SIZE] = {
+    [PEDAL_CURVE_LINEAR] = {
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,   385,   771,  1156,  1542,
+         1927,  2313,  2698,  3084,  3469,  3855,  4240,  4626,  5011,  5397,
+         5782,  6168,  6553,  6939,  7324,  7710,  8095,  8481,  8866,  9252,
+         9637, 10023, 10408, 10794, 11179, 11565, 11950, 12336, 12721, 13107,
+        13492, 13878, 14263, 14649, 15034, 15420, 15805, 16191, 16576, 16962,
+        17347, 17733, 18118, 18504, 18889, 19275, 19660, 20046, 20431, 20817,
+        21202, 21588, 21973, 22359, 22744, 23130, 23515, 23901, 24286, 24672,
+        25057, 25443, 25828, 26214, 26599, 26985, 27370, 27756, 28141, 28527,
+        28912, 29298, 29683, 30069, 30454, 30840, 31225, 31611, 31996, 32382,
+        32767,
+    },
+    [PEDAL_CURVE_PROGRESSIVE] = {
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     5,    18,    41,    73,
+          113,   163,   222,   290,   367,   454,   549,   653,   766,   889,
+         1020,  1161,  1311,  1469,  1637,  1814,  2000,  2195,  2399,  2612,
+         2835,  3066,  3306,  3556,  3814,  4082,  4358,  4644,  4939,  5243,
+         5556,  5878,  6209,  6549,  6898,  7256,  7624,  8000,  8386,  8780,
+         9184,  9597, 10018, 10449, 10889, 11338, 11796, 12263, 12739, 13225,
+        13719, 14222, 14735, 15256, 15787, 16327, 16876, 17433, 18000, 18576,
+        19161, 19755, 20359, 20971, 21592, 22223, 22862, 23511, 24168, 24835,
+        25511, 26195, 26889, 27592, 28304, 29025, 29756, 30495, 31243, 32001,
+        32767,
+    },
+    [PEDAL_CURVE_AGGRESSIVE] = {
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,   766,  1524,  2272,  3011,
+         3742,  4463,  5175,  5878,  6572,  7256,  7932,  8599,  9256,  9905,
+        10544, 11175, 11796, 12408, 13012, 13606, 14191, 14767, 15334, 15891,
+        16440, 16980, 17511, 18032, 18545, 19048, 19542, 20028, 20504, 20971,
+        21429, 21878, 22318, 22749, 23170, 23583, 23987, 24381, 24767, 25143,
+        25511, 25869, 26218, 26558, 26889, 27211, 27524, 27828, 28123, 28409,
+        28685, 28953, 29211, 29461, 29701, 29932, 30155, 30368, 30572, 30767,
+        30953, 31130, 31298, 31456, 31606, 31747, 31878, 32001, 32114, 32218,
+        32313, 32400, 32477, 32545, 32604, 32654, 32694, 32726, 32749, 32762,
+        32767,
+    },
+};
+
+const int16_t PedalMap_OnePedal[NUM_PEDAL_CURVES][PEDAL_MAP_SIZE] = {
+    [PEDAL_CURVE_LINEAR] = {
+        32767, 31456, 30146, 28835, 27524, 26214, 24903, 23592, 22282, 20971,
+        19660, 18350, 17039, 15728, 14417, 13107, 11796, 10485,  9175,  7864,
+         6553,  5243,  3932,  2621,  1311,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,   504,  1008,  1512,  2016,
+         2521,  3025,  3529,  4033,  4537,  5041,  5545,  6049,  6553,  7058,
+         7562,  8066,  8570,  9074,  9578, 10082, 10586, 11090, 11594, 12099,
+        12603, 13107, 13611, 14115, 14619, 15123, 15627, 16131, 16636, 17140,
+        17644, 18148, 18652, 19156, 19660, 20164, 20668, 21173, 21677, 22181,
+        22685, 23189, 23693, 24197, 24701, 25205, 25709, 26214, 26718, 27222,
+        27726, 28230, 28734, 29238, 29742, 30246, 30751, 31255, 31759, 32263,
+        32767,
+    },
+    [PEDAL_CURVE_PROGRESSIVE] = {
+        32767, 31456, 30146, 28835, 27524, 26214, 24903, 23592, 22282, 20971,
+        19660, 18350, 17039, 15728, 14417, 13107, 11796, 10485,  9175,  7864,
+         6553,  5243,  3932,  2621,  1311,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     8,    31,    70,   124,
+          194,   279,   380,   496,   628,   776,   938,  1117,  1311,  1520,
+         1745,  1985,  2241,  2513,  2800,  3102,  3420,  3754,  4103,  4467,
+         4847,  5243,  5654,  6080,  6522,  6980,  7453,  7942,  8446,  8965,
+         9500, 10051, 10617, 11199, 11796, 12409, 13037, 13681, 14340, 15015,
+        15705, 16411, 17132, 17869, 18621, 19389, 20172, 20971, 21785, 22615,
+        23460, 24321, 25198, 26090, 26997, 27920, 28858, 29812, 30782, 31767,
+        32767,
+    },
+    [PEDAL_CURVE_AGGRESSIVE] = {
+        32767, 31456, 30146, 28835, 27524, 26214, 24903, 23592, 22282, 20971,
+        19660, 18350, 17039, 15728, 14417, 13107, 11796, 10485,  9175,  7864,
+         6553,  5243,  3932,  2621,  1311,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,  1000,  1985,  2955,  3909,
+         4847,  5770,  6677,  7569,  8446,  9307, 10152, 10982, 11796, 12595,
+        13378, 14146, 14898, 15635, 16356, 17062, 17752, 18427, 19086, 19730,
+        20358, 20971, 21568, 22150, 22716, 23267, 23802, 24321, 24825, 25314,
+        25787, 26245, 26687, 27113, 27524, 27920, 28300, 28664, 29013, 29347,
+        29665, 29967, 30254, 30526, 30782, 31022, 31247, 31456, 31650, 31829,
+        31991, 32139, 32271, 32387, 32488, 32573, 32643, 32697, 32736, 32759,
+        32767,
+    },
+};
@@ -0,0 +1,134 @@
+/**
+ * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
+ * @file Periodic.c
+ * @brief Fixed period task loops with jitter and execution time measurement
+ *
+ */
+
+#include "Periodic.h"
+#include "Tasks.h"
+#include "BSP_Cycles.h"
+#include "os_cfg_app.h"
+
+/**
+ * @brief Adds a time to a log2 histogram
+ */
+static void record(uint32_t *hist, uint32_t *max, uint32_t us)
+{
+    uint32_t bucket = 31 - __CLZ(us | 1);
+    hist[(bucket < PERIODIC_HIST_BUCKETS) ? bucket : PERIODIC_HIST_BUCKETS - 1]++;
+    if (us > *max) *max = us;
+}
+
+void Periodic_Init(Periodic_t *p, uint32_t periodMs)
+{
+    memset(p, 0, sizeof *p);
+    p->periodTicks = (periodMs * OS_CFG_TICK_RATE_HZ) / 1000;
+    if (p->periodTicks == 0) p->periodTicks = 1;
+    p->periodCycles = p->periodTicks * (SystemCoreClock / OS_CFG_TICK_RATE_HZ); // SysTick counts core cycles
+}
+
+/**
+ * @brief Starts the first iteration
+ */
+static void first(Periodic_t *p)
+{
+    OS_ERR err;
+
+    // The first iteration is released now and sets the time base
+    BSP_Cycles_Init();
+    p->release = OSTimeGet(&err);
+    p->start = p->expectedStart = BSP_Cycles_Get();
+    p->running = true;
+    p->iterations++;
+}
+
+/**
+ * @brief Ends the current iteration and moves the release to the next one
+ */
+static void advance(Periodic_t *p)
+{
+    OS_ERR err;
+
+    record(p->execHist, &p->maxExecUs, BSP_Cycles_ToMicros(BSP_Cycles_Get() - p->start));
+
+    p->release += p->periodTicks;
+    p->expectedStart += p->periodCycles;
+
+    OS_TICK now = OSTimeGet(&err);
+    if ((int32_t)(now - p->release) >= 0) {
+        // Still running when the next iteration was due. Run it right away,
+        // but skip any releases that have passed entirely.
+        p->overruns++;
+        OS_TICK missed = (now - p->release) / p->periodTicks;
+        p->skipped += missed;
+        p->release += missed * p->periodTicks;
+        p->expectedStart += missed * p->periodCycles;
+    }
+}
+
+/**
+ * @brief Starts the iteration at the release
+ */
+static void released(Periodic_t *p)
+{
+    p->start = BSP_Cycles_Get();
+    p->iterations++;
+
+    int32_t jitter = (int32_t)(p->start - p->expectedStart);
+    record(p->jitterHist, &p->maxJitterUs, BSP_Cycles_ToMicros((jitter < 0) ? -jitter : jitter));
+}
+
+void Periodic_Wait(Periodic_t *p)
+{
+    OS_ERR err;
+
+    if (!p->running) {
+        first(p);
+        return;
+    }
+
+    advance(p);
+
+    // Wait for the absolute release tick, so a late wakeup never delays the ones after it
+    OSTimeDly(p->release, OS_OPT_TIME_MATCH, &err);
+    if (err != OS_ERR_TIME_ZERO_DLY) { // the release tick has already come
+        assertOSError(err);
+    }
+
+    released(p);
+}
+
+bool Periodic_WaitOrSignal(Periodic_t *p)
+{
+    OS_ERR err;
+
+    if (!p->running) {
+        first(p);
+        return true;
+    }
+
+    // After a signal the iteration that was running is not over yet
+    if (!p->signaled) {
+        advance(p);
+    }
+
+    OS_TICK now = OSTimeGet(&err);
+    if ((int32_t)(p->release - now) > 0) {
+        // A pend times out relative to now, not at an absolute tick, so the release can be a
+        // tick late if one passes before the pend starts. The releases after it are not affected.
+        OSTaskSemPend(p->release - now, OS_OPT_PEND_BLOCKING, NULL, &err);
+        if (err == OS_ERR_NONE) {
+            p->signaled = true;
+            p->signals++;
+            return false;
+        }
+        if (err != OS_ERR_TIMEOUT) {
+            assertOSError(err);
+        }
+    }
+
+    p->signaled = false;
+    released(p);
+    return true;
+}
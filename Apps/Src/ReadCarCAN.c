@@ -12,6 +12,7 @@
 #include "os.h"
 #include "os_cfg_app.h"
 #include "Display.h"
+#include "VehicleState.h"
 
 // Length of the array and motor PBC saturation buffers
 #define SAT_BUF_LENGTH 5
@@ -32,18 +33,10 @@
 #define ARRAY_PRECHARGE_BYPASS_DLY_TMR_TS ((PRECHARGE_ARRAY_DELAY * OS_CFG_TMR_TASK_RATE_HZ) / (1000u))
 #define MOTOR_CONTROLLER_PRECHARGE_BYPASS_DLY_TMR_TS ((PRECHARGE_PLUS_MINUS_DELAY * OS_CFG_TMR_TASK_RATE_HZ) / (1000u))
 
-// High Voltage BPS Contactor bit mapping
-#define HV_ARRAY_CONTACTOR_BIT 1 // 0b001
-#define HV_MINUS_CONTACTOR_BIT 2 // 0b010
-#define HV_PLUS_CONTACTOR_BIT 4  // 0b100
-
 // Saturation messages
 #define DISABLE_SATURATION_MSG -1
 #define ENABLE_SATURATION_MSG 1
 
-// State of Charge scalar to scale it to correct fixed point
-#define SOC_SCALER 1000000
-
 // CAN watchdog timer variable
 static OS_TMR canWatchTimer;
 
@@ -404,6 +397,65 @@ static void handler_ReadCarCAN_BPSTrip(void)
     Display_Evac(SOC, SBPV); // Display evacuation screen
 }
 
+/**
+ * @brief BPS has a fault and we need to enter fault state
+ * @param msg the BPS_TRIP message
+ */
+static void handleBPSTrip(const CANDATA_t *msg)
+{
+    // kill contactors and enter a nonrecoverable fault
+    assertReadCarCANError(READCARCAN_ERR_BPS_TRIP);
+}
+
+/**
+ * @brief Updates the contactor saturations from BPS's contactor status
+ * @param msg the BPS_CONTACTOR message
+ */
+static void handleBPSContactor(const CANDATA_t *msg)
+{
+    OS_ERR err;
+
+    OSTmrStart(&canWatchTimer, &err); // Restart CAN Watchdog timer for BPS Contactor msg
+    assertOSError(err);
+
+    // HV Plus and Minus must both be on
+    bool HVPlusMinusStatus = CAN_BPS_CONTACTOR_GetHVPlusContactor(msg->data) && CAN_BPS_CONTACTOR_GetHVMinusContactor(msg->data);
+    bool HVArrayStatus = CAN_BPS_CONTACTOR_GetArrayContactor(msg->data);
+
+    // Update HV Array and HV Plus/Minus saturations based on the respective statuses
+    HVArrayStatus ? updateHVArraySaturation(ENABLE_SATURATION_MSG) : disableArrayPrechargeBypassContactor();
+    HVPlusMinusStatus ? updateHVPlusMinusSaturation(ENABLE_SATURATION_MSG) : updateHVPlusMinusSaturation(DISABLE_SATURATION_MSG);
+}
+
+static void handleSupplementalVoltage(const CANDATA_t *msg)
+{
+    SBPV = CAN_SUPPLEMENTAL_VOLTAGE_GetVoltage(msg->data);
+    UpdateDisplay_SetSBPV(SBPV); // Receive value in mV
+    VehicleState_SetBattery(&(VehicleBattery_t){.stateOfCharge = SOC, .supplementalMv = SBPV});
+}
+
+static void handleStateOfCharge(const CANDATA_t *msg)
+{
+    SOC = CAN_STATE_OF_CHARGE_GetStateOfCharge(msg->data); // integer percent
+    UpdateDisplay_SetSOC(SOC);
+    VehicleState_SetBattery(&(VehicleBattery_t){.stateOfCharge = SOC, .supplementalMv = SBPV});
+}
+
+static void handleVoltageSummary(const CANDATA_t *msg)
+{
+    UpdateDisplay_SetBattVoltage(CAN_VOLTAGE_SUMMARY_GetPackVoltage(msg->data));
+}
+
+static void handleTemperatureSummary(const CANDATA_t *msg)
+{
+    UpdateDisplay_SetBattTemperature(CAN_TEMPERATURE_SUMMARY_GetAverageTemp(msg->data));
+}
+
+static void handleCurrentData(const CANDATA_t *msg)
+{
+    UpdateDisplay_SetBattCurrent(CAN_CURRENT_DATA_GetCurrent(msg->data));
+}
+
 void Task_ReadCarCAN(void *p_arg)
 {
     OS_ERR err;
@@ -458,78 +510,23 @@ void Task_ReadCarCAN(void *p_arg)
 
     handler_ReadCarCAN_contactorsDisable();
 
+    // Route each BPS message to its handler
+    CANbus_Subscribe(CARCAN, BPS_TRIP, CAN_HANDLER(handleBPSTrip));
+    CANbus_Subscribe(CARCAN, BPS_CONTACTOR, CAN_HANDLER(handleBPSContactor));
+    CANbus_Subscribe(CARCAN, SUPPLEMENTAL_VOLTAGE, CAN_HANDLER(handleSupplementalVoltage));
+    CANbus_Subscribe(CARCAN, STATE_OF_CHARGE, CAN_HANDLER(handleStateOfCharge));
+    CANbus_Subscribe(CARCAN, VOLTAGE_SUMMARY, CAN_HANDLER(handleVoltageSummary));
+    CANbus_Subscribe(CARCAN, TEMPERATURE_SUMMARY, CAN_HANDLER(handleTemperatureSummary));
+    CANbus_Subscribe(CARCAN, CURRENT_DATA, CAN_HANDLER(handleCurrentData));
+
     while (1)
     {
 
         updatePrechargeContactors(); // Sets array and motor controller PBC if all conditions (PBC Status, Threshold, Precharge Complete) permit
 
         // BPS sent a message
-        ErrorStatus status = CANbus_Read(&dataBuf, true, CARCAN);
-        if (status != SUCCESS)
-        {
-            continue;
-        }
-
-        switch (dataBuf.ID)
-        { // Switch case based on BPS msg received
-        case BPS_TRIP:
-        { // BPS has a fault and we need to enter fault state
-
-            // kill contactors and enter a nonrecoverable fault
-            assertReadCarCANError(READCARCAN_ERR_BPS_TRIP);
-        }
-        case BPS_CONTACTOR:
-        {
-
-            OSTmrStart(&canWatchTimer, &err); // Restart CAN Watchdog timer for BPS Contactor msg
-            assertOSError(err);
-
-            // Retrieving HV contactor statuses using bit mapping
-            // Bitwise to get HV Plus and Minus, and then &&ing to ensure both are on
-            bool HVPlusMinusStatus = (bool)((dataBuf.data[0] & HV_PLUS_CONTACTOR_BIT) && (dataBuf.data[0] & HV_MINUS_CONTACTOR_BIT));
-            // Bitwise to get HV Array
-            bool HVArrayStatus = (bool)(dataBuf.data[0] & HV_ARRAY_CONTACTOR_BIT);
-
-            // Update HV Array and HV Plus/Minus saturations based on the respective statuses
-            HVArrayStatus ? updateHVArraySaturation(ENABLE_SATURATION_MSG) : disableArrayPrechargeBypassContactor();
-            HVPlusMinusStatus ? updateHVPlusMinusSaturation(ENABLE_SATURATION_MSG) : updateHVPlusMinusSaturation(DISABLE_SATURATION_MSG);
-
-            break; // End of BPS Contactor Status Updates
-        }
-
-        case SUPPLEMENTAL_VOLTAGE:
-        {
-            SBPV = *(uint16_t *)dataBuf.data;
-            UpdateDisplay_SetSBPV(SBPV); // Receive value in mV
-            break;
-        }
-        case STATE_OF_CHARGE:
-        {
-            SOC = (*(uint32_t *)dataBuf.data) / (SOC_SCALER); // Convert to integer percent
-            UpdateDisplay_SetSOC(SOC);
-            break;
-        }
-        case VOLTAGE_SUMMARY:
-        {
-            UpdateDisplay_SetBattVoltage((*((uint32_t *)dataBuf.data)) & ~0xFF000000); // uint24_t
-            break;
-        }
-        case TEMPERATURE_SUMMARY:
-        {
-            UpdateDisplay_SetBattTemperature((*((int32_t *)dataBuf.data)) & ~0xFF000000); // uint24_t
-            break;
-        }
-        case CURRENT_DATA:
-        {
-            UpdateDisplay_SetBattCurrent((*(int32_t *)dataBuf.data)); // int32_t
-            break;
-        }
-
-        default:
-        {
-            break; // Unhandled CAN message IDs, do nothing
-        }
-        }
+        CANbus_Read(&dataBuf, true, CARCAN);
+        // Messages are handled by the subscriptions registered above
     }
 }
 
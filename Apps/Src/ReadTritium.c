@@ -7,10 +7,11 @@
 
 #include "ReadTritium.h"
 #include "CANbus.h"
+#include "CANConfig.h"
 #include "UpdateDisplay.h"
 #include "SendCarCAN.h"
+#include "VehicleState.h"
 #include "os_cfg_app.h"
-#include <string.h>
 
 // status limit flag masks
 #define MASK_MOTOR_TEMP_LIMIT (1 << 6) // check if motor temperature is limiting the motor
@@ -28,6 +29,7 @@ static float Motor_BusCurrent = 0;
 CANDATA_t motorstatusmsg = {0};
 
 static OS_TMR MotorWatchdog;
+static bool watchdogCreated = false; // the watchdog is created once the motor controller starts talking
 
 // Function prototypes
 static void assertTritiumError(tritium_error_code_t motor_err);
@@ -39,12 +41,67 @@ static void motorWatchdog(void *tmr, void *p_arg)
 	assertTritiumError(T_MOTOR_WATCHDOG_TRIP);
 }
 
+static void handleBus(const CANDATA_t *msg)
+{
+	Motor_BusVoltage = CAN_MC_BUS_GetBusVoltage(msg->data);
+	Motor_BusCurrent = CAN_MC_BUS_GetBusCurrent(msg->data);
+
+	UpdateDisplay_SetMCVoltage(Motor_BusVoltage * 10);
+	UpdateDisplay_SetMCCurrent(Motor_BusCurrent * 10);
+}
+
+static void handleStatus(const CANDATA_t *msg)
+{
+	Motor_FaultBitmap = (CAN_MOTOR_STATUS_GetErrorFlags(msg->data) & 0x1FE); // Storing error flags into Motor_FaultBitmap
+	motorstatusmsg = *msg;
+
+	assertTritiumError(Motor_FaultBitmap);
+}
+
+static void handleVelocity(const CANDATA_t *msg)
+{
+	OS_ERR err;
+
+	if (watchdogCreated)
+	{
+		OSTmrStart(&MotorWatchdog, &err); // Reset the watchdog
+		assertOSError(err);
+	}
+
+	Motor_RPM = CAN_VELOCITY_GetMotorVelocity(msg->data);
+	Motor_Velocity = CAN_VELOCITY_GetVehicleVelocity(msg->data); // m/s
+	VehicleState_SetMotor(&(VehicleMotor_t){.rpm = Motor_RPM, .velocity = Motor_Velocity});
+	float Car_Velocity = Motor_Velocity * 1000;
+
+	Car_Velocity = (Car_Velocity * 223694) / 10000000;
+
+	UpdateDisplay_SetVelocity(Car_Velocity);
+}
+
+static void handleTemperature(const CANDATA_t *msg)
+{
+	UpdateDisplay_SetHeatSinkTemp(CAN_TEMPERATURE_GetHeatsinkTemp(msg->data));
+}
+
 void Task_ReadTritium(void *p_arg)
 {
 	OS_ERR err;
 	CANDATA_t dataBuf = {0};
 
-	static bool watchdogCreated = false;
+	// Route each motor controller message to its handler
+	CANbus_Subscribe(MOTORCAN, MC_BUS, CAN_HANDLER(handleBus));
+	CANbus_Subscribe(MOTORCAN, MOTOR_STATUS, CAN_HANDLER(handleStatus));
+	CANbus_Subscribe(MOTORCAN, VELOCITY, CAN_HANDLER(handleVelocity));
+	CANbus_Subscribe(MOTORCAN, TEMPERATURE, CAN_HANDLER(handleTemperature));
+
+	// The receive interrupt stores every motor controller message in SendCarCAN's table, which
+	// forwards it onto CarCAN for telemetry within its rate limits. Only the messages subscribed
+	// to above are also read by this task.
+	for (uint8_t i = 0; i < NUM_MOTORCAN_FILTERS; i++)
+	{
+		CANId_t id = motorCANFilterList[i];
+		CANbus_GatewaySink(MOTORCAN, id, SendCarCAN_PutPtr, 1, CANbus_IsSubscribed(MOTORCAN, id));
+	}
 
 	while (1)
 	{
@@ -62,58 +119,6 @@ void Task_ReadTritium(void *p_arg)
 
 				watchdogCreated = true;
 			}
-
-			switch (dataBuf.ID)
-			{
-			case MC_BUS:
-			{
-				Motor_BusVoltage = *((float *)&dataBuf.data[0]);
-				Motor_BusCurrent = *((float *)&dataBuf.data[4]);
-
-				UpdateDisplay_SetMCVoltage(Motor_BusVoltage * 10);
-				UpdateDisplay_SetMCCurrent(Motor_BusCurrent * 10);
-			}
-			case MOTOR_STATUS:
-			{
-				// motor status error flags is in bytes 4-5
-				Motor_FaultBitmap = (*((uint16_t *)(&dataBuf.data[4])) & 0x1FE); // Storing error flags into Motor_FaultBitmap
-				motorstatusmsg = dataBuf;
-
-				assertTritiumError(Motor_FaultBitmap);
-				break;
-			}
-
-			case VELOCITY:
-			{
-				OSTmrStart(&MotorWatchdog, &err); // Reset the watchdog
-				assertOSError(err);
-				memcpy(&Motor_RPM, &dataBuf.data[0], sizeof(float));
-				memcpy(&Motor_Velocity, &dataBuf.data[4], sizeof(float));
-
-				// Motor RPM is in bytes 0-3
-				Motor_RPM = *((float *)(&dataBuf.data[0]));
-
-				// Car Velocity (in m/s) is in bytes 4-7
-				Motor_Velocity = *((float *)(&dataBuf.data[4]));
-				float Car_Velocity = Motor_Velocity * 1000;
-
-				Car_Velocity = (Car_Velocity * 223694) / 10000000;
-
-				UpdateDisplay_SetVelocity(Car_Velocity);
-			}
-
-			case TEMPERATURE:
-			{
-				UpdateDisplay_SetHeatSinkTemp(*(float *)(&dataBuf.data[4]));
-			}
-
-			default:
-			{
-				break; // for cases not handled currently
-			}
-			}
-
-			SendCarCAN_Put(dataBuf); // Forward message on CarCAN for telemetry
 		}
 	}
 }
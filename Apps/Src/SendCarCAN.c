@@ -3,14 +3,15 @@
  * @file SendCarCAN.c
  * @brief Function implementations for the SendCarCAN application.
  * 
- * This contains functions relevant to placing CAN messages in a CarCAN queue and periodically sending
- * those messages in the SendCarCAN task.
+ * This contains functions relevant to keeping the newest copy of each message to be forwarded
+ * onto CarCAN, and sending those messages at a bounded rate in the SendCarCAN task.
  * 
  */
 
 #include "common.h"
 #include "os_cfg_app.h"
 #include "CANbus.h"
+#include "CANConfig.h"
 #include "Minions.h"
 #include "Contactors.h"
 #include "Pedals.h"
@@ -19,60 +20,146 @@
 #include "SendTritium.h"
 
 #define IO_STATE_DLY_MS 250u 
+#define CAN_STATS_PERIOD 4 // in units of IO_STATE_DLY_MS
 
-#define SENDCARCAN_MSG_SKIP_CTR 3
+// The forwarding table is scanned at least this often, and whenever a new message arrives
+#define SENDCARCAN_SCAN_MS 10
+#define SENDCARCAN_SCAN_TICKS ((SENDCARCAN_SCAN_MS * OS_CFG_TICK_RATE_HZ + 999) / 1000)
+
+// Most frames per second forwarded onto CarCAN, and most that may go out back to back
+#define SENDCARCAN_MAX_FPS 200
+#define SENDCARCAN_BURST 8
+
+// Copies of fault messages that may wait to be forwarded, a power of two
+#define SENDCARCAN_FAULT_DEPTH 16
 
 // Task_PutIOState
 OS_TCB putIOState_TCB;
 CPU_STK putIOState_Stk[TASK_SEND_CAR_CAN_STACK_SIZE];
 
-//fifo
-#define FIFO_TYPE CANDATA_t
-#define FIFO_SIZE 50
-#define FIFO_NAME SendCarCAN_Q
-#include "fifo.h"
+/**
+ * Shortest time between forwards of each message in the table, in ms. Messages
+ * that are not listed are forwarded as soon as a new copy arrives and the rate
+ * budget allows. Newer copies that arrive in between replace the waiting one.
+ * Fault messages don't go through the table; see forwardEvery.
+ */
+static const uint16_t forwardPeriodMs[NUM_CAN_MSGS] = {
+    [CAN_MSG_MC_BUS] = 100,
+    [CAN_MSG_VELOCITY] = 100,
+    [CAN_MSG_MC_PHASE_CURRENT] = 200,
+    [CAN_MSG_VOLTAGE_VEC] = 200,
+    [CAN_MSG_CURRENT_VEC] = 200,
+    [CAN_MSG_BACKEMF] = 200,
+    [CAN_MSG_TEMPERATURE] = 1000,
+    [CAN_MSG_ODOMETER_AMPHOURS] = 1000,
+    [CAN_MSG_SLIP_SPEED] = 1000,
+};
+
+// Newest copy of each message waiting to be forwarded, in CANLUT (and so CAN ID) order
+typedef struct {
+    CANDATA_t msg;
+    bool dirty;         // msg has not been forwarded yet
+    OS_TICK nextSend;   // tick after which msg may be forwarded again
+} SendCarCAN_Entry_t;
+
+static SendCarCAN_Entry_t forwardTable[NUM_CAN_MSGS];
+
+/**
+ * Messages that report faults. Every copy of these is forwarded, in the order they
+ * arrived, so a fault is not replaced by a later copy that has cleared it. They
+ * go out ahead of the table and are not held back by the rate budget.
+ */
+static const bool forwardEvery[NUM_CAN_MSGS] = {
+    [CAN_MSG_MOTOR_STATUS] = true,
+};
 
-static SendCarCAN_Q_t CANFifo; 
+// Copies of fault messages waiting to be forwarded. Both counters only count up.
+static CANDATA_t faultQueue[SENDCARCAN_FAULT_DEPTH];
+static volatile uint32_t faultHead;
+static volatile uint32_t faultTail;
+static uint32_t faultDrops; // fault messages lost because faultQueue was full
+
+static uint32_t coalesced; // messages replaced by a newer copy before they were forwarded
+static uint32_t retried;   // times the transmit queue was full and forwarding was put off to the next scan
 
 static OS_SEM CarCAN_Sem4;
-static OS_MUTEX CarCAN_Mtx;
 
 static void Task_PutIOState(void *p_arg);
 
 /**
- * @brief return the space left in SendCarCAN_Q for debug purposes
+ * @brief return the number of messages waiting to be forwarded for debug purposes
 */
 #ifdef DEBUG
-uint8_t get_SendCarCAN_Q_Space(void) {
-    return (CANFifo.get - CANFifo.put - 1) % (sizeof CANFifo.buffer / sizeof CANFifo.buffer[0]);
+uint8_t get_SendCarCAN_Pending(void) {
+    uint8_t pending = (uint8_t)(faultHead - faultTail);
+    for(uint8_t i = 0; i < NUM_CAN_MSGS; i++){
+        pending += forwardTable[i].dirty;
+    }
+    return pending;
+}
+
+uint32_t get_SendCarCAN_Coalesced(void) {
+    return coalesced;
+}
+
+uint32_t get_SendCarCAN_Retried(void) {
+    return retried;
+}
+
+uint32_t get_SendCarCAN_FaultDrops(void) {
+    return faultDrops;
 }
 #endif
 
 /**
- * @brief Wrapper to put new message in the CAN queue
+ * @brief Stores a message to be forwarded, replacing any older copy that is still waiting
 */
 void SendCarCAN_Put(CANDATA_t message){
-    OS_ERR err;
-    CPU_TS ticks;
-    bool success = false;
-    
-    static uint8_t carcan_ctr = 0;
-    
-    if(carcan_ctr > SENDCARCAN_MSG_SKIP_CTR){
-        OSMutexPend(&CarCAN_Mtx, 0, OS_OPT_PEND_BLOCKING, &ticks, &err);
-        assertOSError(err);
+    SendCarCAN_PutPtr(&message);
+}
 
-        success = SendCarCAN_Q_put(&CANFifo, message);
+/**
+ * @brief Stores a message to be forwarded, replacing any older copy that is still waiting.
+ *        Fault messages are queued instead, so every copy is forwarded.
+ *        Safe to call from an interrupt, so it can be a CAN gateway sink.
+*/
+void SendCarCAN_PutPtr(const CANDATA_t *message){
+    int msgIdx = CANLUT_Index(message->ID);
+    if(msgIdx < 0){
+        return;
+    }
 
-        OSMutexPost(&CarCAN_Mtx, OS_OPT_POST_NONE, &err);
-        assertOSError(err);
+    CPU_SR_ALLOC();
+    if(forwardEvery[msgIdx]){
+        CPU_CRITICAL_ENTER();
+        bool full = (faultHead - faultTail == SENDCARCAN_FAULT_DEPTH);
+        if(full){
+            faultDrops++;
+        } else {
+            faultQueue[faultHead % SENDCARCAN_FAULT_DEPTH] = *message;
+            faultHead++;
+        }
+        CPU_CRITICAL_EXIT();
 
-        carcan_ctr = 0;
+        if(!full){
+            OS_ERR err;
+            OSSemPost(&CarCAN_Sem4, OS_OPT_POST_1, &err);
+            assertOSError(err);
+        }
+        return;
     }
-    carcan_ctr++;
 
+    SendCarCAN_Entry_t *entry = &forwardTable[msgIdx];
+    CPU_CRITICAL_ENTER(); // short copy, cheaper than a mutex
+    bool wasDirty = entry->dirty;
+    entry->msg = *message;
+    entry->dirty = true;
+    if(wasDirty) coalesced++;
+    CPU_CRITICAL_EXIT();
 
-    if(success) {
+    // Only wake the task for a new entry; a replaced one is already waiting
+    if(!wasDirty) {
+        OS_ERR err;
         OSSemPost(&CarCAN_Sem4, OS_OPT_POST_1, &err);
         assertOSError(err);
     }
@@ -83,26 +170,78 @@ void SendCarCAN_Put(CANDATA_t message){
 */
 void SendCarCAN_Init(void) {
     OS_ERR err;
-    
-    OSMutexCreate(&CarCAN_Mtx, "CarCAN_Mtx", &err);
-    assertOSError(err);
-    
+
     OSSemCreate(&CarCAN_Sem4, "CarCAN_Sem4", 0, &err);
     assertOSError(err);
 
-    SendCarCAN_Q_renew(&CANFifo);
+    memset(forwardTable, 0, sizeof forwardTable);
+    coalesced = 0;
+    retried = 0;
+    faultHead = faultTail = 0;
+    faultDrops = 0;
+}
+
+/**
+ * @brief Forwards the waiting fault messages, oldest first. One that doesn't fit in the
+ *        transmit queue stays at the front and is retried at the next scan.
+ * @param tokens frames that may still be sent, scaled by OS_CFG_TICK_RATE_HZ
+ * @return tokens left, after the faults forwarded were charged against them
+*/
+static uint32_t forwardFaults(uint32_t tokens){
+    while(faultTail != faultHead){
+        if(CANbus_SendPtr(&faultQueue[faultTail % SENDCARCAN_FAULT_DEPTH], CAN_NON_BLOCKING, CARCAN) == ERROR){
+            retried++;
+            break;
+        }
+        faultTail++; // only the task moves the tail, and the interrupt only reads it
+        tokens = (tokens > OS_CFG_TICK_RATE_HZ) ? tokens - OS_CFG_TICK_RATE_HZ : 0;
+    }
+    return tokens;
+}
+
+/**
+ * @brief Forwards waiting messages in priority order, as far as their rate budgets allow
+ * @param now current tick
+ * @param tokens frames that may still be sent, scaled by OS_CFG_TICK_RATE_HZ
+ * @return tokens left
+*/
+static uint32_t forwardPending(OS_TICK now, uint32_t tokens){
+    for(uint8_t i = 0; i < NUM_CAN_MSGS && tokens >= OS_CFG_TICK_RATE_HZ; i++){
+        SendCarCAN_Entry_t *entry = &forwardTable[i];
+        if(!entry->dirty || (int32_t)(now - entry->nextSend) < 0){
+            continue;
+        }
+
+        CANDATA_t message;
+        CPU_SR_ALLOC();
+        CPU_CRITICAL_ENTER();
+        message = entry->msg;
+        entry->dirty = false;
+        CPU_CRITICAL_EXIT();
+
+        if(CANbus_SendPtr(&message, CAN_NON_BLOCKING, CARCAN) == ERROR){
+            // The transmit queue is full of more important frames. Keep the message for the
+            // next scan instead of losing it, unless a newer copy has already replaced it.
+            CPU_CRITICAL_ENTER();
+            entry->dirty = true;
+            CPU_CRITICAL_EXIT();
+            retried++;
+            break;
+        }
+        entry->nextSend = now + ((OS_TICK)forwardPeriodMs[i] * OS_CFG_TICK_RATE_HZ) / 1000;
+        tokens -= OS_CFG_TICK_RATE_HZ;
+    }
+    return tokens;
 }
 
 /**
- * @brief Grabs the latest messages from the queue and sends over CarCAN
+ * @brief Forwards the newest copy of each waiting message over CarCAN, in CAN ID order,
+ *        limited per message by forwardPeriodMs and overall by SENDCARCAN_MAX_FPS
 */
 void Task_SendCarCAN(void *p_arg){
     OS_ERR err;
     CPU_TS ticks;
 
-    CANDATA_t message;
-    memset(&message, 0, sizeof message);
-
     // PutIOState
     OSTaskCreate(
         (OS_TCB*)&putIOState_TCB,
@@ -121,21 +260,25 @@ void Task_SendCarCAN(void *p_arg){
     );
     assertOSError(err);
 
-    while (1) {
-          
-        // Check if there's something to send in the queue (either IOState or Car state from sendTritium)
-        OSSemPend(&CarCAN_Sem4, 0, OS_OPT_PEND_BLOCKING, &ticks, &err);
-        assertOSError(err);
+    // Token bucket for the overall rate: each tick adds SENDCARCAN_MAX_FPS, each frame costs OS_CFG_TICK_RATE_HZ
+    const uint32_t maxTokens = SENDCARCAN_BURST * OS_CFG_TICK_RATE_HZ;
+    uint32_t tokens = maxTokens;
+    OS_TICK last = OSTimeGet(&err);
 
-        OSMutexPend(&CarCAN_Mtx, 0, OS_OPT_PEND_BLOCKING, &ticks, &err);
-        assertOSError(err);
-    
-        bool res = SendCarCAN_Q_get(&CANFifo, &message);
+    while (1) {
+        // Wake up for new messages, or to retry ones that were held back by their rate budget
+        OSSemPend(&CarCAN_Sem4, SENDCARCAN_SCAN_TICKS, OS_OPT_PEND_BLOCKING, &ticks, &err);
+        if(err != OS_ERR_TIMEOUT){
+            assertOSError(err);
+        }
 
-        OSMutexPost(&CarCAN_Mtx, OS_OPT_POST_NONE, &err);
-        assertOSError(err);
+        OS_TICK now = OSTimeGet(&err);
+        uint32_t refill = (now - last) * SENDCARCAN_MAX_FPS;
+        tokens = (refill >= maxTokens - tokens) ? maxTokens : tokens + refill;
+        last = now;
 
-        if(res) CANbus_Send(message, true, CARCAN);
+        tokens = forwardFaults(tokens);
+        tokens = forwardPending(now, tokens);
     }
 }
 
@@ -144,35 +287,49 @@ static void putIOState(void){
     memset(&message, 0, sizeof message);
     message.ID = IO_STATE;
     
+    CAN_IO_STATE_t io = {0};
+
     // Get pedal information
-    message.data[0] = Pedals_Read(ACCELERATOR);
-    message.data[1] = Pedals_Read(BRAKE);
+    io.AccelPedal = Pedals_Read(ACCELERATOR);
+    io.BrakePedal = Pedals_Read(BRAKE);
 
     // Get minion information
     for(pin_t pin = 0; pin < NUM_PINS; pin++){
         bool pinState = Minions_Read(pin);
-        message.data[2] |= pinState << pin;
+        io.Switches |= pinState << pin;
     }
     
     // Get contactor info
     for(contactor_t contactor = 0; contactor < NUM_CONTACTORS; contactor++){
         bool contactorState = (Contactors_Get(contactor) == ON) ? true : false;
-        message.data[3] |= contactorState << contactor;
+        io.Contactors |= contactorState << contactor;
     }
 
     // Tell BPS if the array contactor should be on
-    message.data[3] |= (Minions_Read(IGN_1) || Minions_Read(IGN_2)) << 2;
+    io.Contactors |= (Minions_Read(IGN_1) || Minions_Read(IGN_2)) << 2;
+
+    CAN_IO_STATE_Pack(message.data, &io);
 
     CANbus_Send(message, true, CARCAN);
 }
 
 /**
- * @brief sends IO information over CarCAN every IO_STATE_DLY_MS
+ * @brief sends IO information over CarCAN every IO_STATE_DLY_MS, and CAN bus statistics every CAN_STATS_PERIOD of those
 */
 static void Task_PutIOState(void *p_arg) {
     OS_ERR err;
+    uint8_t statsCtr = 0;
     while (1) {
         putIOState();
+
+        // Report CAN bus health so message rates can be tuned against measured load
+        if(++statsCtr >= CAN_STATS_PERIOD){
+            CANDATA_t stats;
+            CANbus_GetDiagnostics(&stats);
+            CANbus_Send(stats, CAN_NON_BLOCKING, CARCAN);
+            statsCtr = 0;
+        }
+
         OSTimeDlyHMSM(0, 0, 0, IO_STATE_DLY_MS, OS_OPT_TIME_HMSM_STRICT, &err);
         assertOSError(err);
     }  
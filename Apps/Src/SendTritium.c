@@ -19,11 +19,14 @@
 #include "ReadCarCAN.h"
 #include "Minions.h"
 #include "SendTritium.h"
+#include "PedalMaps.h"
+#include "VehicleState.h"
 #include "ReadTritium.h"
 #include "SendCarCAN.h"
 #include "CANbus.h"
 #include "UpdateDisplay.h"
 #include "CANConfig.h"
+#include "BSP_Cycles.h"
 #include "common.h"
 
 // Macros
@@ -33,17 +36,9 @@
 #define MAX_GEARSWITCH_VELOCITY mpsToRpm(8.0f) // rpm
 
 #define BRAKE_PEDAL_THRESHOLD 50 // percent
-#define ACCEL_PEDAL_THRESHOLD 15 // percent
+// The accelerator thresholds are in PedalMaps.h, since the pedal maps are generated from them
 
-#define ONEPEDAL_BRAKE_THRESHOLD 25   // percent
-#define ONEPEDAL_NEUTRAL_THRESHOLD 35 // percent
-
-#define PEDAL_MIN 0        // percent
-#define PEDAL_MAX 100      // percent
-#define CURRENT_SP_MIN 0   // percent
-#define CURRENT_SP_MAX 100 // percent
-
-#define GEAR_FAULT_THRESHOLD 3 // number of times gear fault can occur before it is considered a fault
+#define GEAR_FAULT_THRESHOLD (300 / FSM_PERIOD)       // number of times gear fault can occur before it is considered a fault
 
 // Inputs
 static bool cruiseEnable = false;
@@ -65,9 +60,21 @@ float busCurrentSetPoint = 69.0f; // why is this float and not int?
 // Current observed velocity
 static float velocityObserved = 0;
 
+// Pedal map used while driving forward
+static PedalCurve_t throttleCurve = PEDAL_CURVE_LINEAR;
+
 // Counter for sending setpoints to motor
 static uint8_t motorMsgCounter = 0;
 
+// Loop timing
+static Periodic_t timing;
+
+// Set by the brake interrupt once it has cut the current, cleared at the start of each period
+static volatile bool brakeCut = false;
+
+// Brake press to current cut
+static BrakeLatency_t brakeLatency;
+
 // Debouncing counters
 // static uint8_t onePedalCounter = 0;
 // static uint8_t cruiseEnableCounter = 0;
@@ -81,8 +88,8 @@ static bool cruiseEnableButton = false;
 static bool cruiseEnablePrevious = false;
 
 // FSM
-static TritiumState_t prevState; // Previous state
-static TritiumState_t state;     // Current state
+static TritiumStateName_t prevState; // Previous state
+static TritiumStateName_t state;     // Current state
 
 // Getter functions for local variables in SendTritium.c
 GETTER(bool, cruiseEnable)
@@ -92,7 +99,6 @@ GETTER(bool, regenEnable)
 GETTER(uint8_t, brakePedalPercent)
 GETTER(uint8_t, accelPedalPercent)
 GETTER(Gear_t, gear)
-GETTER(TritiumState_t, state)
 GETTER(float, velocityObserved)
 GETTER(float, cruiseVelSetpoint)
 GETTER(float, currentSetpoint)
@@ -107,95 +113,60 @@ SETTER(bool, regenEnable)
 SETTER(uint8_t, brakePedalPercent)
 SETTER(uint8_t, accelPedalPercent)
 SETTER(Gear_t, gear)
-SETTER(TritiumState_t, state)
 SETTER(float, velocityObserved)
 SETTER(float, cruiseVelSetpoint)
 SETTER(float, currentSetpoint)
 SETTER(float, velocitySetpoint)
 #endif
 
-// Handler & Decider Declarations
+// Handler Declarations
 static void ForwardDriveHandler(void);
-static void ForwardDriveDecider(void);
 static void NeutralDriveHandler(void);
-static void NeutralDriveDecider(void);
 static void ReverseDriveHandler(void);
-static void ReverseDriveDecider(void);
 static void RecordVelocityHandler(void);
-static void RecordVelocityDecider(void);
 static void PoweredCruiseHandler(void);
-static void PoweredCruiseDecider(void);
 static void CoastingCruiseHandler(void);
-static void CoastingCruiseDecider(void);
 static void BrakeHandler(void);
-static void BrakeDecider(void);
 static void OnePedalDriveHandler(void);
-static void OnePedalDriveDecider(void);
 static void AccelerateCruiseHandler(void);
-static void AccelerateCruiseDecider(void);
 
 // FSM
-static const TritiumState_t FSM[9] = {
-    {FORWARD_DRIVE, &ForwardDriveHandler, &ForwardDriveDecider},
-    {NEUTRAL_DRIVE, &NeutralDriveHandler, &NeutralDriveDecider},
-    {REVERSE_DRIVE, &ReverseDriveHandler, &ReverseDriveDecider},
-    {RECORD_VELOCITY, &RecordVelocityHandler, &RecordVelocityDecider},
-    {POWERED_CRUISE, &PoweredCruiseHandler, &PoweredCruiseDecider},
-    {COASTING_CRUISE, &CoastingCruiseHandler, &CoastingCruiseDecider},
-    {BRAKE_STATE, &BrakeHandler, &BrakeDecider},
-    {ONEPEDAL, &OnePedalDriveHandler, &OnePedalDriveDecider},
-    {ACCELERATE_CRUISE, &AccelerateCruiseHandler, &AccelerateCruiseDecider}};
+static const TritiumState_t FSM[NUM_TRITIUM_STATES] = {
+    {FORWARD_DRIVE, &ForwardDriveHandler},
+    {NEUTRAL_DRIVE, &NeutralDriveHandler},
+    {REVERSE_DRIVE, &ReverseDriveHandler},
+    {RECORD_VELOCITY, &RecordVelocityHandler},
+    {POWERED_CRUISE, &PoweredCruiseHandler},
+    {COASTING_CRUISE, &CoastingCruiseHandler},
+    {BRAKE_STATE, &BrakeHandler},
+    {ONEPEDAL, &OnePedalDriveHandler},
+    {ACCELERATE_CRUISE, &AccelerateCruiseHandler}};
+
+// The state is kept as an index into FSM, but exposed as the whole state
+TritiumState_t get_state(void){
+    return FSM[state];
+}
+
+#ifdef SENDTRITIUM_EXPOSE_VARS
+void set_state(TritiumState_t val){
+    state = val.name;
+}
+#endif
 
 // Helper Functions
 
 #ifdef SENDTRITIUM_PRINT_MES
+static const char *STATE_STRING[] = {
+    FOREACH_TritiumState(GENERATE_STRING)
+};
+
 /**
  * @brief Dumps info to UART during testing
  */
-static void getName(char *nameStr, uint8_t stateNameNum)
-{
-    switch (stateNameNum)
-    {
-    case FORWARD_DRIVE:
-        strcpy(nameStr, "FORWARD_DRIVE");
-        break;
-    case NEUTRAL_DRIVE:
-        strcpy(nameStr, "NEUTRAL_DRIVE");
-        break;
-    case REVERSE_DRIVE:
-        strcpy(nameStr, "REVERSE_DRIVE");
-        break;
-    case RECORD_VELOCITY:
-        strcpy(nameStr, "RECORD_VELOCITY");
-        break;
-    case POWERED_CRUISE:
-        strcpy(nameStr, "POWERED_CRUISE");
-        break;
-    case COASTING_CRUISE:
-        strcpy(nameStr, "COASTING_CRUISE");
-        break;
-    case BRAKE_STATE:
-        strcpy(nameStr, "BRAKE_STATE");
-        break;
-    case ONEPEDAL:
-        strcpy(nameStr, "ONEPEDAL");
-        break;
-    case ACCELERATE_CRUISE:
-        strcpy(nameStr, "ACCELERATE_CRUISE");
-        break;
-    default:
-        strcpy(nameStr, "UNKNOWN");
-        break;
-    }
-    return;
-}
-
 static void dumpInfo()
 {
     printf("-------------------\n\r");
-    char stateName[20];
-    getName(stateName, state.name);
-    printf("State: %s\n\r", stateName);
+    printf("State: %s\n\r", STATE_STRING[state]);
     printf("cruiseEnable: %d\n\r", cruiseEnable);
     printf("cruiseSet: %d\n\r", cruiseSet);
     printf("onePedalEnable: %d\n\r", onePedalEnable);
@@ -216,28 +187,8 @@ static void dumpInfo()
 static void readInputs()
 {
 
-    // Update pedals
-    static uint32_t brakeSaturationCt = 0;
-
-    uint32_t latest_pedal = Pedals_Read(BRAKE);
-
-    if (brakeSaturationCt < 3)
-    {
-        if (latest_pedal == 100)
-            brakeSaturationCt++;
-        else if (latest_pedal == 0 && brakeSaturationCt != 0)
-            brakeSaturationCt--;
-
-        brakePedalPercent = 0;
-    }
-    else if (brakeSaturationCt >= 3)
-    {
-        brakePedalPercent = 100;
-
-        if (latest_pedal == 0)
-            brakeSaturationCt = 0;
-    }
-
+    // Update pedals. The brake is already debounced by the Pedals driver.
+    brakePedalPercent = Pedals_Read(BRAKE);
     accelPedalPercent = Pedals_Read(ACCELERATOR);
 
     // Update regen enable
@@ -268,7 +219,7 @@ static void readInputs()
     {
         // Fault behavior
         if (gearFaultCnt > GEAR_FAULT_THRESHOLD)
-            state = FSM[NEUTRAL_DRIVE];
+            state = NEUTRAL_DRIVE;
         else
             gearFaultCnt++;
     }
@@ -323,42 +274,17 @@ static void readInputs()
 #endif
 
 /**
- * @brief Linearly map range of integers to another range of integers, and provide the pecentage result.
- * in_min to in_max is mapped to out_min to out_max.
- * @param input input integer value
- * @param in_min minimum value of input range
- * @param in_max maximum value of input range
- * @param out_min minimum value of output range
- * @param out_max maximum value of output range
- * @returns float value from (out_min / 100.0) to (out_max / 100.0)
+ * @brief Selects the throttle curve for forward drive, accelerate cruise and one pedal drive.
+ * Reverse always uses the linear curve.
+ * @param curve the curve
  */
-float mapToPercent(uint8_t input, uint8_t in_min, uint8_t in_max, uint8_t out_min, uint8_t out_max)
+void SendTritium_SetThrottleCurve(PedalCurve_t curve)
 {
-    if (in_min >= in_max)
-        in_max = in_min; // The minimum of the input range should never be greater than the maximum of the input range
-
-    if (input <= in_min)
-    {
-        // Lower bound the input to the minimum possible output
-        return out_min / 100.0;
-    }
-    else if (input >= in_max)
-    {
-        // Upper bound the input to the maximum output
-        return out_max / 100.0;
-    }
-    else
-    {
-        // Linear mapping between ranges
-        uint8_t offset_in = input - in_min;    // If input went from A -> B, it now goes from 0 -> B-A
-        uint8_t in_range = in_max - in_min;    // Input range
-        uint8_t out_range = out_max - out_min; // Output range
-        uint8_t offset_out = out_min;
-        return ((offset_in * out_range) / in_range + offset_out) / 100.0; // slope = out_range/in_range. y=mx+b so output=slope*offset_in+offset_out
-    }
+    if (curve < NUM_PEDAL_CURVES)
+        throttleCurve = curve;
 }
 
-// State Handlers & Deciders
+// State Handlers
 
 /**
  * @brief Forward Drive State Handler. Accelerator is mapped directly
@@ -366,37 +292,13 @@ float mapToPercent(uint8_t input, uint8_t in_min, uint8_t in_max, uint8_t out_mi
  */
 static void ForwardDriveHandler()
 {
-    if (prevState.name != state.name)
+    if (prevState != state)
     {
         UpdateDisplay_SetCruiseState(DISP_DISABLED);
         UpdateDisplay_SetRegenState(DISP_DISABLED);
     }
     velocitySetpoint = MAX_VELOCITY;
-    currentSetpoint = mapToPercent(accelPedalPercent, ACCEL_PEDAL_THRESHOLD, PEDAL_MAX, CURRENT_SP_MIN, CURRENT_SP_MAX);
-}
-
-/**
- * @brief Forward Drive State Decider. Determines transitions out of
- * forward drive state (brake, record velocity, one pedal, neutral drive).
- */
-static void ForwardDriveDecider()
-{
-    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
-    {
-        state = FSM[BRAKE_STATE];
-    }
-    else if (cruiseSet && cruiseEnable && velocityObserved >= MIN_CRUISE_VELOCITY)
-    {
-        state = FSM[RECORD_VELOCITY];
-    }
-    else if (onePedalEnable)
-    {
-        state = FSM[ONEPEDAL];
-    }
-    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
-    {
-        state = FSM[NEUTRAL_DRIVE];
-    }
+    currentSetpoint = PedalMap_Lookup(PedalMap_Throttle[throttleCurve], accelPedalPercent);
 }
 
 /**
@@ -404,7 +306,7 @@ static void ForwardDriveDecider()
  */
 static void NeutralDriveHandler()
 {
-    if (prevState.name != state.name)
+    if (prevState != state)
     {
         UpdateDisplay_SetCruiseState(DISP_DISABLED);
         UpdateDisplay_SetRegenState(DISP_DISABLED);
@@ -416,66 +318,30 @@ static void NeutralDriveHandler()
     onePedalEnable = false;
 }
 
-/**
- * @brief Neutral Drive State Decider. Determines transitions out of
- * neutral drive state (brake, forward drive, reverse drive).
- */
-static void NeutralDriveDecider()
-{
-    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
-    {
-        state = FSM[BRAKE_STATE];
-    }
-    else if (gear == FORWARD_GEAR)
-    {
-        state = FSM[FORWARD_DRIVE];
-    }
-    else if (gear == REVERSE_GEAR)
-    {
-        state = FSM[REVERSE_DRIVE];
-    }
-}
-
 /**
  * @brief Reverse Drive State Handler. Accelerator is mapped directly to
  * current setpoint (at negative velocity).
  */
 static void ReverseDriveHandler()
 {
-    if (prevState.name != state.name)
+    if (prevState != state)
     {
         UpdateDisplay_SetCruiseState(DISP_DISABLED);
         UpdateDisplay_SetRegenState(DISP_DISABLED);
     }
     velocitySetpoint = -MAX_VELOCITY;
-    currentSetpoint = mapToPercent(accelPedalPercent, ACCEL_PEDAL_THRESHOLD, PEDAL_MAX, CURRENT_SP_MIN, CURRENT_SP_MAX);
+    currentSetpoint = PedalMap_Lookup(PedalMap_Throttle[PEDAL_CURVE_LINEAR], accelPedalPercent);
     cruiseEnable = false;
     onePedalEnable = false;
 }
 
-/**
- * @brief Reverse Drive State Decider. Determines transitions out of
- * reverse drive state (brake, neutral drive).
- */
-static void ReverseDriveDecider()
-{
-    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
-    {
-        state = FSM[BRAKE_STATE];
-    }
-    else if (gear == NEUTRAL_GEAR || gear == FORWARD_GEAR)
-    {
-        state = FSM[NEUTRAL_DRIVE];
-    }
-}
-
 /**
  * @brief Record Velocity State. While pressing the cruise set button,
  * the car will record the observed velocity into velocitySetpoint.
  */
 static void RecordVelocityHandler()
 {
-    if (prevState.name != state.name)
+    if (prevState != state)
     {
         UpdateDisplay_SetCruiseState(DISP_ACTIVE);
         UpdateDisplay_SetRegenState(DISP_DISABLED);
@@ -486,35 +352,6 @@ static void RecordVelocityHandler()
     cruiseVelSetpoint = velocityObserved;
 }
 
-/**
- * @brief Record Velocity State Decider. Determines transitions out of record velocity
- * state (brake, neutral drive, one pedal, forward drive, powered cruise).
- */
-static void RecordVelocityDecider()
-{
-    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
-    {
-        state = FSM[BRAKE_STATE];
-    }
-    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
-    {
-        state = FSM[NEUTRAL_DRIVE];
-    }
-    else if (onePedalEnable)
-    {
-        cruiseEnable = false;
-        state = FSM[ONEPEDAL];
-    }
-    else if (!cruiseEnable)
-    {
-        state = FSM[FORWARD_DRIVE];
-    }
-    else if (cruiseEnable && !cruiseSet)
-    {
-        state = FSM[POWERED_CRUISE];
-    }
-}
-
 /**
  * @brief Powered Cruise State. Continue to travel at the recorded velocity as long as
  * Observed Velocity <= Velocity Setpoint
@@ -525,44 +362,6 @@ static void PoweredCruiseHandler()
     currentSetpoint = 1.0f;
 }
 
-/**
- * @brief Powered Cruise State Decider. Determines transitions out of powered
- * cruise state (brake, neutral drive, one pedal, forward drive, record velocity,
- * accelerate cruise, coasting cruise).
- */
-static void PoweredCruiseDecider()
-{
-    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
-    {
-        state = FSM[BRAKE_STATE];
-    }
-    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
-    {
-        state = FSM[NEUTRAL_DRIVE];
-    }
-    else if (onePedalEnable)
-    {
-        cruiseEnable = false;
-        state = FSM[ONEPEDAL];
-    }
-    else if (!cruiseEnable)
-    {
-        state = FSM[FORWARD_DRIVE];
-    }
-    else if (cruiseSet && velocityObserved >= MIN_CRUISE_VELOCITY)
-    {
-        state = FSM[RECORD_VELOCITY];
-    }
-    else if (accelPedalPercent >= ACCEL_PEDAL_THRESHOLD)
-    {
-        state = FSM[ACCELERATE_CRUISE];
-    }
-    else if (velocityObserved > cruiseVelSetpoint)
-    {
-        state = FSM[COASTING_CRUISE];
-    }
-}
-
 /**
  * @brief Coasting Cruise State. We do not want to utilize motor braking
  * in cruise control mode due to safety issues. Coast the motor (go into neutral)
@@ -574,44 +373,6 @@ static void CoastingCruiseHandler()
     currentSetpoint = 0;
 }
 
-/**
- * @brief Coasting Cruise State Decider. Determines transitions out of coasting
- * cruise state (brake, neutral drive, one pedal, forward drive, record velocity,
- * accelerate cruise, powered cruise).
- */
-static void CoastingCruiseDecider()
-{
-    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
-    {
-        state = FSM[BRAKE_STATE];
-    }
-    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
-    {
-        state = FSM[NEUTRAL_DRIVE];
-    }
-    else if (onePedalEnable)
-    {
-        cruiseEnable = false;
-        state = FSM[ONEPEDAL];
-    }
-    else if (!cruiseEnable)
-    {
-        state = FSM[FORWARD_DRIVE];
-    }
-    else if (cruiseSet && velocityObserved >= MIN_CRUISE_VELOCITY)
-    {
-        state = FSM[RECORD_VELOCITY];
-    }
-    else if (accelPedalPercent >= ACCEL_PEDAL_THRESHOLD)
-    {
-        state = FSM[ACCELERATE_CRUISE];
-    }
-    else if (velocityObserved <= cruiseVelSetpoint)
-    {
-        state = FSM[POWERED_CRUISE];
-    }
-}
-
 /**
  * @brief Accelerate Cruise State. In the event that the driver needs to accelerate in cruise
  * mode, we will accelerate to the pedal percentage. Upon release of the accelerator
@@ -620,41 +381,7 @@ static void CoastingCruiseDecider()
 static void AccelerateCruiseHandler()
 {
     velocitySetpoint = MAX_VELOCITY;
-    currentSetpoint = mapToPercent(accelPedalPercent, ACCEL_PEDAL_THRESHOLD, PEDAL_MAX, CURRENT_SP_MIN, CURRENT_SP_MAX);
-}
-
-/**
- * @brief Accelerate Cruise State Decider. Determines transitions out of accelerate
- * cruise state (brake, neutral drive, one pedal, forward drive, record velocity,
- * coasting cruise).
- */
-static void AccelerateCruiseDecider()
-{
-    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
-    {
-        state = FSM[BRAKE_STATE];
-    }
-    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
-    {
-        state = FSM[NEUTRAL_DRIVE];
-    }
-    else if (onePedalEnable)
-    {
-        cruiseEnable = false;
-        state = FSM[ONEPEDAL];
-    }
-    else if (!cruiseEnable)
-    {
-        state = FSM[FORWARD_DRIVE];
-    }
-    else if (cruiseSet && velocityObserved >= MIN_CRUISE_VELOCITY)
-    {
-        state = FSM[RECORD_VELOCITY];
-    }
-    else if (accelPedalPercent < ACCEL_PEDAL_THRESHOLD)
-    {
-        state = FSM[COASTING_CRUISE];
-    }
+    currentSetpoint = PedalMap_Lookup(PedalMap_Throttle[throttleCurve], accelPedalPercent);
 }
 
 /**
@@ -665,7 +392,7 @@ static void AccelerateCruiseDecider()
  */
 static void OnePedalDriveHandler()
 {
-    if (prevState.name != state.name)
+    if (prevState != state)
     {
         UpdateDisplay_SetCruiseState(DISP_DISABLED);
     }
@@ -673,7 +400,7 @@ static void OnePedalDriveHandler()
     {
         // Regen brake: Map 0 -> brake to 100 -> 0
         velocitySetpoint = 0;
-        currentSetpoint = mapToPercent(accelPedalPercent, PEDAL_MIN, ONEPEDAL_BRAKE_THRESHOLD, CURRENT_SP_MAX, CURRENT_SP_MIN);
+        currentSetpoint = PedalMap_Lookup(PedalMap_OnePedal[throttleCurve], accelPedalPercent);
         Minions_Write(BRAKELIGHT, true);
         UpdateDisplay_SetRegenState(DISP_ACTIVE);
     }
@@ -689,34 +416,12 @@ static void OnePedalDriveHandler()
     {
         // Accelerate: Map neutral -> 100 to 0 -> 100
         velocitySetpoint = MAX_VELOCITY;
-        currentSetpoint = mapToPercent(accelPedalPercent, ONEPEDAL_NEUTRAL_THRESHOLD, PEDAL_MAX, CURRENT_SP_MIN, CURRENT_SP_MAX);
+        currentSetpoint = PedalMap_Lookup(PedalMap_OnePedal[throttleCurve], accelPedalPercent);
         Minions_Write(BRAKELIGHT, false);
         UpdateDisplay_SetRegenState(DISP_ENABLED);
     }
 }
 
-/**
- * @brief One Pedal Drive State Decider. Determines transitions out of one pedal
- * drive state (brake, record velocity, neutral drive).
- */
-static void OnePedalDriveDecider()
-{
-    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
-    {
-        state = FSM[BRAKE_STATE];
-    }
-    else if (cruiseSet && cruiseEnable && velocityObserved >= MIN_CRUISE_VELOCITY)
-    {
-        state = FSM[RECORD_VELOCITY];
-        Minions_Write(BRAKELIGHT, false);
-    }
-    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
-    {
-        state = FSM[NEUTRAL_DRIVE];
-        Minions_Write(BRAKELIGHT, false);
-    }
-}
-
 /**
  * @brief Brake State. When brake pedal is pressed, physical brakes will be active.
  * Put motor in neutral to prevent motor braking while physical brakes are engaged.
@@ -724,7 +429,7 @@ static void OnePedalDriveDecider()
  */
 static void BrakeHandler()
 {
-    if (prevState.name != state.name)
+    if (prevState != state)
     {
         UpdateDisplay_SetCruiseState(DISP_DISABLED);
         UpdateDisplay_SetRegenState(DISP_DISABLED);
@@ -739,35 +444,265 @@ static void BrakeHandler()
     UpdateDisplay_SetBrake(true);
 }
 
+// Transitions
+
+/**
+ * Inputs the transitions depend on. Each is evaluated once per iteration
+ * into one bit of a mask, after the state handler and readInputs have run.
+ */
+enum {
+    IN_BRAKE,           // brake pedal pressed
+    IN_FORWARD,         // forward gear selected
+    IN_REVERSE,         // reverse gear selected (neither means neutral)
+    IN_ONEPEDAL,        // one pedal drive enabled
+    IN_CRUISE_EN,       // cruise control enabled
+    IN_CRUISE_SET,      // cruise set button held
+    IN_CRUISE_VEL,      // fast enough to record a cruise velocity
+    IN_ACCEL,           // accelerator pressed
+    IN_OVER_CRUISE,     // faster than the cruise velocity setpoint
+    NUM_INPUTS
+};
+#define IN(input) (1 << IN_##input)
+
+// Side effects of a transition
+#define DO_CRUISE_OFF       0x1 // disable cruise control
+#define DO_BRAKELIGHT_OFF   0x2
+#define DO_BRAKE_RELEASE    0x4 // clear the brake indicator on the display
+
+typedef struct {
+    uint8_t from;
+    uint8_t to;
+    uint8_t actions;
+    uint16_t mask;      // inputs the guard looks at
+    uint16_t value;     // the values they must have
+} Transition_t;
+
+/**
+ * Transition table. A transition is taken when every input in set is true and every
+ * input in clear is false. A state's transitions are checked in the order listed here
+ * and the first one that matches is taken; if none matches, the state is kept.
+ */
+#define T(from, to, set, clear, actions) {from, to, actions, (set) | (clear), (set)}
+static const Transition_t transitions[] = {
+    //  from               to                 set                                              clear           actions
+    T(FORWARD_DRIVE,     BRAKE_STATE,       IN(BRAKE),                                         0,              0),
+    T(FORWARD_DRIVE,     RECORD_VELOCITY,   IN(CRUISE_SET) | IN(CRUISE_EN) | IN(CRUISE_VEL),   0,              0),
+    T(FORWARD_DRIVE,     ONEPEDAL,          IN(ONEPEDAL),                                      0,              0),
+    T(FORWARD_DRIVE,     NEUTRAL_DRIVE,     0,                                                 IN(FORWARD),    0),
+
+    T(NEUTRAL_DRIVE,     BRAKE_STATE,       IN(BRAKE),                                         0,              0),
+    T(NEUTRAL_DRIVE,     FORWARD_DRIVE,     IN(FORWARD),                                       0,              0),
+    T(NEUTRAL_DRIVE,     REVERSE_DRIVE,     IN(REVERSE),                                       0,              0),
+
+    T(REVERSE_DRIVE,     BRAKE_STATE,       IN(BRAKE),                                         0,              0),
+    T(REVERSE_DRIVE,     NEUTRAL_DRIVE,     0,                                                 IN(REVERSE),    0),
+
+    T(RECORD_VELOCITY,   BRAKE_STATE,       IN(BRAKE),                                         0,              0),
+    T(RECORD_VELOCITY,   NEUTRAL_DRIVE,     0,                                                 IN(FORWARD),    0),
+    T(RECORD_VELOCITY,   ONEPEDAL,          IN(ONEPEDAL),                                      0,              DO_CRUISE_OFF),
+    T(RECORD_VELOCITY,   FORWARD_DRIVE,     0,                                                 IN(CRUISE_EN),  0),
+    T(RECORD_VELOCITY,   POWERED_CRUISE,    IN(CRUISE_EN),                                     IN(CRUISE_SET), 0),
+
+    T(POWERED_CRUISE,    BRAKE_STATE,       IN(BRAKE),                                         0,              0),
+    T(POWERED_CRUISE,    NEUTRAL_DRIVE,     0,                                                 IN(FORWARD),    0),
+    T(POWERED_CRUISE,    ONEPEDAL,          IN(ONEPEDAL),                                      0,              DO_CRUISE_OFF),
+    T(POWERED_CRUISE,    FORWARD_DRIVE,     0,                                                 IN(CRUISE_EN),  0),
+    T(POWERED_CRUISE,    RECORD_VELOCITY,   IN(CRUISE_SET) | IN(CRUISE_VEL),                   0,              0),
+    T(POWERED_CRUISE,    ACCELERATE_CRUISE, IN(ACCEL),                                         0,              0),
+    T(POWERED_CRUISE,    COASTING_CRUISE,   IN(OVER_CRUISE),                                   0,              0),
+
+    T(COASTING_CRUISE,   BRAKE_STATE,       IN(BRAKE),                                         0,              0),
+    T(COASTING_CRUISE,   NEUTRAL_DRIVE,     0,                                                 IN(FORWARD),    0),
+    T(COASTING_CRUISE,   ONEPEDAL,          IN(ONEPEDAL),                                      0,              DO_CRUISE_OFF),
+    T(COASTING_CRUISE,   FORWARD_DRIVE,     0,                                                 IN(CRUISE_EN),  0),
+    T(COASTING_CRUISE,   RECORD_VELOCITY,   IN(CRUISE_SET) | IN(CRUISE_VEL),                   0,              0),
+    T(COASTING_CRUISE,   ACCELERATE_CRUISE, IN(ACCEL),                                         0,              0),
+    T(COASTING_CRUISE,   POWERED_CRUISE,    0,                                                 IN(OVER_CRUISE),0),
+
+    T(ACCELERATE_CRUISE, BRAKE_STATE,       IN(BRAKE),                                         0,              0),
+    T(ACCELERATE_CRUISE, NEUTRAL_DRIVE,     0,                                                 IN(FORWARD),    0),
+    T(ACCELERATE_CRUISE, ONEPEDAL,          IN(ONEPEDAL),                                      0,              DO_CRUISE_OFF),
+    T(ACCELERATE_CRUISE, FORWARD_DRIVE,     0,                                                 IN(CRUISE_EN),  0),
+    T(ACCELERATE_CRUISE, RECORD_VELOCITY,   IN(CRUISE_SET) | IN(CRUISE_VEL),                   0,              0),
+    T(ACCELERATE_CRUISE, COASTING_CRUISE,   0,                                                 IN(ACCEL),      0),
+
+    T(ONEPEDAL,          BRAKE_STATE,       IN(BRAKE),                                         0,              0),
+    T(ONEPEDAL,          RECORD_VELOCITY,   IN(CRUISE_SET) | IN(CRUISE_EN) | IN(CRUISE_VEL),   0,              DO_BRAKELIGHT_OFF),
+    T(ONEPEDAL,          NEUTRAL_DRIVE,     0,                                                 IN(FORWARD),    DO_BRAKELIGHT_OFF),
+
+    T(BRAKE_STATE,       FORWARD_DRIVE,     IN(FORWARD),                                       IN(BRAKE),      DO_BRAKELIGHT_OFF | DO_BRAKE_RELEASE),
+    T(BRAKE_STATE,       NEUTRAL_DRIVE,     0,                                                 IN(BRAKE) | IN(FORWARD) | IN(REVERSE), DO_BRAKELIGHT_OFF | DO_BRAKE_RELEASE),
+    T(BRAKE_STATE,       REVERSE_DRIVE,     IN(REVERSE),                                       IN(BRAKE),      DO_BRAKELIGHT_OFF | DO_BRAKE_RELEASE),
+};
+#undef T
+
+/**
+ * The transition table compiled into a lookup of every combination of inputs, so
+ * picking the next state costs one load no matter which state the FSM is in or how
+ * many transitions it has. Each entry holds the next state in the low nibble and
+ * its actions in the high nibble.
+ */
+static uint8_t plan[NUM_TRITIUM_STATES][1 << NUM_INPUTS];
+#define PLAN_STATE(step) ((step) & 0x0F)
+#define PLAN_ACTIONS(step) ((step) >> 4)
+
+// State change trace
+static TritiumTransition_t trace[SENDTRITIUM_TRACE_DEPTH];
+static uint32_t traceCount = 0;
+
+// Longest iteration seen in each state, in cycles
+static uint32_t maxCycles[NUM_TRITIUM_STATES];
+
 /**
- * @brief Brake State Decider. Determines transitions out of brake state (forward drive,
- * neutral drive).
+ * @brief Fills in plan from the transition table
  */
-static void BrakeDecider()
+static void compilePlan(void)
 {
-    if (brakePedalPercent < BRAKE_PEDAL_THRESHOLD)
+    for (uint8_t from = 0; from < NUM_TRITIUM_STATES; from++)
     {
-        if (gear == FORWARD_GEAR)
-        {
-            state = FSM[FORWARD_DRIVE];
-            Minions_Write(BRAKELIGHT, false);
-            UpdateDisplay_SetBrake(false);
-        }
-        else if (gear == NEUTRAL_GEAR)
+        for (uint16_t inputs = 0; inputs < (1 << NUM_INPUTS); inputs++)
         {
-            state = FSM[NEUTRAL_DRIVE];
-            Minions_Write(BRAKELIGHT, false);
-            UpdateDisplay_SetBrake(false);
+            uint8_t step = from;
+            for (uint8_t t = 0; t < sizeof(transitions) / sizeof(transitions[0]); t++)
+            {
+                const Transition_t *tr = &transitions[t];
+                if (tr->from == from && (inputs & tr->mask) == tr->value)
+                {
+                    step = tr->to | (tr->actions << 4);
+                    break;
+                }
+            }
+            plan[from][inputs] = step;
         }
-        else if (gear == REVERSE_GEAR)
+    }
+}
+
+/**
+ * @brief Evaluates the inputs the transitions depend on
+ * @returns one bit per input, see IN()
+ */
+static uint16_t readTransitionInputs(void)
+{
+    return ((brakePedalPercent >= BRAKE_PEDAL_THRESHOLD) << IN_BRAKE) |
+           ((gear == FORWARD_GEAR) << IN_FORWARD) |
+           ((gear == REVERSE_GEAR) << IN_REVERSE) |
+           (onePedalEnable << IN_ONEPEDAL) |
+           (cruiseEnable << IN_CRUISE_EN) |
+           (cruiseSet << IN_CRUISE_SET) |
+           ((velocityObserved >= MIN_CRUISE_VELOCITY) << IN_CRUISE_VEL) |
+           ((accelPedalPercent >= ACCEL_PEDAL_THRESHOLD) << IN_ACCEL) |
+           ((velocityObserved > cruiseVelSetpoint) << IN_OVER_CRUISE);
+}
+
+/**
+ * @brief Decides the next state and performs the actions of the transition to it
+ */
+static void decideState(void)
+{
+    uint16_t inputs = readTransitionInputs();
+    uint8_t step = plan[state][inputs];
+    uint8_t actions = PLAN_ACTIONS(step);
+
+    if (actions & DO_CRUISE_OFF)
+        cruiseEnable = false;
+    if (actions & DO_BRAKELIGHT_OFF)
+        Minions_Write(BRAKELIGHT, false);
+    if (actions & DO_BRAKE_RELEASE)
+        UpdateDisplay_SetBrake(false);
+
+    if (PLAN_STATE(step) != state)
+    {
+        uint32_t now = BSP_Cycles_Get();
+        CPU_SR_ALLOC();
+        CPU_CRITICAL_ENTER();
+        TritiumTransition_t *entry = &trace[traceCount % SENDTRITIUM_TRACE_DEPTH];
+        entry->timestamp = now;
+        entry->inputs = inputs;
+        entry->from = state;
+        entry->to = PLAN_STATE(step);
+        traceCount++;
+        CPU_CRITICAL_EXIT();
+
+        state = PLAN_STATE(step);
+
+#ifndef SENDTRITIUM_EXPOSE_VARS
+        if (state == BRAKE_STATE)
         {
-            state = FSM[REVERSE_DRIVE];
-            Minions_Write(BRAKELIGHT, false);
-            UpdateDisplay_SetBrake(false);
+            uint32_t us = BSP_Cycles_ToMicros(now - Pedals_BrakeChangedAt());
+            brakeLatency.lastStateUs = us;
+            if (us > brakeLatency.maxStateUs)
+                brakeLatency.maxStateUs = us;
         }
+#endif
     }
 }
 
+#ifndef SENDTRITIUM_EXPOSE_VARS
+/**
+ * @brief Brake interrupt handler. Queues a zero current command right away,
+ * then wakes the task to enter the brake state.
+ */
+static void brakeEdge(bool pressed, uint32_t timestamp)
+{
+    if (!pressed)
+        return;
+
+    brakeCut = true;
+
+    CANDATA_t cutCmd = {.ID = MOTOR_DRIVE, .idx = 0};
+    CAN_MOTOR_DRIVE_SetMotorCurrent(cutCmd.data, 0.0f);
+    CAN_MOTOR_DRIVE_SetMotorVelocity(cutCmd.data, MAX_VELOCITY);
+
+    brakeLatency.presses++;
+    if (CANbus_SendPtr(&cutCmd, CAN_NON_BLOCKING, MOTORCAN) == SUCCESS) // never waits
+    {
+        uint32_t us = BSP_Cycles_ToMicros(BSP_Cycles_Get() - timestamp);
+        brakeLatency.lastCutUs = us;
+        if (us > brakeLatency.maxCutUs)
+            brakeLatency.maxCutUs = us;
+    }
+    else
+    {
+        brakeLatency.cutDrops++;
+    }
+
+    OS_ERR err;
+    OSTaskSemPost(&SendTritium_TCB, OS_OPT_POST_NONE, &err);
+    assertOSError(err);
+}
+
+/**
+ * @brief Runs between periods when the brake interrupt wakes the task, so the
+ * brake state (and the brake light) does not wait for the next period
+ */
+static void brakeIteration(void)
+{
+    brakePedalPercent = Pedals_Read(BRAKE);
+    prevState = state;
+    decideState();
+    if (state == BRAKE_STATE && prevState != BRAKE_STATE)
+        FSM[state].stateHandler();
+}
+#endif
+
+uint8_t SendTritium_GetTrace(TritiumTransition_t *out)
+{
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    uint8_t count = (traceCount < SENDTRITIUM_TRACE_DEPTH) ? traceCount : SENDTRITIUM_TRACE_DEPTH;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        out[i] = trace[(traceCount - count + i) % SENDTRITIUM_TRACE_DEPTH];
+    }
+    CPU_CRITICAL_EXIT();
+    return count;
+}
+
+uint32_t SendTritium_GetMaxCycles(TritiumStateName_t s)
+{
+    return (s < NUM_TRITIUM_STATES) ? maxCycles[s] : 0;
+}
+
 // Task (main loop)
 
 /**
@@ -775,12 +710,11 @@ static void BrakeDecider()
  */
 void Task_SendTritium(void *p_arg)
 {
-    OS_ERR err;
-
-    // Initialize current state to FORWARD_DRIVE
-    state = FSM[NEUTRAL_DRIVE];
-    prevState = FSM[NEUTRAL_DRIVE];
+    // Initialize current state to NEUTRAL_DRIVE
+    state = NEUTRAL_DRIVE;
+    prevState = NEUTRAL_DRIVE;
     UpdateDisplay_SetGear(DISP_NEUTRAL);
+    compilePlan();
 
 #ifndef SENDTRITIUM_EXPOSE_VARS
     CANDATA_t driveCmd = {
@@ -795,17 +729,54 @@ void Task_SendTritium(void *p_arg)
         .data = {0.0f, 0.0f},
     };
 
+    Periodic_Init(&timing, FSM_PERIOD);
+#ifndef SENDTRITIUM_EXPOSE_VARS
+    Pedals_SetBrakeHandler(brakeEdge);
+#endif
+
     while (1)
     {
-        memcpy(&powerCmd.data[4], &busCurrentSetPoint, sizeof(float));
-        CANbus_Send(powerCmd, CAN_BLOCKING, MOTORCAN); //<-------
-        state.stateHandler();                          // do what the current state does
+        // Release every FSM_PERIOD ms, however long the last iteration took,
+        // or right away when the brake interrupt signals a press
+        if (!Periodic_WaitOrSignal(&timing))
+        {
+#ifndef SENDTRITIUM_EXPOSE_VARS
+            brakeIteration();
+#endif
+            continue;
+        }
+
+#ifndef SENDTRITIUM_EXPOSE_VARS
+        brakeCut = false; // a press from here on is seen by the send below
+#endif
+        TritiumStateName_t current = state;
+        uint32_t start = BSP_Cycles_Get();
+        FSM[state].stateHandler(); // do what the current state does
+        uint32_t cycles = BSP_Cycles_Get() - start;
 #ifndef SENDTRITIUM_EXPOSE_VARS
         readInputs(); // read inputs from the system
         UpdateDisplay_SetAccel(accelPedalPercent);
 #endif
         prevState = state;
-        state.stateDecider(); // decide what the next state is
+        start = BSP_Cycles_Get();
+        decideState(); // decide what the next state is
+        cycles += BSP_Cycles_Get() - start;
+        if (cycles > maxCycles[current])
+            maxCycles[current] = cycles;
+
+        VehicleState_SetControl(&(VehicleControl_t){
+            .state = state,
+            .gear = gear,
+            .accelPedalPercent = accelPedalPercent,
+            .brakePedalPercent = brakePedalPercent,
+            .cruiseEnable = cruiseEnable,
+            .cruiseSet = cruiseSet,
+            .onePedalEnable = onePedalEnable,
+            .regenEnable = regenEnable,
+            .currentSetpoint = currentSetpoint,
+            .velocitySetpoint = velocitySetpoint,
+            .cruiseVelSetpoint = cruiseVelSetpoint,
+        });
 
         // Disable velocity controlled mode by always overwriting velocity to the maximum
         // in the appropriate direction.
@@ -815,25 +786,39 @@ void Task_SendTritium(void *p_arg)
 #ifdef SENDTRITIUM_PRINT_MES
         dumpInfo();
 #endif
-#ifndef SENDTRITIUM_EXPOSE_VARS
-        if (MOTOR_MSG_COUNTER_THRESHOLD == motorMsgCounter)
+        // Neither send blocks: a setpoint older than one period is stale, so it is
+        // dropped rather than holding up the control loop
+        if (++motorMsgCounter >= MOTOR_MSG_COUNTER_THRESHOLD)
         {
-            memcpy(&driveCmd.data[4], &currentSetpoint, sizeof(float));
-            memcpy(&driveCmd.data[0], &velocitySetpoint, sizeof(float));
-            CANbus_Send(driveCmd, CAN_NON_BLOCKING, MOTORCAN);
             motorMsgCounter = 0;
-        }
-        else
-        {
-            motorMsgCounter++;
-        }
+#ifndef SENDTRITIUM_EXPOSE_VARS
+            // This iteration may have decided its state before the brake interrupt cut the
+            // current. Check and send with interrupts off, so the cut is either seen here or
+            // queued after this frame, and no frame after the cut carries drive current.
+            CPU_SR_ALLOC();
+            CPU_CRITICAL_ENTER();
+            if (state == BRAKE_STATE || brakeCut)
+            {
+                currentSetpoint = 0;
+                velocitySetpoint = MAX_VELOCITY;
+            }
+            CAN_MOTOR_DRIVE_SetMotorCurrent(driveCmd.data, currentSetpoint);
+            CAN_MOTOR_DRIVE_SetMotorVelocity(driveCmd.data, velocitySetpoint);
+            CANbus_SendDeadline(driveCmd, MOTOR_MSG_PERIOD, MOTORCAN);
+            CPU_CRITICAL_EXIT();
 #endif
-
-        // Delay of FSM_PERIOD ms
-        OSTimeDlyHMSM(0, 0, 0, FSM_PERIOD, OS_OPT_TIME_HMSM_STRICT, &err);
-        if (err != OS_ERR_NONE)
-        {
-            assertOSError(err);
+            CAN_MOTOR_POWER_SetBusCurrent(powerCmd.data, busCurrentSetPoint);
+            CANbus_SendDeadline(powerCmd, MOTOR_MSG_PERIOD, MOTORCAN);
         }
     }
 }
+
+const Periodic_t *SendTritium_GetTiming(void)
+{
+    return &timing;
+}
+
+const BrakeLatency_t *SendTritium_GetBrakeLatency(void)
+{
+    return &brakeLatency;
+}
@@ -11,16 +11,17 @@
 
 #include "UpdateDisplay.h"
 #include "Minions.h"
+#include "Periodic.h"
 #include <math.h>
 
 // For fault handling
-#define RESTART_THRESHOLD 3 // number of times to reset before displaying the fault screen
+#define RESTART_THRESHOLD 3 // number of times in a row to reset an unresponsive display before only recording the error
 
 /**
  * Function prototypes
 */
 // check for and assert errors in UpdateDisplay
-// static void assertUpdateDisplayError(UpdateDisplayError_t err);
+static void assertUpdateDisplayError(UpdateDisplayError_t err);
 
 /**
  * Enum and corresponding array for easy component selection.
@@ -55,33 +56,116 @@ typedef enum{
 
 static uint32_t componentVals[NUM_COMPONENTS] = {0};
 
-const char* compStrings[NUM_COMPONENTS]= {
-	// Boolean components
-	"arr",
-    "hb",
-    "cs",
-	"mcs",
-	"brake",
-	"mot",
-	// Non-boolean components
-	"vel",
-	"accel",
-	"soc",
-	"supp",
-	"cruiseSt",
-	"rbsSt",
-    "pv",
-    "pc",
-    "pt",
-	"mcv",
-	"mcc",
-	"heatsink",
-	"gear",
+// Bit per component whose value changed since it was last sent
+static uint32_t dirtyComps = 0;
+// Tick each component first changed at since it was last sent
+static OS_TICK changedAt[NUM_COMPONENTS];
+#define COMP_BIT(comp) (1u << (comp))
+
+// Components sent by the task: ARRAY to GEAR, except the cruise and regen indicators
+#define SENT_COMPS ((COMP_BIT(GEAR + 1) - 1) & ~(COMP_BIT(CRUISE_ST) | COMP_BIT(REGEN_ST)))
+// Components the display only redraws after a touch/click event
+#define REFRESH_COMPS (COMP_BIT(GEAR) | COMP_BIT(CRUISE_ST) | COMP_BIT(REGEN_ST))
+
+// Priority classes, sent in this order. A fast component wakes the task as soon as it
+// changes; normal ones go out every release and slow ones every SLOW_PERIOD_MS.
+#define FAST_COMPS (COMP_BIT(GEAR) | COMP_BIT(BRAKE) | COMP_BIT(VELOCITY) | COMP_BIT(ARRAY) | COMP_BIT(MOTOR))
+#define SLOW_COMPS (COMP_BIT(PACK_TEMP) | COMP_BIT(SUPP_BATT) | COMP_BIT(HEAT_SINK_TEMP))
+#define NORMAL_COMPS (SENT_COMPS & ~FAST_COMPS & ~SLOW_COMPS)
+static const uint32_t classComps[] = {FAST_COMPS, NORMAL_COMPS, SLOW_COMPS};
+
+#define NORMAL_PERIOD_MS 250
+#define SLOW_PERIOD_MS 2000
+
+// Bandwidth budget: credit, in bytes times ticks per second, refilled at
+// DISPLAY_BUDGET_BYTES_PER_S and capped at DISPLAY_BUDGET_BURST bytes
+static uint32_t budgetCredit;
+static OS_TICK budgetTick;
+#define BUDGET_SCALE OSCfg_TickRate_Hz
+
+// Set once the task runs, so setters called before then don't post to it
+static volatile bool taskStarted = false;
+
+static UpdateDisplayStats_t stats = {0};
+
+// Page last selected, shown again if the display restarts
+static Page_t currentPage = INFO;
+// Display reply counts as of the last check, and resets since it last answered
+static DisplayStats_t linkSeen;
+static uint32_t displayResets = 0;
+
+/**
+ * @brief Marks every component that is sent as changed now
+ */
+static void UpdateDisplay_MarkAll(void){
+	OS_ERR err;
+	OS_TICK now = OSTimeGet(&err);
+	CPU_SR_ALLOC();
+	CPU_CRITICAL_ENTER();
+	for(int comp = ARRAY; comp <= GEAR; comp++){
+		if(!(dirtyComps & COMP_BIT(comp))) changedAt[comp] = now;
+	}
+	dirtyComps |= SENT_COMPS;
+	CPU_CRITICAL_EXIT();
+}
+
+// "click 0,1", a touch event that makes the display redraw
+static const DisplayTemplate_t REFRESH_TEMPLATE = DISPLAY_TEMPLATE("click 0,");
+
+// The text of each component's command before its value
+static const DisplayTemplate_t compTemplates[NUM_COMPONENTS]= {
+	// Boolean components: vis <comp>,<value>
+	DISPLAY_TEMPLATE("vis arr,"),
+    DISPLAY_TEMPLATE("vis hb,"),
+    DISPLAY_TEMPLATE("vis cs,"),
+	DISPLAY_TEMPLATE("vis mcs,"),
+	DISPLAY_TEMPLATE("vis brake,"),
+	DISPLAY_TEMPLATE("vis mot,"),
+	// Non-boolean components: <comp>.val=<value>
+	DISPLAY_TEMPLATE("vel.val="),
+	DISPLAY_TEMPLATE("accel.val="),
+	DISPLAY_TEMPLATE("soc.val="),
+	DISPLAY_TEMPLATE("supp.val="),
+	DISPLAY_TEMPLATE("cruiseSt.val="),
+	DISPLAY_TEMPLATE("rbsSt.val="),
+    DISPLAY_TEMPLATE("pv.val="),
+    DISPLAY_TEMPLATE("pc.val="),
+    DISPLAY_TEMPLATE("pt.val="),
+	DISPLAY_TEMPLATE("mcv.val="),
+	DISPLAY_TEMPLATE("mcc.val="),
+	DISPLAY_TEMPLATE("heatsink.val="),
+	DISPLAY_TEMPLATE("gear.val="),
 	// Fault code components
-	"oserr",
-	"faulterr"
+	DISPLAY_TEMPLATE("oserr.val="),
+	DISPLAY_TEMPLATE("faulterr.val=")
 };
 
+/**
+ * @brief Stores a component value, marking it to be sent if it changed
+ * @param comp component to set value of
+ * @param val value
+ */
+static void UpdateDisplay_Store(Component_t comp, uint32_t val){
+	OS_ERR err;
+	bool signal = false;
+	CPU_SR_ALLOC();
+	CPU_CRITICAL_ENTER();
+	if(componentVals[comp] != val){
+		componentVals[comp] = val;
+		if(!(dirtyComps & COMP_BIT(comp))){
+			changedAt[comp] = OSTimeGet(&err);
+			dirtyComps |= COMP_BIT(comp);
+			signal = (FAST_COMPS & COMP_BIT(comp)) && taskStarted;
+		}
+	}
+	CPU_CRITICAL_EXIT();
+
+	// Wake the task for a fast component, outside the critical section since it may reschedule
+	if(signal){
+		OSTaskSemPost(&UpdateDisplay_TCB, OS_OPT_POST_NONE, &err);
+	}
+}
+
 UpdateDisplayError_t UpdateDisplay_Init(){
 	OS_ERR err;
 
@@ -99,69 +183,26 @@ UpdateDisplayError_t UpdateDisplay_Init(){
  * @returns UpdateDisplayError_t
  */
 static UpdateDisplayError_t UpdateDisplay_Refresh(){
-	DisplayCmd_t refreshCmd = {
-		.compOrCmd = "click",
-		.attr = NULL,
-		.op = NULL,
-		.numArgs = 2,
-		.argTypes = {INT_ARG,INT_ARG},
-		{
-			{.num=0},
-			{.num=1}
-		}
-	};
-
-	Display_Send(refreshCmd);
+	Display_QueueValue(&REFRESH_TEMPLATE, 1);
 	return UPDATEDISPLAY_ERR_NONE;
 }
 
 /**
  * @brief Uses component enum to make assigning component values easier.
- * Differentiates between timers, variables, and components to assign values.
+ * Adds the command for the component's type to the current frame.
  * @param comp component to set value of
  * @param val value
  * @return UpdateDisplayError_t
  */
-static UpdateDisplayError_t UpdateDisplay_SetComponent(Component_t comp){
-	UpdateDisplayError_t ret = UPDATEDISPLAY_ERR_NONE;
-	
-	// For components that are on/off
-	if(comp <= MOTOR){
-		DisplayCmd_t visCmd = {
-			.compOrCmd = "vis",
-			.attr = NULL,
-			.op = NULL,
-			.numArgs = 2,
-			.argTypes = {STR_ARG,INT_ARG},
-			{
-				{.str=(char*)compStrings[comp]},
-				{.num=componentVals[comp]}
-			}
-		};
-		
-		ret = Display_Send(visCmd);
-		return ret;
-	}
-	// For components that have a non-boolean value
-	else if(comp > MOTOR){
-		DisplayCmd_t setCmd = {
-			.compOrCmd = (char*)compStrings[comp],
-			.attr = "val",
-			.op = "=",
-			.numArgs = 1,
-			.argTypes = {INT_ARG},
-			{
-				{.num=componentVals[comp]}
-			}
-		};
-
-		ret = Display_Send(setCmd);
-		return ret;
+static UpdateDisplayError_t UpdateDisplay_SetComponent(Component_t comp, uint32_t val){
+	if (Display_QueueValue(&compTemplates[comp], (int32_t)val) != DISPLAY_ERR_NONE){
+		return UPDATEDISPLAY_ERR_DRIVER;
 	}
 	return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetPage(Page_t page){
+	currentPage = page;
 	DisplayCmd_t pgCmd = {
 		.compOrCmd = "page",
 		.attr = NULL,
@@ -174,133 +215,302 @@ UpdateDisplayError_t UpdateDisplay_SetPage(Page_t page){
 	};
 
     Display_Send(pgCmd);
+
+	// The new page starts from its defaults, so send every value again
+	UpdateDisplay_MarkAll();
 	
 	return UPDATEDISPLAY_ERR_NONE;
 }
 
+const UpdateDisplayStats_t *UpdateDisplay_GetStats(void){
+	return &stats;
+}
+
 /* WRAPPERS */
 UpdateDisplayError_t UpdateDisplay_SetSOC(uint32_t percent){	// Integer percentage from 0-100
-	componentVals[SOC] = (percent);
+	UpdateDisplay_Store(SOC, (percent));
     
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetSBPV(uint32_t mv){
-	componentVals[SUPP_BATT] = mv;
+	UpdateDisplay_Store(SUPP_BATT, mv);
     
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetVelocity(uint32_t mphTenths){
-	componentVals[VELOCITY] = mphTenths;
+	UpdateDisplay_Store(VELOCITY, mphTenths);
 
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetAccel(uint8_t percent){
-    componentVals[ACCEL_METER] = (percent > 100)?100:percent;
+    UpdateDisplay_Store(ACCEL_METER, (percent > 100)?100:percent);
     
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetArray(bool state){
-	componentVals[ARRAY] = state;
+	UpdateDisplay_Store(ARRAY, state);
     
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetMotor(bool state){
-	componentVals[MOTOR] = state;
+	UpdateDisplay_Store(MOTOR, state);
 
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetGear(TriState_t gear){
-    componentVals[GEAR] = gear;
+    UpdateDisplay_Store(GEAR, gear);
 	
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetRegenState(TriState_t state){
-	componentVals[REGEN_ST] = state;
+	UpdateDisplay_Store(REGEN_ST, state);
 
 	return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetCruiseState(TriState_t state){
-    componentVals[CRUISE_ST] = state;
+    UpdateDisplay_Store(CRUISE_ST, state);
 	
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetBattVoltage(uint32_t mv){
-    componentVals[PACK_VOLTAGE] = (mv/100); // mv to tenths of a volt
+    UpdateDisplay_Store(PACK_VOLTAGE, (mv/100)); // mv to tenths of a volt
 	
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetBattTemperature(uint32_t val){
-	componentVals[PACK_TEMP] = (val/100);
+	UpdateDisplay_Store(PACK_TEMP, (val/100));
 
 	return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetBattCurrent(int32_t val){
-    componentVals[PACK_CURRENT] = (((val<0)?-val:val)/100);
-    componentVals[PACK_CURR_SIGN] = (val < 0)?1:0;
+    UpdateDisplay_Store(PACK_CURRENT, (((val<0)?-val:val)/100));
+    UpdateDisplay_Store(PACK_CURR_SIGN, (val < 0)?1:0);
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetMCVoltage(uint32_t volts){
-	componentVals[MC_BUS_VOLTAGE] = (volts);
+	UpdateDisplay_Store(MC_BUS_VOLTAGE, (volts));
 
 	return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetMCCurrent(int32_t val){
-	componentVals[MC_BUS_CURRENT] = (val<0)?-val:val;
-    componentVals[MC_CURR_SIGN] = (val < 0)?1:0;
+	UpdateDisplay_Store(MC_BUS_CURRENT, (val<0)?-val:val);
+    UpdateDisplay_Store(MC_CURR_SIGN, (val < 0)?1:0);
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetBrake(bool state){
-	componentVals[BRAKE] = (state)?1:0;
+	UpdateDisplay_Store(BRAKE, (state)?1:0);
 
 	return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetHeartbeat(uint32_t val){
-    componentVals[HEARTBEAT] = val;
+    UpdateDisplay_Store(HEARTBEAT, val);
 
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 UpdateDisplayError_t UpdateDisplay_SetHeatSinkTemp(uint32_t val){
-    componentVals[HEAT_SINK_TEMP] = val;
+    UpdateDisplay_Store(HEAT_SINK_TEMP, val);
 
     return UPDATEDISPLAY_ERR_NONE;
 }
 
 
 /**
- * @brief Loops through the display queue and sends all messages
+ * @brief Adds the credit earned since the last refill, up to the burst size
+ * @returns the whole bytes that can be sent now
+ */
+static uint32_t UpdateDisplay_Refill(void){
+	OS_ERR err;
+	OS_TICK now = OSTimeGet(&err);
+	uint64_t credit = budgetCredit + (uint64_t)(now - budgetTick) * DISPLAY_BUDGET_BYTES_PER_S;
+	budgetCredit = (credit > (uint64_t)DISPLAY_BUDGET_BURST * BUDGET_SCALE)
+		? DISPLAY_BUDGET_BURST * BUDGET_SCALE : (uint32_t)credit;
+	budgetTick = now;
+	return budgetCredit / BUDGET_SCALE;
+}
+
+/**
+ * @brief Handles the display's replies. Sends every value again if some may
+ * have been lost, and the page too if it restarted. Asserts an error if it
+ * stopped answering.
+ */
+static void UpdateDisplay_CheckLink(void){
+	Display_Poll();
+	const DisplayStats_t *link = Display_GetStats();
+
+	if(link->restarts != linkSeen.restarts){
+		UpdateDisplay_SetPage(currentPage);
+	}
+	else if(link->resyncs != linkSeen.resyncs){
+		UpdateDisplay_MarkAll();
+	}
+
+	bool answered = link->acks != linkSeen.acks;
+	bool timedOut = link->errors[DISPLAY_ERR_NO_ACK] != linkSeen.errors[DISPLAY_ERR_NO_ACK];
+	linkSeen = *link;
+
+	if(answered){
+		displayResets = 0;
+	}
+	else if(timedOut){
+		assertUpdateDisplayError(UPDATEDISPLAY_ERR_NO_RESPONSE);
+	}
+}
+
+/**
+ * @brief Sends the changed components of the given classes in one write, highest
+ * class first, stopping at the first one the budget or the display's free
+ * input buffer can't cover
+ * @param classes bit per entry of classComps to send
+ * @returns the components of those classes still waiting to be sent
+ */
+static uint32_t UpdateDisplay_SendFrame(uint32_t classes){
+	OS_ERR err;
+	uint32_t vals[NUM_COMPONENTS];
+	CPU_SR_ALLOC();
+
+	UpdateDisplay_CheckLink();
+	uint32_t budget = UpdateDisplay_Refill();
+	uint32_t creditBytes, creditCmds;
+	Display_GetCredit(&creditBytes, &creditCmds);
+
+	CPU_CRITICAL_ENTER();
+	uint32_t pending = dirtyComps;
+	memcpy(vals, componentVals, sizeof(vals));
+	CPU_CRITICAL_EXIT();
+
+	uint32_t wanted = 0;
+	for(uint32_t c = 0; c < sizeof(classComps) / sizeof(classComps[0]); c++){
+		if(classes & (1u << c)) wanted |= classComps[c] & pending;
+	}
+
+	// Always leave room for the refresh, since any command may need it
+	uint32_t cost = DISPLAY_VALUE_MAX_LEN(&REFRESH_TEMPLATE);
+	uint32_t cmds = 1;
+	uint32_t sent = 0;
+	for(uint32_t c = 0; c < sizeof(classComps) / sizeof(classComps[0]); c++){
+		uint32_t comps = wanted & classComps[c];
+		for(Component_t comp = ARRAY; comps != 0; comp++){
+			if(!(comps & COMP_BIT(comp))) continue;
+			comps &= ~COMP_BIT(comp);
+
+			uint32_t len = DISPLAY_VALUE_MAX_LEN(&compTemplates[comp]);
+			if(cost + len > creditBytes || cmds + 1 > creditCmds){
+				stats.displayBusy++;
+				goto flush;
+			}
+			if(cost + len > budget){
+				stats.deferred++;
+				goto flush;
+			}
+			UpdateDisplay_SetComponent(comp, vals[comp]);
+			cost += len;
+			cmds++;
+			sent |= COMP_BIT(comp);
+		}
+	}
+
+flush:
+	if(sent & REFRESH_COMPS){
+		UpdateDisplay_Refresh();
+	}
+	uint32_t before = Display_GetBytesSent();
+	Display_Flush();
+	uint32_t bytes = Display_GetBytesSent() - before;
+	budgetCredit = (bytes * BUDGET_SCALE < budgetCredit) ? budgetCredit - bytes * BUDGET_SCALE : 0;
+
+	// Done, unless a setter changed the value again since it was copied
+	OS_TICK now = OSTimeGet(&err);
+	CPU_CRITICAL_ENTER();
+	for(Component_t comp = ARRAY; sent != 0; comp++){
+		if(!(sent & COMP_BIT(comp))) continue;
+		sent &= ~COMP_BIT(comp);
+
+		if(FAST_COMPS & COMP_BIT(comp)){
+			uint32_t latencyMs = ((now - changedAt[comp]) * 1000) / OSCfg_TickRate_Hz;
+			if(latencyMs > stats.maxFastLatencyMs) stats.maxFastLatencyMs = latencyMs;
+		}
+		if(componentVals[comp] == vals[comp]){
+			dirtyComps &= ~COMP_BIT(comp);
+		}
+		else{
+			changedAt[comp] = now;
+		}
+	}
+	pending = dirtyComps & wanted;
+	CPU_CRITICAL_EXIT();
+
+	if(bytes > 0) stats.frames++;
+	return pending;
+}
+
+/**
+ * @brief Sends fast components as soon as they change, and the others on their
+ * periods, within the bandwidth budget
  */
 void Task_UpdateDisplay(void *p_arg) {
     OS_ERR err;
+    static Periodic_t timing;
+    uint32_t lastBytes = Display_GetBytesSent();
+    OS_TICK lastTick = OSTimeGet(&err);
+    uint32_t releases = 0;
+    bool slowDue = true;
+
+    Periodic_Init(&timing, NORMAL_PERIOD_MS);
+    budgetTick = lastTick;
+    budgetCredit = DISPLAY_BUDGET_BURST * BUDGET_SCALE;
+
+    // Send everything once
+    UpdateDisplay_MarkAll();
+    taskStarted = true;
+
     while (1) {
-		for(Component_t comp = ARRAY; comp <= GEAR; comp++){
-			if (comp != REGEN_ST && comp != CRUISE_ST){
-				UpdateDisplay_SetComponent(comp);
-			}
+        bool released = Periodic_WaitOrSignal(&timing);
+
+        uint32_t classes = 1u << 0;     // fast
+        if (released){
+            classes |= 1u << 1;         // normal
+            if (++releases % (SLOW_PERIOD_MS / NORMAL_PERIOD_MS) == 0) slowDue = true;
+            if (slowDue) classes |= 1u << 2;
+        }
+        uint32_t pending = UpdateDisplay_SendFrame(classes);
+        if (released && !(pending & SLOW_COMPS)) slowDue = false;
+
+        // Out of budget or display buffer for a fast component: wait for just enough, not the next release
+        while (pending & FAST_COMPS){
+            stats.budgetWaits++;
+            OSTimeDly(1, OS_OPT_TIME_DLY, &err);
+            assertOSError(err);
+            pending = UpdateDisplay_SendFrame(1u << 0);
         }
 
-        UpdateDisplay_SetHeartbeat(componentVals[HEARTBEAT]?0:1);
+        if (!released) continue;
 
-        UpdateDisplay_Refresh();
+        UpdateDisplay_SetHeartbeat(componentVals[HEARTBEAT]?0:1);
 
-        // Delay of 250 ms
-        OSTimeDlyHMSM(0, 0, 0, 250, OS_OPT_TIME_HMSM_STRICT, &err);
-        assertOSError(err);
+        // Bytes per second on the display UART
+        OS_TICK now = OSTimeGet(&err);
+        if (now - lastTick >= OSCfg_TickRate_Hz){
+            uint32_t bytes = Display_GetBytesSent();
+            stats.bytesPerSecond = (uint32_t)((uint64_t)(bytes - lastBytes) * OSCfg_TickRate_Hz / (now - lastTick));
+            lastBytes = bytes;
+            lastTick = now;
+        }
     }
 }
 
@@ -313,23 +523,28 @@ void Task_UpdateDisplay(void *p_arg) {
  * @brief A handler callback function run by the main throwTaskError function
  * used if we haven't reached the restart limit and encounter an error
  */ 
-// static void handler_UpdateDisplay_Restart() {
-//     Display_Reset(); // Try resetting to fix the display error
-// }
+static void handler_UpdateDisplay_Restart() {
+    Display_Reset(); // Try resetting to fix the display error
+}
 
 /**
  * @brief Check for a display error and assert it if it exists.
  * Stores the error code, calls the main assertion function 
- * and runs a callback function as a handler to restart the display and clear the queue.
+ * and runs a callback function as a handler to restart the display.
+ * After RESTART_THRESHOLD resets in a row the error is only recorded,
+ * since the car can still be driven without the display.
  * @param   err variable with display error codes
  */
-//  static void assertUpdateDisplayError(UpdateDisplayError_t err){
-// 	Error_UpdateDisplay = (error_code_t)err; // Store the error code for inspection
+static void assertUpdateDisplayError(UpdateDisplayError_t err){
+	Error_UpdateDisplay = (error_code_t)err; // Store the error code for inspection
 
-// 	if (err == UPDATEDISPLAY_ERR_NONE) return; // No error, return
+	if (err == UPDATEDISPLAY_ERR_NONE) return; // No error, return
 
-//     // Otherwise try resetting the display using the restart callback
-//     throwTaskError(Error_UpdateDisplay, handler_UpdateDisplay_Restart,OPT_NO_LOCK_SCHED, OPT_RECOV);
+	if (displayResets >= RESTART_THRESHOLD) return; // Given up on it, leave the error recorded
+	displayResets++;
 
-//     Error_UpdateDisplay = UPDATEDISPLAY_ERR_NONE; // Clear the error after handling it
-// }
+    // Otherwise try resetting the display using the restart callback
+    throwTaskError(Error_UpdateDisplay, handler_UpdateDisplay_Restart,OPT_NO_LOCK_SCHED, OPT_RECOV);
+
+    Error_UpdateDisplay = UPDATEDISPLAY_ERR_NONE; // Clear the error after handling it
+}
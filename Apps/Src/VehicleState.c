@@ -0,0 +1,93 @@
+/**
+ * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
+ * @file VehicleState.c
+ * @brief Vehicle data shared between tasks through double buffered sequence locks
+ *
+ */
+
+#include "VehicleState.h"
+#include "stm32f4xx.h"
+
+/**
+ * A domain's sequence number. Even: readers use copy 0. Odd: readers use copy 1.
+ * Divided by two, it is the number of completed writes.
+ */
+typedef volatile uint32_t Seq_t;
+
+static Seq_t motorSeq;
+static VehicleMotor_t motorCopies[2];
+
+static Seq_t controlSeq;
+static VehicleControl_t controlCopies[2];
+
+static Seq_t batterySeq;
+static VehicleBattery_t batteryCopies[2];
+
+/**
+ * @brief Writes both copies of a domain, pointing readers away from each one while it changes
+ */
+static void write(Seq_t *seq, void *copies, const void *src, size_t size)
+{
+    uint32_t s = *seq;
+
+    *seq = s + 1;   // readers use copy 1
+    __DMB();
+    memcpy(copies, src, size);
+    __DMB();
+    *seq = s + 2;   // readers use copy 0
+    __DMB();
+    memcpy((uint8_t *)copies + size, src, size);
+}
+
+/**
+ * @brief Copies the copy of a domain readers are pointed at, again if a write moved them meanwhile
+ * @returns the number of completed writes
+ */
+static uint32_t read(Seq_t *seq, const void *copies, void *dst, size_t size)
+{
+    uint32_t s;
+    do {
+        s = *seq;
+        __DMB();
+        memcpy(dst, (const uint8_t *)copies + (s & 1) * size, size);
+        __DMB();
+    } while (*seq != s);
+    return s / 2;
+}
+
+void VehicleState_SetMotor(const VehicleMotor_t *motor)
+{
+    write(&motorSeq, motorCopies, motor, sizeof *motor);
+}
+
+void VehicleState_SetControl(const VehicleControl_t *control)
+{
+    write(&controlSeq, controlCopies, control, sizeof *control);
+}
+
+void VehicleState_SetBattery(const VehicleBattery_t *battery)
+{
+    write(&batterySeq, batteryCopies, battery, sizeof *battery);
+}
+
+uint32_t VehicleState_GetMotor(VehicleMotor_t *motor)
+{
+    return read(&motorSeq, motorCopies, motor, sizeof *motor);
+}
+
+uint32_t VehicleState_GetControl(VehicleControl_t *control)
+{
+    return read(&controlSeq, controlCopies, control, sizeof *control);
+}
+
+uint32_t VehicleState_GetBattery(VehicleBattery_t *battery)
+{
+    return read(&batterySeq, batteryCopies, battery, sizeof *battery);
+}
+
+void VehicleState_Get(VehicleState_t *state)
+{
+    VehicleState_GetMotor(&state->motor);
+    VehicleState_GetControl(&state->control);
+    VehicleState_GetBattery(&state->battery);
+}
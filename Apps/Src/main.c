@@ -99,7 +99,7 @@ void Task_Init(void *p_arg){
     Pedals_Init();
     BSP_UART_Init(UART_2);
     CANbus_Init(CARCAN, carCANFilterList, NUM_CARCAN_FILTERS);
-    CANbus_Init(MOTORCAN, NULL, NUM_MOTORCAN_FILTERS);
+    CANbus_Init(MOTORCAN, motorCANFilterList, NUM_MOTORCAN_FILTERS);
     Contactors_Init();
     Display_Init();
     Minions_Init();
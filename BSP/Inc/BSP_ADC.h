@@ -3,6 +3,11 @@
  * @file BSP_ADC.h
  * @brief Header file for the library to interact
  * with the Analog to Digital Converter (ADC)
+ *
+ * TIM3 triggers a scan of every channel ADC_SAMPLE_HZ times a second, and DMA
+ * copies the results into a buffer split in two halves. Each time a half fills,
+ * an interrupt decimates its ADC_OVERSAMPLE scans into one filtered value per
+ * channel, so the values served out are refreshed ADC_OUTPUT_HZ times a second.
  * 
  * @defgroup BSP_ADC
  * @addtogroup BSP_ADC
@@ -20,6 +25,11 @@
 #define ADC_PRECISION_BITS 12
 #define ADC_RANGE_MILLIVOLTS 3300
 
+#define ADC_SAMPLE_HZ 2000      // scans of every channel per second
+#define ADC_OVERSAMPLE 16       // scans decimated into each filtered value
+#define ADC_OUTPUT_HZ (ADC_SAMPLE_HZ / ADC_OVERSAMPLE)
+#define ADC_BLOCK_US (1000000 / ADC_OUTPUT_HZ) // time spanned by the scans behind each value
+
 typedef enum 
 {
     Accelerator_ADC, 
@@ -34,7 +44,7 @@ typedef enum
 void BSP_ADC_Init(void);
 
 /**
- * @brief   Provides the ADC value of the channel at the specified index
+ * @brief   Provides the latest filtered ADC value of the channel at the specified index
  * @param   hardwareDevice pedal enum that represents the specific device
  * @return  Raw ADC value without conversion
  */ 
@@ -47,6 +57,13 @@ int16_t BSP_ADC_Get_Value(ADC_t hardwareDevice);
  */ 
 int16_t BSP_ADC_Get_Millivoltage(ADC_t hardwareDevice);
 
+/**
+ * @brief   Provides the age of the latest filtered values, which is never
+ *          more than ADC_BLOCK_US * 3 / 2 while the ADC is running
+ * @return  microseconds since the middle of the block of scans they came from
+ */
+uint32_t BSP_ADC_Get_Age(void);
+
 #endif
 
 
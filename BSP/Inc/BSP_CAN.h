@@ -18,16 +18,142 @@
 
 typedef enum {CAN_1=0, CAN_3, NUM_CAN} CAN_t;
 
+/**
+ * Depth of the software receive queue for each bus.
+ * Must be a power of two. MotorCAN sees far more traffic, so it gets the deeper queue.
+ */
+#ifndef CAN1_RX_QUEUE_DEPTH
+#define CAN1_RX_QUEUE_DEPTH 32
+#endif
+
+#ifndef CAN3_RX_QUEUE_DEPTH
+#define CAN3_RX_QUEUE_DEPTH 64
+#endif
+
+/**
+ * Depth of the software receive queue for high priority (FIFO1) traffic.
+ * Must be a power of two.
+ */
+#ifndef CAN1_RX_PRIO_QUEUE_DEPTH
+#define CAN1_RX_PRIO_QUEUE_DEPTH 8
+#endif
+
+#ifndef CAN3_RX_PRIO_QUEUE_DEPTH
+#define CAN3_RX_PRIO_QUEUE_DEPTH 8
+#endif
+
+/**
+ * Receive priority lanes. Normal IDs are filtered into hardware FIFO0,
+ * high priority IDs into FIFO1. Each lane has its own interrupt and queue.
+ */
+typedef enum {CAN_PRIO_NORMAL=0, CAN_PRIO_HIGH, NUM_CAN_PRIO} CAN_Prio_t;
+
+/**
+ * @brief A received frame, as stored in a slot of the receive queue
+ */
+typedef struct {
+    uint16_t id;        // standard 11 bit ID
+    uint8_t len;        // number of data bytes
+    uint8_t reserved;
+    uint8_t data[8];    // word aligned, so it is filled with two word copies
+    uint32_t timestamp; // cycle count when the ISR took the frame out of the hardware FIFO
+} CAN_Frame_t;
+
+/**
+ * @brief Function the receive interrupt calls with each frame before queueing it.
+ *        Runs in interrupt context, so it must be short and must not block.
+ * @return true to queue the frame for the reading task, false to drop it
+ */
+typedef bool (*CAN_RxHook_t)(CAN_t bus, const CAN_Frame_t* frame);
+
+/**
+ * @brief Snapshot of a bus's receive queue health
+ */
+typedef struct {
+    uint32_t overflows; // frames dropped because the software queue was full
+    uint32_t highWater; // most frames ever waiting in the queue at once
+    uint32_t pending;   // frames currently waiting in the queue
+    uint32_t depth;     // capacity of the queue
+} CAN_RxStats_t;
+
+/**
+ * Number of buckets in the receive latency histogram.
+ * Bucket k counts frames that waited [2^k, 2^(k+1)) CPU cycles between the
+ * receive interrupt and BSP_CAN_Read or BSP_CAN_Peek. The last bucket also counts anything longer.
+ */
+#define CAN_LATENCY_BUCKETS 24
+
+/**
+ * @brief Traffic and error counters for a bus
+ */
+typedef struct {
+    uint32_t rxFrames;      // frames taken out of the hardware FIFOs
+    uint32_t txFrames;      // frames put into transmit mailboxes
+    uint32_t bits;          // worst case bits of all rx and tx frames, for bus load estimates
+    uint32_t fifoOverruns;  // times a hardware FIFO overran (FOVR) and lost a frame
+    uint32_t overflows;     // frames dropped because a software queue was full
+    uint32_t bitRate;       // configured bit rate in bits per second
+    uint8_t tec;            // transmit error counter
+    uint8_t rec;            // receive error counter
+    uint8_t lec;            // last error code
+    uint32_t latency[CAN_LATENCY_BUCKETS];
+} CAN_BusStats_t;
+
+/**
+ * Number of hardware filter banks each bus may use. CAN1 shares its banks with the
+ * unused CAN2, which is left a single bank. CAN3 has its own banks.
+ */
+#define CAN1_FILTER_BANKS 27
+#define CAN3_FILTER_BANKS 14
+#define CAN_MAX_FILTER_BANKS 27
+
+/**
+ * @brief Kinds of hardware filter bank
+ */
+typedef enum {
+    CAN_FILTER_LIST16 = 0,  // four IDs, accepted exactly
+    CAN_FILTER_MASK16,      // two ID/mask pairs
+    CAN_FILTER_LIST32,      // two IDs, accepted exactly. Wins over any 16 bit bank.
+    CAN_FILTER_MASK32       // one ID/mask pair. Wins over 16 bit banks.
+} CAN_FilterType_t;
+
+/**
+ * @brief One hardware filter bank as programmed by BSP_CAN_Init.
+ *        Mask entries accept any ID whose bits under mask[i] equal id[i].
+ */
+typedef struct {
+    uint8_t bank;           // hardware filter number
+    uint8_t fifo;           // 0 for normal IDs, 1 for high priority IDs
+    CAN_FilterType_t type;
+    uint8_t count;          // number of IDs (list) or ID/mask pairs (mask) in use
+    uint16_t id[4];         // standard 11 bit IDs
+    uint16_t mask[2];       // mask banks only
+} CAN_FilterBank_t;
+
 /**
  * @brief   Initializes the CAN module that communicates with the rest of the electrical system.
  * @param   bus : The bus to initialize. Should only be either CAN_1 or CAN_3.
  * @param   rxEvent : the function to execute when recieving a message. NULL for no action.
  * @param   txEnd : the function to execute after transmitting a message. NULL for no action.
  * @param   idWhitelist : the idWhitelist to use for message filtering. NULL for no filtering.
+ *          The IDs are packed into as few filter banks as possible, using mask banks for
+ *          runs of IDs that differ in a few bits. If they do not fit, all IDs are accepted.
  * @param   idWhitelistSize : the size of the idWhitelist, if it is not NULL.
+ * @param   idPriorityList : IDs to receive through the high priority FIFO. These are accepted
+ *          even if they are not in idWhitelist. NULL for none.
+ * @param   idPriorityListSize : the size of the idPriorityList, if it is not NULL.
+ * @return  None
+ */
+void BSP_CAN_Init(CAN_t bus, callback_t rxEvent, callback_t txEnd, uint16_t* idWhitelist, uint8_t idWhitelistSize, uint16_t* idPriorityList, uint8_t idPriorityListSize);
+
+/**
+ * @brief   Sets the function the receive interrupt calls with each frame of a bus.
+ *          The hook is called even when the receive queue is full.
+ * @param   bus the CAN line to hook
+ * @param   hook the function to call, NULL for none
  * @return  None
  */
-void BSP_CAN_Init(CAN_t bus, callback_t rxEvent, callback_t txEnd, uint16_t* idWhitelist, uint8_t idWhitelistSize);
+void BSP_CAN_SetRxHook(CAN_t bus, CAN_RxHook_t hook);
 
 /**
  * @brief   Writes a message to the specified CAN line
@@ -36,19 +162,75 @@ void BSP_CAN_Init(CAN_t bus, callback_t rxEvent, callback_t txEnd, uint16_t* idW
  * @param   id the hex ID for the message to be sent
  * @param   data pointer to the array containing the message
  * @param   len length of the message in bytes
- * @return  number of bytes transmitted (0 if unsuccessful)
+ * @return  ERROR if no transmit mailbox was free, SUCCESS otherwise
+ */
+ErrorStatus BSP_CAN_Write(CAN_t bus, uint32_t id, const uint8_t data[8], uint8_t len);
+
+/**
+ * @brief   Checks whether a frame with the given ID is still waiting in a transmit mailbox.
+ *          The mailboxes are sent lowest ID first, so callers use this to keep frames
+ *          with the same ID in order.
+ * @param   bus the CAN line to check
+ * @param   id the ID to look for
+ * @return  true if a frame with that ID is pending
  */
-ErrorStatus BSP_CAN_Write(CAN_t bus, uint32_t id, uint8_t data[8], uint8_t len);
+bool BSP_CAN_TxIdPending(CAN_t bus, uint32_t id);
 
 /**
- * @brief   Reads the message on the specified CAN line
+ * @brief   Reads the message on the specified CAN line.
+ *          High priority messages are always returned before normal ones.
  * @param   id pointer to integer to store the 
  *          message ID that was read
  * @param   data pointer to integer array to store
  *          the message in bytes
- * @return  number of bytes read (0 if unsuccessful)
+ * @param   timestamp pointer to store the cycle count (BSP_Cycles_Get) at which
+ *          the receive interrupt took the frame out of the hardware FIFO. NULL if not needed.
+ * @return  ERROR if no message was waiting
+ */
+ErrorStatus BSP_CAN_Read(CAN_t bus, uint32_t* id, uint8_t* data, uint32_t* timestamp);
+
+/**
+ * @brief   Gets the next received frame without copying it out of the receive queue.
+ *          High priority frames are always returned before normal ones.
+ *          The frame stays valid, and is returned again, until BSP_CAN_Release is called.
+ * @note    Only the one task that reads the bus may call this
+ * @param   bus the CAN line to read
+ * @return  the frame, or NULL if no frame was waiting
+ */
+const CAN_Frame_t* BSP_CAN_Peek(CAN_t bus);
+
+/**
+ * @brief   Hands the frame returned by the last BSP_CAN_Peek back to the receive interrupt
+ * @param   bus the CAN line the frame was read from
+ * @return  None
+ */
+void BSP_CAN_Release(CAN_t bus);
+
+/**
+ * @brief   Gets the receive queue statistics for a bus
+ * @param   bus the CAN line to report on
+ * @param   lane the receive queue to report on
+ * @param   stats pointer to store the statistics in
+ * @return  None
+ */
+void BSP_CAN_GetRxStats(CAN_t bus, CAN_Prio_t lane, CAN_RxStats_t* stats);
+
+/**
+ * @brief   Gets the traffic and error counters for a bus
+ * @param   bus the CAN line to report on
+ * @param   stats pointer to store the counters in
+ * @return  None
+ */
+void BSP_CAN_GetBusStats(CAN_t bus, CAN_BusStats_t* stats);
+
+/**
+ * @brief   Gets the filter banks programmed for a bus, to see which IDs land
+ *          in which bank and FIFO
+ * @param   bus the CAN line to report on
+ * @param   map set to point at the bus's filter banks
+ * @return  the number of banks in use
  */
-ErrorStatus BSP_CAN_Read(CAN_t bus, uint32_t* id, uint8_t* data);
+uint8_t BSP_CAN_GetFilterMap(CAN_t bus, const CAN_FilterBank_t** map);
 
 #endif
 
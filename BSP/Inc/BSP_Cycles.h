@@ -0,0 +1,44 @@
+/**
+ * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
+ * @file BSP_Cycles.h
+ * @brief Header file for the library to read the CPU cycle counter.
+ * Used for timestamps and execution time measurements.
+ * 
+ * @defgroup BSP_Cycles
+ * @addtogroup BSP_Cycles
+ * @{
+ */
+
+#ifndef __BSP_CYCLES_H
+#define __BSP_CYCLES_H
+
+#include "common.h"
+#include "stm32f4xx.h"
+
+/**
+ * @brief   Starts the DWT cycle counter. Safe to call more than once;
+ *          the counter is not reset.
+ * @return  None
+ */
+void BSP_Cycles_Init(void);
+
+/**
+ * @brief   Reads the free-running cycle counter. Wraps every 2^32 cycles,
+ *          so use unsigned subtraction to find elapsed time.
+ * @return  the current cycle count
+ */
+static inline uint32_t BSP_Cycles_Get(void) {
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief   Converts a number of cycles to microseconds
+ * @param   cycles the number of cycles
+ * @return  the number of microseconds
+ */
+uint32_t BSP_Cycles_ToMicros(uint32_t cycles);
+
+#endif
+
+
+/* @} */
@@ -21,6 +21,13 @@
 typedef enum {PORTA = 0, PORTB, PORTC, PORTD, NUM_PORTS} port_t; 
 typedef enum {INPUT = 0, OUTPUT} direction_t;
 
+/**
+ * Called from the EXTI interrupt on each edge of a pin
+ * @param level the level of the pin after the edge
+ * @param timestamp cycle count (BSP_Cycles_Get) when the interrupt started
+ */
+typedef void (*GPIO_EdgeHandler_t)(bool level, uint32_t timestamp);
+
 GPIO_TypeDef* GPIO_GetPort(port_t port);
 
 /**
@@ -32,6 +39,17 @@ GPIO_TypeDef* GPIO_GetPort(port_t port);
  */ 
 void BSP_GPIO_Init(port_t port, uint16_t mask, direction_t direction, bool pull_down);
 
+/**
+ * @brief   Calls a handler from the EXTI interrupt on every rising and falling edge of an input pin.
+ *          Only one port can use each pin number, since the EXTI line is shared.
+ * @param   port The port of the pin, already initialized as an input
+ * @param   pinmask Mask from stm header file that says which pin to watch (a single pin)
+ * @param   handler Called with the new level on each edge. Runs in the interrupt,
+ *          so it must not block.
+ * @return  None
+ */
+void BSP_GPIO_Init_Interrupt(port_t port, uint16_t pinmask, GPIO_EdgeHandler_t handler);
+
 /**
  * @brief   Reads value of the specified port
  * @param   port to read
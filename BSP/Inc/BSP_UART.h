@@ -16,11 +16,39 @@
 #include <bsp.h>
 
 typedef enum {UART_2, UART_3, NUM_UART} UART_t;
+
+// Transmit counters of one UART
+typedef struct {
+    uint32_t bytes;         // bytes the DMA has finished sending
+    uint32_t transfers;     // DMA transfers completed, one interrupt each
+    uint32_t waits;         // times a task pended because the ring was full
+    uint32_t dropped;       // echoed bytes dropped because the ring was full
+    uint32_t queued;        // bytes waiting or in flight right now
+} UART_TxStats_t;
+
 /**
  * @brief   Initializes the UART peripheral
  */
 void BSP_UART_Init(UART_t);
 
+/**
+ * @brief   Initializes the UART peripheral to receive binary data,
+ *          such as replies from the display. Bytes received are
+ *          kept as they are and not echoed; read them with
+ *          BSP_UART_ReadRaw instead of BSP_UART_Read.
+ */
+void BSP_UART_InitRaw(UART_t uart);
+
+/**
+ * @brief   Takes the bytes received so far on a UART
+ *          initialized with BSP_UART_InitRaw. Does not wait.
+ * @param   uart device selected
+ * @param   buf where to copy the bytes
+ * @param   len most bytes to copy
+ * @return  number of bytes copied
+ */
+uint32_t BSP_UART_ReadRaw(UART_t uart, char *buf, uint32_t len);
+
 /**
  * @brief   Gets one line of ASCII text that was received 
  *          from a specified UART device
@@ -42,6 +70,13 @@ uint32_t BSP_UART_Read(UART_t uart, char *str);
  */
 uint32_t BSP_UART_Write(UART_t uart ,char *str, uint32_t len);
 
+/**
+ * @brief   Gets the transmit counters of a UART device
+ * @param   uart device selected
+ * @param   stats where to copy the counters
+ */
+void BSP_UART_Get_TxStats(UART_t uart, UART_TxStats_t *stats);
+
 #endif
 
 
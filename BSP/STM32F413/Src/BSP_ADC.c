@@ -1,9 +1,17 @@
 /* Copyright (c) 2020 UT Longhorn Racing Solar */
 
 #include "BSP_ADC.h"
+#include "BSP_Cycles.h"
 #include "stm32f4xx.h"
+#include "os.h"
 
-static volatile uint16_t ADCresults[2];
+// Two halves, each holding ADC_OVERSAMPLE scans of every channel.
+// DMA fills one half while the interrupt decimates the other.
+static volatile uint16_t ADCbuffer[2][ADC_OVERSAMPLE][NUMBER_OF_CHANNELS];
+
+// Latest decimated value of each channel, and when it was computed
+static volatile uint16_t ADCfiltered[NUMBER_OF_CHANNELS];
+static volatile uint32_t ADCtimestamp;
 
 static void ADC_InitDMA(void) {
 	// Start the clock for the DMA
@@ -14,9 +22,9 @@ static void ADC_InitDMA(void) {
 
 	DMA_InitStruct.DMA_Channel = DMA_Channel_0;
 	DMA_InitStruct.DMA_PeripheralBaseAddr = (uint32_t)&(ADC1->DR);
-	DMA_InitStruct.DMA_Memory0BaseAddr = (uint32_t) &ADCresults;
+	DMA_InitStruct.DMA_Memory0BaseAddr = (uint32_t) &ADCbuffer;
 	DMA_InitStruct.DMA_DIR = DMA_DIR_PeripheralToMemory;
-	DMA_InitStruct.DMA_BufferSize = 2;
+	DMA_InitStruct.DMA_BufferSize = sizeof(ADCbuffer) / sizeof(ADCbuffer[0][0][0]);
 	DMA_InitStruct.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
 	DMA_InitStruct.DMA_MemoryInc = DMA_MemoryInc_Enable;
 	DMA_InitStruct.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
@@ -29,10 +37,46 @@ static void ADC_InitDMA(void) {
 	DMA_InitStruct.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
 	DMA_Init(DMA2_Stream0, &DMA_InitStruct);
 
+	// Interrupt when each half of the buffer fills
+	DMA_ITConfig(DMA2_Stream0, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+	NVIC_InitTypeDef NVIC_InitStruct;
+	NVIC_InitStruct.NVIC_IRQChannel = DMA2_Stream0_IRQn;
+	NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = 0x02;
+	NVIC_InitStruct.NVIC_IRQChannelSubPriority = 0x00;
+	NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStruct);
+
 	// Enable DMA2 stream 0
 	DMA_Cmd(DMA2_Stream0, ENABLE);
 }
 
+/**
+ * @brief   Starts TIM3, whose update event triggers one scan of every channel
+ *          ADC_SAMPLE_HZ times a second
+ * @param   None
+ * @return  None
+ */
+static void ADC_InitTrigger(void) {
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, ENABLE);
+
+	// APB1 timers run at twice the bus clock whenever the bus is divided down
+	RCC_ClocksTypeDef clocks;
+	RCC_GetClocksFreq(&clocks);
+	uint32_t timerClock = (clocks.PCLK1_Frequency == clocks.HCLK_Frequency)
+		? clocks.PCLK1_Frequency : 2 * clocks.PCLK1_Frequency;
+
+	TIM_TimeBaseInitTypeDef TIM_InitStruct;
+	TIM_TimeBaseStructInit(&TIM_InitStruct);
+	TIM_InitStruct.TIM_Prescaler = (uint16_t)(timerClock / 1000000 - 1);	// 1 MHz tick
+	TIM_InitStruct.TIM_Period = 1000000 / ADC_SAMPLE_HZ - 1;
+	TIM_InitStruct.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(TIM3, &TIM_InitStruct);
+
+	TIM_SelectOutputTrigger(TIM3, TIM_TRGOSource_Update);
+	TIM_Cmd(TIM3, ENABLE);
+}
+
 /**
  * @brief   Initializes the ADC module. This is to measure the hall effect sensors
  *          on the Current Monitor Board.
@@ -43,6 +87,7 @@ void BSP_ADC_Init(void) {
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1, ENABLE);	// Enable the ADC clock
 	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOC, ENABLE);	// Enable the PC clock for port C
 
+	BSP_Cycles_Init();	// Timestamps the filtered values
 	ADC_InitDMA();
 
 	GPIO_InitTypeDef GPIO_InitStruct;
@@ -67,11 +112,11 @@ void BSP_ADC_Init(void) {
 	ADC_InitTypeDef ADC_InitStruct;	// Initialization structure
 	ADC_InitStruct.ADC_Resolution = ADC_Resolution_12b;	// High resolution
 	ADC_InitStruct.ADC_ScanConvMode = ENABLE;						// So we can go through all the channels
-	ADC_InitStruct.ADC_ContinuousConvMode = ENABLE; 		// Cycle the channels
-	ADC_InitStruct.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_None;
-	ADC_InitStruct.ADC_ExternalTrigConv = DISABLE;
+	ADC_InitStruct.ADC_ContinuousConvMode = DISABLE; 		// One scan per trigger
+	ADC_InitStruct.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_Rising;
+	ADC_InitStruct.ADC_ExternalTrigConv = ADC_ExternalTrigConv_T3_TRGO;	// Paced by TIM3
 	ADC_InitStruct.ADC_DataAlign = ADC_DataAlign_Right;
-	ADC_InitStruct.ADC_NbrOfConversion = 2;							// We have two channels that we need to read
+	ADC_InitStruct.ADC_NbrOfConversion = NUMBER_OF_CHANNELS;		// We have two channels that we need to read
 
 	ADC_Init(ADC1, &ADC_InitStruct);
 
@@ -88,18 +133,19 @@ void BSP_ADC_Init(void) {
 	// Enable ADC1
 	ADC_Cmd(ADC1, ENABLE);
 
-	ADC_SoftwareStartConv(ADC1);
+	// Conversions start with the first timer update
+	ADC_InitTrigger();
 }
 
 /**
- * @brief   Gets converted ADC value in units of mV.
- * @param   None
- * @return  millivoltage value ADC measurement
+ * @brief   Gets the latest filtered ADC value.
+ * @param   hardwareDevice pedal enum that represents the specific device
+ * @return  raw ADC value
  */
 int16_t BSP_ADC_Get_Value(ADC_t hardwareDevice) {
 
     // Get ADC raw data
-    uint16_t data = ADCresults[hardwareDevice];
+    uint16_t data = ADCfiltered[hardwareDevice];
     
     return (int16_t) data;
 }
@@ -112,8 +158,61 @@ int16_t BSP_ADC_Get_Value(ADC_t hardwareDevice) {
 int16_t BSP_ADC_Get_Millivoltage(ADC_t hardwareDevice) {
 
     // Get ADC raw data
-    int16_t data = (int16_t) ADCresults[hardwareDevice];
+    int16_t data = (int16_t) ADCfiltered[hardwareDevice];
     
     // Convert to millivoltage
     return (ADC_RANGE_MILLIVOLTS * data) >> ADC_PRECISION_BITS;
 }
+
+/**
+ * @brief   Gets how old the filtered values are
+ * @param   None
+ * @return  microseconds since the middle of the block they were computed from
+ */
+uint32_t BSP_ADC_Get_Age(void) {
+    return BSP_Cycles_ToMicros(BSP_Cycles_Get() - ADCtimestamp) + ADC_BLOCK_US / 2;
+}
+
+/**
+ * @brief   Decimates one half of the DMA buffer into a single value per channel.
+ *          The highest and lowest samples are dropped so a single spike cannot
+ *          move the result, and the rest are averaged.
+ * @param   block the half that just filled
+ * @return  None
+ */
+static void decimate(volatile uint16_t block[ADC_OVERSAMPLE][NUMBER_OF_CHANNELS]) {
+	for (uint8_t ch = 0; ch < NUMBER_OF_CHANNELS; ch++) {
+		uint32_t sum = 0;
+		uint16_t min = UINT16_MAX, max = 0;
+		for (uint8_t i = 0; i < ADC_OVERSAMPLE; i++) {
+			uint16_t sample = block[i][ch];
+			sum += sample;
+			if (sample < min) min = sample;
+			if (sample > max) max = sample;
+		}
+		sum -= min + max;
+		ADCfiltered[ch] = (uint16_t)((sum + (ADC_OVERSAMPLE - 2) / 2) / (ADC_OVERSAMPLE - 2));
+	}
+	ADCtimestamp = BSP_Cycles_Get();
+}
+
+void DMA2_Stream0_IRQHandler(void) {
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    OSIntEnter();
+    CPU_CRITICAL_EXIT();
+
+    // First half full, DMA is now writing the second
+    if (DMA_GetITStatus(DMA2_Stream0, DMA_IT_HTIF0) == SET) {
+        DMA_ClearITPendingBit(DMA2_Stream0, DMA_IT_HTIF0);
+        decimate(ADCbuffer[0]);
+    }
+
+    // Second half full, DMA has wrapped around to the first
+    if (DMA_GetITStatus(DMA2_Stream0, DMA_IT_TCIF0) == SET) {
+        DMA_ClearITPendingBit(DMA2_Stream0, DMA_IT_TCIF0);
+        decimate(ADCbuffer[1]);
+    }
+
+    OSIntExit();
+}
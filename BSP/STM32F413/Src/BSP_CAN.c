@@ -1,38 +1,99 @@
 /* Copyright (c) 2020 UT Longhorn Racing Solar */
 
 #include "BSP_CAN.h"
+#include "BSP_Cycles.h"
 #include "stm32f4xx.h"
 #include "os.h"
 
-// The message information that we care to receive
-typedef struct _msg
-{
-    uint32_t id;
-    uint8_t data[8];
-} msg_t;
-
-// Set up a fifo for receiving
-#define FIFO_TYPE msg_t
-#define FIFO_SIZE 25
-#define FIFO_NAME msg_queue
-#include "fifo.h"
+_Static_assert((CAN1_RX_QUEUE_DEPTH & (CAN1_RX_QUEUE_DEPTH - 1)) == 0, "CAN1_RX_QUEUE_DEPTH must be a power of two");
+_Static_assert((CAN3_RX_QUEUE_DEPTH & (CAN3_RX_QUEUE_DEPTH - 1)) == 0, "CAN3_RX_QUEUE_DEPTH must be a power of two");
+_Static_assert((CAN1_RX_PRIO_QUEUE_DEPTH & (CAN1_RX_PRIO_QUEUE_DEPTH - 1)) == 0, "CAN1_RX_PRIO_QUEUE_DEPTH must be a power of two");
+_Static_assert((CAN3_RX_PRIO_QUEUE_DEPTH & (CAN3_RX_PRIO_QUEUE_DEPTH - 1)) == 0, "CAN3_RX_PRIO_QUEUE_DEPTH must be a power of two");
 
-#define NUM_FILTER_REGS 4   // Number of 16 bit registers for ids in one CAN_FilterInit struct
+/**
+ * Single-producer/single-consumer receive ring.
+ * head is only ever written by the RX interrupt, tail is only ever written by the
+ * reading task. Both are free-running counters, so (head - tail) is the fill level
+ * and (counter & mask) is the slot index.
+ */
+typedef struct {
+    CAN_Frame_t *buffer;
+    uint32_t mask;
+    volatile uint32_t head;     // owned by the ISR
+    volatile uint32_t tail;     // owned by the task
+    volatile uint32_t overflows;
+    volatile uint32_t highWater;
+} rx_ring_t;
 
 //return error if someone tries to call from motor can
 
-static msg_queue_t gRxQueue[2];
+static CAN_Frame_t gRxBuffer1[CAN1_RX_QUEUE_DEPTH];
+static CAN_Frame_t gRxBuffer3[CAN3_RX_QUEUE_DEPTH];
+static CAN_Frame_t gRxPrioBuffer1[CAN1_RX_PRIO_QUEUE_DEPTH];
+static CAN_Frame_t gRxPrioBuffer3[CAN3_RX_PRIO_QUEUE_DEPTH];
 
-// Required for receiving CAN messages
-static CanTxMsg gTxMessage[2];
-static CanRxMsg gRxMessage[2];
+// One ring per hardware FIFO: normal traffic in FIFO0, high priority traffic in FIFO1
+static rx_ring_t gRxQueue[NUM_CAN][NUM_CAN_PRIO] = {
+    {
+        [CAN_PRIO_NORMAL] = {.buffer = gRxBuffer1, .mask = CAN1_RX_QUEUE_DEPTH - 1},
+        [CAN_PRIO_HIGH] = {.buffer = gRxPrioBuffer1, .mask = CAN1_RX_PRIO_QUEUE_DEPTH - 1},
+    },
+    {
+        [CAN_PRIO_NORMAL] = {.buffer = gRxBuffer3, .mask = CAN3_RX_QUEUE_DEPTH - 1},
+        [CAN_PRIO_HIGH] = {.buffer = gRxPrioBuffer3, .mask = CAN3_RX_PRIO_QUEUE_DEPTH - 1},
+    },
+};
+
+// Lane of the frame handed out by the last BSP_CAN_Peek on each bus
+static CAN_Prio_t gPeekLane[NUM_CAN];
 
 // User parameters for CAN events
 static callback_t gRxEvent[2];
 static callback_t gTxEnd[2];
+static volatile CAN_RxHook_t gRxHook[NUM_CAN];
+
+// Traffic counters
+typedef struct {
+    volatile uint32_t rxFrames;
+    volatile uint32_t txFrames;
+    volatile uint32_t bits;
+    volatile uint32_t fifoOverruns;
+    uint32_t bitRate;
+    uint32_t latency[CAN_LATENCY_BUCKETS];
+} bus_stats_t;
+
+static bus_stats_t gStats[NUM_CAN];
+
+/**
+ * @brief   Worst case number of bits a standard data frame takes up on the bus,
+ *          including bit stuffing and interframe space
+ * @param   dlc : number of data bytes
+ */
+static inline uint32_t BSP_CAN_FrameBits(uint8_t dlc)
+{
+    uint32_t stuffable = 34 + 8 * dlc;
+    return stuffable + 13 + (stuffable - 1) / 4;
+}
+
+/**
+ * @brief   Computes the configured bit rate of a bus from its bit timing register
+ * @param   CANx : the peripheral to read
+ * @return  the bit rate in bits per second
+ */
+static uint32_t BSP_CAN_BitRate(CAN_TypeDef *CANx)
+{
+    RCC_ClocksTypeDef clocks;
+    RCC_GetClocksFreq(&clocks);
+
+    uint32_t btr = CANx->BTR;
+    uint32_t prescaler = (btr & CAN_BTR_BRP) + 1;
+    uint32_t bs1 = ((btr & CAN_BTR_TS1) >> 16) + 1;
+    uint32_t bs2 = ((btr & CAN_BTR_TS2) >> 20) + 1;
+    return clocks.PCLK1_Frequency / (prescaler * (1 + bs1 + bs2));
+}
 
-void BSP_CAN1_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize);
-void BSP_CAN3_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize);
+void BSP_CAN1_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize, uint16_t* idPriorityList, uint8_t idPriorityListSize);
+void BSP_CAN3_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize, uint16_t* idPriorityList, uint8_t idPriorityListSize);
 
 /**
  * @brief   Initializes the CAN module that communicates with the rest of the electrical system.
@@ -41,30 +102,304 @@ void BSP_CAN3_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize);
  * @return  None
  */
 
-void BSP_CAN_Init(CAN_t bus, callback_t rxEvent, callback_t txEnd, uint16_t* idWhitelist, uint8_t idWhitelistSize) {
+void BSP_CAN_Init(CAN_t bus, callback_t rxEvent, callback_t txEnd, uint16_t* idWhitelist, uint8_t idWhitelistSize, uint16_t* idPriorityList, uint8_t idPriorityListSize) {
 
     // Configure event handles
     gRxEvent[bus] = rxEvent;
     gTxEnd[bus] = txEnd;
 
+    // Frames are timestamped with the cycle counter
+    BSP_Cycles_Init();
+    memset(&gStats[bus], 0, sizeof gStats[bus]);
+
     if (bus == CAN_1)
     {
-        BSP_CAN1_Init(idWhitelist, idWhitelistSize);
+        BSP_CAN1_Init(idWhitelist, idWhitelistSize, idPriorityList, idPriorityListSize);
     }
     else
     {
-        BSP_CAN3_Init(idWhitelist, idWhitelistSize);
+        BSP_CAN3_Init(idWhitelist, idWhitelistSize, idPriorityList, idPriorityListSize);
+    }
+}
+
+/* Filter compiler *********************************************************/
+
+#define FILTER_MAX_IDS 32       // most IDs per FIFO we try to pack
+#define FILTER_ID_BITS 0x7FF    // standard IDs only
+#define FILTER_MIN_GROUP 4      // smaller mask groups take as much room as list entries
+
+static CAN_FilterBank_t gFilterMap[NUM_CAN][CAN_MAX_FILTER_BANKS];
+static uint8_t gFilterBanks[NUM_CAN];
+
+// An ID with don't-care bits: matches every ID equal to id outside of dc
+typedef struct {
+    uint16_t id;
+    uint16_t dc;
+} filter_term_t;
+
+/**
+ * @brief   Adds a bank to the filter map of a bus
+ * @return  NULL if the bus is out of banks
+ */
+static CAN_FilterBank_t* BSP_CAN_FilterAddBank(CAN_t bus, CAN_FilterType_t type, uint8_t fifo)
+{
+    uint8_t limit = (bus == CAN_1) ? CAN1_FILTER_BANKS : CAN3_FILTER_BANKS;
+    if(gFilterBanks[bus] >= limit){
+        return NULL;
+    }
+
+    CAN_FilterBank_t *bank = &gFilterMap[bus][gFilterBanks[bus]];
+    memset(bank, 0, sizeof *bank);
+    bank->bank = gFilterBanks[bus]++;
+    bank->type = type;
+    bank->fifo = fifo;
+    return bank;
+}
+
+/**
+ * @brief   Checks that every ID matched by a term is in the list and not grouped yet
+ */
+static bool BSP_CAN_FilterTermFree(const uint16_t *ids, uint8_t n, const bool *grouped, filter_term_t term)
+{
+    uint8_t found = 0;
+    for(uint8_t i = 0; i < n; i++){
+        if((ids[i] & ~term.dc) == term.id){
+            if(grouped[i]) return false;
+            found++;
+        }
+    }
+    return found == (1u << __builtin_popcount(term.dc));
+}
+
+/**
+ * @brief   Finds groups of IDs that can each be matched exactly by one mask filter.
+ *          A group is grown around each ID by freeing one bit at a time, as long as
+ *          every ID the group then matches is in the list. Groups never share IDs.
+ * @param   ids the IDs to group. No duplicates.
+ * @param   n the number of IDs
+ * @param   groups where to store the groups
+ * @param   grouped set for every ID that was put in a group
+ * @return  the number of groups
+ */
+static uint8_t BSP_CAN_FilterFindGroups(const uint16_t *ids, uint8_t n, filter_term_t *groups, bool *grouped)
+{
+    uint8_t numGroups = 0;
+    memset(grouped, 0, n * sizeof *grouped);
+
+    for(uint8_t i = 0; i < n; i++){
+        if(grouped[i]) continue;
+
+        filter_term_t term = {ids[i], 0};
+        for(uint16_t bit = 1; bit <= FILTER_ID_BITS; bit <<= 1){
+            filter_term_t grown = {term.id & ~bit, term.dc | bit};
+            if(BSP_CAN_FilterTermFree(ids, n, grouped, grown)){
+                term = grown;
+            }
+        }
+        if((1u << __builtin_popcount(term.dc)) < FILTER_MIN_GROUP) continue;
+
+        for(uint8_t j = 0; j < n; j++){
+            if((ids[j] & ~term.dc) == term.id){
+                grouped[j] = true;
+            }
+        }
+        groups[numGroups++] = term;
+    }
+    return numGroups;
+}
+
+/**
+ * @brief   Packs a list of IDs into 16 bit mask and list banks routed to one FIFO
+ * @return  ERROR if the bus ran out of banks
+ */
+static ErrorStatus BSP_CAN_FilterCompile(CAN_t bus, const uint16_t *idList, uint8_t size, uint8_t fifo)
+{
+    uint16_t ids[FILTER_MAX_IDS];
+    bool grouped[FILTER_MAX_IDS];
+    filter_term_t groups[FILTER_MAX_IDS / FILTER_MIN_GROUP];
+    uint16_t singles[FILTER_MAX_IDS];
+    uint8_t n = 0;
+
+    // Drop invalid and repeated IDs
+    for(uint8_t i = 0; i < size; i++){
+        bool repeat = false;
+        for(uint8_t j = 0; j < n && !repeat; j++){
+            repeat = (ids[j] == idList[i]);
+        }
+        if(idList[i] == 0 || idList[i] > FILTER_ID_BITS || repeat){
+            continue;
+        }
+        if(n >= FILTER_MAX_IDS){
+            return ERROR;
+        }
+        ids[n++] = idList[i];
+    }
+
+    uint8_t numGroups = BSP_CAN_FilterFindGroups(ids, n, groups, grouped);
+    uint8_t numSingles = 0;
+    for(uint8_t i = 0; i < n; i++){
+        if(!grouped[i]){
+            singles[numSingles++] = ids[i];
+        }
+    }
+
+    // Two groups per mask bank. A spare mask slot can hold one leftover ID exactly,
+    // which saves a list bank when exactly one ID would be left over.
+    CAN_FilterBank_t *bank = NULL;
+    for(uint8_t g = 0; g < numGroups; g++){
+        if(g % 2 == 0){
+            bank = BSP_CAN_FilterAddBank(bus, CAN_FILTER_MASK16, fifo);
+            if(bank == NULL) return ERROR;
+        }
+        bank->id[bank->count] = groups[g].id;
+        bank->mask[bank->count] = FILTER_ID_BITS & ~groups[g].dc;
+        bank->count++;
+    }
+    if(numGroups % 2 == 1 && numSingles % 4 == 1){
+        bank->id[1] = singles[--numSingles];
+        bank->mask[1] = FILTER_ID_BITS;
+        bank->count++;
+    }
+
+    // Four IDs per list bank
+    for(uint8_t i = 0; i < numSingles; i++){
+        if(i % 4 == 0){
+            bank = BSP_CAN_FilterAddBank(bus, CAN_FILTER_LIST16, fifo);
+            if(bank == NULL) return ERROR;
+        }
+        bank->id[bank->count++] = singles[i];
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief   Puts IDs in 32 bit list banks, which win over the 32 bit accept-all bank
+ * @return  ERROR if the bus ran out of banks
+ */
+static ErrorStatus BSP_CAN_FilterCompileWide(CAN_t bus, const uint16_t *idList, uint8_t size, uint8_t fifo)
+{
+    CAN_FilterBank_t *bank = NULL;
+    for(uint8_t i = 0; i < size; i++){
+        if(i % 2 == 0){
+            bank = BSP_CAN_FilterAddBank(bus, CAN_FILTER_LIST32, fifo);
+            if(bank == NULL) return ERROR;
+        }
+        bank->id[bank->count++] = idList[i];
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief   Programs the filter banks in the filter map of a bus into the hardware
+ */
+static void BSP_CAN_FilterApply(CAN_t bus)
+{
+    CAN_TypeDef *CANx = (bus == CAN_1) ? CAN1 : CAN3;
+    CAN_FilterInitTypeDef init;
+
+    if(bus == CAN_1){
+        CAN_SlaveStartBank(CAN1, CAN1_FILTER_BANKS); // the rest of the shared banks go to CAN2, which we don't use
+    }
+
+    for(uint8_t b = 0; b < gFilterBanks[bus]; b++){
+        CAN_FilterBank_t *bank = &gFilterMap[bus][b];
+        uint8_t second = (bank->count > 1) ? 1 : 0;
+        uint16_t reg[4];
+
+        // Unused entries repeat a used one, so they can't accept anything new
+        switch(bank->type){
+            case CAN_FILTER_LIST16:
+                for(uint8_t i = 0; i < 4; i++){
+                    reg[i] = bank->id[(i < bank->count) ? i : bank->count - 1] << 5;
+                }
+                break;
+            case CAN_FILTER_MASK16:
+                reg[0] = bank->id[0] << 5;
+                reg[1] = (bank->mask[0] << 5) | 0x18; // RTR and IDE must be 0: standard data frames only
+                reg[2] = bank->id[second] << 5;
+                reg[3] = (bank->mask[second] << 5) | 0x18;
+                break;
+            case CAN_FILTER_LIST32:
+                reg[0] = 0;
+                reg[1] = 0;
+                reg[2] = bank->id[0] << 5;
+                reg[3] = bank->id[second] << 5;
+                break;
+            case CAN_FILTER_MASK32:
+            default:
+                reg[0] = 0;
+                reg[1] = 0;
+                reg[2] = bank->id[0] << 5;
+                reg[3] = bank->mask[0] << 5;
+                break;
+        }
+
+        init.CAN_FilterNumber = bank->bank;
+        init.CAN_FilterMode = (bank->type == CAN_FILTER_LIST16 || bank->type == CAN_FILTER_LIST32) ? CAN_FilterMode_IdList : CAN_FilterMode_IdMask;
+        init.CAN_FilterScale = (bank->type == CAN_FILTER_LIST16 || bank->type == CAN_FILTER_MASK16) ? CAN_FilterScale_16bit : CAN_FilterScale_32bit;
+        init.CAN_FilterIdLow = reg[0];
+        init.CAN_FilterMaskIdLow = reg[1];
+        init.CAN_FilterIdHigh = reg[2];
+        init.CAN_FilterMaskIdHigh = reg[3];
+        init.CAN_FilterFIFOAssignment = (bank->fifo == 0) ? CAN_Filter_FIFO0 : CAN_Filter_FIFO1;
+        init.CAN_FilterActivation = ENABLE;
+        CAN_FilterInit(CANx, &init);
     }
 }
 
-void BSP_CAN1_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize) {
+/**
+ * @brief   Builds and programs the filter banks of a bus
+ * @param   bus : the bus to configure
+ * @param   idWhitelist : IDs to receive through FIFO0. NULL to accept everything.
+ * @param   idWhitelistSize : the size of idWhitelist
+ * @param   idPriorityList : IDs to route to FIFO1. NULL for none.
+ * @param   idPriorityListSize : the size of idPriorityList
+ */
+static void BSP_CAN_FilterInit(CAN_t bus, uint16_t* idWhitelist, uint8_t idWhitelistSize, uint16_t* idPriorityList, uint8_t idPriorityListSize)
+{
+    if(idPriorityList == NULL){
+        idPriorityListSize = 0;
+    }
+
+    gFilterBanks[bus] = 0;
+    ErrorStatus fits = ERROR;
+    if(idWhitelist != NULL){
+        // The two lists don't overlap, so bank precedence doesn't matter here
+        fits = BSP_CAN_FilterCompile(bus, idPriorityList, idPriorityListSize, 1);
+        if(fits == SUCCESS){
+            fits = BSP_CAN_FilterCompile(bus, idWhitelist, idWhitelistSize, 0);
+        }
+    }
+
+    if(fits == ERROR){
+        // No filtering, or too many IDs to filter. Accept everything, but the high
+        // priority IDs still need banks that take precedence over the accept-all bank.
+        gFilterBanks[bus] = 0;
+        BSP_CAN_FilterCompileWide(bus, idPriorityList, idPriorityListSize, 1);
+        CAN_FilterBank_t *all = BSP_CAN_FilterAddBank(bus, CAN_FILTER_MASK32, 0);
+        if(all != NULL){
+            all->count = 1; // ID 0, mask 0: every frame matches
+        }
+    }
+
+    BSP_CAN_FilterApply(bus);
+}
+
+uint8_t BSP_CAN_GetFilterMap(CAN_t bus, const CAN_FilterBank_t** map)
+{
+    *map = gFilterMap[bus];
+    return gFilterBanks[bus];
+}
+
+void BSP_CAN1_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize, uint16_t* idPriorityList, uint8_t idPriorityListSize) {
     GPIO_InitTypeDef GPIO_InitStruct;
     CAN_InitTypeDef CAN_InitStruct;
     NVIC_InitTypeDef NVIC_InitStruct;
-    CAN_FilterInitTypeDef CAN_FilterInitStruct;
 
-    // Initialize the queue
-    gRxQueue[0] = msg_queue_new();
+    // Initialize the queues
+    for(CAN_Prio_t lane = CAN_PRIO_NORMAL; lane < NUM_CAN_PRIO; lane++){
+        gRxQueue[CAN_1][lane].head = gRxQueue[CAN_1][lane].tail = 0;
+    }
 
     /* CAN GPIOs configuration **************************************************/
 
@@ -93,7 +428,7 @@ void BSP_CAN1_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize) {
     CAN_InitStruct.CAN_AWUM = DISABLE;
     CAN_InitStruct.CAN_NART = DISABLE;
     CAN_InitStruct.CAN_RFLM = DISABLE;
-    CAN_InitStruct.CAN_TXFP = ENABLE;
+    CAN_InitStruct.CAN_TXFP = DISABLE; // send the lowest ID first, the driver queue is ordered the same way
     #ifdef CAR_LOOPBACK
     CAN_InitStruct.CAN_Mode = CAN_Mode_LoopBack;
     #else
@@ -109,86 +444,28 @@ void BSP_CAN1_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize) {
     CAN_InitStruct.CAN_BS2 = CAN_BS2_4tq;
     CAN_InitStruct.CAN_Prescaler = 16;
     CAN_Init(CAN1, &CAN_InitStruct);
+    gStats[CAN_1].bitRate = BSP_CAN_BitRate(CAN1);
 
     /* CAN filter init 
      * Initializes hardware filter banks to be used for filtering CAN IDs (whitelist)
      */
-    if(idWhitelist == NULL){
-        // No filtering. All IDs can pass through.
-        CAN_FilterInitStruct.CAN_FilterNumber = 0;
-        CAN_FilterInitStruct.CAN_FilterMode = CAN_FilterMode_IdMask;
-        CAN_FilterInitStruct.CAN_FilterScale = CAN_FilterScale_32bit;
-        CAN_FilterInitStruct.CAN_FilterIdHigh = 0x0000;
-        CAN_FilterInitStruct.CAN_FilterIdLow = 0x0000;
-        CAN_FilterInitStruct.CAN_FilterMaskIdHigh = 0x0000;
-        CAN_FilterInitStruct.CAN_FilterMaskIdLow = 0x0000;
-        CAN_FilterInitStruct.CAN_FilterFIFOAssignment = 0;
-        CAN_FilterInitStruct.CAN_FilterActivation = ENABLE;
-        CAN_FilterInit(CAN1, &CAN_FilterInitStruct);
-    } else{
-        // Filter CAN IDs
-        // So far, if we shift whatever id we need by 5, it works
-        // If whitelist is passed but no valid ID exists inside of it, filter nothing i.e. no ID gets through
-        // MAXIMUM CAN ID ALLOWED IS 2047
-
-        CAN_FilterInitStruct.CAN_FilterMode = CAN_FilterMode_IdList; //list mode
-        CAN_FilterInitStruct.CAN_FilterScale = CAN_FilterScale_16bit;
-        CAN_FilterInitStruct.CAN_FilterFIFOAssignment = 0;
-        CAN_FilterInitStruct.CAN_FilterActivation = ENABLE;
-        uint16_t validIDCounter = 0;
-
-        uint16_t* FilterStructPtr = (uint16_t*)&(CAN_FilterInitStruct); //address of CAN Filter Struct
-        for(uint8_t i = 0; i < idWhitelistSize; i++){
-            if (idWhitelist[i] == 0){ //zero ID check
-                continue;
-            }
-                
-            CAN_FilterInitStruct.CAN_FilterNumber = i / NUM_FILTER_REGS; //determines filter number based on CAN ID
-            *(FilterStructPtr + (i%NUM_FILTER_REGS)) = idWhitelist[i] << 5;
-            validIDCounter++;
+    BSP_CAN_FilterInit(CAN_1, idWhitelist, idWhitelistSize, idPriorityList, idPriorityListSize);
 
-            if(i % NUM_FILTER_REGS == NUM_FILTER_REGS - 1){ //if four elements have been written to a filter call CAN_FilterInit()
-                CAN_FilterInit(CAN1, &CAN_FilterInitStruct);
-            }
-            else if(i == idWhitelistSize - 1){ //we are out of elements, call CAN_FilterInit()
-                for(uint8_t j = i%NUM_FILTER_REGS + 1; j <= NUM_FILTER_REGS - 1; j++)   // Set unfilled filter registers to 0
-                    *(FilterStructPtr + j) = 0x0000;
-
-                CAN_FilterInit(CAN1, &CAN_FilterInitStruct);
-            }
-            else if(validIDCounter > 112){ //All filter banks are to be filled and there is no point in filtering
-                for(uint8_t filter = 0; filter < 28; filter++){//Therefore, let all IDs through (no filtering)
-                    CAN_FilterInitStruct.CAN_FilterNumber = filter;
-                    CAN_FilterInitStruct.CAN_FilterActivation = DISABLE;
-                    CAN_FilterInit(CAN1, &CAN_FilterInitStruct);
-                } 
-            }
-        }
-    }
-
-    /* Transmit Structure preparation */
-    gTxMessage[0].ExtId = 0x5;
-    gTxMessage[0].RTR = CAN_RTR_DATA;
-    gTxMessage[0].IDE = CAN_ID_STD;
-    gTxMessage[0].DLC = 1;
-
-    /* Receive Structure preparation */
-    gRxMessage[0].StdId = 0x00;
-    gRxMessage[0].ExtId = 0x00;
-    gRxMessage[0].IDE = CAN_ID_STD;
-    gRxMessage[0].DLC = 0;
-    gRxMessage[0].FMI = 0;
-
-    /* Enable FIFO 0 message pending Interrupt */
-    CAN_ITConfig(CAN1, CAN_IT_FMP0, ENABLE);
+    /* Enable FIFO 0 and FIFO 1 message pending Interrupts */
+    CAN_ITConfig(CAN1, CAN_IT_FMP0 | CAN_IT_FMP1, ENABLE);
 
     // Enable Rx interrupts
-    NVIC_InitStruct.NVIC_IRQChannel = CAN1_RX0_IRQn; // TODO: CHECK IRQ CHANNELS
-    NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = 0x00;
+    // FIFO1 carries the high priority IDs, so it may preempt FIFO0 processing
+    NVIC_InitStruct.NVIC_IRQChannel = CAN1_RX0_IRQn;
+    NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = 0x01;
     NVIC_InitStruct.NVIC_IRQChannelSubPriority = 0x00;
     NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStruct);
 
+    NVIC_InitStruct.NVIC_IRQChannel = CAN1_RX1_IRQn;
+    NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = 0x00;
+    NVIC_Init(&NVIC_InitStruct);
+
     if(NULL != gTxEnd[0]) {
         // Enable Tx Interrupts
         CAN_ITConfig(CAN1, CAN_IT_TME, ENABLE);
@@ -200,15 +477,16 @@ void BSP_CAN1_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize) {
     }
 }
 
-void BSP_CAN3_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize)
+void BSP_CAN3_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize, uint16_t* idPriorityList, uint8_t idPriorityListSize)
 {
     GPIO_InitTypeDef GPIO_InitStruct;
     CAN_InitTypeDef CAN_InitStruct;
     NVIC_InitTypeDef NVIC_InitStruct;
-    CAN_FilterInitTypeDef CAN_FilterInitStruct;
 
-    // Initialize the queue
-    gRxQueue[1] = msg_queue_new();
+    // Initialize the queues
+    for(CAN_Prio_t lane = CAN_PRIO_NORMAL; lane < NUM_CAN_PRIO; lane++){
+        gRxQueue[CAN_3][lane].head = gRxQueue[CAN_3][lane].tail = 0;
+    }
 
     /* CAN GPIOs configuration **************************************************/
 
@@ -237,7 +515,7 @@ void BSP_CAN3_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize)
     CAN_InitStruct.CAN_AWUM = DISABLE;
     CAN_InitStruct.CAN_NART = DISABLE;
     CAN_InitStruct.CAN_RFLM = DISABLE;
-    CAN_InitStruct.CAN_TXFP = ENABLE;
+    CAN_InitStruct.CAN_TXFP = DISABLE; // send the lowest ID first, the driver queue is ordered the same way
     #ifdef MOTOR_LOOPBACK
     CAN_InitStruct.CAN_Mode = CAN_Mode_LoopBack;
     #else
@@ -253,72 +531,28 @@ void BSP_CAN3_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize)
     CAN_InitStruct.CAN_BS2 = CAN_BS2_4tq;
     CAN_InitStruct.CAN_Prescaler = 16;
     CAN_Init(CAN3, &CAN_InitStruct);
+    gStats[CAN_3].bitRate = BSP_CAN_BitRate(CAN3);
 
     /* CAN filter init 
      * Initializes hardware filter banks to be used for filtering CAN IDs (whitelist)
      */
-    if(idWhitelist == NULL){
-        // No filtering. All IDs can pass through.
-        CAN_FilterInitStruct.CAN_FilterNumber = 0;
-        CAN_FilterInitStruct.CAN_FilterMode = CAN_FilterMode_IdMask;
-        CAN_FilterInitStruct.CAN_FilterScale = CAN_FilterScale_32bit;
-        CAN_FilterInitStruct.CAN_FilterIdHigh = 0x0000;
-        CAN_FilterInitStruct.CAN_FilterIdLow = 0x0000;
-        CAN_FilterInitStruct.CAN_FilterMaskIdHigh = 0x0000;
-        CAN_FilterInitStruct.CAN_FilterMaskIdLow = 0x0000;
-        CAN_FilterInitStruct.CAN_FilterFIFOAssignment = 0;
-        CAN_FilterInitStruct.CAN_FilterActivation = ENABLE;
-        CAN_FilterInit(CAN3, &CAN_FilterInitStruct);
-    } else{
-        // Filter CAN IDs
-        CAN_FilterInitStruct.CAN_FilterMode = CAN_FilterMode_IdList; //list mode
-        CAN_FilterInitStruct.CAN_FilterScale = CAN_FilterScale_16bit;
-        CAN_FilterInitStruct.CAN_FilterFIFOAssignment = 0;
-        CAN_FilterInitStruct.CAN_FilterActivation = ENABLE;
-        
-        uint16_t* FilterStructPtr = (uint16_t*)&(CAN_FilterInitStruct); //address of CAN Filter Struct
-        for(uint8_t i = 0; i < idWhitelistSize; i++){
-            CAN_FilterInitStruct.CAN_FilterNumber = i / NUM_FILTER_REGS; //determines filter number based on CAN ID
-            *(FilterStructPtr + (i%NUM_FILTER_REGS)) = idWhitelist[i];
-
-            if(i % NUM_FILTER_REGS == NUM_FILTER_REGS - 1){ //if four elements have been written to a filter call CAN_FilterInit()
-                CAN_FilterInit(CAN3, &CAN_FilterInitStruct);
-            }
-            else if(i == idWhitelistSize - 1){ //we are out of elements, call CAN_FilterInit()
-                for(uint8_t j = i%NUM_FILTER_REGS + 1; j <= NUM_FILTER_REGS - 1; j++)   // Set unfilled filter registers to 0
-                    *(FilterStructPtr + j) = 0x0000;
-
-                CAN_FilterInit(CAN3, &CAN_FilterInitStruct);
-            }
-        }
-    }
-
-    // CAN_SlaveStartBank(CAN1, 0);
+    BSP_CAN_FilterInit(CAN_3, idWhitelist, idWhitelistSize, idPriorityList, idPriorityListSize);
 
-    /* Transmit Structure preparation */
-    gTxMessage[1].ExtId = 0x5;
-    gTxMessage[1].RTR = CAN_RTR_DATA;
-    gTxMessage[1].IDE = CAN_ID_STD;
-    gTxMessage[1].DLC = 1;
+    /* Enable FIFO 0 and FIFO 1 message pending Interrupts */
+    CAN_ITConfig(CAN3, CAN_IT_FMP0 | CAN_IT_FMP1, ENABLE);
 
-    /* Receive Structure preparation */
-    gRxMessage[1].StdId = 0x00;
-    gRxMessage[1].ExtId = 0x00;
-    gRxMessage[1].IDE = CAN_ID_STD;
-    gRxMessage[1].DLC = 0;
-    gRxMessage[1].FMI = 0;
-
-    /* Enable FIFO 0 message pending Interrupt */
-    CAN_ITConfig(CAN3, CAN_IT_FMP0, ENABLE);
-
-    //TODO: Double check preemption priority and subpriority
     // Enable Rx interrupts
+    // FIFO1 carries the high priority IDs, so it may preempt FIFO0 processing
     NVIC_InitStruct.NVIC_IRQChannel = CAN3_RX0_IRQn;
-    NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = 0x00;
+    NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = 0x01;
     NVIC_InitStruct.NVIC_IRQChannelSubPriority = 0x00;
     NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStruct);
 
+    NVIC_InitStruct.NVIC_IRQChannel = CAN3_RX1_IRQn;
+    NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = 0x00;
+    NVIC_Init(&NVIC_InitStruct);
+
     // Enable Tx interrupts
     if(NULL != gTxEnd[1]){ 
         CAN_ITConfig(CAN3,CAN_IT_TME,ENABLE);
@@ -330,6 +564,17 @@ void BSP_CAN3_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize)
     }
 }
 
+/**
+ * @brief   Sets the function the receive interrupt calls with each frame
+ * @param   bus : the CAN bus to hook
+ * @param   hook : the function to call, NULL for none
+ * @return  None
+ */
+void BSP_CAN_SetRxHook(CAN_t bus, CAN_RxHook_t hook)
+{
+    gRxHook[bus] = hook;
+}
+
 /**
  * @brief   Transmits the data onto the CAN bus with the specified id
  * @param   id : Message of ID. Also indicates the priority of message. The lower the value, the higher the priority.
@@ -337,23 +582,50 @@ void BSP_CAN3_Init(uint16_t* idWhitelist, uint8_t idWhitelistSize)
  * @param   length : num of bytes of data to be transmitted. This must be <= 8 bytes or else the rest of the message is dropped.
  * @return  ERROR if module was unable to transmit the data onto the CAN bus. SUCCESS indicates data was transmitted.
  */
-ErrorStatus BSP_CAN_Write(CAN_t bus, uint32_t id, uint8_t data[8], uint8_t length)
+ErrorStatus BSP_CAN_Write(CAN_t bus, uint32_t id, const uint8_t data[8], uint8_t length)
 {
-
-    memset(gTxMessage[bus].Data, 0, sizeof gTxMessage[bus].Data);
-    gTxMessage[bus].StdId = id;
-    gTxMessage[bus].DLC = length;
-    for (int i = 0; i < length; i++)
+    CAN_TypeDef *CANx = (bus == CAN_1) ? CAN1 : CAN3;
+    uint32_t tsr = CANx->TSR;
+    if (!(tsr & CAN_TSR_TME))
     {
-        gTxMessage[bus].Data[i] = data[i];
+        return ERROR;
     }
 
-    uint8_t retVal = (CAN_Transmit(bus == CAN_1 ? CAN1 : CAN3, &gTxMessage[bus]) != 0);
-    if (retVal == CAN_TxStatus_NoMailBox)
+    // Write the data straight into the mailbox registers that CODE says are free next
+    CAN_TxMailBox_TypeDef *mailbox = &CANx->sTxMailBox[(tsr & CAN_TSR_CODE) >> 24];
+    uint32_t lo, hi;
+    memcpy(&lo, &data[0], sizeof lo);
+    memcpy(&hi, &data[4], sizeof hi);
+    mailbox->TDTR = (mailbox->TDTR & ~CAN_TDT0R_DLC) | (length & CAN_TDT0R_DLC);
+    mailbox->TDLR = lo;
+    mailbox->TDHR = hi;
+    mailbox->TIR = (id << 21) | CAN_TI0R_TXRQ; // standard data frame, requested last
+
+    gStats[bus].txFrames++;
+    gStats[bus].bits += BSP_CAN_FrameBits(length);
+    return SUCCESS;
+}
+
+/**
+ * @brief   Checks whether a frame with the given ID is waiting in a transmit mailbox
+ * @param   bus : the CAN bus to check
+ * @param   id : the standard ID to look for
+ * @return  true if one of the mailboxes holds a frame with that ID
+ */
+bool BSP_CAN_TxIdPending(CAN_t bus, uint32_t id)
+{
+    CAN_TypeDef *CANx = (bus == CAN_1) ? CAN1 : CAN3;
+    static const uint32_t emptyFlags[3] = {CAN_TSR_TME0, CAN_TSR_TME1, CAN_TSR_TME2};
+    uint32_t tsr = CANx->TSR;
+
+    for (uint8_t i = 0; i < 3; i++)
     {
-        return ERROR;
+        if (!(tsr & emptyFlags[i]) && ((CANx->sTxMailBox[i].TIR >> 21) & 0x7FF) == id)
+        {
+            return true;
+        }
     }
-    return SUCCESS;
+    return false;
 }
 
 /**
@@ -364,60 +636,193 @@ ErrorStatus BSP_CAN_Write(CAN_t bus, uint32_t id, uint8_t data[8], uint8_t lengt
  * @param   data : pointer to store data that was received. Must be 8bytes or bigger.
  * @return  ERROR if nothing was received so ignore id and data that was received. SUCCESS indicates data was received and stored.
  */
-ErrorStatus BSP_CAN_Read(CAN_t bus, uint32_t *id, uint8_t *data)
+ErrorStatus BSP_CAN_Read(CAN_t bus, uint32_t *id, uint8_t *data, uint32_t *timestamp)
 {
-    // If the queue is empty, return err
-    if (msg_queue_is_empty(&gRxQueue[bus]))
+    const CAN_Frame_t *frame = BSP_CAN_Peek(bus);
+    if (frame == NULL)
     {
         return ERROR;
     }
 
-    // Get the message
-    msg_t msg;
-    msg_queue_get(&gRxQueue[bus], &msg);
-
     // Transfer the message to the provided pointers
-    for (int i = 0; i < 8; i++)
+    memcpy(data, frame->data, sizeof frame->data);
+    *id = frame->id;
+    if (timestamp != NULL)
     {
-        data[i] = msg.data[i];
+        *timestamp = frame->timestamp;
     }
-    *id = msg.id;
 
+    BSP_CAN_Release(bus);
     return SUCCESS;
 }
 
-void CAN3_RX0_IRQHandler()
+/**
+ * @brief   Gets the next received frame, leaving it in its receive queue slot
+ * @note    Non-blocking statement
+ * @param   bus : the CAN bus to read
+ * @return  the frame, or NULL if nothing was received
+ */
+const CAN_Frame_t* BSP_CAN_Peek(CAN_t bus)
 {
-    CPU_SR_ALLOC();
-    CPU_CRITICAL_ENTER();
-    OSIntEnter();
-    CPU_CRITICAL_EXIT();
+    // Always empty the high priority queue first
+    for(int lane = CAN_PRIO_HIGH; lane >= CAN_PRIO_NORMAL; lane--){
+        rx_ring_t *ring = &gRxQueue[bus][lane];
+        uint32_t tail = ring->tail;
 
-    // Take any pending messages into a queue
-    while (CAN_MessagePending(CAN3, CAN_FIFO0))
-    {
-        CAN_Receive(CAN3, CAN_FIFO0, &gRxMessage[1]);
+        if (ring->head == tail)
+        {
+            continue;
+        }
+        __DMB(); // don't read the slot before we've seen the ISR publish it
+
+        const CAN_Frame_t *frame = &ring->buffer[tail & ring->mask];
+        gPeekLane[bus] = lane;
+
+        // Bucket k of the histogram counts latencies of [2^k, 2^(k+1)) cycles
+        uint32_t latency = BSP_Cycles_Get() - frame->timestamp;
+        uint32_t bucket = 31 - __CLZ(latency | 1);
+        gStats[bus].latency[(bucket < CAN_LATENCY_BUCKETS) ? bucket : CAN_LATENCY_BUCKETS - 1]++;
+
+        return frame;
+    }
 
-        msg_t rxMsg;
-        rxMsg.id = gRxMessage[1].StdId;
-        memcpy(&rxMsg.data[0], gRxMessage[1].Data, 8);
+    // If both queues are empty, return err
+    return NULL;
+}
 
-        // Place the message in the queue
-        if (msg_queue_put(&gRxQueue[1], rxMsg))
+/**
+ * @brief   Frees the slot of the frame returned by the last BSP_CAN_Peek
+ * @param   bus : the CAN bus the frame was read from
+ * @return  None
+ */
+void BSP_CAN_Release(CAN_t bus)
+{
+    rx_ring_t *ring = &gRxQueue[bus][gPeekLane[bus]];
+    __DMB(); // finish reading the slot before handing it back to the ISR
+    ring->tail = ring->tail + 1;
+}
+
+/**
+ * @brief   Gets the receive queue statistics for a bus
+ * @param   bus : the CAN bus to report on
+ * @param   lane : which of the bus's receive queues to report on
+ * @param   stats : where to store the statistics
+ * @return  None
+ */
+void BSP_CAN_GetRxStats(CAN_t bus, CAN_Prio_t lane, CAN_RxStats_t *stats)
+{
+    rx_ring_t *ring = &gRxQueue[bus][lane];
+    stats->depth = ring->mask + 1;
+    stats->pending = ring->head - ring->tail;
+    stats->highWater = ring->highWater;
+    stats->overflows = ring->overflows;
+}
+
+/**
+ * @brief   Gets the traffic and error counters for a bus
+ * @param   bus : the CAN bus to report on
+ * @param   stats : where to store the counters
+ * @return  None
+ */
+void BSP_CAN_GetBusStats(CAN_t bus, CAN_BusStats_t *stats)
+{
+    uint32_t esr = ((bus == CAN_1) ? CAN1 : CAN3)->ESR;
+
+    stats->rxFrames = gStats[bus].rxFrames;
+    stats->txFrames = gStats[bus].txFrames;
+    stats->bits = gStats[bus].bits;
+    stats->fifoOverruns = gStats[bus].fifoOverruns;
+    stats->overflows = gRxQueue[bus][CAN_PRIO_NORMAL].overflows + gRxQueue[bus][CAN_PRIO_HIGH].overflows;
+    stats->bitRate = gStats[bus].bitRate;
+    stats->tec = (esr & CAN_ESR_TEC) >> 16;
+    stats->rec = (esr & CAN_ESR_REC) >> 24;
+    stats->lec = (esr & CAN_ESR_LEC) >> 4;
+    memcpy(stats->latency, gStats[bus].latency, sizeof stats->latency);
+}
+
+/**
+ * @brief   Moves every frame waiting in a hardware FIFO into its software queue.
+ *          Frames are always released from the hardware FIFO; if the software queue
+ *          is full the frame is dropped and counted instead.
+ * @param   bus : the CAN bus being serviced
+ * @param   CANx : the peripheral for that bus
+ * @param   lane : CAN_PRIO_NORMAL to service FIFO0, CAN_PRIO_HIGH to service FIFO1
+ */
+static void BSP_CAN_RxDrain(CAN_t bus, CAN_TypeDef *CANx, CAN_Prio_t lane)
+{
+    rx_ring_t *ring = &gRxQueue[bus][lane];
+    CAN_FIFOMailBox_TypeDef *mailbox = &CANx->sFIFOMailBox[lane == CAN_PRIO_HIGH ? CAN_FIFO1 : CAN_FIFO0];
+    volatile uint32_t *rfr = (lane == CAN_PRIO_HIGH) ? &CANx->RF1R : &CANx->RF0R; // RF0R and RF1R share a layout
+    uint32_t head = ring->head;
+
+    // The hardware FIFO filled up before we got to it, so at least one frame was lost
+    if (*rfr & CAN_RF0R_FOVR0)
+    {
+        gStats[bus].fifoOverruns++;
+        *rfr = CAN_RF0R_FOVR0; // write 1 to clear, writing 0 to the other bits does nothing
+    }
+
+    while (*rfr & CAN_RF0R_FMP0)
+    {
+        uint32_t timestamp = BSP_Cycles_Get();
+        uint32_t fill = head - ring->tail;
+        bool room = (fill <= ring->mask);
+
+        // Copy straight out of the mailbox registers into the slot. If the queue is full,
+        // the frame still goes to the hook from a scratch copy.
+        CAN_Frame_t spill;
+        CAN_Frame_t *slot = room ? &ring->buffer[head & ring->mask] : &spill;
+        uint32_t lo = mailbox->RDLR;
+        uint32_t hi = mailbox->RDHR;
+        slot->id = (mailbox->RIR >> 21) & 0x7FF;
+        uint8_t dlc = mailbox->RDTR & CAN_RDT0R_DLC;
+        slot->len = (dlc > 8) ? 8 : dlc;
+        slot->timestamp = timestamp;
+        memcpy(&slot->data[0], &lo, sizeof lo);
+        memcpy(&slot->data[4], &hi, sizeof hi);
+
+        CAN_RxHook_t hook = gRxHook[bus];
+        bool wanted = (hook == NULL) || hook(bus, slot);
+        bool kept = wanted && room;
+
+        if (kept)
         {
-            // If the queue was not already full...
-            // Call the driver-provided function, if it is not null
-            if (gRxEvent[1] != NULL)
+            __DMB(); // slot contents must land before the task can see the new head
+            ring->head = ++head;
+
+            if (++fill > ring->highWater)
             {
-                gRxEvent[1]();
+                ring->highWater = fill;
             }
         }
-        else
+        else if (wanted)
+        {
+            ring->overflows++;
+        }
+
+        gStats[bus].rxFrames++;
+        gStats[bus].bits += BSP_CAN_FrameBits(mailbox->RDTR & CAN_RDT0R_DLC);
+
+        // Release the hardware FIFO entry whether or not we kept the frame
+        *rfr = CAN_RF0R_RFOM0; // a plain write, so overrun and full flags set meanwhile stay set
+
+        // Call the driver-provided function, if it is not null
+        if (kept && gRxEvent[bus] != NULL)
         {
-            // If the queue is already full, then we can't really do anything else
-            break;
+            gRxEvent[bus]();
         }
     }
+}
+
+void CAN3_RX0_IRQHandler()
+{
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    OSIntEnter();
+    CPU_CRITICAL_EXIT();
+
+    // Take any pending messages into a queue
+    BSP_CAN_RxDrain(CAN_3, CAN3, CAN_PRIO_NORMAL);
 
     OSIntExit(); // Signal to uC/OS
 }
@@ -430,30 +835,33 @@ void CAN1_RX0_IRQHandler(void)
     CPU_CRITICAL_EXIT();
 
     // Take any pending messages into a queue
-    while (CAN_MessagePending(CAN1, CAN_FIFO0))
-    {
-        CAN_Receive(CAN1, CAN_FIFO0, &gRxMessage[0]);
+    BSP_CAN_RxDrain(CAN_1, CAN1, CAN_PRIO_NORMAL);
 
-        msg_t rxMsg;
-        rxMsg.id = gRxMessage[0].StdId;
-        memcpy(&rxMsg.data[0], gRxMessage[0].Data, 8);
+    OSIntExit(); // Signal to uC/OS
+}
 
-        // Place the message in the queue
-        if (msg_queue_put(&gRxQueue[0], rxMsg))
-        {
-            // If the queue was not already full...
-            // Call the driver-provided function, if it is not null
-            if (gRxEvent[0] != NULL)
-            {
-                gRxEvent[0]();
-            }
-        }
-        else
-        {
-            // If the queue is already full, then we can't really do anything else
-            break;
-        }
-    }
+void CAN3_RX1_IRQHandler(void)
+{
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    OSIntEnter();
+    CPU_CRITICAL_EXIT();
+
+    // Take any pending high priority messages into their queue
+    BSP_CAN_RxDrain(CAN_3, CAN3, CAN_PRIO_HIGH);
+
+    OSIntExit(); // Signal to uC/OS
+}
+
+void CAN1_RX1_IRQHandler(void)
+{
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    OSIntEnter();
+    CPU_CRITICAL_EXIT();
+
+    // Take any pending high priority messages into their queue
+    BSP_CAN_RxDrain(CAN_1, CAN1, CAN_PRIO_HIGH);
 
     OSIntExit(); // Signal to uC/OS
 }
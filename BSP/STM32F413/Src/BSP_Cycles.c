@@ -0,0 +1,22 @@
+/* Copyright (c) 2023 UT Longhorn Racing Solar */
+
+#include "BSP_Cycles.h"
+
+/**
+ * @brief   Starts the DWT cycle counter. Safe to call more than once;
+ *          the counter is not reset.
+ * @return  None
+ */
+void BSP_Cycles_Init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief   Converts a number of cycles to microseconds
+ * @param   cycles the number of cycles
+ * @return  the number of microseconds
+ */
+uint32_t BSP_Cycles_ToMicros(uint32_t cycles) {
+    return (uint32_t)(((uint64_t)cycles * 1000000) / SystemCoreClock);
+}
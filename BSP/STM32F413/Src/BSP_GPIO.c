@@ -1,8 +1,13 @@
 /* Copyright (c) 2021 UT Longhorn Racing Solar */
 
 #include "BSP_GPIO.h"
+#include "BSP_Cycles.h"
 #include "Tasks.h"
 
+// Edge handlers and their ports, by pin number (EXTI line)
+static GPIO_EdgeHandler_t edgeHandlers[16];
+static GPIO_TypeDef *edgePorts[16];
+
 GPIO_TypeDef* GPIO_GetPort(port_t port){
  	const GPIO_TypeDef* gpio_mapping[4] = {GPIOA, GPIOB, GPIOC, GPIOD};
 
@@ -108,3 +113,79 @@ uint8_t BSP_GPIO_Get_State(port_t port, uint16_t pin){
 
 	return GPIO_ReadOutputDataBit(gpio_port, pin);	
 }
+
+
+
+/**
+ * @brief   Calls a handler from the EXTI interrupt on every rising and falling edge of an input pin.
+ * @param   port The port of the pin, already initialized as an input
+ * @param   pinmask Mask from stm header file that says which pin to watch (a single pin)
+ * @param   handler Called with the new level on each edge
+ * @return  None
+ */
+
+void BSP_GPIO_Init_Interrupt(port_t port, uint16_t pinmask, GPIO_EdgeHandler_t handler){
+	uint8_t pin = __builtin_ctz(pinmask);
+	static const uint8_t irqs[16] = {
+		EXTI0_IRQn, EXTI1_IRQn, EXTI2_IRQn, EXTI3_IRQn, EXTI4_IRQn,
+		EXTI9_5_IRQn, EXTI9_5_IRQn, EXTI9_5_IRQn, EXTI9_5_IRQn, EXTI9_5_IRQn,
+		EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn,
+	};
+
+	BSP_Cycles_Init();	// Timestamps the edges
+	edgePorts[pin] = GPIO_GetPort(port);
+	edgeHandlers[pin] = handler;
+
+	// Route the pin to its EXTI line
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_SYSCFG, ENABLE);
+	SYSCFG_EXTILineConfig(port, pin);	// EXTI_PortSourceGPIOx and EXTI_PinSourcex are the port and pin numbers
+
+	EXTI_InitTypeDef EXTI_InitStruct;
+	EXTI_InitStruct.EXTI_Line = pinmask;	// EXTI_Linex is the pin mask
+	EXTI_InitStruct.EXTI_Mode = EXTI_Mode_Interrupt;
+	EXTI_InitStruct.EXTI_Trigger = EXTI_Trigger_Rising_Falling;
+	EXTI_InitStruct.EXTI_LineCmd = ENABLE;
+	EXTI_ClearITPendingBit(pinmask);
+	EXTI_Init(&EXTI_InitStruct);
+
+	NVIC_InitTypeDef NVIC_InitStruct;
+	NVIC_InitStruct.NVIC_IRQChannel = irqs[pin];
+	NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = 0x01;
+	NVIC_InitStruct.NVIC_IRQChannelSubPriority = 0x00;
+	NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStruct);
+}
+
+/**
+ * @brief   Calls the handlers of every pending EXTI line in a range
+ * @param   first the first line the interrupt is shared by
+ * @param   last the last line the interrupt is shared by
+ * @return  None
+ */
+static void dispatchEdges(uint8_t first, uint8_t last){
+	CPU_SR_ALLOC();
+	CPU_CRITICAL_ENTER();
+	OSIntEnter();
+	CPU_CRITICAL_EXIT();
+
+	uint32_t timestamp = BSP_Cycles_Get();
+	for(uint8_t pin = first; pin <= last; pin++){
+		uint16_t line = 1 << pin;
+		if(EXTI_GetITStatus(line) == SET){
+			EXTI_ClearITPendingBit(line);
+			if(edgeHandlers[pin] != NULL){
+				edgeHandlers[pin](GPIO_ReadInputDataBit(edgePorts[pin], line) == Bit_SET, timestamp);
+			}
+		}
+	}
+
+	OSIntExit();
+}
+
+void EXTI0_IRQHandler(void){ dispatchEdges(0, 0); }
+void EXTI1_IRQHandler(void){ dispatchEdges(1, 1); }
+void EXTI2_IRQHandler(void){ dispatchEdges(2, 2); }
+void EXTI3_IRQHandler(void){ dispatchEdges(3, 3); }
+void EXTI4_IRQHandler(void){ dispatchEdges(4, 4); }
+void EXTI9_5_IRQHandler(void){ dispatchEdges(5, 9); }
+void EXTI15_10_IRQHandler(void){ dispatchEdges(10, 15); }
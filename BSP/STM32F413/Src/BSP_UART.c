@@ -3,19 +3,14 @@
 #include "BSP_UART.h"
 #include "stm32f4xx.h"
 #include "os.h"
+#include "Tasks.h"
 
-#define TX_SIZE     128
-#define RX_SIZE     64
+#define TX_SIZE     512     // Must be a power of two
+#define TX_COPY_MAX 64      // Most bytes copied in with interrupts off at once
+#define RX_SIZE     256     // Fits the replies to a full display frame in raw mode
 
 // Initialize the FIFOs
 
-#define FIFO_TYPE char
-#define FIFO_SIZE TX_SIZE
-#define FIFO_NAME txfifo
-#include "fifo.h"
-static txfifo_t usbTxFifo;
-static txfifo_t displayTxFifo;
-
 #define FIFO_TYPE char
 #define FIFO_SIZE RX_SIZE
 #define FIFO_NAME rxfifo
@@ -23,21 +18,168 @@ static txfifo_t displayTxFifo;
 static rxfifo_t usbRxFifo;
 static rxfifo_t displayRxFifo;
 
+// Transmit rings, emptied by DMA. Writers add bytes at head and the DMA sends
+// them from tail. Both only count up, so head - tail is the number queued.
+typedef struct {
+    char buffer[TX_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t inFlight;     // Length of the transfer being sent, 0 when idle
+    volatile uint32_t waiters;      // Tasks pending on space
+    OS_SEM space;                   // Posted after each transfer while a task waits
+    UART_TxStats_t stats;
+} txring_t;
+static txring_t txRings[NUM_UART];
+
 static bool usbLineReceived = false;
 static bool displayLineReceived = false;
 
+// Raw UARTs keep every byte received, without echo or line editing
+static volatile bool rawMode[NUM_UART] = {false, false};
+
 static callback_t usbRxCallback = NULL;
-static callback_t usbTxCallback = NULL;
 static callback_t displayRxCallback = NULL;
-static callback_t displayTxCallback = NULL;
+static callback_t txCallbacks[NUM_UART] = {NULL, NULL};
 
 static rxfifo_t *rx_fifos[NUM_UART]     = {&usbRxFifo, &displayRxFifo};
-static txfifo_t *tx_fifos[NUM_UART]     = {&usbTxFifo, &displayTxFifo};
 static bool     *lineRecvd[NUM_UART]    = {&usbLineReceived, &displayLineReceived};
 static USART_TypeDef *handles[NUM_UART] = {USART2, USART3};
 
+// USART2 TX is DMA1 stream 6 and USART3 TX is DMA1 stream 3, both on channel 4
+static DMA_Stream_TypeDef *txStreams[NUM_UART] = {DMA1_Stream6, DMA1_Stream3};
+static const IRQn_Type txStreamIRQs[NUM_UART] = {DMA1_Stream6_IRQn, DMA1_Stream3_IRQn};
+static const uint32_t txDoneFlags[NUM_UART]   = {DMA_FLAG_TCIF6, DMA_FLAG_TCIF3};
+static const uint32_t txAllFlags[NUM_UART]    = {
+    DMA_FLAG_TCIF6 | DMA_FLAG_HTIF6 | DMA_FLAG_TEIF6 | DMA_FLAG_DMEIF6 | DMA_FLAG_FEIF6,
+    DMA_FLAG_TCIF3 | DMA_FLAG_HTIF3 | DMA_FLAG_TEIF3 | DMA_FLAG_DMEIF3 | DMA_FLAG_FEIF3,
+};
+
+/**
+ * @brief   Sets up the DMA stream that sends a UART's transmit ring. Each transfer
+ *          is started by hand and interrupts once when it completes.
+ * @param   uart the UART, whose USART must already be initialized
+ * @return  None
+ */
+static void TX_InitDMA(UART_t uart) {
+    txring_t *ring = &txRings[uart];
+    ring->head = ring->tail = ring->inFlight = ring->waiters = 0;
+
+    OS_ERR err;
+    OSSemCreate(&ring->space, (uart == UART_2 ? "UART 2 TX space" : "UART 3 TX space"), 0, &err);
+    assertOSError(err);
+
+    RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+
+    DMA_InitTypeDef DMA_InitStruct;
+    DMA_InitStruct.DMA_Channel = DMA_Channel_4;
+    DMA_InitStruct.DMA_PeripheralBaseAddr = (uint32_t)&(handles[uart]->DR);
+    DMA_InitStruct.DMA_Memory0BaseAddr = (uint32_t)ring->buffer;
+    DMA_InitStruct.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+    DMA_InitStruct.DMA_BufferSize = 1;     // Set for each transfer
+    DMA_InitStruct.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStruct.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStruct.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStruct.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStruct.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStruct.DMA_Priority = DMA_Priority_Low;
+    DMA_InitStruct.DMA_FIFOMode = DMA_FIFOMode_Disable;
+    DMA_InitStruct.DMA_FIFOThreshold = DMA_FIFOThreshold_HalfFull;
+    DMA_InitStruct.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+    DMA_InitStruct.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+    DMA_Cmd(txStreams[uart], DISABLE);
+    DMA_Init(txStreams[uart], &DMA_InitStruct);
+    DMA_ITConfig(txStreams[uart], DMA_IT_TC, ENABLE);
+
+    // Same priority as the USART, so the two handlers never preempt each other
+    NVIC_InitTypeDef NVIC_InitStructure;
+    NVIC_InitStructure.NVIC_IRQChannel = txStreamIRQs[uart];
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+
+    USART_DMACmd(handles[uart], USART_DMAReq_Tx, ENABLE);
+}
+
+/**
+ * @brief   Starts sending the queued bytes up to the end of the ring, unless a
+ *          transfer is already in flight. Call with interrupts disabled.
+ * @param   uart the UART
+ * @return  None
+ */
+static void TX_Start(UART_t uart) {
+    txring_t *ring = &txRings[uart];
+    uint32_t queued = ring->head - ring->tail;
+    if (ring->inFlight != 0 || queued == 0) return;
+
+    // Bytes that wrap around to the front go in the next transfer
+    uint32_t start = ring->tail % TX_SIZE;
+    uint32_t len = TX_SIZE - start;
+    if (len > queued) len = queued;
+
+    DMA_Stream_TypeDef *stream = txStreams[uart];
+    DMA_ClearFlag(stream, txAllFlags[uart]);
+    stream->M0AR = (uint32_t)&ring->buffer[start];
+    stream->NDTR = len;
+    ring->inFlight = len;
+    DMA_Cmd(stream, ENABLE);
+}
+
+/**
+ * @brief   Frees the bytes of the transfer that just completed, starts the next
+ *          one and wakes any task waiting for space. Call with interrupts disabled.
+ * @param   uart the UART
+ * @return  None
+ */
+static void TX_Complete(UART_t uart) {
+    txring_t *ring = &txRings[uart];
+    DMA_ClearFlag(txStreams[uart], txAllFlags[uart]);
+    ring->tail += ring->inFlight;
+    ring->stats.bytes += ring->inFlight;
+    ring->stats.transfers++;
+    ring->inFlight = 0;
+
+    TX_Start(uart);
+
+    if (ring->waiters > 0) {
+        OS_ERR err;
+        OSSemPost(&ring->space, OS_OPT_POST_ALL, &err);
+        assertOSError(err);
+    }
+    if (ring->inFlight == 0 && txCallbacks[uart] != NULL) {
+        txCallbacks[uart]();
+    }
+}
+
+/**
+ * @brief   Queues one byte from an interrupt, dropping it if the ring is full
+ * @param   uart the UART
+ * @param   data the byte
+ * @return  None
+ */
+static void TX_PutFromISR(UART_t uart, char data) {
+    txring_t *ring = &txRings[uart];
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    if (ring->head - ring->tail < TX_SIZE) {
+        ring->buffer[ring->head % TX_SIZE] = data;
+        ring->head++;
+        TX_Start(uart);
+    } else {
+        ring->stats.dropped++;
+    }
+    CPU_CRITICAL_EXIT();
+}
+
+/**
+ * @brief   Whether the caller may pend on an OS object: a task, with the OS
+ *          running and the scheduler unlocked
+ */
+static bool canPend(void) {
+    return OSRunning == OS_STATE_OS_RUNNING && OSIntNestingCtr == 0 && OSSchedLockNestingCtr == 0;
+}
+
 static void USART_DISPLAY_Init() {
-    displayTxFifo = txfifo_new();
     displayRxFifo = rxfifo_new();
 
     GPIO_InitTypeDef GPIO_InitStruct = {0};
@@ -73,6 +215,7 @@ static void USART_DISPLAY_Init() {
     // Enable interrupts
 
     USART_Cmd(USART3, ENABLE);
+    TX_InitDMA(UART_3);
 
     // Enable NVIC
     NVIC_InitTypeDef NVIC_InitStructure;
@@ -84,7 +227,6 @@ static void USART_DISPLAY_Init() {
 }
 
 static void USART_USB_Init() {
-    usbTxFifo = txfifo_new();
     usbRxFifo = rxfifo_new();
 
     GPIO_InitTypeDef GPIO_InitStruct = {0};
@@ -115,6 +257,7 @@ static void USART_USB_Init() {
     USART_Init(USART2, &UART_InitStruct);
 
     USART_Cmd(USART2, ENABLE);
+    TX_InitDMA(UART_2);
 
     // Enable NVIC
     NVIC_InitTypeDef NVIC_InitStructure;
@@ -135,17 +278,16 @@ static void BSP_UART_Init_Internal(callback_t rxCallback, callback_t txCallback,
     case UART_2: // their UART_USB
         USART_USB_Init();
         usbRxCallback = rxCallback;
-        usbTxCallback = txCallback;
         break;
     case UART_3: // their UART_DISPLAY
         USART_DISPLAY_Init();
         displayRxCallback = rxCallback;
-        displayTxCallback = txCallback;
         break;
     default:
         // Error
-        break;
+        return;
     }
+    txCallbacks[uart] = txCallback;
 }
 
 void BSP_UART_Init(UART_t uart) {
@@ -153,6 +295,38 @@ void BSP_UART_Init(UART_t uart) {
     BSP_UART_Init_Internal(NULL, NULL, uart);
 }
 
+/**
+ * @brief   Initializes the UART peripheral to receive binary data. Every byte
+ *          received is stored for BSP_UART_ReadRaw, without being echoed.
+ */
+void BSP_UART_InitRaw(UART_t uart) {
+    if(uart >= NUM_UART) return;
+    rawMode[uart] = true;
+    BSP_UART_Init_Internal(NULL, NULL, uart);
+    USART_ITConfig(handles[uart], USART_IT_RXNE, ENABLE);
+}
+
+/**
+ * @brief   Takes the bytes received so far on a raw UART, without waiting
+ * @param   usart : which usart to read from
+ * @param   buf : where to copy the bytes
+ * @param   len : most bytes to copy
+ * @return  number of bytes copied
+ */
+uint32_t BSP_UART_ReadRaw(UART_t usart, char *buf, uint32_t len) {
+    rxfifo_t *fifo = rx_fifos[usart];
+    uint32_t recvd = 0;
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    while(recvd < len && rxfifo_get(fifo, &buf[recvd])) {
+        recvd++;
+    }
+    CPU_CRITICAL_EXIT();
+
+    return recvd;
+}
+
 /**
  * @brief   Gets one line of ASCII text that was received. The '\n' and '\r' characters will not be stored (tested on Putty on Windows)
  * @pre     str should be at least 128bytes long.
@@ -198,36 +372,93 @@ uint32_t BSP_UART_Read(UART_t usart, char *str) {
  * @param   usart : which usart to read from (2 or 3)
  * @return  number of bytes that were sent
  * 
- * @note This function uses a fifo to buffer the write. If that
- *       fifo is full, this function may block while waiting for
- *       space to open up. Do not call from timing-critical
- *       sections of code.
+ * @note This function copies the data into a ring that DMA sends
+ *       in the background. If the ring is full, a task pends until
+ *       a transfer frees space. Before the OS starts, in interrupts
+ *       and with the scheduler locked it busy-waits instead.
  */
 uint32_t BSP_UART_Write(UART_t usart, char *str, uint32_t len) {
+    txring_t *ring = &txRings[usart];
     uint32_t sent = 0;
+    CPU_SR_ALLOC();
 
-    USART_TypeDef *usart_handle = handles[usart];
+    while(sent < len) {
+        bool pend = canPend();
+
+        CPU_CRITICAL_ENTER();
+        uint32_t head = ring->head;
+        uint32_t count = TX_SIZE - (head - ring->tail);
+        if(count > len - sent) count = len - sent;
+        if(count > TX_COPY_MAX) count = TX_COPY_MAX;
+
+        // Copy in up to two pieces, when the free space wraps around
+        uint32_t start = head % TX_SIZE;
+        uint32_t first = (count < TX_SIZE - start) ? count : TX_SIZE - start;
+        memcpy(&ring->buffer[start], &str[sent], first);
+        memcpy(ring->buffer, &str[sent + first], count - first);
+        ring->head = head + count;
+        sent += count;
+        TX_Start(usart);
+
+        bool full = (count == 0);
+        if(full && pend) {
+            ring->waiters++;
+            ring->stats.waits++;
+        } else if(full && DMA_GetFlagStatus(txStreams[usart], txDoneFlags[usart]) != RESET) {
+            // Can't pend, and the interrupt may be masked: finish the transfer here
+            TX_Complete(usart);
+        }
+        CPU_CRITICAL_EXIT();
+
+        if(full && pend) {
+            OS_ERR err;
+            OSSemPend(&ring->space, 0, OS_OPT_PEND_BLOCKING, NULL, &err);
+            assertOSError(err);
+            CPU_CRITICAL_ENTER();
+            ring->waiters--;
+            CPU_CRITICAL_EXIT();
+        }
+    }
 
-    USART_ITConfig(usart_handle, USART_IT_TC, RESET);
+    return sent;
+}
 
-    txfifo_t *fifo = tx_fifos[usart];
+/**
+ * @brief   Gets the transmit counters of a UART
+ * @param   usart : which usart
+ * @param   stats : where to copy them
+ * @return  None
+ */
+void BSP_UART_Get_TxStats(UART_t usart, UART_TxStats_t *stats) {
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    *stats = txRings[usart].stats;
+    stats->queued = txRings[usart].head - txRings[usart].tail;
+    CPU_CRITICAL_EXIT();
+}
 
-    while(sent < len) {
-        if(!txfifo_put(fifo, str[sent])) {
-            // Allow the interrupt to fire
-            USART_ITConfig(usart_handle, USART_IT_TC, SET);
-            // Wait for space to open up
-            while(txfifo_is_full(fifo));
-            // Disable the interrupt again
-            USART_ITConfig(usart_handle, USART_IT_TC, RESET);
-        } else {
-            sent++;  
-        }
+/**
+ * @brief   Handles the end of a transmit DMA transfer
+ */
+static void TX_IRQHandler(UART_t uart) {
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    OSIntEnter();
+    // A writer that could not pend may have completed it already
+    if(DMA_GetFlagStatus(txStreams[uart], txDoneFlags[uart]) != RESET) {
+        TX_Complete(uart);
     }
+    CPU_CRITICAL_EXIT();
+
+    OSIntExit();
+}
 
-    USART_ITConfig(usart_handle, USART_IT_TC, SET);
+void DMA1_Stream6_IRQHandler(void) {
+    TX_IRQHandler(UART_2);
+}
 
-    return sent;
+void DMA1_Stream3_IRQHandler(void) {
+    TX_IRQHandler(UART_3);
 }
 
 void USART2_IRQHandler(void) {
@@ -236,7 +467,10 @@ void USART2_IRQHandler(void) {
     OSIntEnter();
     CPU_CRITICAL_EXIT();
 
-    if(USART_GetFlagStatus(USART2, USART_FLAG_RXNE) != RESET) {
+    if(USART_GetFlagStatus(USART2, USART_FLAG_RXNE) != RESET && rawMode[UART_2]) {
+        rxfifo_put(&usbRxFifo, USART2->DR);
+    }
+    else if(USART_GetFlagStatus(USART2, USART_FLAG_RXNE) != RESET) {
         uint8_t data = USART2->DR;
         bool removeSuccess = 1;
         if(data == '\r' || data == '\n'){
@@ -257,19 +491,10 @@ void USART2_IRQHandler(void) {
             char junk;
             // Delete the last entry!
             removeSuccess = rxfifo_popback(&usbRxFifo, &junk); 
-
-            USART_SendData(UART_2, 0x7F);   // TODO: Not sure if the backspace works. Need to test
         }
+        // Echo through the transmit ring, so it can't clobber a transfer
         if(removeSuccess) {
-            USART2->DR = data;
-        }
-    }
-    if(USART_GetITStatus(USART2, USART_IT_TC) != RESET) {
-        // If getting data from fifo fails i.e. the tx fifo is empty, then turn off the TX interrupt
-        if(!txfifo_get(&usbTxFifo, (char*)&(USART2->DR))) {
-            USART_ITConfig(USART2, USART_IT_TC, RESET); // Turn off the interrupt
-            if(usbTxCallback != NULL)
-                usbTxCallback();    // Callback
+            TX_PutFromISR(UART_2, data);
         }
     }
     if(USART_GetITStatus(USART2, USART_IT_ORE) != RESET);
@@ -285,7 +510,11 @@ void USART3_IRQHandler(void) {
     OSIntEnter();
     CPU_CRITICAL_EXIT();
 
-    if(USART_GetITStatus(USART3, USART_IT_RXNE) != RESET) {
+    if(USART_GetITStatus(USART3, USART_IT_RXNE) != RESET && rawMode[UART_3]) {
+        // Replies from the display are binary: keep them all and don't echo
+        rxfifo_put(&displayRxFifo, USART3->DR);
+    }
+    else if(USART_GetITStatus(USART3, USART_IT_RXNE) != RESET) {
         uint8_t data = USART3->DR;
         bool removeSuccess = 1;
         if(data == '\r'){
@@ -306,15 +535,7 @@ void USART3_IRQHandler(void) {
             removeSuccess = rxfifo_popback(&displayRxFifo, &junk);
         }
         if(removeSuccess) {
-            USART3->DR = data;
-        }
-    }
-    if(USART_GetITStatus(USART3, USART_IT_TC) != RESET) {
-        // If getting data from fifo fails i.e. the tx fifo is empty, then turn off the TX interrupt
-        if(!txfifo_get(&displayTxFifo, (char*)&(USART3->DR))) {
-            USART_ITConfig(USART3, USART_IT_TC, RESET);
-            if(displayTxCallback != NULL)
-                displayTxCallback();
+            TX_PutFromISR(UART_3, data);
         }
     }
     if(USART_GetITStatus(USART3, USART_IT_ORE) != RESET);
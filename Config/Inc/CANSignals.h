@@ -0,0 +1,830 @@
+/**
+ * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
+ * @file CANSignals.h
+ * @brief Pack/unpack functions for the signals of every CAN message.
+ *
+ * GENERATED by Scripts/can_codegen.py from Config/CAN/Controls.dbc. Do not edit by hand.
+ *
+ * Getters read a signal straight out of a message's data bytes, setters write one into them.
+ * Every access goes through memcpy, so the data does not need to be aligned; the compiler
+ * turns each one into a single load or store. Scaled signals are converted with integer math,
+ * in 32 bits unless a value could overflow them. Setters of scaled signals expect values
+ * within the signal's range in the DBC.
+ * Only depends on the C standard library so host tools can include it too.
+ * Assumes a little-endian target, like CAN payloads.
+ *
+ * @defgroup CANSignals
+ * @addtogroup CANSignals
+ * @{
+ */
+
+#ifndef CAN_SIGNALS_H
+#define CAN_SIGNALS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// BPS_TRIP (0x002), 8 bytes
+typedef struct {
+    uint8_t Trip;
+} CAN_BPS_TRIP_t;
+
+static inline uint8_t CAN_BPS_TRIP_GetTrip(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[0], sizeof raw);
+    return raw;
+}
+static inline void CAN_BPS_TRIP_SetTrip(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[0], &raw, sizeof raw);
+}
+static inline void CAN_BPS_TRIP_Unpack(const uint8_t* data, CAN_BPS_TRIP_t* out){
+    out->Trip = CAN_BPS_TRIP_GetTrip(data);
+}
+static inline void CAN_BPS_TRIP_Pack(uint8_t* data, const CAN_BPS_TRIP_t* in){
+    CAN_BPS_TRIP_SetTrip(data, in->Trip);
+}
+
+// BPS_CONTACTOR (0x102), 8 bytes
+typedef struct {
+    bool ArrayContactor;
+    bool HVMinusContactor;
+    bool HVPlusContactor;
+} CAN_BPS_CONTACTOR_t;
+
+static inline bool CAN_BPS_CONTACTOR_GetArrayContactor(const uint8_t* data){
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 1);
+    uint8_t raw = (uint8_t)(bits & 0x1u);
+    return raw != 0;
+}
+static inline void CAN_BPS_CONTACTOR_SetArrayContactor(uint8_t* data, bool value){
+    uint8_t raw = (uint8_t)value;
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 1);
+    bits = (bits & ~0x1ull) | ((uint64_t)raw & 0x1ull);
+    memcpy(&data[0], &bits, 1);
+}
+static inline bool CAN_BPS_CONTACTOR_GetHVMinusContactor(const uint8_t* data){
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 1);
+    uint8_t raw = (uint8_t)((bits >> 1) & 0x1u);
+    return raw != 0;
+}
+static inline void CAN_BPS_CONTACTOR_SetHVMinusContactor(uint8_t* data, bool value){
+    uint8_t raw = (uint8_t)value;
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 1);
+    bits = (bits & ~0x2ull) | (((uint64_t)raw << 1) & 0x2ull);
+    memcpy(&data[0], &bits, 1);
+}
+static inline bool CAN_BPS_CONTACTOR_GetHVPlusContactor(const uint8_t* data){
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 1);
+    uint8_t raw = (uint8_t)((bits >> 2) & 0x1u);
+    return raw != 0;
+}
+static inline void CAN_BPS_CONTACTOR_SetHVPlusContactor(uint8_t* data, bool value){
+    uint8_t raw = (uint8_t)value;
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 1);
+    bits = (bits & ~0x4ull) | (((uint64_t)raw << 2) & 0x4ull);
+    memcpy(&data[0], &bits, 1);
+}
+static inline void CAN_BPS_CONTACTOR_Unpack(const uint8_t* data, CAN_BPS_CONTACTOR_t* out){
+    out->ArrayContactor = CAN_BPS_CONTACTOR_GetArrayContactor(data);
+    out->HVMinusContactor = CAN_BPS_CONTACTOR_GetHVMinusContactor(data);
+    out->HVPlusContactor = CAN_BPS_CONTACTOR_GetHVPlusContactor(data);
+}
+static inline void CAN_BPS_CONTACTOR_Pack(uint8_t* data, const CAN_BPS_CONTACTOR_t* in){
+    CAN_BPS_CONTACTOR_SetArrayContactor(data, in->ArrayContactor);
+    CAN_BPS_CONTACTOR_SetHVMinusContactor(data, in->HVMinusContactor);
+    CAN_BPS_CONTACTOR_SetHVPlusContactor(data, in->HVPlusContactor);
+}
+
+// CURRENT_DATA (0x103), 8 bytes
+typedef struct {
+    int32_t Current; // mA
+} CAN_CURRENT_DATA_t;
+
+static inline int32_t CAN_CURRENT_DATA_GetCurrent(const uint8_t* data){
+    int32_t raw;
+    memcpy(&raw, &data[0], sizeof raw);
+    return raw;
+}
+static inline void CAN_CURRENT_DATA_SetCurrent(uint8_t* data, int32_t value){
+    int32_t raw = (int32_t)value;
+    memcpy(&data[0], &raw, sizeof raw);
+}
+static inline void CAN_CURRENT_DATA_Unpack(const uint8_t* data, CAN_CURRENT_DATA_t* out){
+    out->Current = CAN_CURRENT_DATA_GetCurrent(data);
+}
+static inline void CAN_CURRENT_DATA_Pack(uint8_t* data, const CAN_CURRENT_DATA_t* in){
+    CAN_CURRENT_DATA_SetCurrent(data, in->Current);
+}
+
+// STATE_OF_CHARGE (0x106), 8 bytes
+typedef struct {
+    int32_t StateOfCharge; // %
+} CAN_STATE_OF_CHARGE_t;
+
+static inline int32_t CAN_STATE_OF_CHARGE_GetStateOfCharge(const uint8_t* data){
+    uint32_t raw;
+    memcpy(&raw, &data[0], sizeof raw);
+    return (int32_t)(((uint32_t)raw) / 1000000u);
+}
+static inline void CAN_STATE_OF_CHARGE_SetStateOfCharge(uint8_t* data, int32_t value){
+    uint32_t raw = (uint32_t)((uint32_t)value * 1000000u);
+    memcpy(&data[0], &raw, sizeof raw);
+}
+static inline void CAN_STATE_OF_CHARGE_Unpack(const uint8_t* data, CAN_STATE_OF_CHARGE_t* out){
+    out->StateOfCharge = CAN_STATE_OF_CHARGE_GetStateOfCharge(data);
+}
+static inline void CAN_STATE_OF_CHARGE_Pack(uint8_t* data, const CAN_STATE_OF_CHARGE_t* in){
+    CAN_STATE_OF_CHARGE_SetStateOfCharge(data, in->StateOfCharge);
+}
+
+// SUPPLEMENTAL_VOLTAGE (0x10B), 8 bytes
+typedef struct {
+    uint16_t Voltage; // mV
+} CAN_SUPPLEMENTAL_VOLTAGE_t;
+
+static inline uint16_t CAN_SUPPLEMENTAL_VOLTAGE_GetVoltage(const uint8_t* data){
+    uint16_t raw;
+    memcpy(&raw, &data[0], sizeof raw);
+    return raw;
+}
+static inline void CAN_SUPPLEMENTAL_VOLTAGE_SetVoltage(uint8_t* data, uint16_t value){
+    uint16_t raw = (uint16_t)value;
+    memcpy(&data[0], &raw, sizeof raw);
+}
+static inline void CAN_SUPPLEMENTAL_VOLTAGE_Unpack(const uint8_t* data, CAN_SUPPLEMENTAL_VOLTAGE_t* out){
+    out->Voltage = CAN_SUPPLEMENTAL_VOLTAGE_GetVoltage(data);
+}
+static inline void CAN_SUPPLEMENTAL_VOLTAGE_Pack(uint8_t* data, const CAN_SUPPLEMENTAL_VOLTAGE_t* in){
+    CAN_SUPPLEMENTAL_VOLTAGE_SetVoltage(data, in->Voltage);
+}
+
+// VOLTAGE_SUMMARY (0x10D), 8 bytes
+typedef struct {
+    uint32_t PackVoltage; // mV
+} CAN_VOLTAGE_SUMMARY_t;
+
+static inline uint32_t CAN_VOLTAGE_SUMMARY_GetPackVoltage(const uint8_t* data){
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 3);
+    uint32_t raw = (uint32_t)(bits & 0xFFFFFFu);
+    return raw;
+}
+static inline void CAN_VOLTAGE_SUMMARY_SetPackVoltage(uint8_t* data, uint32_t value){
+    uint32_t raw = (uint32_t)value;
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 3);
+    bits = (bits & ~0xFFFFFFull) | ((uint64_t)raw & 0xFFFFFFull);
+    memcpy(&data[0], &bits, 3);
+}
+static inline void CAN_VOLTAGE_SUMMARY_Unpack(const uint8_t* data, CAN_VOLTAGE_SUMMARY_t* out){
+    out->PackVoltage = CAN_VOLTAGE_SUMMARY_GetPackVoltage(data);
+}
+static inline void CAN_VOLTAGE_SUMMARY_Pack(uint8_t* data, const CAN_VOLTAGE_SUMMARY_t* in){
+    CAN_VOLTAGE_SUMMARY_SetPackVoltage(data, in->PackVoltage);
+}
+
+// TEMPERATURE_SUMMARY (0x10E), 8 bytes
+typedef struct {
+    uint32_t AverageTemp; // mC
+} CAN_TEMPERATURE_SUMMARY_t;
+
+static inline uint32_t CAN_TEMPERATURE_SUMMARY_GetAverageTemp(const uint8_t* data){
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 3);
+    uint32_t raw = (uint32_t)(bits & 0xFFFFFFu);
+    return raw;
+}
+static inline void CAN_TEMPERATURE_SUMMARY_SetAverageTemp(uint8_t* data, uint32_t value){
+    uint32_t raw = (uint32_t)value;
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 3);
+    bits = (bits & ~0xFFFFFFull) | ((uint64_t)raw & 0xFFFFFFull);
+    memcpy(&data[0], &bits, 3);
+}
+static inline void CAN_TEMPERATURE_SUMMARY_Unpack(const uint8_t* data, CAN_TEMPERATURE_SUMMARY_t* out){
+    out->AverageTemp = CAN_TEMPERATURE_SUMMARY_GetAverageTemp(data);
+}
+static inline void CAN_TEMPERATURE_SUMMARY_Pack(uint8_t* data, const CAN_TEMPERATURE_SUMMARY_t* in){
+    CAN_TEMPERATURE_SUMMARY_SetAverageTemp(data, in->AverageTemp);
+}
+
+// MOTOR_DRIVE (0x221), 8 bytes
+typedef struct {
+    float MotorVelocity; // rpm
+    float MotorCurrent;
+} CAN_MOTOR_DRIVE_t;
+
+static inline float CAN_MOTOR_DRIVE_GetMotorVelocity(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[0], sizeof value);
+    return value;
+}
+static inline void CAN_MOTOR_DRIVE_SetMotorVelocity(uint8_t* data, float value){
+    memcpy(&data[0], &value, sizeof value);
+}
+static inline float CAN_MOTOR_DRIVE_GetMotorCurrent(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[4], sizeof value);
+    return value;
+}
+static inline void CAN_MOTOR_DRIVE_SetMotorCurrent(uint8_t* data, float value){
+    memcpy(&data[4], &value, sizeof value);
+}
+static inline void CAN_MOTOR_DRIVE_Unpack(const uint8_t* data, CAN_MOTOR_DRIVE_t* out){
+    out->MotorVelocity = CAN_MOTOR_DRIVE_GetMotorVelocity(data);
+    out->MotorCurrent = CAN_MOTOR_DRIVE_GetMotorCurrent(data);
+}
+static inline void CAN_MOTOR_DRIVE_Pack(uint8_t* data, const CAN_MOTOR_DRIVE_t* in){
+    CAN_MOTOR_DRIVE_SetMotorVelocity(data, in->MotorVelocity);
+    CAN_MOTOR_DRIVE_SetMotorCurrent(data, in->MotorCurrent);
+}
+
+// MOTOR_POWER (0x222), 8 bytes
+typedef struct {
+    float Reserved;
+    float BusCurrent;
+} CAN_MOTOR_POWER_t;
+
+static inline float CAN_MOTOR_POWER_GetReserved(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[0], sizeof value);
+    return value;
+}
+static inline void CAN_MOTOR_POWER_SetReserved(uint8_t* data, float value){
+    memcpy(&data[0], &value, sizeof value);
+}
+static inline float CAN_MOTOR_POWER_GetBusCurrent(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[4], sizeof value);
+    return value;
+}
+static inline void CAN_MOTOR_POWER_SetBusCurrent(uint8_t* data, float value){
+    memcpy(&data[4], &value, sizeof value);
+}
+static inline void CAN_MOTOR_POWER_Unpack(const uint8_t* data, CAN_MOTOR_POWER_t* out){
+    out->Reserved = CAN_MOTOR_POWER_GetReserved(data);
+    out->BusCurrent = CAN_MOTOR_POWER_GetBusCurrent(data);
+}
+static inline void CAN_MOTOR_POWER_Pack(uint8_t* data, const CAN_MOTOR_POWER_t* in){
+    CAN_MOTOR_POWER_SetReserved(data, in->Reserved);
+    CAN_MOTOR_POWER_SetBusCurrent(data, in->BusCurrent);
+}
+
+// MOTOR_RESET (0x223), 8 bytes
+// No signals
+
+// MOTOR_STATUS (0x241), 8 bytes
+typedef struct {
+    uint16_t LimitFlags;
+    uint16_t ErrorFlags;
+    uint8_t TxErrorCount;
+    uint8_t RxErrorCount;
+} CAN_MOTOR_STATUS_t;
+
+static inline uint16_t CAN_MOTOR_STATUS_GetLimitFlags(const uint8_t* data){
+    uint16_t raw;
+    memcpy(&raw, &data[0], sizeof raw);
+    return raw;
+}
+static inline void CAN_MOTOR_STATUS_SetLimitFlags(uint8_t* data, uint16_t value){
+    uint16_t raw = (uint16_t)value;
+    memcpy(&data[0], &raw, sizeof raw);
+}
+static inline uint16_t CAN_MOTOR_STATUS_GetErrorFlags(const uint8_t* data){
+    uint16_t raw;
+    memcpy(&raw, &data[4], sizeof raw);
+    return raw;
+}
+static inline void CAN_MOTOR_STATUS_SetErrorFlags(uint8_t* data, uint16_t value){
+    uint16_t raw = (uint16_t)value;
+    memcpy(&data[4], &raw, sizeof raw);
+}
+static inline uint8_t CAN_MOTOR_STATUS_GetTxErrorCount(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[6], sizeof raw);
+    return raw;
+}
+static inline void CAN_MOTOR_STATUS_SetTxErrorCount(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[6], &raw, sizeof raw);
+}
+static inline uint8_t CAN_MOTOR_STATUS_GetRxErrorCount(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[7], sizeof raw);
+    return raw;
+}
+static inline void CAN_MOTOR_STATUS_SetRxErrorCount(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[7], &raw, sizeof raw);
+}
+static inline void CAN_MOTOR_STATUS_Unpack(const uint8_t* data, CAN_MOTOR_STATUS_t* out){
+    out->LimitFlags = CAN_MOTOR_STATUS_GetLimitFlags(data);
+    out->ErrorFlags = CAN_MOTOR_STATUS_GetErrorFlags(data);
+    out->TxErrorCount = CAN_MOTOR_STATUS_GetTxErrorCount(data);
+    out->RxErrorCount = CAN_MOTOR_STATUS_GetRxErrorCount(data);
+}
+static inline void CAN_MOTOR_STATUS_Pack(uint8_t* data, const CAN_MOTOR_STATUS_t* in){
+    CAN_MOTOR_STATUS_SetLimitFlags(data, in->LimitFlags);
+    CAN_MOTOR_STATUS_SetErrorFlags(data, in->ErrorFlags);
+    CAN_MOTOR_STATUS_SetTxErrorCount(data, in->TxErrorCount);
+    CAN_MOTOR_STATUS_SetRxErrorCount(data, in->RxErrorCount);
+}
+
+// MC_BUS (0x242), 8 bytes
+typedef struct {
+    float BusVoltage; // V
+    float BusCurrent; // A
+} CAN_MC_BUS_t;
+
+static inline float CAN_MC_BUS_GetBusVoltage(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[0], sizeof value);
+    return value;
+}
+static inline void CAN_MC_BUS_SetBusVoltage(uint8_t* data, float value){
+    memcpy(&data[0], &value, sizeof value);
+}
+static inline float CAN_MC_BUS_GetBusCurrent(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[4], sizeof value);
+    return value;
+}
+static inline void CAN_MC_BUS_SetBusCurrent(uint8_t* data, float value){
+    memcpy(&data[4], &value, sizeof value);
+}
+static inline void CAN_MC_BUS_Unpack(const uint8_t* data, CAN_MC_BUS_t* out){
+    out->BusVoltage = CAN_MC_BUS_GetBusVoltage(data);
+    out->BusCurrent = CAN_MC_BUS_GetBusCurrent(data);
+}
+static inline void CAN_MC_BUS_Pack(uint8_t* data, const CAN_MC_BUS_t* in){
+    CAN_MC_BUS_SetBusVoltage(data, in->BusVoltage);
+    CAN_MC_BUS_SetBusCurrent(data, in->BusCurrent);
+}
+
+// VELOCITY (0x243), 8 bytes
+typedef struct {
+    float MotorVelocity; // rpm
+    float VehicleVelocity; // m/s
+} CAN_VELOCITY_t;
+
+static inline float CAN_VELOCITY_GetMotorVelocity(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[0], sizeof value);
+    return value;
+}
+static inline void CAN_VELOCITY_SetMotorVelocity(uint8_t* data, float value){
+    memcpy(&data[0], &value, sizeof value);
+}
+static inline float CAN_VELOCITY_GetVehicleVelocity(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[4], sizeof value);
+    return value;
+}
+static inline void CAN_VELOCITY_SetVehicleVelocity(uint8_t* data, float value){
+    memcpy(&data[4], &value, sizeof value);
+}
+static inline void CAN_VELOCITY_Unpack(const uint8_t* data, CAN_VELOCITY_t* out){
+    out->MotorVelocity = CAN_VELOCITY_GetMotorVelocity(data);
+    out->VehicleVelocity = CAN_VELOCITY_GetVehicleVelocity(data);
+}
+static inline void CAN_VELOCITY_Pack(uint8_t* data, const CAN_VELOCITY_t* in){
+    CAN_VELOCITY_SetMotorVelocity(data, in->MotorVelocity);
+    CAN_VELOCITY_SetVehicleVelocity(data, in->VehicleVelocity);
+}
+
+// MC_PHASE_CURRENT (0x244), 8 bytes
+typedef struct {
+    float PhaseBCurrent; // A
+    float PhaseCCurrent; // A
+} CAN_MC_PHASE_CURRENT_t;
+
+static inline float CAN_MC_PHASE_CURRENT_GetPhaseBCurrent(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[0], sizeof value);
+    return value;
+}
+static inline void CAN_MC_PHASE_CURRENT_SetPhaseBCurrent(uint8_t* data, float value){
+    memcpy(&data[0], &value, sizeof value);
+}
+static inline float CAN_MC_PHASE_CURRENT_GetPhaseCCurrent(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[4], sizeof value);
+    return value;
+}
+static inline void CAN_MC_PHASE_CURRENT_SetPhaseCCurrent(uint8_t* data, float value){
+    memcpy(&data[4], &value, sizeof value);
+}
+static inline void CAN_MC_PHASE_CURRENT_Unpack(const uint8_t* data, CAN_MC_PHASE_CURRENT_t* out){
+    out->PhaseBCurrent = CAN_MC_PHASE_CURRENT_GetPhaseBCurrent(data);
+    out->PhaseCCurrent = CAN_MC_PHASE_CURRENT_GetPhaseCCurrent(data);
+}
+static inline void CAN_MC_PHASE_CURRENT_Pack(uint8_t* data, const CAN_MC_PHASE_CURRENT_t* in){
+    CAN_MC_PHASE_CURRENT_SetPhaseBCurrent(data, in->PhaseBCurrent);
+    CAN_MC_PHASE_CURRENT_SetPhaseCCurrent(data, in->PhaseCCurrent);
+}
+
+// VOLTAGE_VEC (0x245), 8 bytes
+typedef struct {
+    float Vq; // V
+    float Vd; // V
+} CAN_VOLTAGE_VEC_t;
+
+static inline float CAN_VOLTAGE_VEC_GetVq(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[0], sizeof value);
+    return value;
+}
+static inline void CAN_VOLTAGE_VEC_SetVq(uint8_t* data, float value){
+    memcpy(&data[0], &value, sizeof value);
+}
+static inline float CAN_VOLTAGE_VEC_GetVd(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[4], sizeof value);
+    return value;
+}
+static inline void CAN_VOLTAGE_VEC_SetVd(uint8_t* data, float value){
+    memcpy(&data[4], &value, sizeof value);
+}
+static inline void CAN_VOLTAGE_VEC_Unpack(const uint8_t* data, CAN_VOLTAGE_VEC_t* out){
+    out->Vq = CAN_VOLTAGE_VEC_GetVq(data);
+    out->Vd = CAN_VOLTAGE_VEC_GetVd(data);
+}
+static inline void CAN_VOLTAGE_VEC_Pack(uint8_t* data, const CAN_VOLTAGE_VEC_t* in){
+    CAN_VOLTAGE_VEC_SetVq(data, in->Vq);
+    CAN_VOLTAGE_VEC_SetVd(data, in->Vd);
+}
+
+// CURRENT_VEC (0x246), 8 bytes
+typedef struct {
+    float Iq; // A
+    float Id; // A
+} CAN_CURRENT_VEC_t;
+
+static inline float CAN_CURRENT_VEC_GetIq(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[0], sizeof value);
+    return value;
+}
+static inline void CAN_CURRENT_VEC_SetIq(uint8_t* data, float value){
+    memcpy(&data[0], &value, sizeof value);
+}
+static inline float CAN_CURRENT_VEC_GetId(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[4], sizeof value);
+    return value;
+}
+static inline void CAN_CURRENT_VEC_SetId(uint8_t* data, float value){
+    memcpy(&data[4], &value, sizeof value);
+}
+static inline void CAN_CURRENT_VEC_Unpack(const uint8_t* data, CAN_CURRENT_VEC_t* out){
+    out->Iq = CAN_CURRENT_VEC_GetIq(data);
+    out->Id = CAN_CURRENT_VEC_GetId(data);
+}
+static inline void CAN_CURRENT_VEC_Pack(uint8_t* data, const CAN_CURRENT_VEC_t* in){
+    CAN_CURRENT_VEC_SetIq(data, in->Iq);
+    CAN_CURRENT_VEC_SetId(data, in->Id);
+}
+
+// BACKEMF (0x247), 8 bytes
+typedef struct {
+    float BEMFq; // V
+    float BEMFd; // V
+} CAN_BACKEMF_t;
+
+static inline float CAN_BACKEMF_GetBEMFq(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[0], sizeof value);
+    return value;
+}
+static inline void CAN_BACKEMF_SetBEMFq(uint8_t* data, float value){
+    memcpy(&data[0], &value, sizeof value);
+}
+static inline float CAN_BACKEMF_GetBEMFd(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[4], sizeof value);
+    return value;
+}
+static inline void CAN_BACKEMF_SetBEMFd(uint8_t* data, float value){
+    memcpy(&data[4], &value, sizeof value);
+}
+static inline void CAN_BACKEMF_Unpack(const uint8_t* data, CAN_BACKEMF_t* out){
+    out->BEMFq = CAN_BACKEMF_GetBEMFq(data);
+    out->BEMFd = CAN_BACKEMF_GetBEMFd(data);
+}
+static inline void CAN_BACKEMF_Pack(uint8_t* data, const CAN_BACKEMF_t* in){
+    CAN_BACKEMF_SetBEMFq(data, in->BEMFq);
+    CAN_BACKEMF_SetBEMFd(data, in->BEMFd);
+}
+
+// TEMPERATURE (0x24B), 8 bytes
+typedef struct {
+    float MotorTemp; // C
+    float HeatsinkTemp; // C
+} CAN_TEMPERATURE_t;
+
+static inline float CAN_TEMPERATURE_GetMotorTemp(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[0], sizeof value);
+    return value;
+}
+static inline void CAN_TEMPERATURE_SetMotorTemp(uint8_t* data, float value){
+    memcpy(&data[0], &value, sizeof value);
+}
+static inline float CAN_TEMPERATURE_GetHeatsinkTemp(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[4], sizeof value);
+    return value;
+}
+static inline void CAN_TEMPERATURE_SetHeatsinkTemp(uint8_t* data, float value){
+    memcpy(&data[4], &value, sizeof value);
+}
+static inline void CAN_TEMPERATURE_Unpack(const uint8_t* data, CAN_TEMPERATURE_t* out){
+    out->MotorTemp = CAN_TEMPERATURE_GetMotorTemp(data);
+    out->HeatsinkTemp = CAN_TEMPERATURE_GetHeatsinkTemp(data);
+}
+static inline void CAN_TEMPERATURE_Pack(uint8_t* data, const CAN_TEMPERATURE_t* in){
+    CAN_TEMPERATURE_SetMotorTemp(data, in->MotorTemp);
+    CAN_TEMPERATURE_SetHeatsinkTemp(data, in->HeatsinkTemp);
+}
+
+// ODOMETER_AMPHOURS (0x24E), 8 bytes
+typedef struct {
+    float Odometer; // m
+    float DCBusAmpHours; // Ah
+} CAN_ODOMETER_AMPHOURS_t;
+
+static inline float CAN_ODOMETER_AMPHOURS_GetOdometer(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[0], sizeof value);
+    return value;
+}
+static inline void CAN_ODOMETER_AMPHOURS_SetOdometer(uint8_t* data, float value){
+    memcpy(&data[0], &value, sizeof value);
+}
+static inline float CAN_ODOMETER_AMPHOURS_GetDCBusAmpHours(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[4], sizeof value);
+    return value;
+}
+static inline void CAN_ODOMETER_AMPHOURS_SetDCBusAmpHours(uint8_t* data, float value){
+    memcpy(&data[4], &value, sizeof value);
+}
+static inline void CAN_ODOMETER_AMPHOURS_Unpack(const uint8_t* data, CAN_ODOMETER_AMPHOURS_t* out){
+    out->Odometer = CAN_ODOMETER_AMPHOURS_GetOdometer(data);
+    out->DCBusAmpHours = CAN_ODOMETER_AMPHOURS_GetDCBusAmpHours(data);
+}
+static inline void CAN_ODOMETER_AMPHOURS_Pack(uint8_t* data, const CAN_ODOMETER_AMPHOURS_t* in){
+    CAN_ODOMETER_AMPHOURS_SetOdometer(data, in->Odometer);
+    CAN_ODOMETER_AMPHOURS_SetDCBusAmpHours(data, in->DCBusAmpHours);
+}
+
+// ARRAY_CONTACTOR_STATE_CHANGE (0x24F), 1 byte
+typedef struct {
+    bool State;
+} CAN_ARRAY_CONTACTOR_STATE_CHANGE_t;
+
+static inline bool CAN_ARRAY_CONTACTOR_STATE_CHANGE_GetState(const uint8_t* data){
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 1);
+    uint8_t raw = (uint8_t)(bits & 0x1u);
+    return raw != 0;
+}
+static inline void CAN_ARRAY_CONTACTOR_STATE_CHANGE_SetState(uint8_t* data, bool value){
+    uint8_t raw = (uint8_t)value;
+    uint64_t bits = 0;
+    memcpy(&bits, &data[0], 1);
+    bits = (bits & ~0x1ull) | ((uint64_t)raw & 0x1ull);
+    memcpy(&data[0], &bits, 1);
+}
+static inline void CAN_ARRAY_CONTACTOR_STATE_CHANGE_Unpack(const uint8_t* data, CAN_ARRAY_CONTACTOR_STATE_CHANGE_t* out){
+    out->State = CAN_ARRAY_CONTACTOR_STATE_CHANGE_GetState(data);
+}
+static inline void CAN_ARRAY_CONTACTOR_STATE_CHANGE_Pack(uint8_t* data, const CAN_ARRAY_CONTACTOR_STATE_CHANGE_t* in){
+    CAN_ARRAY_CONTACTOR_STATE_CHANGE_SetState(data, in->State);
+}
+
+// SLIP_SPEED (0x257), 8 bytes
+typedef struct {
+    float Reserved;
+    float SlipSpeed; // Hz
+} CAN_SLIP_SPEED_t;
+
+static inline float CAN_SLIP_SPEED_GetReserved(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[0], sizeof value);
+    return value;
+}
+static inline void CAN_SLIP_SPEED_SetReserved(uint8_t* data, float value){
+    memcpy(&data[0], &value, sizeof value);
+}
+static inline float CAN_SLIP_SPEED_GetSlipSpeed(const uint8_t* data){
+    float value;
+    memcpy(&value, &data[4], sizeof value);
+    return value;
+}
+static inline void CAN_SLIP_SPEED_SetSlipSpeed(uint8_t* data, float value){
+    memcpy(&data[4], &value, sizeof value);
+}
+static inline void CAN_SLIP_SPEED_Unpack(const uint8_t* data, CAN_SLIP_SPEED_t* out){
+    out->Reserved = CAN_SLIP_SPEED_GetReserved(data);
+    out->SlipSpeed = CAN_SLIP_SPEED_GetSlipSpeed(data);
+}
+static inline void CAN_SLIP_SPEED_Pack(uint8_t* data, const CAN_SLIP_SPEED_t* in){
+    CAN_SLIP_SPEED_SetReserved(data, in->Reserved);
+    CAN_SLIP_SPEED_SetSlipSpeed(data, in->SlipSpeed);
+}
+
+// CONTROL_MODE (0x580), 1 byte
+typedef struct {
+    uint8_t Mode;
+} CAN_CONTROL_MODE_t;
+
+static inline uint8_t CAN_CONTROL_MODE_GetMode(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[0], sizeof raw);
+    return raw;
+}
+static inline void CAN_CONTROL_MODE_SetMode(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[0], &raw, sizeof raw);
+}
+static inline void CAN_CONTROL_MODE_Unpack(const uint8_t* data, CAN_CONTROL_MODE_t* out){
+    out->Mode = CAN_CONTROL_MODE_GetMode(data);
+}
+static inline void CAN_CONTROL_MODE_Pack(uint8_t* data, const CAN_CONTROL_MODE_t* in){
+    CAN_CONTROL_MODE_SetMode(data, in->Mode);
+}
+
+// IO_STATE (0x581), 8 bytes
+typedef struct {
+    uint8_t AccelPedal; // %
+    uint8_t BrakePedal; // %
+    uint8_t Switches;
+    uint8_t Contactors;
+} CAN_IO_STATE_t;
+
+static inline uint8_t CAN_IO_STATE_GetAccelPedal(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[0], sizeof raw);
+    return raw;
+}
+static inline void CAN_IO_STATE_SetAccelPedal(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[0], &raw, sizeof raw);
+}
+static inline uint8_t CAN_IO_STATE_GetBrakePedal(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[1], sizeof raw);
+    return raw;
+}
+static inline void CAN_IO_STATE_SetBrakePedal(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[1], &raw, sizeof raw);
+}
+static inline uint8_t CAN_IO_STATE_GetSwitches(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[2], sizeof raw);
+    return raw;
+}
+static inline void CAN_IO_STATE_SetSwitches(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[2], &raw, sizeof raw);
+}
+static inline uint8_t CAN_IO_STATE_GetContactors(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[3], sizeof raw);
+    return raw;
+}
+static inline void CAN_IO_STATE_SetContactors(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[3], &raw, sizeof raw);
+}
+static inline void CAN_IO_STATE_Unpack(const uint8_t* data, CAN_IO_STATE_t* out){
+    out->AccelPedal = CAN_IO_STATE_GetAccelPedal(data);
+    out->BrakePedal = CAN_IO_STATE_GetBrakePedal(data);
+    out->Switches = CAN_IO_STATE_GetSwitches(data);
+    out->Contactors = CAN_IO_STATE_GetContactors(data);
+}
+static inline void CAN_IO_STATE_Pack(uint8_t* data, const CAN_IO_STATE_t* in){
+    CAN_IO_STATE_SetAccelPedal(data, in->AccelPedal);
+    CAN_IO_STATE_SetBrakePedal(data, in->BrakePedal);
+    CAN_IO_STATE_SetSwitches(data, in->Switches);
+    CAN_IO_STATE_SetContactors(data, in->Contactors);
+}
+
+// CAN_STATS (0x582), 8 bytes
+typedef struct {
+    uint8_t CarCANLoad; // %
+    uint8_t MotorCANLoad; // %
+    uint8_t CarCANTEC;
+    uint8_t CarCANREC;
+    uint8_t MotorCANTEC;
+    uint8_t MotorCANREC;
+    uint8_t CarCANDrops;
+    uint8_t MotorCANDrops;
+} CAN_CAN_STATS_t;
+
+static inline uint8_t CAN_CAN_STATS_GetCarCANLoad(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[0], sizeof raw);
+    return raw;
+}
+static inline void CAN_CAN_STATS_SetCarCANLoad(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[0], &raw, sizeof raw);
+}
+static inline uint8_t CAN_CAN_STATS_GetMotorCANLoad(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[1], sizeof raw);
+    return raw;
+}
+static inline void CAN_CAN_STATS_SetMotorCANLoad(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[1], &raw, sizeof raw);
+}
+static inline uint8_t CAN_CAN_STATS_GetCarCANTEC(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[2], sizeof raw);
+    return raw;
+}
+static inline void CAN_CAN_STATS_SetCarCANTEC(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[2], &raw, sizeof raw);
+}
+static inline uint8_t CAN_CAN_STATS_GetCarCANREC(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[3], sizeof raw);
+    return raw;
+}
+static inline void CAN_CAN_STATS_SetCarCANREC(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[3], &raw, sizeof raw);
+}
+static inline uint8_t CAN_CAN_STATS_GetMotorCANTEC(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[4], sizeof raw);
+    return raw;
+}
+static inline void CAN_CAN_STATS_SetMotorCANTEC(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[4], &raw, sizeof raw);
+}
+static inline uint8_t CAN_CAN_STATS_GetMotorCANREC(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[5], sizeof raw);
+    return raw;
+}
+static inline void CAN_CAN_STATS_SetMotorCANREC(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[5], &raw, sizeof raw);
+}
+static inline uint8_t CAN_CAN_STATS_GetCarCANDrops(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[6], sizeof raw);
+    return raw;
+}
+static inline void CAN_CAN_STATS_SetCarCANDrops(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[6], &raw, sizeof raw);
+}
+static inline uint8_t CAN_CAN_STATS_GetMotorCANDrops(const uint8_t* data){
+    uint8_t raw;
+    memcpy(&raw, &data[7], sizeof raw);
+    return raw;
+}
+static inline void CAN_CAN_STATS_SetMotorCANDrops(uint8_t* data, uint8_t value){
+    uint8_t raw = (uint8_t)value;
+    memcpy(&data[7], &raw, sizeof raw);
+}
+static inline void CAN_CAN_STATS_Unpack(const uint8_t* data, CAN_CAN_STATS_t* out){
+    out->CarCANLoad = CAN_CAN_STATS_GetCarCANLoad(data);
+    out->MotorCANLoad = CAN_CAN_STATS_GetMotorCANLoad(data);
+    out->CarCANTEC = CAN_CAN_STATS_GetCarCANTEC(data);
+    out->CarCANREC = CAN_CAN_STATS_GetCarCANREC(data);
+    out->MotorCANTEC = CAN_CAN_STATS_GetMotorCANTEC(data);
+    out->MotorCANREC = CAN_CAN_STATS_GetMotorCANREC(data);
+    out->CarCANDrops = CAN_CAN_STATS_GetCarCANDrops(data);
+    out->MotorCANDrops = CAN_CAN_STATS_GetMotorCANDrops(data);
+}
+static inline void CAN_CAN_STATS_Pack(uint8_t* data, const CAN_CAN_STATS_t* in){
+    CAN_CAN_STATS_SetCarCANLoad(data, in->CarCANLoad);
+    CAN_CAN_STATS_SetMotorCANLoad(data, in->MotorCANLoad);
+    CAN_CAN_STATS_SetCarCANTEC(data, in->CarCANTEC);
+    CAN_CAN_STATS_SetCarCANREC(data, in->CarCANREC);
+    CAN_CAN_STATS_SetMotorCANTEC(data, in->MotorCANTEC);
+    CAN_CAN_STATS_SetMotorCANREC(data, in->MotorCANREC);
+    CAN_CAN_STATS_SetCarCANDrops(data, in->CarCANDrops);
+    CAN_CAN_STATS_SetMotorCANDrops(data, in->MotorCANDrops);
+}
+
+#endif
+
+/* @} */
@@ -11,19 +11,73 @@
 #define CAN_CONFIG
 #include "CANbus.h"
 
+// Used to count the messages on each whitelist in CAN_MESSAGE_TABLE
+#define CAN_ON_CARCAN_RX_CARCAN 1
+#define CAN_ON_CARCAN_RX_MOTORCAN 0
+#define CAN_ON_CARCAN_RX_NONE 0
+#define CAN_ON_MOTORCAN_RX_CARCAN 0
+#define CAN_ON_MOTORCAN_RX_MOTORCAN 1
+#define CAN_ON_MOTORCAN_RX_NONE 0
+#define CAN_COUNT_CARCAN(name, id, size, idx, prio, rx) + CAN_ON_CARCAN_##rx
+#define CAN_COUNT_MOTORCAN(name, id, size, idx, prio, rx) + CAN_ON_MOTORCAN_##rx
+
 /**
- * Filter Lists for CarCAN and MotorCAN
+ * Filter Lists for CarCAN and MotorCAN, generated from the rx column of CAN_MESSAGE_TABLE
 */
-#define NUM_CARCAN_FILTERS 7
-#define NUM_MOTORCAN_FILTERS 7
+#define NUM_CARCAN_FILTERS (0 CAN_MESSAGE_TABLE(CAN_COUNT_CARCAN))
+#define NUM_MOTORCAN_FILTERS (0 CAN_MESSAGE_TABLE(CAN_COUNT_MOTORCAN))
 extern  CANId_t carCANFilterList[NUM_CARCAN_FILTERS];
 extern  CANId_t motorCANFilterList[NUM_MOTORCAN_FILTERS];
 
+/**
+ * Size of the hash table used to find a message's lookup table entry from its ID. Must be a power of two.
+ */
+#define CAN_HASH_BITS 6
+#define CAN_HASH_SIZE (1 << CAN_HASH_BITS)
+
+/**
+ * Multiplier of the hash. Chosen by Scripts/can_hash.py so that no two IDs in
+ * CAN_MESSAGE_TABLE share a slot; collisions are a compile error in CANConfig.c.
+ */
+#define CAN_HASH_MULT 0x88561713u
+
+/**
+ * Slot of a CAN ID in CANHashSlot. Usable in constant expressions.
+ */
+#define CAN_HASH(id) ((uint32_t)((uint32_t)(id) * CAN_HASH_MULT) >> (32 - CAN_HASH_BITS))
+
+/**
+ * The lookup table containing the entries for all of our CAN messages, in CAN_MESSAGE_TABLE order. Located in CANConfig.c
+ */
+extern const CANLUT_T CANLUT[NUM_CAN_MSGS];
+
+/**
+ * Maps CAN_HASH(id) to the message's position in CANLUT plus one, or zero if no message hashes there
+ */
+extern const uint8_t CANHashSlot[CAN_HASH_SIZE];
+
+/**
+ * @brief   Finds the position of a message in CANLUT in constant time
+ * @param   id CAN ID to look up
+ * @return  The position of the message in CANLUT, or -1 if the ID is not in the table
+ */
+static inline int CANLUT_Index(uint32_t id){
+    uint8_t slot = CANHashSlot[CAN_HASH(id)];
+    if(slot == 0 || CANLUT[slot - 1].id != id){
+        return -1;
+    }
+    return slot - 1;
+}
 
 /**
- * The lookup table containing the entries for all of our CAN messages. Located in CANLUT.c
+ * @brief   Finds the lookup table entry of a message in constant time
+ * @param   id CAN ID to look up
+ * @return  The entry, or NULL if the ID is not in the table
  */
-extern const CANLUT_T CANLUT[MAX_CAN_ID];
+static inline const CANLUT_T* CANLUT_Find(uint32_t id){
+    int i = CANLUT_Index(id);
+    return (i < 0) ? NULL : &CANLUT[i];
+}
 #endif
 
 
@@ -0,0 +1,56 @@
+/**
+ * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
+ * @file CANMessages.h
+ * @brief The list of every CAN message we send or receive. The CANId_t enum, the
+ * lookup table, and the CarCAN/MotorCAN whitelists are all generated from this list.
+ *
+ * To add a message, add a line anywhere in the list (keep it sorted by ID). If the
+ * build then fails with an "initialized field overwritten" error in CANConfig.c, two IDs
+ * hash to the same slot; run Scripts/can_hash.py and update CAN_HASH_MULT in CANConfig.h.
+ *
+ * Columns:
+ *  name    CANId_t enum name
+ *  id      CAN ID
+ *  size    data length: BYTE, HALFWORD, WORD, or DOUBLE
+ *  idx     IDX if the message is part of a sequence of messages, NOIDX otherwise
+ *  prio    PRIO_HIGH to receive it through the high priority FIFO, PRIO_NORMAL otherwise
+ *  rx      RX_CARCAN or RX_MOTORCAN to put it on that bus's whitelist, RX_NONE otherwise
+ *
+ * @defgroup CANMessages
+ * @addtogroup CANMessages
+ * @{
+ */
+
+#ifndef CAN_MESSAGES_H
+#define CAN_MESSAGES_H
+
+#define CAN_MESSAGE_TABLE(X) \
+/*    name                          id     size      idx    prio         rx          */ \
+    X(BPS_TRIP,                     0x002, DOUBLE,   NOIDX, PRIO_HIGH,   RX_CARCAN   ) \
+    X(BPS_CONTACTOR,                0x102, DOUBLE,   NOIDX, PRIO_NORMAL, RX_CARCAN   ) /* Bit 1 and 0 contain BPS HV Plus/Minus (associated Motor Controller) Contactor and BPS HV Array Contactor, respectively */ \
+    X(CURRENT_DATA,                 0x103, DOUBLE,   NOIDX, PRIO_NORMAL, RX_CARCAN   ) \
+    X(STATE_OF_CHARGE,              0x106, DOUBLE,   NOIDX, PRIO_NORMAL, RX_CARCAN   ) \
+    X(SUPPLEMENTAL_VOLTAGE,         0x10B, DOUBLE,   NOIDX, PRIO_NORMAL, RX_CARCAN   ) \
+    X(VOLTAGE_SUMMARY,              0x10D, DOUBLE,   NOIDX, PRIO_NORMAL, RX_CARCAN   ) \
+    X(TEMPERATURE_SUMMARY,          0x10E, DOUBLE,   NOIDX, PRIO_NORMAL, RX_CARCAN   ) \
+    X(MOTOR_DRIVE,                  0x221, DOUBLE,   NOIDX, PRIO_NORMAL, RX_NONE     ) \
+    X(MOTOR_POWER,                  0x222, DOUBLE,   NOIDX, PRIO_NORMAL, RX_NONE     ) \
+    X(MOTOR_RESET,                  0x223, DOUBLE,   NOIDX, PRIO_NORMAL, RX_NONE     ) \
+    X(MOTOR_STATUS,                 0x241, DOUBLE,   NOIDX, PRIO_NORMAL, RX_MOTORCAN ) \
+    X(MC_BUS,                       0x242, DOUBLE,   NOIDX, PRIO_NORMAL, RX_MOTORCAN ) \
+    X(VELOCITY,                     0x243, DOUBLE,   NOIDX, PRIO_HIGH,   RX_MOTORCAN ) \
+    X(MC_PHASE_CURRENT,             0x244, DOUBLE,   NOIDX, PRIO_NORMAL, RX_MOTORCAN ) \
+    X(VOLTAGE_VEC,                  0x245, DOUBLE,   NOIDX, PRIO_NORMAL, RX_MOTORCAN ) \
+    X(CURRENT_VEC,                  0x246, DOUBLE,   NOIDX, PRIO_NORMAL, RX_MOTORCAN ) \
+    X(BACKEMF,                      0x247, DOUBLE,   NOIDX, PRIO_NORMAL, RX_MOTORCAN ) \
+    X(TEMPERATURE,                  0x24B, DOUBLE,   NOIDX, PRIO_NORMAL, RX_MOTORCAN ) \
+    X(ODOMETER_AMPHOURS,            0x24E, DOUBLE,   NOIDX, PRIO_NORMAL, RX_MOTORCAN ) \
+    X(ARRAY_CONTACTOR_STATE_CHANGE, 0x24F, BYTE,     NOIDX, PRIO_NORMAL, RX_NONE     ) \
+    X(SLIP_SPEED,                   0x257, DOUBLE,   NOIDX, PRIO_NORMAL, RX_MOTORCAN ) \
+    X(CONTROL_MODE,                 0x580, BYTE,     NOIDX, PRIO_NORMAL, RX_NONE     ) \
+    X(IO_STATE,                     0x581, DOUBLE,   NOIDX, PRIO_NORMAL, RX_NONE     ) \
+    X(CAN_STATS,                    0x582, DOUBLE,   NOIDX, PRIO_NORMAL, RX_NONE     )
+
+#endif
+
+/* @} */
@@ -12,56 +12,50 @@
 #define CAN_H__
 
 #include "BSP_CAN.h"
+#include "BSP_UART.h"
+#include "os.h"
+#include "CANMessages.h"
+#include "CANSignals.h"
 
 #define CARCAN CAN_1 //convenience aliases for the CANBuses
 #define MOTORCAN CAN_3
 
 /**
  * This enum is used to signify the ID of the message you want to send. 
- * It is used internally to index our lookup table (CANLUT.C) and get message-specific fields.
+ * It is generated from CAN_MESSAGE_TABLE in CANMessages.h, which is also
+ * used to build the lookup table (CANConfig.c) that holds message-specific fields.
  * For user purposes, it selects the message to send.
  * 
- * If changing the order of this enum, make sure to mirror that change in the lookup table, or
- * else the driver will not work properly. 
- * 
- * If adding new types of CAN messages, add the identifier wherever it fits in 
- * (the enum is sorted in ascending order on purpose), and then add an entry to the lookup table.
+ * If adding new types of CAN messages, add them to CAN_MESSAGE_TABLE.
  */
+#define CAN_ID_ENUM(name, id, size, idx, prio, rx) name = id,
 typedef enum { 
-	BPS_TRIP						= 0x002,
-	BPS_CONTACTOR					= 0x102,
-    CURRENT_DATA                    = 0x103,
-	STATE_OF_CHARGE 				= 0x106,
-	SUPPLEMENTAL_VOLTAGE 			= 0x10B,
-    VOLTAGE_SUMMARY                 = 0x10D,
-    TEMPERATURE_SUMMARY             = 0x10E,
-	MOTOR_DRIVE 					= 0x221,
-	MOTOR_POWER						= 0x222,
-	MOTOR_RESET 					= 0x223,
-	MOTOR_STATUS 					= 0x241,
-	MC_BUS 							= 0x242,
-	VELOCITY 						= 0x243,
-	MC_PHASE_CURRENT 				= 0x244,
-	VOLTAGE_VEC 					= 0x245,
-	CURRENT_VEC 					= 0x246,
-	BACKEMF 						= 0x247,
-	TEMPERATURE 					= 0x24B,
-	ODOMETER_AMPHOURS 				= 0x24E,
-	ARRAY_CONTACTOR_STATE_CHANGE 	= 0x24F,
-    SLIP_SPEED                      = 0x257,
-	CONTROL_MODE                    = 0x580,
-    IO_STATE 						= 0x581,
-	MAX_CAN_ID
+	CAN_MESSAGE_TABLE(CAN_ID_ENUM)
 } CANId_t;
+#undef CAN_ID_ENUM
+
+/**
+ * Position of each message in the lookup table, followed by the number of messages
+ */
+#define CAN_MSG_ENUM(name, id, size, idx, prio, rx) CAN_MSG_##name,
+typedef enum {
+	CAN_MESSAGE_TABLE(CAN_MSG_ENUM)
+	NUM_CAN_MSGS
+} CANMsgIndex_t;
+#undef CAN_MSG_ENUM
 
 /**
  * @brief Struct to use in CAN MSG LUT
+ * @param id The CAN ID this entry describes.
  * @param idxEn Whether or not this message is part of a sequence of messages.
  * @param size Size of message's data. Should be a maximum of eight (in decimal).
+ * @param prio Whether or not this message is received through the high priority FIFO.
  */
 typedef struct {
+	uint32_t id;
 	bool idxEn: 1;
-	unsigned int size: 7;
+	unsigned int size: 6;
+	bool prio: 1;
 } CANLUT_T;
 
 /**
@@ -70,11 +64,14 @@ typedef struct {
  * @param idx 	If message is part of a sequence of messages (for messages longer than 64 bits), this indicates the index of the message. 
  * 				This is not designed to exceed the 8bit unsigned max value.
  * @param data 	data of the message
+ * @param timestamp	Received messages only: cycle count (BSP_Cycles_Get) when the receive interrupt
+ * 				took the frame out of the hardware. Ignored when sending.
 */
 typedef struct {
 	CANId_t ID; 		
 	uint8_t idx; 		
 	uint8_t data[8]; 
+	uint32_t timestamp;
 } CANDATA_t;
 
 /**
@@ -87,27 +84,305 @@ typedef struct {
 #define CAN_BLOCKING true
 #define CAN_NON_BLOCKING false
 
+/**
+ * Number of frames the software transmit queue of each bus can hold
+ */
+#define CAN_TX_QUEUE_DEPTH 32
+
+/**
+ * @brief Transmit queue counters for a bus
+ * @param sent 		frames handed to a hardware mailbox
+ * @param drops 	frames dropped because the queue was full
+ * @param late 		frames discarded because their deadline passed before a mailbox was free
+ * @param highWater most frames ever waiting in the queue at once
+ * @param pending 	frames currently waiting in the queue
+ */
+typedef struct {
+	uint32_t sent;
+	uint32_t drops;
+	uint32_t late;
+	uint8_t highWater;
+	uint8_t pending;
+} CANTxStats_t;
+
+/**
+ * Length of the window the bus load is measured over
+ */
+#define CAN_LOAD_WINDOW_MS 1000
+
+/**
+ * @brief Counters for one CAN ID
+ * @param rx 		messages read
+ * @param tx 		messages handed to a hardware mailbox
+ * @param drops 	messages dropped because the transmit queue was full
+ * @param late 		messages discarded because their deadline passed
+ * @param lastRx 	timestamp of the last message read
+ * @param period 	time between received messages in microseconds, smoothed over about 8 messages
+ * @param jitter 	mean deviation of that time from the period in microseconds, smoothed over about 16 messages
+ */
+typedef struct {
+	uint32_t rx;
+	uint32_t tx;
+	uint32_t drops;
+	uint32_t late;
+	uint32_t lastRx;
+	uint32_t period;
+	uint32_t jitter;
+} CANIdStats_t;
+
+/**
+ * @brief Everything we know about the health of a bus
+ * @param hw 			traffic, error, and latency counters from the CAN hardware
+ * @param tx 			transmit queue counters
+ * @param drops 		all frames lost: receive queue overflows, transmit drops, and late transmits
+ * @param loadPercent 	load of the frames seen by this node over the last CAN_LOAD_WINDOW_MS,
+ * 						computed from the frames we sent and the frames that passed our
+ * 						acceptance filters, and the configured bit rate. Frames the filters
+ * 						drop are not counted, so the true bus load may be higher.
+ */
+typedef struct {
+	CAN_BusStats_t hw;
+	CANTxStats_t tx;
+	uint32_t drops;
+	uint8_t loadPercent;
+} CANBusStats_t;
+
+/**
+ * Number of frames the capture ring holds. Must be a power of two.
+ */
+#define CAN_CAPTURE_DEPTH 512
+
+/**
+ * @brief A frame recorded by the capture ring
+ * @param timestamp cycle count (BSP_Cycles_Get) when the frame was received or handed to a mailbox
+ * @param id 		CAN ID
+ * @param flags 	CAN_CAPTURE_TX if the frame was sent, CAN_CAPTURE_MOTORCAN if it was on MotorCAN
+ * @param len 		number of data bytes
+ * @param data 		data of the frame
+ */
+typedef struct {
+	uint32_t timestamp;
+	uint16_t id;
+	uint8_t flags;
+	uint8_t len;
+	uint8_t data[8];
+} CANCaptureRecord_t;
+
+#define CAN_CAPTURE_TX 			0x01
+#define CAN_CAPTURE_MOTORCAN 	0x02
+
+/**
+ * Format version of the stream written by CANbus_CaptureDump. See Scripts/can_replay.py.
+ */
+#define CAN_CAPTURE_VERSION 1
+
+/**
+ * Number of subscriptions that can be registered on each bus
+ */
+#define CAN_MAX_SUBSCRIPTIONS 16
+
+/**
+ * Number of messages a subscription queue can hold
+ */
+#define CAN_QUEUE_DEPTH 8
+
+/**
+ * @brief Function called with every received message of a subscribed ID.
+ * 		  Runs in the context of the task that reads the bus, so it should be short.
+ */
+typedef void (*CANHandler_t)(const CANDATA_t* msg);
+
+/**
+ * @brief Queue that a subscription copies its messages into.
+ * 		  Read it with CANbus_QueueRead. Must only be read by one task.
+ */
+typedef struct {
+	CANDATA_t buffer[CAN_QUEUE_DEPTH];
+	volatile uint8_t head;
+	volatile uint8_t tail;
+	uint32_t overflows;
+	OS_SEM sem;
+} CANQueue_t;
+
+/**
+ * @brief Slot that always holds the newest message of a subscribed ID.
+ * 		  Read it with CANbus_ReadLatest from any task.
+ * @param seq 	number of times the slot has been written. 0 means it has never been written.
+ * @param msg 	the newest message
+ */
+typedef struct {
+	volatile uint32_t seq;
+	CANDATA_t msg;
+} CANLatest_t;
+
+/**
+ * Ways a subscription can receive messages
+ */
+typedef enum {
+	CAN_SUB_HANDLER = 0,	// call a function
+	CAN_SUB_QUEUE,			// copy into a CANQueue_t
+	CAN_SUB_LATEST			// overwrite a CANLatest_t
+} CANSubType_t;
+
+/**
+ * @brief A subscription target. Build one with CAN_HANDLER, CAN_QUEUE, or CAN_LATEST.
+ */
+typedef struct {
+	CANSubType_t type;
+	union {
+		CANHandler_t handler;
+		CANQueue_t* queue;
+		CANLatest_t* latest;
+	};
+} CANSub_t;
+
+#define CAN_HANDLER(fn) ((CANSub_t){.type = CAN_SUB_HANDLER, .handler = (fn)})
+#define CAN_QUEUE(q) ((CANSub_t){.type = CAN_SUB_QUEUE, .queue = (q)})
+#define CAN_LATEST(slot) ((CANSub_t){.type = CAN_SUB_LATEST, .latest = (slot)})
+
 
 /**
  * @brief   Initializes the CAN system for a given bus
  * @param   bus The bus to initialize. You can either use CAN_1, CAN_3, or the convenience macros CARCAN and MOTORCAN. CAN2 will not be supported.
  * @param   idWhitelist A list of CAN IDs that we want to receive. If NULL, we will receive all messages.
+ *          IDs marked as high priority in CANLUT are received through their own hardware FIFO and queue,
+ *          and are always read before normal priority messages.
  * @param   idWhitelistSize The size of the whitelist.
  * @return  ERROR if bus != CAN1 or CAN3, SUCCESS otherwise
  */
 ErrorStatus CANbus_Init(CAN_t bus, CANId_t* idWhitelist, uint8_t idWhitelistSize);
 
 /**
- * @brief   Transmits data onto the CANbus. Transmits up to 8 bytes at a time. If more is necessary, please use an IDX message.
+ * @brief   Queues data for transmission onto the CANbus. Transmits up to 8 bytes at a time. If more is necessary, please use an IDX message.
+ * 			Queued frames are sent in order of CAN ID (lowest first) as hardware mailboxes free up. This never waits for a mailbox.
+ * 			If the queue is full, the least important frame is dropped to make room for a more important one.
  * @param 	CanData 	The data to be transmitted
- * @param 	blocking 	Whether or not this transmission should be a blocking send.
+ * @param 	blocking 	Whether or not to wait for room when the queue is full of more important frames.
+ * 						If false, the frame is dropped in that case.
  * @param  	bus			The bus to transmit on. This should be either CARCAN or MOTORCAN.
- * @return  ERROR if data wasn't sent, otherwise it was sent.
+ * @return  ERROR if data wasn't queued, otherwise it was queued.
  */
 ErrorStatus CANbus_Send(CANDATA_t CanData,bool blocking, CAN_t bus);
 
+/**
+ * @brief   Same as CANbus_Send, but takes the message by reference. If no frames are queued
+ * 			and a mailbox is free, the data is written straight into the mailbox registers.
+ * 			Otherwise it is copied once into the transmit queue.
+ * @param 	CanData 	The data to be transmitted. Not used after the call returns.
+ * @param 	blocking 	Whether or not to wait for room when the queue is full of more important frames
+ * @param  	bus			The bus to transmit on. This should be either CARCAN or MOTORCAN.
+ * @return  ERROR if data wasn't queued, otherwise it was queued.
+ */
+ErrorStatus CANbus_SendPtr(const CANDATA_t* CanData, bool blocking, CAN_t bus);
+
+/**
+ * @brief   Queues data for transmission like a non-blocking CANbus_Send, but discards the frame
+ * 			if it has not reached a hardware mailbox within maxAgeMs. Use this for setpoints that
+ * 			are worse than useless when sent late.
+ * @param 	CanData 	The data to be transmitted
+ * @param 	maxAgeMs 	How long the frame may wait in the queue
+ * @param  	bus			The bus to transmit on. This should be either CARCAN or MOTORCAN.
+ * @return  ERROR if data wasn't queued, otherwise it was queued.
+ */
+ErrorStatus CANbus_SendDeadline(CANDATA_t CanData, uint16_t maxAgeMs, CAN_t bus);
+
+/**
+ * @brief   Gets the transmit queue counters for a bus
+ * @param   bus 	The bus to report on
+ * @param   stats 	Where to store the counters
+ */
+void CANbus_GetTxStats(CAN_t bus, CANTxStats_t* stats);
+
+/**
+ * @brief   Gets all counters for a bus. The bus load is only recomputed once
+ * 			every CAN_LOAD_WINDOW_MS, so this should be called at least that often.
+ * @param   bus 	The bus to report on
+ * @param   stats 	Where to store the counters
+ */
+void CANbus_GetBusStats(CAN_t bus, CANBusStats_t* stats);
+
+/**
+ * @brief   Gets the counters for a CAN ID
+ * @param   id 		The ID to report on
+ * @param   stats 	Where to store the counters
+ * @return  ERROR if the ID is not in the lookup table
+ */
+ErrorStatus CANbus_GetIdStats(CANId_t id, CANIdStats_t* stats);
+
+/**
+ * @brief   Gets how long ago a received message was taken out of the hardware.
+ * 			The cycle counter wraps, so ages over 2^32 cycles (about 4 minutes at 16 MHz) are wrong.
+ * @param   msg 	A message filled in by CANbus_Read
+ * @return  The age of the message in microseconds
+ */
+static inline uint32_t CANbus_Age(const CANDATA_t* msg){
+	return BSP_Cycles_ToMicros(BSP_Cycles_Get() - msg->timestamp);
+}
+
+/**
+ * @brief   Gets how long ago the last message of an ID was received
+ * @param   id 		The ID to check
+ * @return  The age in microseconds, or UINT32_MAX if no message of that ID has been received
+ */
+uint32_t CANbus_IdAge(CANId_t id);
+
+/**
+ * @brief   Builds the CAN_STATS diagnostic message.
+ * 			Byte 0/1: CarCAN/MotorCAN load of the frames seen by this node, in percent.
+ * 			Byte 2/3: CarCAN TEC/REC. Byte 4/5: MotorCAN TEC/REC.
+ * 			Byte 6/7: CarCAN/MotorCAN frames dropped, saturating at 255.
+ * @param   msg 	Where to store the message
+ */
+void CANbus_GetDiagnostics(CANDATA_t* msg);
+
+/**
+ * @brief   Function a gateway route hands each forwarded message to. Called from the
+ * 			receive interrupt, so it must be short and must not block.
+ */
+typedef void (*CANGatewaySink_t)(const CANDATA_t* msg);
+
+/**
+ * @brief   Forwards every frame of an ID received on one bus onto another bus, straight from
+ * 			the receive interrupt. Nothing limits the rate, so only use this for IDs whose
+ * 			rate the other bus can take; CANbus_GatewaySink can feed a rate-limited sender instead. The frame goes into a free mailbox of the other bus, or into its
+ * 			transmit queue (never blocking), and only reaches the task reading the first bus if local is set.
+ * 			Calling this again for the same ID replaces the route.
+ * @param   from 		The bus to forward from
+ * @param   id 			The ID to forward. Must be in the message table.
+ * @param   to 			The bus to forward to
+ * @param   toId 		The ID to send the frame with, which may differ from id
+ * @param   decimate 	Forward one of every this many frames (0 or 1 forwards all of them)
+ * @param   local 		Whether the task reading the first bus should also get the frames
+ * @returns ERROR if the buses or ID are invalid, SUCCESS otherwise
+ */
+ErrorStatus CANbus_Gateway(CAN_t from, CANId_t id, CAN_t to, CANId_t toId, uint8_t decimate, bool local);
+
+/**
+ * @brief   Hands every frame of an ID received on a bus to a function, straight from the
+ * 			receive interrupt, e.g. to store it for a task that sends at a bounded rate.
+ * 			Calling this again for the same ID replaces the route.
+ * @param   from 		The bus to forward from
+ * @param   id 			The ID to forward. Must be in the message table.
+ * @param   sink 		The function to call with each message
+ * @param   decimate 	Hand over one of every this many frames (0 or 1 hands over all of them)
+ * @param   local 		Whether the task reading the bus should also get the frames
+ * @returns ERROR if the bus, sink or ID are invalid, SUCCESS otherwise
+ */
+ErrorStatus CANbus_GatewaySink(CAN_t from, CANId_t id, CANGatewaySink_t sink, uint8_t decimate, bool local);
+
+/**
+ * @brief   Stops forwarding an ID. Its frames go to the reading task again.
+ * @param   from 		The bus the ID was forwarded from
+ * @param   id 			The ID
+ * @returns ERROR if the bus or ID is invalid, SUCCESS otherwise
+ */
+ErrorStatus CANbus_GatewayRemove(CAN_t from, CANId_t id);
+
 /**
  * @brief   Reads a CAN message from the CAN hardware and returns it to the provided pointers.
+ *          Pending high priority messages are always returned first.
+ * @note    Each bus has a single reader: the first task to read it. Reads of the bus from any
+ * 			other task fail with ERROR. This covers CANbus_ReadBorrow too.
  * @param   data 		pointer to where to store the CAN id of the received msg
  * @param   blocking 	Whether or not this read should be a blocking read
  * @param   bus 		The bus to use. This should either be CARCAN or MOTORCAN.
@@ -115,6 +390,107 @@ ErrorStatus CANbus_Send(CANDATA_t CanData,bool blocking, CAN_t bus);
  */
 ErrorStatus CANbus_Read(CANDATA_t* data, bool blocking, CAN_t bus);
 
+/**
+ * @brief   Reads a CAN message without copying it: returns a reference to the receive queue slot
+ * 			the interrupt copied it into. Subscriptions are delivered as with CANbus_Read.
+ * 			For indexed messages, data[0] holds the idx byte and the payload starts at data[1].
+ * @note    The slot is not reused until CANbus_Release is called, which must happen before
+ * 			the next read of the bus. Hold it briefly; the receive queue is shallow.
+ * @param   frame 		Where to store the reference to the frame
+ * @param   blocking 	Whether or not this read should be a blocking read
+ * @param   bus 		The bus to use. This should either be CARCAN or MOTORCAN.
+ * @returns ERROR if read failed (nothing needs to be released), SUCCESS otherwise
+ */
+ErrorStatus CANbus_ReadBorrow(const CAN_Frame_t** frame, bool blocking, CAN_t bus);
+
+/**
+ * @brief   Hands the frame from the last CANbus_ReadBorrow back to the receive queue
+ * @param   bus 		The bus the frame was read from
+ */
+void CANbus_Release(CAN_t bus);
+
+/**
+ * @brief   Registers a subscription for a CAN ID. Every message of that ID read from the bus
+ * 			is delivered to the subscription as part of CANbus_Read, before CANbus_Read returns.
+ * @note    Each bus must only be read by one task, which is where handlers run.
+ * @param   bus 	The bus to subscribe on. This should either be CARCAN or MOTORCAN.
+ * @param   id 		The CAN ID to subscribe to
+ * @param   sub 	Where to deliver the messages. Use CAN_HANDLER(fn), CAN_QUEUE(&queue), or CAN_LATEST(&slot).
+ * @returns ERROR if the ID is invalid or the subscription table is full, SUCCESS otherwise
+ */
+ErrorStatus CANbus_Subscribe(CAN_t bus, CANId_t id, CANSub_t sub);
+
+/**
+ * @brief   Checks whether a task other than the caller has claimed a bus by reading it
+ * @param   bus 	The bus
+ * @returns true if reads of the bus from the calling task would be refused
+ */
+bool CANbus_HasOtherReader(CAN_t bus);
+
+/**
+ * @brief   Checks whether anything subscribed to an ID on a bus
+ * @param   bus 	The bus
+ * @param   id 		The ID
+ * @returns true if CANbus_Subscribe was called for the ID on that bus
+ */
+bool CANbus_IsSubscribed(CAN_t bus, CANId_t id);
+
+/**
+ * @brief   Reads a message out of a subscription queue
+ * @param   queue 		The queue to read from
+ * @param   data 		Where to store the message
+ * @param   blocking 	Whether or not to wait for a message
+ * @returns ERROR if no message was read, SUCCESS otherwise
+ */
+ErrorStatus CANbus_QueueRead(CANQueue_t* queue, CANDATA_t* data, bool blocking);
+
+/**
+ * @brief   Copies the newest message out of a latest-value slot. Never blocks.
+ * @param   slot 	The slot to read
+ * @param   data 	Where to store the message
+ * @returns the slot's sequence number (0 if no message has been received yet)
+ */
+uint32_t CANbus_ReadLatest(CANLatest_t* slot, CANDATA_t* data);
+
+/**
+ * @brief   Starts or stops recording frames into the capture ring. Every frame received
+ * 			or sent on either bus is recorded, unless its ID is filtered out. Received frames
+ * 			are recorded by the receive interrupt, so frames the receive queue had no room for
+ * 			are recorded too.
+ * 			Once the ring is full, the oldest frames are overwritten.
+ * @param   enable 	true to start recording, false to stop
+ */
+void CANbus_CaptureEnable(bool enable);
+
+/**
+ * @brief   Chooses whether frames of an ID are recorded. All IDs are recorded by default.
+ * 			Frames with IDs missing from the message table are always recorded.
+ * @param   id 		The ID to filter
+ * @param   record 	Whether to record frames of the ID
+ * @returns ERROR if the ID is not in the message table, SUCCESS otherwise
+ */
+ErrorStatus CANbus_CaptureFilter(CANId_t id, bool record);
+
+/**
+ * @brief   Chooses whether frames of every ID are recorded
+ * @param   record 	Whether to record frames
+ */
+void CANbus_CaptureFilterAll(bool record);
+
+/**
+ * @brief   Writes the contents of the capture ring, oldest frame first, as a binary stream.
+ * 			Recording is paused while the ring is written and the ring is not cleared.
+ * 			Decode the stream with Scripts/can_replay.py.
+ * @param   uart 	The UART to write to
+ * @returns the number of frames written
+ */
+uint32_t CANbus_CaptureDump(UART_t uart);
+
+/**
+ * @brief   Empties the capture ring
+ */
+void CANbus_CaptureClear(void);
+
 #endif
 
 
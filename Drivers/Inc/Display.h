@@ -16,13 +16,34 @@
 
 #include "common.h"	// common headers
 #include "Tasks.h"	// for os and fault error locs
+#include "DisplayFormat.h"	// for command templates
 
 #define MAX_ARGS 2	// maximum # of arguments in a command packet
 
+// Size of the display's serial input buffer (1024 bytes on the Nextion)
+#ifndef DISPLAY_INPUT_BUFFER
+#define DISPLAY_INPUT_BUFFER 1024
+#endif
+
+// Most commands sent and not yet answered. Their replies, 4 bytes each,
+// must fit the 256 byte receive FIFO of the display UART.
+#ifndef DISPLAY_MAX_INFLIGHT
+#define DISPLAY_MAX_INFLIGHT 32
+#endif
+
+#if DISPLAY_MAX_INFLIGHT > 64
+#error "DISPLAY_MAX_INFLIGHT replies must fit the display UART receive FIFO"
+#endif
+
+// A command still unanswered after this long is written off
+#define DISPLAY_ACK_TIMEOUT_MS 500
+// How long the display takes to start up after a reset
+#define DISPLAY_BOOT_MS 300
+
 /**
  * Error types
  */
-typedef enum{ // Currently only ERR_NONE and ERR_PARSE are used
+typedef enum{
 	DISPLAY_ERR_NONE,
 	DISPLAY_ERR_PARSE,	    // Error parsing command struct passed to Display_Send
 	DISPLAY_ERR_INV_INSTR,	// Invalid instruction passed to nextion (0x00)
@@ -33,9 +54,35 @@ typedef enum{ // Currently only ERR_NONE and ERR_PARSE are used
 	DISPLAY_ERR_ASSIGN,	    // Assignment failure nextion	(0x1C)
 	DISPLAY_ERR_PARAMS,	    // Invalid number of parameters passed to nextion	(0x1E)
 	DISPLAY_ERR_MAX_ARGS,   // Command arg list exceeded MAX_ARGS elements
-	DISPLAY_ERR_OTHER       // Other nextion display error
+	DISPLAY_ERR_OTHER,      // Other nextion display error
+	DISPLAY_ERR_OVERFLOW,   // Nextion serial buffer overflowed, commands were lost (0x24)
+	DISPLAY_ERR_NO_ACK,     // Nextion didn't answer a command within DISPLAY_ACK_TIMEOUT_MS
+	NUM_DISPLAY_ERRORS
 } DisplayError_t;
 
+/**
+ * Which replies the display sends for each command (Nextion bkcmd)
+ */
+typedef enum{
+	DISPLAY_RETURN_NONE=0,
+	DISPLAY_RETURN_SUCCESS,	// Only when a command succeeds
+	DISPLAY_RETURN_FAILURE,	// Only when a command fails, the Nextion's default
+	DISPLAY_RETURN_ALL		// Always, which lets every command be tracked
+} DisplayReturnLevel_t;
+
+/**
+ * Counts of the replies received from the display
+ */
+typedef struct{
+	uint32_t acks;			// commands the display reported done
+	uint32_t errors[NUM_DISPLAY_ERRORS];	// commands it rejected, lost or never answered, by error
+	uint32_t restarts;		// times it reported being ready after starting up
+	uint32_t resyncs;		// times the values it shows may have been lost
+	uint32_t events;		// replies not to a command, such as touch events
+	uint32_t stray;			// replies with no command in flight
+	uint8_t page;			// page it last reported
+} DisplayStats_t;
+
 
 /**
  * All three pages on the HMI 
@@ -70,11 +117,73 @@ typedef struct{
 } DisplayCmd_t;
 
 /**
- * @brief Sends a display message.
+ * @brief Sends a display message, tracking it until the display answers.
+ * It doesn't wait for credit: check Display_GetCredit first.
  * @returns DisplayError_t
  */
 DisplayError_t Display_Send(DisplayCmd_t cmd);
 
+/**
+ * @brief Adds a display message to the current frame without sending it.
+ * If the frame is full, the messages already in it are sent first.
+ * Only one task may build frames.
+ * @returns DisplayError_t
+ */
+DisplayError_t Display_Queue(DisplayCmd_t cmd);
+
+/**
+ * @brief Adds a template and a number to the current frame without sending it.
+ * Same rules as Display_Queue, but much faster than building a DisplayCmd_t.
+ * @param tmpl the text of the command before the number, e.g. "vel.val="
+ * @param val the number
+ * @returns DisplayError_t
+ */
+DisplayError_t Display_QueueValue(const DisplayTemplate_t *tmpl, int32_t val);
+
+/**
+ * @brief Sends every message in the current frame in a single UART write,
+ * tracking each until the display answers
+ * @returns DisplayError_t
+ */
+DisplayError_t Display_Flush(void);
+
+/**
+ * @brief Reads and handles the replies the display has sent. Each
+ * reply to a command frees the room it took, and unanswered commands
+ * are written off after DISPLAY_ACK_TIMEOUT_MS.
+ * Call from the task that sends frames.
+ * @returns the last error the display reported, or DISPLAY_ERR_NONE
+ */
+DisplayError_t Display_Poll(void);
+
+/**
+ * @brief Gets how much more can be sent before the display's input
+ * buffer could overrun. Zero until the display has started up.
+ * @param bytes set to the bytes that can be sent
+ * @param cmds set to the commands that can be sent
+ */
+void Display_GetCredit(uint32_t *bytes, uint32_t *cmds);
+
+/**
+ * @brief Sets which replies the display sends (bkcmd).
+ * Display_Init uses DISPLAY_RETURN_ALL.
+ * @param level the replies to send
+ * @returns DisplayError_t
+ */
+DisplayError_t Display_SetReturnLevel(DisplayReturnLevel_t level);
+
+/**
+ * @brief Gets the counts of the replies received from the display
+ * @returns the counts, updated by Display_Poll
+ */
+const DisplayStats_t *Display_GetStats(void);
+
+/**
+ * @brief Gets the number of bytes written to the display so far
+ * @returns the byte count, which wraps at 2^32
+ */
+uint32_t Display_GetBytesSent(void);
+
 /**
  * @brief Initializes the display
  * @returns DisplayError_t
@@ -88,13 +197,17 @@ DisplayError_t Display_Init(void);
 DisplayError_t Display_Reset(void);
 
 /**
- * @brief Overwrites any processing commands and triggers the display fault screen
+ * @brief Overwrites any processing commands and triggers the display fault screen.
+ * Safe to call with the scheduler locked or from an interrupt. The commands in
+ * flight are written off and the screen's commands are tracked in their place.
  * @returns DisplayError_t
  */
 DisplayError_t Display_Error();
 
 /**
- * @brief Overwrites any processing commands and triggers the evacuation screen
+ * @brief Overwrites any processing commands and triggers the evacuation screen.
+ * Safe to call with the scheduler locked or from an interrupt. Tracked like
+ * Display_Error.
  * @param SOC_percent the state of charge of the battery in percent
  * @param supp_mv the voltage of the battery in millivolts
  * @returns DisplayError_t
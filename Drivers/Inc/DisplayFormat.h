@@ -0,0 +1,102 @@
+/**
+ * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
+ * @file DisplayFormat.h
+ * @brief Formats Nextion commands straight into a caller's buffer.
+ *
+ * Nothing here allocates, locks or calls into the C library's formatter,
+ * so commands can be built from any task, with the scheduler locked or
+ * from an interrupt. Commands that only change a number are built from a
+ * template: the constant text before the number, with its length worked
+ * out at compile time.
+ *
+ * Check and time it on the host with: make displaybench
+ *
+ * @defgroup DisplayFormat
+ * @addtogroup DisplayFormat
+ * @{
+ */
+
+#ifndef __DISPLAY_FORMAT_H
+#define __DISPLAY_FORMAT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define DISPLAY_TERMINATOR "\xff\xff\xff"
+#define DISPLAY_TERMINATOR_LEN (sizeof(DISPLAY_TERMINATOR) - 1)
+#define DISPLAY_INT_LEN 11	// "-2147483648"
+
+/**
+ * The constant text of a command, up to the number it sets
+ */
+typedef struct {
+	const char *text;
+	uint32_t len;
+} DisplayTemplate_t;
+
+// Builds a template from a string literal, e.g. DISPLAY_TEMPLATE("vel.val=")
+#define DISPLAY_TEMPLATE(literal) {(literal), sizeof(literal) - 1}
+
+// Longest command a template can produce, with its terminator
+#define DISPLAY_VALUE_MAX_LEN(tmpl) ((tmpl)->len + DISPLAY_INT_LEN + DISPLAY_TERMINATOR_LEN)
+
+/**
+ * @brief Writes a number in decimal
+ * @param out at least DISPLAY_INT_LEN bytes
+ * @param val the number
+ * @returns the number of characters written
+ */
+static inline uint32_t DisplayFormat_Int(char *out, int32_t val){
+	char digits[10];
+	uint32_t n = 0, len = 0;
+	uint32_t mag = (val < 0) ? 0u - (uint32_t)val : (uint32_t)val;
+
+	if (val < 0){
+		out[len++] = '-';
+	}
+	do{
+		digits[n++] = (char)('0' + mag % 10);
+		mag /= 10;
+	} while (mag != 0);
+	while (n > 0){
+		out[len++] = digits[--n];
+	}
+	return len;
+}
+
+/**
+ * @brief Copies a string without its NUL, stopping after max characters
+ * @param out at least max bytes
+ * @param str the string
+ * @param max room in out
+ * @returns the number of characters copied, or max + 1 if str is longer than max
+ */
+static inline uint32_t DisplayFormat_Str(char *out, const char *str, uint32_t max){
+	uint32_t len = 0;
+	while (str[len] != '\0'){
+		if (len == max){
+			return max + 1;
+		}
+		out[len] = str[len];
+		len++;
+	}
+	return len;
+}
+
+/**
+ * @brief Writes a template, a number and the terminator
+ * @param out at least DISPLAY_VALUE_MAX_LEN(tmpl) bytes
+ * @param tmpl text before the number
+ * @param val the number
+ * @returns the number of characters written
+ */
+static inline uint32_t DisplayFormat_Value(char *out, const DisplayTemplate_t *tmpl, int32_t val){
+	memcpy(out, tmpl->text, tmpl->len);
+	uint32_t len = tmpl->len + DisplayFormat_Int(&out[tmpl->len], val);
+	memcpy(&out[len], DISPLAY_TERMINATOR, DISPLAY_TERMINATOR_LEN);
+	return len + DISPLAY_TERMINATOR_LEN;
+}
+
+#endif
+
+/* @} */
@@ -13,6 +13,9 @@
 
 #include "BSP_ADC.h"
 
+// How long the brake switch must be quiet after a change before another change is accepted
+#define BRAKE_DEBOUNCE_US 10000
+
 /**
  * @brief Stuff
  * 
@@ -24,6 +27,13 @@ typedef enum
     NUMBER_OF_PEDALS
 } pedal_t;
 
+/**
+ * Called from the brake switch interrupt on every debounced press and release
+ * @param pressed whether the brake is now pressed
+ * @param timestamp cycle count (BSP_Cycles_Get) of the edge
+ */
+typedef void (*Pedals_BrakeHandler_t)(bool pressed, uint32_t timestamp);
+
 /**
  * @brief   Initialize the pedals
  * @param   None
@@ -38,6 +48,20 @@ void Pedals_Init(void);
  */ 
 int8_t Pedals_Read(pedal_t pedal);
 
+/**
+ * @brief   Sets a function to call from the interrupt on every debounced brake press and release.
+ *          A change the interrupt dropped as a bounce is caught by the next Pedals_Read(BRAKE)
+ *          instead, without calling the handler.
+ * @param   handler the function, which must not block, or NULL for none
+ */
+void Pedals_SetBrakeHandler(Pedals_BrakeHandler_t handler);
+
+/**
+ * @brief   Gets when the brake was last pressed or released, after debouncing
+ * @return  cycle count (BSP_Cycles_Get) of the edge
+ */
+uint32_t Pedals_BrakeChangedAt(void);
+
 
 #endif
 
@@ -1,7 +1,7 @@
 /**
  * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar
  * @file CANConfig.c
- * @brief 
+ * @brief Tables generated from CAN_MESSAGE_TABLE in CANMessages.h
  * 
  */
 #include "CANConfig.h"
@@ -12,61 +12,48 @@
 #define DOUBLE 8
 #define NOIDX false
 #define IDX true
+#define PRIO_NORMAL false
+#define PRIO_HIGH true
 
 /**
  * @brief Lookup table to simplify user-defined packet structs. Contains metadata fields that are always the same for every message of a given ID.
- *        Indexed by CANId_t values. Any changes or additions must be made in parallel with changes made to the CANID_t enum in CANbus.h
+ *        Holds one entry per message in CAN_MESSAGE_TABLE order, so its size depends only on the number of messages. Use CANLUT_Find to look up an ID.
  */
-const CANLUT_T CANLUT[MAX_CAN_ID] = {
-	[BPS_TRIP]						= {NOIDX, DOUBLE}, /**	   BPS_TRIP						   **/
-	[BPS_CONTACTOR]		        	= {NOIDX, DOUBLE}, /**	   BPS_CONTACTOR		           **/
-	[STATE_OF_CHARGE] 				= {NOIDX, DOUBLE}, /**     STATE_OF_CHARGE                 **/
-	[SUPPLEMENTAL_VOLTAGE] 			= {NOIDX, DOUBLE}, /**     SUPPLEMENTAL_VOLTAGE            **/
-    [CURRENT_DATA]                  = {NOIDX, DOUBLE},
-    [VOLTAGE_SUMMARY]               = {NOIDX, DOUBLE},
-    [TEMPERATURE_SUMMARY]           = {NOIDX, DOUBLE},
-	[MOTOR_DRIVE] 					= {NOIDX, DOUBLE}, /**     MOTOR_DRIVE                     **/
-	[MOTOR_POWER]					= {NOIDX, DOUBLE}, /**     MOTOR_POWER                     **/
-	[MOTOR_RESET] 					= {NOIDX, DOUBLE}, /**     MOTOR_RESET                     **/
-	[MOTOR_STATUS] 					= {NOIDX, DOUBLE}, /**     MOTOR_STATUS                    **/
-	[MC_BUS] 						= {NOIDX, DOUBLE}, /**     MC_BUS                          **/
-	[VELOCITY] 						= {NOIDX, DOUBLE}, /**     VELOCITY                        **/
-	[MC_PHASE_CURRENT] 				= {NOIDX, DOUBLE}, /**     MC_PHASE_CURRENT                **/
-	[VOLTAGE_VEC] 					= {NOIDX, DOUBLE}, /**     VOLTAGE_VEC                     **/
-	[CURRENT_VEC] 					= {NOIDX, DOUBLE}, /**     CURRENT_VEC                     **/
-	[BACKEMF] 						= {NOIDX, DOUBLE}, /**     BACKEMF                         **/
-	[TEMPERATURE] 					= {NOIDX, DOUBLE}, /**     TEMPERATURE                     **/
-	[ODOMETER_AMPHOURS] 			= {NOIDX, DOUBLE}, /**     ODOMETER_AMPHOURS               **/
-	[ARRAY_CONTACTOR_STATE_CHANGE] 	= {NOIDX, BYTE  }, /**     ARRAY_CONTACTOR_STATE_CHANGE    **/
-    [SLIP_SPEED]                    = {NOIDX, DOUBLE},
-	[MOTOR_DRIVE] 					= {NOIDX, DOUBLE}, /**     MOTOR_DRIVE                     **/
-	[MOTOR_POWER]					= {NOIDX, DOUBLE}, /**     MOTOR_POWER                     **/
-	[MOTOR_RESET] 					= {NOIDX, DOUBLE}, /**     MOTOR_RESET                     **/
-	[MOTOR_STATUS] 					= {NOIDX, DOUBLE}, /**     MOTOR_STATUS                    **/
-	[IO_STATE] 				        = {NOIDX, DOUBLE}, /**     IO_STATE			               **/
-    [CONTROL_MODE]                  = {NOIDX, BYTE  }, /**     CONTROL_MODE			           **/
+#define CAN_LUT_ENTRY(name, id, size, idx, prio, rx) [CAN_MSG_##name] = {name, idx, size, prio},
+const CANLUT_T CANLUT[NUM_CAN_MSGS] = {
+    CAN_MESSAGE_TABLE(CAN_LUT_ENTRY)
 };
 
+/**
+ * @brief Perfect hash from CAN ID to position in CANLUT. If two IDs share a slot,
+ *        the second initializer overwrites the first, which is turned into an error here.
+ */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Woverride-init"
+#define CAN_HASH_ENTRY(name, id, size, idx, prio, rx) [CAN_HASH(id)] = CAN_MSG_##name + 1,
+const uint8_t CANHashSlot[CAN_HASH_SIZE] = {
+    CAN_MESSAGE_TABLE(CAN_HASH_ENTRY)
+};
+#pragma GCC diagnostic pop
+
+_Static_assert(NUM_CAN_MSGS < UINT8_MAX, "CANHashSlot entries are a uint8_t");
+_Static_assert((NUM_CAN_MSGS * 3) / 2 <= CAN_HASH_SIZE, "CAN_HASH_SIZE is too small to find a perfect hash easily");
+
 /**
  * @brief Lists of CAN IDs that we want to receive. Used to initialize the CAN filters for CarCAN and MotorCAN.
 */
-
+#define CAN_LIST_CARCAN_RX_CARCAN(name) name,
+#define CAN_LIST_CARCAN_RX_MOTORCAN(name)
+#define CAN_LIST_CARCAN_RX_NONE(name)
+#define CAN_LIST_CARCAN(name, id, size, idx, prio, rx) CAN_LIST_CARCAN_##rx(name)
 CANId_t carCANFilterList[NUM_CARCAN_FILTERS] = {
-    BPS_TRIP, 
-	BPS_CONTACTOR,			// Bit 1 and 0 contain BPS HV Plus/Minus (associated Motor Controller) Contactor and BPS HV Array Contactor, respectively
-    STATE_OF_CHARGE,	
-    SUPPLEMENTAL_VOLTAGE,
-    VOLTAGE_SUMMARY,
-    TEMPERATURE_SUMMARY,
-    CURRENT_DATA
+    CAN_MESSAGE_TABLE(CAN_LIST_CARCAN)
 };
 
+#define CAN_LIST_MOTORCAN_RX_CARCAN(name)
+#define CAN_LIST_MOTORCAN_RX_MOTORCAN(name) name,
+#define CAN_LIST_MOTORCAN_RX_NONE(name)
+#define CAN_LIST_MOTORCAN(name, id, size, idx, prio, rx) CAN_LIST_MOTORCAN_##rx(name)
 CANId_t motorCANFilterList[NUM_MOTORCAN_FILTERS] = {
-    MC_BUS,
-    VELOCITY,
-    BACKEMF,
-    TEMPERATURE,
-    ODOMETER_AMPHOURS,
-    SLIP_SPEED,
-    MOTOR_STATUS
+    CAN_MESSAGE_TABLE(CAN_LIST_MOTORCAN)
 };
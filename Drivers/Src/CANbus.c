@@ -7,13 +7,143 @@
 #include "CANbus.h"
 #include "config.h"
 #include "os.h"
+#include "os_cfg_app.h"
 #include "Tasks.h"
 #include "CANConfig.h"
 
-static OS_SEM CANMail_Sem4[NUM_CAN];       // sem4 to count how many sending hardware mailboxes we have left (start at 3)
 static OS_SEM CANBus_ReceiveSem4[NUM_CAN]; // sem4 to count how many msgs in our recieving queue
-static OS_MUTEX CANbus_TxMutex[NUM_CAN];   // mutex to lock tx line
-static OS_MUTEX CANbus_RxMutex[NUM_CAN];   // mutex to lock Rx line
+static OS_SEM CANbus_TxSpaceSem4[NUM_CAN]; // sem4 posted when a blocked sender may have room in the tx queue
+static OS_TCB *readers[NUM_CAN]; // the one task that reads each bus, the first one to try
+
+// A frame waiting to be put in a hardware mailbox
+typedef struct {
+    uint16_t id;        // CAN ID, lower is sent first
+    uint16_t seq;       // order of arrival, keeps frames with the same ID in order
+    uint8_t len;
+    bool hasDeadline;
+    uint8_t data[8];
+    OS_TICK deadline;   // tick after which the frame is stale and will be discarded
+} CANTxFrame_t;
+
+// Software transmit queue. A binary min-heap on (id, seq), only touched with interrupts disabled.
+typedef struct {
+    CANTxFrame_t heap[CAN_TX_QUEUE_DEPTH];
+    uint8_t size;
+    uint8_t waiters;    // senders blocked on CANbus_TxSpaceSem4
+    uint16_t seq;
+    CANTxStats_t stats;
+} CANTxQueue_t;
+
+static CANTxQueue_t txQueue[NUM_CAN];
+
+// Per-ID counters, in CANLUT order
+static CANIdStats_t idStats[NUM_CAN_MSGS];
+
+// Where the receive interrupt forwards each message of each bus, in CANLUT order
+typedef struct {
+    volatile bool enabled;
+    bool local;         // also queue the frame for the reading task
+    CANGatewaySink_t sink; // takes the message instead of the other bus, if set
+    CAN_t to;
+    uint16_t toId;
+    uint8_t decimate;   // forward one frame in this many
+    uint8_t count;
+} CANGatewayRoute_t;
+
+static CANGatewayRoute_t gateway[NUM_CAN][NUM_CAN_MSGS];
+
+// Bus load is measured over windows of CAN_LOAD_WINDOW_MS
+#define CAN_LOAD_WINDOW_TICKS ((CAN_LOAD_WINDOW_MS * OS_CFG_TICK_RATE_HZ) / 1000)
+static uint32_t loadLastBits[NUM_CAN];
+static OS_TICK loadLastTick[NUM_CAN];
+static uint8_t loadPercent[NUM_CAN];
+
+// Capture ring. head counts every frame ever recorded; slots are reserved with interrupts
+// disabled so the receive and transmit interrupts and the sending tasks never write the same slot.
+_Static_assert((CAN_CAPTURE_DEPTH & (CAN_CAPTURE_DEPTH - 1)) == 0, "CAN_CAPTURE_DEPTH must be a power of two");
+_Static_assert(CAN_CAPTURE_DEPTH <= UINT16_MAX, "CAN_CAPTURE_DEPTH must fit the 16-bit count of the dump header");
+#define CAN_CAPTURE_FILTER_WORDS ((NUM_CAN_MSGS + 31) / 32)
+static CANCaptureRecord_t captureRing[CAN_CAPTURE_DEPTH];
+static uint32_t captureHead;
+static volatile bool captureEnabled;
+static uint32_t captureFilter[CAN_CAPTURE_FILTER_WORDS] = {[0 ... CAN_CAPTURE_FILTER_WORDS - 1] = UINT32_MAX};
+
+/**
+ * @brief Records a frame in the capture ring if capture is on and the frame's ID is not filtered out
+ * @param bus The bus the frame was on
+ * @param flags CAN_CAPTURE_TX if the frame was sent
+ * @param msgIdx Index of the frame's message in CANLUT, or -1 if it is not in the table
+ * @param id CAN ID of the frame
+ * @param data Data of the frame (8 bytes are always copied)
+ * @param len Number of data bytes
+ * @param timestamp When the frame was received or sent
+ */
+static inline void CANbus_Capture(CAN_t bus, uint8_t flags, int msgIdx, uint16_t id, const uint8_t *data, uint8_t len, uint32_t timestamp)
+{
+    if (!captureEnabled) return;
+    if (msgIdx >= 0 && !(captureFilter[msgIdx / 32] & (1u << (msgIdx % 32)))) return;
+
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    CANCaptureRecord_t *rec = &captureRing[captureHead++ & (CAN_CAPTURE_DEPTH - 1)];
+    CPU_CRITICAL_EXIT();
+
+    rec->timestamp = timestamp;
+    rec->id = id;
+    rec->flags = flags | (bus == MOTORCAN ? CAN_CAPTURE_MOTORCAN : 0);
+    rec->len = len;
+    memcpy(rec->data, data, sizeof rec->data);
+}
+
+/**
+ * @brief Counts a received message and updates its ID's period and jitter estimates
+ *        (the running averages RFC 3550 uses for jitter)
+ * @param ids The counters of the message's ID
+ * @param timestamp When the message was received
+ */
+static void CANbus_UpdateTiming(CANIdStats_t *ids, uint32_t timestamp)
+{
+    if (ids->rx > 0) {
+        int32_t interval = BSP_Cycles_ToMicros(timestamp - ids->lastRx);
+        if (ids->rx == 1) {
+            ids->period = interval;
+        } else {
+            int32_t deviation = interval - (int32_t)ids->period;
+            ids->period += deviation / 8;
+            if (deviation < 0) deviation = -deviation;
+            ids->jitter += (deviation - (int32_t)ids->jitter) / 16;
+        }
+    }
+    ids->lastRx = timestamp;
+    ids->rx++;
+}
+
+/**
+ * @brief Finds the counters for a CAN ID
+ * @return NULL if the ID is not in CANLUT
+ */
+static inline CANIdStats_t *idStatsFor(uint32_t id)
+{
+    int i = CANLUT_Index(id);
+    return (i < 0) ? NULL : &idStats[i];
+}
+
+_Static_assert((CAN_QUEUE_DEPTH & (CAN_QUEUE_DEPTH - 1)) == 0, "CAN_QUEUE_DEPTH must be a power of two");
+
+// Subscription table. Only written during setup, so the reading task can walk it without locking.
+// The subscriptions to each message are chained together, starting from subHead.
+typedef struct {
+    CANSub_t sub;
+    uint8_t next;   // position of the next subscription to the same message plus one, or zero
+} CANSubEntry_t;
+
+static CANSubEntry_t subscriptions[NUM_CAN][CAN_MAX_SUBSCRIPTIONS];
+static uint8_t numSubscriptions[NUM_CAN];
+static uint8_t subHead[NUM_CAN][NUM_CAN_MSGS]; // first subscription to each message plus one, or zero
+
+#define CANBUS_MAX_FILTER_IDS 32 // most IDs we will split into normal/high priority filter lists
+static uint16_t normalIds[CANBUS_MAX_FILTER_IDS];
+static uint16_t priorityIds[CANBUS_MAX_FILTER_IDS];
 
 /**
  * @brief this function will be passed down to the BSP layer to trigger on RX events. Increments the receive semaphore to signal message in hardware mailbox. Do not access directly outside this driver.
@@ -26,15 +156,113 @@ void CANbus_RxHandler(CAN_t bus)
     assertOSError(err);
 }
 
+static inline bool txFrameBefore(const CANTxFrame_t *a, const CANTxFrame_t *b)
+{
+    return (a->id < b->id) || (a->id == b->id && (int16_t)(a->seq - b->seq) < 0);
+}
+
+static void txHeapSiftUp(CANTxQueue_t *q, uint8_t i)
+{
+    CANTxFrame_t frame = q->heap[i];
+    while (i > 0) {
+        uint8_t parent = (i - 1) / 2;
+        if (!txFrameBefore(&frame, &q->heap[parent])) break;
+        q->heap[i] = q->heap[parent];
+        i = parent;
+    }
+    q->heap[i] = frame;
+}
+
+static void txHeapSiftDown(CANTxQueue_t *q, uint8_t i)
+{
+    CANTxFrame_t frame = q->heap[i];
+    while (true) {
+        uint8_t child = 2 * i + 1;
+        if (child >= q->size) break;
+        if (child + 1 < q->size && txFrameBefore(&q->heap[child + 1], &q->heap[child])) child++;
+        if (!txFrameBefore(&q->heap[child], &frame)) break;
+        q->heap[i] = q->heap[child];
+        i = child;
+    }
+    q->heap[i] = frame;
+}
+
+/**
+ * @brief Removes the frame at position i of the heap
+ */
+static void txHeapRemove(CANTxQueue_t *q, uint8_t i)
+{
+    q->size--;
+    if (i == q->size) return;
+    q->heap[i] = q->heap[q->size];
+    txHeapSiftDown(q, i);
+    txHeapSiftUp(q, i);
+}
+
+/**
+ * @brief Counts a frame that was handed to a hardware mailbox and records it in the capture ring
+ */
+static inline void CANbus_TxSent(CAN_t bus, int msgIdx, uint16_t id, const uint8_t *data, uint8_t len)
+{
+    txQueue[bus].stats.sent++;
+    if (msgIdx >= 0) idStats[msgIdx].tx++;
+    CANbus_Capture(bus, CAN_CAPTURE_TX, msgIdx, id, data, len, BSP_Cycles_Get());
+}
+
+/**
+ * @brief Moves as many queued frames as possible into free hardware mailboxes.
+ *        Must be called with interrupts disabled.
+ * @return true if a slot was freed and a blocked sender should be woken
+ */
+static bool CANbus_TxPump(CAN_t bus)
+{
+    CANTxQueue_t *q = &txQueue[bus];
+    uint8_t startSize = q->size;
+    OS_ERR err;
+    OS_TICK now = OSTimeGet(&err);
+
+    while (q->size > 0) {
+        CANTxFrame_t *top = &q->heap[0];
+
+        if (top->hasDeadline && (int32_t)(now - top->deadline) > 0) {
+            q->stats.late++; // too old to be useful, drop it instead of sending it late
+            CANIdStats_t *ids = idStatsFor(top->id);
+            if (ids) ids->late++;
+            txHeapRemove(q, 0);
+            continue;
+        }
+
+        // Hardware picks mailboxes by ID, so only one frame of an ID may be in the mailboxes at a time
+        if (BSP_CAN_TxIdPending(bus, top->id)) break;
+        if (BSP_CAN_Write(bus, top->id, top->data, top->len) == ERROR) break; // no free mailbox
+
+        CANbus_TxSent(bus, CANLUT_Index(top->id), top->id, top->data, top->len);
+        txHeapRemove(q, 0);
+    }
+
+    if (q->size < startSize && q->waiters > 0) {
+        q->waiters--;
+        return true;
+    }
+    return false;
+}
+
 /**
- * @brief this function will be passed down to the BSP layer to trigger on TXend. Releases hold of the mailbox semaphore (Increments it to show mailbox available). Do not access directly outside this driver.
+ * @brief this function will be passed down to the BSP layer to trigger on TXend. Refills the hardware mailboxes from the software queue. Do not access directly outside this driver.
  * @param bus The CAN bus to operate on. Should be CARCAN or MOTORCAN.
  */
 void CANbus_TxHandler(CAN_t bus)
 {
-    OS_ERR err;
-    OSSemPost(&(CANMail_Sem4[bus]), OS_OPT_POST_1, &err);
-    assertOSError(err);
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    bool wake = CANbus_TxPump(bus);
+    CPU_CRITICAL_EXIT();
+
+    if (wake) {
+        OS_ERR err;
+        OSSemPost(&(CANbus_TxSpaceSem4[bus]), OS_OPT_POST_1, &err);
+        assertOSError(err);
+    }
 }
 
 //wrapper functions for the interrupt customized for each bus
@@ -60,130 +288,401 @@ void CANbus_RxHandler_3(){
 */
 static CANId_t* whitelist_validator(CANId_t* wlist, uint8_t size){
     for(int i = 0; i < size; i++){
-        CANId_t curr = wlist[i];
-        if(curr >= MAX_CAN_ID) {
-            wlist[i] = 0;
-        } else if (CANLUT[curr].size == 0 ) {
+        if(CANLUT_Find(wlist[i]) == NULL) {
             wlist[i] = 0;
         }
     }
     return wlist;
 }
 
+static void CANbus_Dispatch(CAN_t bus, int msgIdx, const CANDATA_t* msg);
+static bool CANbus_RxHook(CAN_t bus, const CAN_Frame_t *frame);
+static void CANbus_Unpack(const CAN_Frame_t *frame, int msgIdx, CANDATA_t *msg);
+
 ErrorStatus CANbus_Init(CAN_t bus, CANId_t* idWhitelist, uint8_t idWhitelistSize)
 {
-    // initialize CAN mailbox semaphore to 3 for the 3 CAN mailboxes that we have
-    // initialize tx
     OS_ERR err;
     
-    OSMutexCreate(&(CANbus_TxMutex[bus]), (bus == CAN_1 ? "CAN TX Lock 1":"CAN TX Lock 3"), &err);
-    assertOSError(err);
-
-    OSMutexCreate(&(CANbus_RxMutex[bus]), (bus == CAN_1 ? "CAN RX Lock 1":"CAN RX Lock 3"), &err);
-    assertOSError(err);
-
-    OSSemCreate(&(CANMail_Sem4[bus]), (bus == CAN_1 ? "CAN Mailbox Semaphore 1":"CAN Mailbox Semaphore 3"), 3, &err); // there's 3 hardware mailboxes on the board, so 3 software mailboxes
+    OSSemCreate(&(CANbus_TxSpaceSem4[bus]), (bus == CAN_1 ? "CAN TX Queue Space 1":"CAN TX Queue Space 3"), 0, &err);
     assertOSError(err);
+    memset(&txQueue[bus], 0, sizeof txQueue[bus]);
 
     OSSemCreate(&(CANBus_ReceiveSem4[bus]), (bus == CAN_1 ? "CAN Received Msg Queue Ctr 1":"CAN Received Msg Queue Ctr 3"), 0, &err); // create a mailbox counter to hold the messages in as they come in
     assertOSError(err);
 
-    idWhitelist = whitelist_validator(idWhitelist, idWhitelistSize);
+    // Split the IDs into the normal and high priority lanes
+    uint8_t numNormal = 0;
+    uint8_t numPriority = 0;
+    if(idWhitelist != NULL){
+        idWhitelist = whitelist_validator(idWhitelist, idWhitelistSize);
+        for(uint8_t i = 0; i < idWhitelistSize && numNormal + numPriority < CANBUS_MAX_FILTER_IDS; i++){
+            if(idWhitelist[i] == 0) continue;
+            if(CANLUT_Find(idWhitelist[i])->prio){
+                priorityIds[numPriority++] = idWhitelist[i];
+            } else {
+                normalIds[numNormal++] = idWhitelist[i];
+            }
+        }
+    } else {
+        // Everything is accepted, but the high priority IDs still get their own lane
+        for(uint8_t i = 0; i < NUM_CAN_MSGS && numPriority < CANBUS_MAX_FILTER_IDS; i++){
+            if(CANLUT[i].prio){
+                priorityIds[numPriority++] = CANLUT[i].id;
+            }
+        }
+    }
+
     if(bus==CAN_1){
-        BSP_CAN_Init(bus,&CANbus_RxHandler_1,&CANbus_TxHandler_1, (uint16_t*)idWhitelist, idWhitelistSize);
+        BSP_CAN_Init(bus,&CANbus_RxHandler_1,&CANbus_TxHandler_1, (idWhitelist == NULL) ? NULL : normalIds, numNormal, priorityIds, numPriority);
     } else if (bus==CAN_3){
-        BSP_CAN_Init(bus,&CANbus_RxHandler_3,&CANbus_TxHandler_3, (uint16_t*)idWhitelist, idWhitelistSize);
+        BSP_CAN_Init(bus,&CANbus_RxHandler_3,&CANbus_TxHandler_3, (idWhitelist == NULL) ? NULL : normalIds, numNormal, priorityIds, numPriority);
     } else {
         return ERROR;
     }
+    BSP_CAN_SetRxHook(bus, CANbus_RxHook);
 
     return SUCCESS;
 }
 
-ErrorStatus CANbus_Send(CANDATA_t CanData,bool blocking, CAN_t bus)
+/**
+ * @brief Puts a frame in the transmit queue and starts sending it if a mailbox is free
+ * @param frame The frame to queue. Its seq is filled in here.
+ * @param blocking Whether to wait for room if the queue is full of higher priority frames
+ * @param bus The bus to transmit on
+ * @return ERROR if the frame was dropped, SUCCESS otherwise
+ */
+static ErrorStatus CANbus_Enqueue(CANTxFrame_t *frame, bool blocking, CAN_t bus)
 {
-    CPU_TS timestamp;
+    CANTxQueue_t *q = &txQueue[bus];
     OS_ERR err;
+    CPU_TS timestamp;
+    CPU_SR_ALLOC();
 
-    //error check the id
-    if(CanData.ID >= MAX_CAN_ID){return ERROR;}
+    while (true) {
+        CPU_CRITICAL_ENTER();
 
-    CANLUT_T msginfo = CANLUT[CanData.ID]; //lookup msg information in table
-    
-    if(msginfo.size == 0){return ERROR;} //if they passed in an invalid id, it will be zero
+        if (q->size >= CAN_TX_QUEUE_DEPTH) {
+            // Find the least important frame in the queue
+            uint8_t worst = 0;
+            for (uint8_t i = 1; i < q->size; i++) {
+                if (txFrameBefore(&q->heap[worst], &q->heap[i])) worst = i;
+            }
 
+            if (txFrameBefore(frame, &q->heap[worst])) {
+                // Make room by dropping it
+                CANIdStats_t *ids = idStatsFor(q->heap[worst].id);
+                if (ids) ids->drops++;
+                txHeapRemove(q, worst);
+                q->stats.drops++;
+            } else if (blocking == CAN_BLOCKING) {
+                // Wait for the interrupt to make room, then try again
+                q->waiters++;
+                CPU_CRITICAL_EXIT();
+                OSSemPend(&(CANbus_TxSpaceSem4[bus]), 0, OS_OPT_PEND_BLOCKING, &timestamp, &err);
+                assertOSError(err);
+                continue;
+            } else {
+                CANIdStats_t *ids = idStatsFor(frame->id);
+                if (ids) ids->drops++;
+                q->stats.drops++;
+                CPU_CRITICAL_EXIT();
+                return ERROR;
+            }
+        }
 
-    // make sure that Can mailbox is available
-    if (blocking == CAN_BLOCKING)
-    {
-        OSSemPend(
-            &(CANMail_Sem4[bus]),
-            0,
-            OS_OPT_PEND_BLOCKING,
-            &timestamp,
-            &err);
-    }
-    else
-    {
-        OSSemPend(
-            &(CANMail_Sem4[bus]),
-            0,
-            OS_OPT_PEND_NON_BLOCKING,
-            &timestamp,
-            &err);
+        frame->seq = q->seq++;
+        q->heap[q->size] = *frame;
+        txHeapSiftUp(q, q->size);
+        q->size++;
+        if (q->size > q->stats.highWater) {
+            q->stats.highWater = q->size;
+        }
 
-        // don't crash if we are just using this in non-blocking mode and don't block
-        if(err == OS_ERR_PEND_WOULD_BLOCK){
-            return ERROR;
+        bool wake = CANbus_TxPump(bus); // the mailboxes may already be free, in which case no interrupt is coming
+        CPU_CRITICAL_EXIT();
+
+        // The pump counted a blocked sender as woken, so it must be posted here
+        if (wake) {
+            OSSemPost(&(CANbus_TxSpaceSem4[bus]), OS_OPT_POST_1, &err);
+            assertOSError(err);
         }
+        return SUCCESS;
     }
-    if (err != OS_ERR_NONE)
-    {
-        assertOSError(err);
-        return ERROR;
+}
+
+/**
+ * @brief Writes a frame straight into a free mailbox, if no queued frame should go before it
+ * @return true if the frame was sent
+ */
+static bool CANbus_TryDirect(CAN_t bus, int msgIdx, uint16_t id, const uint8_t *data, uint8_t len)
+{
+    bool sent = false;
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    if(txQueue[bus].size == 0 && !BSP_CAN_TxIdPending(bus, id)
+        && BSP_CAN_Write(bus, id, data, len) == SUCCESS){
+        CANbus_TxSent(bus, msgIdx, id, data, len);
+        sent = true;
     }
+    CPU_CRITICAL_EXIT();
+    return sent;
+}
 
-    uint8_t txdata[8];
+/**
+ * @brief Builds the raw frame for a message
+ * @return ERROR if the message ID is invalid
+ */
+static ErrorStatus CANbus_BuildFrame(const CANDATA_t *CanData, CANTxFrame_t *frame)
+{
+    //lookup msg information in table
+    const CANLUT_T *info = CANLUT_Find(CanData->ID);
+    if(info == NULL){return ERROR;} //they passed in an invalid id
+    CANLUT_T msginfo = *info;
+
+    frame->id = CanData->ID;
     if(msginfo.idxEn){ //first byte of txData should be the idx value
-        memcpy(txdata, &CanData.idx, 1);
-        memcpy(&(txdata[sizeof(CanData.idx)]), &CanData.data, msginfo.size);
+        frame->data[0] = CanData->idx;
+        memcpy(&(frame->data[sizeof(CanData->idx)]), CanData->data, msginfo.size);
+        frame->len = msginfo.size + sizeof(CanData->idx);
     } else { //non-idx case
-        memcpy(txdata, &CanData.data, msginfo.size);
+        memcpy(frame->data, CanData->data, msginfo.size);
+        frame->len = msginfo.size;
     }
+    return SUCCESS;
+}
 
-    OSMutexPend( // ensure that tx line is available
-        &(CANbus_TxMutex[bus]),
-        0,
-        OS_OPT_PEND_BLOCKING,
-        &timestamp,
-        &err);
-    assertOSError(err);    // couldn't lock tx line
-    
-    // tx line locked
-    ErrorStatus retval = BSP_CAN_Write(
-        bus, //bus to transmit onto 
-        CanData.ID, //ID from Data struct
-        txdata, //data we memcpy'd earlier
-        (msginfo.idxEn ? msginfo.size+sizeof(CanData.idx) : msginfo.size) //if IDX then add one to the msg size, else the msg size
-    );
-
-    OSMutexPost( // unlock the TX line
-        &(CANbus_TxMutex[bus]),
-        OS_OPT_POST_NONE,
-        &err);
-    assertOSError(err);
-    if(retval == ERROR){
-        CANbus_TxHandler(bus); //release the mailbox by posting back to the counter semaphore
+ErrorStatus CANbus_Send(CANDATA_t CanData, bool blocking, CAN_t bus)
+{
+    return CANbus_SendPtr(&CanData, blocking, bus);
+}
+
+ErrorStatus CANbus_SendPtr(const CANDATA_t* CanData, bool blocking, CAN_t bus)
+{
+    int msgIdx = CANLUT_Index(CanData->ID);
+    if(msgIdx < 0){return ERROR;} //they passed in an invalid id
+    const CANLUT_T *info = &CANLUT[msgIdx];
+
+    if(!info->idxEn && CANbus_TryDirect(bus, msgIdx, CanData->ID, CanData->data, info->size)){
+        return SUCCESS;
     }
 
-    return retval;
+    CANTxFrame_t frame = {.hasDeadline = false};
+    if(CANbus_BuildFrame(CanData, &frame) == ERROR){
+        return ERROR;
+    }
+    return CANbus_Enqueue(&frame, blocking, bus);
 }
 
-ErrorStatus CANbus_Read(CANDATA_t* MsgContainer, bool blocking, CAN_t bus)
+ErrorStatus CANbus_SendDeadline(CANDATA_t CanData, uint16_t maxAgeMs, CAN_t bus)
+{
+    OS_ERR err;
+    CANTxFrame_t frame = {.hasDeadline = true};
+    if(CANbus_BuildFrame(&CanData, &frame) == ERROR){
+        return ERROR;
+    }
+    frame.deadline = OSTimeGet(&err) + ((OS_TICK)maxAgeMs * OS_CFG_TICK_RATE_HZ) / 1000;
+    return CANbus_Enqueue(&frame, CAN_NON_BLOCKING, bus);
+}
+
+/**
+ * @brief Receive hook, called from the receive interrupt with every frame, even ones the
+ *        receive queue has no room for. Records the frame in the capture ring, in the order
+ *        the frames arrived, and forwards frames with a gateway route.
+ * @return true if the reading task should also get the frame
+ */
+static bool CANbus_RxHook(CAN_t bus, const CAN_Frame_t *frame)
+{
+    int msgIdx = CANLUT_Index(frame->id);
+    CANbus_Capture(bus, 0, msgIdx, frame->id, frame->data, frame->len, frame->timestamp);
+    if(msgIdx < 0){
+        return true;
+    }
+    CANGatewayRoute_t *route = &gateway[bus][msgIdx];
+    if(!route->enabled){
+        return true;
+    }
+
+    if(++route->count >= route->decimate){
+        route->count = 0;
+        if(route->sink != NULL){
+            CANDATA_t msg = {0};
+            CANbus_Unpack(frame, msgIdx, &msg);
+            route->sink(&msg);
+        } else {
+            int toIdx = CANLUT_Index(route->toId);
+            if(!CANbus_TryDirect(route->to, toIdx, route->toId, frame->data, frame->len)){
+                CANTxFrame_t tx = {.id = route->toId, .len = frame->len, .hasDeadline = false};
+                memcpy(tx.data, frame->data, sizeof tx.data);
+                CANbus_Enqueue(&tx, CAN_NON_BLOCKING, route->to); // never waits, so safe in an interrupt
+            }
+        }
+    }
+
+    if(route->local){
+        return true;
+    }
+    // The reading task never sees this frame, so count it here
+    CANbus_UpdateTiming(&idStats[msgIdx], frame->timestamp);
+    return false;
+}
+
+ErrorStatus CANbus_Gateway(CAN_t from, CANId_t id, CAN_t to, CANId_t toId, uint8_t decimate, bool local)
+{
+    int msgIdx = CANLUT_Index(id);
+    if(from >= NUM_CAN || to >= NUM_CAN || from == to || msgIdx < 0){
+        return ERROR;
+    }
+
+    // Written with interrupts off, so the receive interrupt never runs a half-written route
+    CANGatewayRoute_t *route = &gateway[from][msgIdx];
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    route->sink = NULL;
+    route->to = to;
+    route->toId = toId;
+    route->decimate = (decimate == 0) ? 1 : decimate;
+    route->count = 0;
+    route->local = local;
+    route->enabled = true;
+    CPU_CRITICAL_EXIT();
+    return SUCCESS;
+}
+
+ErrorStatus CANbus_GatewaySink(CAN_t from, CANId_t id, CANGatewaySink_t sink, uint8_t decimate, bool local)
+{
+    int msgIdx = CANLUT_Index(id);
+    if(from >= NUM_CAN || sink == NULL || msgIdx < 0){
+        return ERROR;
+    }
+
+    // Written with interrupts off, like CANbus_Gateway
+    CANGatewayRoute_t *route = &gateway[from][msgIdx];
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    route->sink = sink;
+    route->decimate = (decimate == 0) ? 1 : decimate;
+    route->count = 0;
+    route->local = local;
+    route->enabled = true;
+    CPU_CRITICAL_EXIT();
+    return SUCCESS;
+}
+
+ErrorStatus CANbus_GatewayRemove(CAN_t from, CANId_t id)
+{
+    int msgIdx = CANLUT_Index(id);
+    if(from >= NUM_CAN || msgIdx < 0){
+        return ERROR;
+    }
+    gateway[from][msgIdx].enabled = false;
+    return SUCCESS;
+}
+
+void CANbus_GetTxStats(CAN_t bus, CANTxStats_t *stats)
+{
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    *stats = txQueue[bus].stats;
+    stats->pending = txQueue[bus].size;
+    CPU_CRITICAL_EXIT();
+}
+
+void CANbus_GetBusStats(CAN_t bus, CANBusStats_t *stats)
+{
+    OS_ERR err;
+    CPU_SR_ALLOC();
+
+    BSP_CAN_GetBusStats(bus, &stats->hw);
+    CANbus_GetTxStats(bus, &stats->tx);
+    stats->drops = stats->hw.overflows + stats->tx.drops + stats->tx.late;
+
+    // Start a new load measurement once the current window is over
+    OS_TICK now = OSTimeGet(&err);
+    CPU_CRITICAL_ENTER();
+    OS_TICK elapsed = now - loadLastTick[bus];
+    if(elapsed >= CAN_LOAD_WINDOW_TICKS && stats->hw.bitRate != 0){
+        uint64_t bits = stats->hw.bits - loadLastBits[bus];
+        uint64_t capacity = ((uint64_t)stats->hw.bitRate * elapsed) / OS_CFG_TICK_RATE_HZ;
+        uint64_t load = (bits * 100) / capacity;
+        loadPercent[bus] = (load > 100) ? 100 : load;
+        loadLastBits[bus] = stats->hw.bits;
+        loadLastTick[bus] = now;
+    }
+    stats->loadPercent = loadPercent[bus];
+    CPU_CRITICAL_EXIT();
+}
+
+ErrorStatus CANbus_GetIdStats(CANId_t id, CANIdStats_t *stats)
+{
+    CANIdStats_t *ids = idStatsFor(id);
+    if(ids == NULL){
+        return ERROR;
+    }
+
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    *stats = *ids;
+    CPU_CRITICAL_EXIT();
+    return SUCCESS;
+}
+
+uint32_t CANbus_IdAge(CANId_t id)
+{
+    CANIdStats_t *ids = idStatsFor(id);
+    if(ids == NULL || ids->rx == 0){
+        return UINT32_MAX;
+    }
+    return BSP_Cycles_ToMicros(BSP_Cycles_Get() - ids->lastRx);
+}
+
+void CANbus_GetDiagnostics(CANDATA_t *msg)
+{
+    CANBusStats_t car, motor;
+    CANbus_GetBusStats(CARCAN, &car);
+    CANbus_GetBusStats(MOTORCAN, &motor);
+
+    memset(msg, 0, sizeof *msg);
+    msg->ID = CAN_STATS;
+    CAN_CAN_STATS_t stats = {
+        .CarCANLoad = car.loadPercent,
+        .MotorCANLoad = motor.loadPercent,
+        .CarCANTEC = car.hw.tec,
+        .CarCANREC = car.hw.rec,
+        .MotorCANTEC = motor.hw.tec,
+        .MotorCANREC = motor.hw.rec,
+        .CarCANDrops = (car.drops > UINT8_MAX) ? UINT8_MAX : car.drops,
+        .MotorCANDrops = (motor.drops > UINT8_MAX) ? UINT8_MAX : motor.drops,
+    };
+    CAN_CAN_STATS_Pack(msg->data, &stats);
+}
+
+/**
+ * @brief Waits for a received frame and takes a reference to it out of the BSP receive queue.
+ *        Counts the frame. It was already recorded by the receive hook.
+ * @param frame Where to store the frame. It must be handed back with BSP_CAN_Release.
+ * @param msgIdx Where to store the index of the frame's message in CANLUT
+ * @param blocking Whether to wait for a frame
+ * @param bus The bus to read
+ * @return ERROR if no frame was read or its ID is not in the message table
+ */
+static ErrorStatus CANbus_Take(const CAN_Frame_t **frame, int *msgIdx, bool blocking, CAN_t bus)
 {
     CPU_TS timestamp;
     OS_ERR err;
 
+    // The receive queue and the borrowed frame have no lock on this side, so the first
+    // task to read a bus claims it and any other task is refused
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    if(readers[bus] == NULL){
+        readers[bus] = OSTCBCurPtr;
+    }
+    bool claimed = (readers[bus] == OSTCBCurPtr);
+    CPU_CRITICAL_EXIT();
+    if(!claimed){
+        return ERROR;
+    }
+
     if (blocking == CAN_BLOCKING)
     {
         OSSemPend( // check if the queue actually has anything
@@ -213,47 +712,269 @@ ErrorStatus CANbus_Read(CANDATA_t* MsgContainer, bool blocking, CAN_t bus)
         return ERROR;
     }
 
-    OSMutexPend( // ensure that RX line is available
-        &(CANbus_RxMutex[bus]),
+    // Only the claiming task gets here, so the BSP queue needs no lock on this side
+    const CAN_Frame_t *rx = BSP_CAN_Peek(bus);
+    if(rx == NULL){
+        return ERROR;
+    }
+
+    //error check the id
+    int idx = CANLUT_Index(rx->id); //lookup msg information in table
+    if(idx < 0){
+        BSP_CAN_Release(bus);
+        return ERROR;
+    } //they passed in an invalid id
+
+    CANbus_UpdateTiming(&idStats[idx], rx->timestamp);
+    *frame = rx;
+    *msgIdx = idx;
+    return SUCCESS;
+}
+
+/**
+ * @brief Copies a received frame into a CANDATA_t, splitting off the idx byte of indexed messages
+ */
+static void CANbus_Unpack(const CAN_Frame_t *frame, int msgIdx, CANDATA_t *msg)
+{
+    msg->ID = (CANId_t) frame->id;
+    msg->timestamp = frame->timestamp;
+    if(CANLUT[msgIdx].idxEn){
+        msg->idx = frame->data[0];
+        memcpy(msg->data, &frame->data[1], 7); // max size of data (8) - size of idx byte (1)
+    } else {
+        memcpy(msg->data, frame->data, sizeof msg->data);
+    }
+}
+
+ErrorStatus CANbus_Read(CANDATA_t* MsgContainer, bool blocking, CAN_t bus)
+{
+    const CAN_Frame_t *frame;
+    int msgIdx;
+    if(CANbus_Take(&frame, &msgIdx, blocking, bus) == ERROR){
+        return ERROR;
+    }
+
+    CANbus_Unpack(frame, msgIdx, MsgContainer);
+    BSP_CAN_Release(bus);
+
+    CANbus_Dispatch(bus, msgIdx, MsgContainer);
+    return SUCCESS;
+}
+
+ErrorStatus CANbus_ReadBorrow(const CAN_Frame_t** frame, bool blocking, CAN_t bus)
+{
+    int msgIdx;
+    if(CANbus_Take(frame, &msgIdx, blocking, bus) == ERROR){
+        return ERROR;
+    }
+
+    // Subscriptions are delivered a CANDATA_t, so only build one if the message has any
+    if(subHead[bus][msgIdx] != 0){
+        CANDATA_t msg;
+        CANbus_Unpack(*frame, msgIdx, &msg);
+        CANbus_Dispatch(bus, msgIdx, &msg);
+    }
+    return SUCCESS;
+}
+
+void CANbus_Release(CAN_t bus)
+{
+    BSP_CAN_Release(bus);
+}
+
+bool CANbus_HasOtherReader(CAN_t bus)
+{
+    return bus < NUM_CAN && readers[bus] != NULL && readers[bus] != OSTCBCurPtr;
+}
+
+bool CANbus_IsSubscribed(CAN_t bus, CANId_t id)
+{
+    int msgIdx = CANLUT_Index(id);
+    return bus < NUM_CAN && msgIdx >= 0 && subHead[bus][msgIdx] != 0;
+}
+
+ErrorStatus CANbus_Subscribe(CAN_t bus, CANId_t id, CANSub_t sub)
+{
+    int msgIdx = CANLUT_Index(id);
+    if(bus >= NUM_CAN || msgIdx < 0){
+        return ERROR;
+    }
+    if(numSubscriptions[bus] >= CAN_MAX_SUBSCRIPTIONS){
+        return ERROR;
+    }
+
+    if(sub.type == CAN_SUB_QUEUE){
+        OS_ERR err;
+        sub.queue->head = sub.queue->tail = 0;
+        sub.queue->overflows = 0;
+        OSSemCreate(&(sub.queue->sem), "CAN Subscription Queue", 0, &err);
+        assertOSError(err);
+    } else if(sub.type == CAN_SUB_LATEST){
+        sub.latest->seq = 0;
+    }
+
+    subscriptions[bus][numSubscriptions[bus]].sub = sub;
+    subscriptions[bus][numSubscriptions[bus]].next = 0;
+    numSubscriptions[bus]++;
+
+    // Add it to the end of the message's chain so subscriptions are delivered in order
+    uint8_t *link = &subHead[bus][msgIdx];
+    while(*link != 0){
+        link = &subscriptions[bus][*link - 1].next;
+    }
+    *link = numSubscriptions[bus];
+    return SUCCESS;
+}
+
+/**
+ * @brief Delivers a message to everything subscribed to its ID
+ * @param bus The bus the message was read from
+ * @param msgIdx The position of the message in CANLUT
+ * @param msg The message
+ */
+static void CANbus_Dispatch(CAN_t bus, int msgIdx, const CANDATA_t* msg)
+{
+    for(uint8_t i = subHead[bus][msgIdx]; i != 0; i = subscriptions[bus][i - 1].next){
+        CANSubEntry_t *entry = &subscriptions[bus][i - 1];
+
+        switch(entry->sub.type){
+            case CAN_SUB_HANDLER: {
+                entry->sub.handler(msg);
+                break;
+            }
+            case CAN_SUB_QUEUE: {
+                CANQueue_t *q = entry->sub.queue;
+                if((uint8_t)(q->head - q->tail) >= CAN_QUEUE_DEPTH){
+                    q->overflows++; // reader isn't keeping up, drop the newest message
+                    break;
+                }
+                q->buffer[q->head % CAN_QUEUE_DEPTH] = *msg;
+                q->head++;
+
+                OS_ERR err;
+                OSSemPost(&(q->sem), OS_OPT_POST_1, &err);
+                assertOSError(err);
+                break;
+            }
+            case CAN_SUB_LATEST: {
+                CANLatest_t *slot = entry->sub.latest;
+                CPU_SR_ALLOC();
+                CPU_CRITICAL_ENTER(); // 16 byte copy, cheaper than any lock
+                slot->msg = *msg;
+                slot->seq++;
+                CPU_CRITICAL_EXIT();
+                break;
+            }
+        }
+    }
+}
+
+ErrorStatus CANbus_QueueRead(CANQueue_t* queue, CANDATA_t* data, bool blocking)
+{
+    CPU_TS timestamp;
+    OS_ERR err;
+
+    OSSemPend(
+        &(queue->sem),
         0,
-        OS_OPT_PEND_BLOCKING,
+        (blocking == CAN_BLOCKING) ? OS_OPT_PEND_BLOCKING : OS_OPT_PEND_NON_BLOCKING,
         &timestamp,
         &err);
-    assertOSError(err);
-
-    // Actually get the message
-    uint32_t id;
-    ErrorStatus status = BSP_CAN_Read(bus, &id, MsgContainer->data);
 
-    OSMutexPost( // unlock RX line
-        &(CANbus_RxMutex[bus]),
-        OS_OPT_POST_NONE,
-        &err);
-    assertOSError(err);
-    if(status == ERROR){
+    // don't crash if we are just using this in non-blocking mode and don't block
+    if(err == OS_ERR_PEND_WOULD_BLOCK){
         return ERROR;
     }
-
-    //error check the id
-    MsgContainer->ID = (CANId_t) id;
-    if(MsgContainer->ID >= MAX_CAN_ID){
-        MsgContainer = NULL;
+    if (err != OS_ERR_NONE)
+    {
+        assertOSError(err);
         return ERROR;
     }
-    CANLUT_T entry = CANLUT[MsgContainer->ID]; //lookup msg information in table
-    if(entry.size == 0){
-        MsgContainer = NULL;
+
+    *data = queue->buffer[queue->tail % CAN_QUEUE_DEPTH];
+    queue->tail++;
+    return SUCCESS;
+}
+
+uint32_t CANbus_ReadLatest(CANLatest_t* slot, CANDATA_t* data)
+{
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    *data = slot->msg;
+    uint32_t seq = slot->seq;
+    CPU_CRITICAL_EXIT();
+    return seq;
+}
+
+void CANbus_CaptureEnable(bool enable)
+{
+    captureEnabled = enable;
+}
+
+ErrorStatus CANbus_CaptureFilter(CANId_t id, bool record)
+{
+    int msgIdx = CANLUT_Index(id);
+    if(msgIdx < 0){
         return ERROR;
-    } //if they passed in an invalid id, it will be zero
-    
-    //search LUT for id to populate idx and trim data
-    if(entry.idxEn==true){
-        MsgContainer->idx = MsgContainer->data[0];
-        memmove( // Can't use memcpy, as memory regions overlap
-            MsgContainer->data,
-            &(MsgContainer->data[1]),
-            7 // max size of data (8) - size of idx byte (1)
-        );
-    }
-    return status;
+    }
+
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    if(record){
+        captureFilter[msgIdx / 32] |= 1u << (msgIdx % 32);
+    } else {
+        captureFilter[msgIdx / 32] &= ~(1u << (msgIdx % 32));
+    }
+    CPU_CRITICAL_EXIT();
+    return SUCCESS;
+}
+
+void CANbus_CaptureFilterAll(bool record)
+{
+    for(uint8_t i = 0; i < CAN_CAPTURE_FILTER_WORDS; i++){
+        captureFilter[i] = record ? UINT32_MAX : 0;
+    }
+}
+
+void CANbus_CaptureClear(void)
+{
+    CPU_SR_ALLOC();
+    CPU_CRITICAL_ENTER();
+    captureHead = 0;
+    CPU_CRITICAL_EXIT();
+}
+
+uint32_t CANbus_CaptureDump(UART_t uart)
+{
+    bool wasEnabled = captureEnabled;
+    captureEnabled = false;
+
+    uint32_t head = captureHead;
+    uint16_t count = (head < CAN_CAPTURE_DEPTH) ? head : CAN_CAPTURE_DEPTH;
+    uint32_t lost = head - count;
+    uint32_t clock = SystemCoreClock;
+
+    // Header: "CANC", version, record count, core clock in Hz, frames overwritten before the dump
+    uint8_t header[16] = {'C', 'A', 'N', 'C', CAN_CAPTURE_VERSION, 0};
+    memcpy(&header[6], &count, 2);
+    memcpy(&header[8], &clock, 4);
+    memcpy(&header[12], &lost, 4);
+    BSP_UART_Write(uart, (char*)header, sizeof header);
+
+    // Records: timestamp (4 bytes), ID | MotorCAN << 11 | TX << 12 (2 bytes), length, data
+    for(uint32_t i = head - count; i != head; i++){
+        const CANCaptureRecord_t *rec = &captureRing[i & (CAN_CAPTURE_DEPTH - 1)];
+        uint8_t out[15];
+        uint16_t tag = (rec->id & 0x7FF)
+            | ((rec->flags & CAN_CAPTURE_MOTORCAN) ? 1u << 11 : 0)
+            | ((rec->flags & CAN_CAPTURE_TX) ? 1u << 12 : 0);
+        memcpy(&out[0], &rec->timestamp, 4);
+        memcpy(&out[4], &tag, 2);
+        out[6] = rec->len;
+        memcpy(&out[7], rec->data, rec->len);
+        BSP_UART_Write(uart, (char*)out, 7 + rec->len);
+    }
+
+    captureEnabled = wasEnabled;
+    return count;
 }
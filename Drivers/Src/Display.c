@@ -9,77 +9,429 @@
  */
 
 #include "Display.h"
+#include "DisplayFormat.h"
 #include "bsp.h"   // for writing to UART
 #include "Tasks.h" // for os and fault error codes
 
 #define DISP_OUT UART_3
-#define MAX_MSG_LEN 32
-#define MAX_ARG_LEN 16
+#define MAX_CMD_LEN 64	// Longest formatted command, with its terminator
+#define FRAME_LEN 256	// Commands queued before a flush is forced
+#define FRAME_MAX_CMDS 32	// Commands in a frame, each tracked on its own
+#define REPLY_MAX_LEN 16	// Longest reply kept, without its terminator
+#define ERROR_SCREEN_LEN 128	// Fits the page change and four error codes
+#define EVAC_SCREEN_LEN 80	// Fits the page change, the SOC and the supplemental voltage
 // Assignment commands have only 1 arg, an operator, and an attribute
 #define isAssignCmd(cmd) (cmd.compOrCmd != NULL && cmd.op != NULL && cmd.attr != NULL && cmd.numArgs == 1)
 // Operational commands have no attribute and no operator, just a command and >= 0 arguments
 #define isOpCmd(cmd) (cmd.op == NULL && cmd.attr == NULL)
 
-static const char *TERMINATOR = "\xff\xff\xff";
+// Screens shown over whatever is in progress start by terminating it
+static const DisplayTemplate_t INTERRUPT_PAGE = DISPLAY_TEMPLATE(DISPLAY_TERMINATOR "page ");
+static const DisplayTemplate_t ERROR_CODES[] = {
+	DISPLAY_TEMPLATE("oserr.val="),
+	DISPLAY_TEMPLATE("rccerr.val="),
+	DISPLAY_TEMPLATE("merr.val="),
+	DISPLAY_TEMPLATE("disperr.val=")
+};
+static const DisplayTemplate_t EVAC_SOC = DISPLAY_TEMPLATE("soc.val=");
+static const DisplayTemplate_t EVAC_SUPP = DISPLAY_TEMPLATE("supp.val=");
+#define EVAC_PAGE 3
+static const DisplayTemplate_t RETURN_LEVEL = DISPLAY_TEMPLATE("bkcmd=");
+
+// Codes the display replies with (Nextion return data)
+#define REPLY_OK		0x01
+#define REPLY_OVERFLOW	0x24
+#define REPLY_PAGE		0x66
+#define REPLY_READY		0x88
+
+// Commands queued for the next flush, and every byte written to the display
+static char frame[FRAME_LEN];
+static uint32_t frameLen = 0;
+static uint16_t frameCmdLens[FRAME_MAX_CMDS];
+static uint32_t frameCmds = 0;
+static volatile uint32_t bytesSent = 0;
+
+// Commands sent and not yet answered, oldest at tail. Both only count up.
+typedef struct{
+	uint16_t len;
+	OS_TICK sentAt;
+} InFlight_t;
+static InFlight_t inFlight[DISPLAY_MAX_INFLIGHT];
+static uint32_t inFlightHead = 0;
+static uint32_t inFlightTail = 0;
+static uint32_t inFlightBytes = 0;
+
+// Nothing is tracked until the display has been told its return level
+static DisplayReturnLevel_t returnLevel = DISPLAY_RETURN_ALL;
+static bool levelSet = false;
+static OS_TICK resetAt = 0;
+
+// The reply being received, and how many bytes of its terminator have arrived
+static uint8_t reply[REPLY_MAX_LEN + DISPLAY_TERMINATOR_LEN];
+static uint32_t replyLen = 0;
+static uint32_t replyEnd = 0;
+
+static DisplayStats_t stats = {0};
+
+/**
+ * @brief Writes to the display UART, counting the bytes
+ */
+static void Display_Write(char *str, uint32_t len){
+	uint32_t sent = BSP_UART_Write(DISP_OUT, str, len);
+	CPU_SR_ALLOC();
+	CPU_CRITICAL_ENTER();
+	bytesSent += sent;
+	CPU_CRITICAL_EXIT();
+}
 
 DisplayError_t Display_Init(){
-	BSP_UART_Init(DISP_OUT);
+	BSP_UART_InitRaw(DISP_OUT);
     
 	return Display_Reset();
 }
 
-DisplayError_t Display_Send(DisplayCmd_t cmd){
-	char msgArgs[MAX_MSG_LEN];
-	if (isAssignCmd(cmd)){
-		if (cmd.argTypes[0] == INT_ARG){
-			sprintf(msgArgs, "%d", (int)cmd.args[0].num);
+/**
+ * @brief Adds a command about to be sent to the ones in flight. If none
+ * are free, the oldest is written off as unanswered.
+ */
+static void Display_Track(uint32_t len){
+	OS_ERR err;
+	if (!levelSet){return;}
+	OS_TICK now = OSTimeGet(&err);
+
+	CPU_SR_ALLOC();
+	CPU_CRITICAL_ENTER();
+	if (inFlightHead - inFlightTail == DISPLAY_MAX_INFLIGHT){
+		inFlightBytes -= inFlight[inFlightTail % DISPLAY_MAX_INFLIGHT].len;
+		inFlightTail++;
+		stats.errors[DISPLAY_ERR_NO_ACK]++;
+	}
+	inFlight[inFlightHead % DISPLAY_MAX_INFLIGHT] = (InFlight_t){.len = (uint16_t)len, .sentAt = now};
+	inFlightHead++;
+	inFlightBytes += len;
+	CPU_CRITICAL_EXIT();
+}
+
+/**
+ * @brief Frees the oldest command in flight, which the display has answered
+ * @returns false if none was in flight
+ */
+static bool Display_Retire(void){
+	bool retired = false;
+	CPU_SR_ALLOC();
+	CPU_CRITICAL_ENTER();
+	if (inFlightHead != inFlightTail){
+		inFlightBytes -= inFlight[inFlightTail % DISPLAY_MAX_INFLIGHT].len;
+		inFlightTail++;
+		retired = true;
+	}
+	CPU_CRITICAL_EXIT();
+	return retired;
+}
+
+/**
+ * @brief Writes off every command in flight, whose replies won't come
+ */
+static void Display_DropInFlight(void){
+	CPU_SR_ALLOC();
+	CPU_CRITICAL_ENTER();
+	inFlightTail = inFlightHead;
+	inFlightBytes = 0;
+	CPU_CRITICAL_EXIT();
+}
+
+/**
+ * @brief Gets the bytes of data that follow a reply code, before the
+ * terminator. They may contain 0xFF, which isn't the terminator there.
+ */
+static uint32_t Display_ReplyDataLen(uint8_t code){
+	switch (code){
+		case 0x65: return 3;	// Touch event: page, component, event
+		case REPLY_PAGE: return 1;
+		case 0x67:				// Touch coordinates
+		case 0x68: return 5;
+		case 0x71: return 4;	// Numeric data
+		default: return 0;
+	}
+}
+
+/**
+ * @brief Gets the error a reply code reports for a command
+ * @returns DISPLAY_ERR_NONE if it isn't the reply to a failed command
+ */
+static DisplayError_t Display_ReplyError(uint8_t code){
+	switch (code){
+		case 0x00: return DISPLAY_ERR_INV_INSTR;
+		case 0x02: return DISPLAY_ERR_INV_COMP;
+		case 0x03: return DISPLAY_ERR_INV_PGID;
+		case 0x1A: return DISPLAY_ERR_INV_VAR;
+		case 0x1B: return DISPLAY_ERR_INV_VAROP;
+		case 0x1C: return DISPLAY_ERR_ASSIGN;
+		case 0x1E: return DISPLAY_ERR_PARAMS;
+		// Invalid picture, font, file operation, CRC, baud, waveform, escape
+		// character, buffer or variable name, or too long a variable name
+		case 0x04: case 0x05: case 0x06: case 0x09: case 0x11: case 0x12:
+		case 0x1D: case 0x1F: case 0x20: case 0x23:
+			return DISPLAY_ERR_OTHER;
+		default: return DISPLAY_ERR_NONE;
+	}
+}
+
+/**
+ * @brief Handles one reply from the display
+ * @param data the reply, without its terminator
+ * @param len its length
+ * @returns the error it reports, or DISPLAY_ERR_NONE
+ */
+static DisplayError_t Display_HandleReply(const uint8_t *data, uint32_t len){
+	uint8_t code = data[0];
+	DisplayError_t err = Display_ReplyError(code);
+
+	if (code == 0x00 && len == 3 && data[1] == 0x00 && data[2] == 0x00){ // Starting up
+		Display_DropInFlight();
+		return DISPLAY_ERR_NONE;
+	}
+	if (err != DISPLAY_ERR_NONE){
+		stats.errors[err]++;
+		if (!Display_Retire()){stats.stray++;}
+		return err;
+	}
+
+	switch (code){
+		case REPLY_OK:
+			stats.acks++;
+			if (!Display_Retire()){stats.stray++;}
+			break;
+		case REPLY_OVERFLOW: // Everything in its buffer was thrown away
+			stats.errors[DISPLAY_ERR_OVERFLOW]++;
+			stats.resyncs++;
+			Display_DropInFlight();
+			return DISPLAY_ERR_OVERFLOW;
+		case REPLY_READY: // Started up, back at its default return level
+			stats.restarts++;
+			stats.resyncs++;
+			Display_SetReturnLevel(returnLevel);
+			break;
+		case REPLY_PAGE:
+			stats.page = data[1];
+			break;
+		default:
+			stats.events++;
+			break;
+	}
+	return DISPLAY_ERR_NONE;
+}
+
+/**
+ * @brief Adds a byte to the reply being received, handling it once its
+ * terminator is complete
+ * @returns the error the reply reports, or DISPLAY_ERR_NONE
+ */
+static DisplayError_t Display_ParseByte(uint8_t byte){
+	if (replyLen < sizeof(reply)){reply[replyLen] = byte;}
+	replyLen++;
+
+	if (byte == 0xFF && replyLen > 1 + Display_ReplyDataLen(reply[0])){
+		replyEnd++;
+	}
+	else{
+		replyEnd = 0;
+	}
+	if (replyEnd < DISPLAY_TERMINATOR_LEN){return DISPLAY_ERR_NONE;}
+
+	uint32_t len = replyLen - DISPLAY_TERMINATOR_LEN;
+	replyLen = replyEnd = 0;
+	if (len == 0 || len > REPLY_MAX_LEN){ // Too long to keep, such as a string
+		stats.events++;
+		return DISPLAY_ERR_NONE;
+	}
+	return Display_HandleReply(reply, len);
+}
+
+DisplayError_t Display_Poll(){
+	OS_ERR err;
+	DisplayError_t last = DISPLAY_ERR_NONE;
+	char buf[32];
+	uint32_t n;
+
+	while ((n = BSP_UART_ReadRaw(DISP_OUT, buf, sizeof(buf))) > 0){
+		for (uint32_t i = 0; i < n; i++){
+			DisplayError_t replyErr = Display_ParseByte((uint8_t)buf[i]);
+			if (replyErr != DISPLAY_ERR_NONE){last = replyErr;}
+		}
+	}
+
+	OS_TICK now = OSTimeGet(&err);
+	if (!levelSet){
+		// No ready reply, maybe missed: set the level once it has had time to start up
+		if (now - resetAt >= (DISPLAY_BOOT_MS * OSCfg_TickRate_Hz) / 1000){
+			Display_SetReturnLevel(returnLevel);
 		}
-		else{
-			if (cmd.args[0].str == NULL){return DISPLAY_ERR_PARSE;}
-			sprintf(msgArgs, "%s", cmd.args[0].str);
+		return last;
+	}
+
+	// Below DISPLAY_RETURN_ALL successes aren't answered, so timing out is how they are freed
+	OS_TICK timeout = (DISPLAY_ACK_TIMEOUT_MS * OSCfg_TickRate_Hz) / 1000;
+	bool expired = false;
+	CPU_SR_ALLOC();
+	CPU_CRITICAL_ENTER();
+	while (inFlightHead != inFlightTail && now - inFlight[inFlightTail % DISPLAY_MAX_INFLIGHT].sentAt >= timeout){
+		inFlightBytes -= inFlight[inFlightTail % DISPLAY_MAX_INFLIGHT].len;
+		inFlightTail++;
+		if (returnLevel == DISPLAY_RETURN_ALL){
+			stats.errors[DISPLAY_ERR_NO_ACK]++;
+			expired = true;
 		}
+	}
+	CPU_CRITICAL_EXIT();
+
+	if (expired){
+		stats.resyncs++;
+		last = DISPLAY_ERR_NO_ACK;
+	}
+	return last;
+}
+
+void Display_GetCredit(uint32_t *bytes, uint32_t *cmds){
+	CPU_SR_ALLOC();
+	CPU_CRITICAL_ENTER();
+	uint32_t used = inFlightHead - inFlightTail;
+	*bytes = (levelSet && inFlightBytes < DISPLAY_INPUT_BUFFER) ? DISPLAY_INPUT_BUFFER - inFlightBytes : 0;
+	*cmds = levelSet ? DISPLAY_MAX_INFLIGHT - used : 0;
+	CPU_CRITICAL_EXIT();
+}
+
+DisplayError_t Display_SetReturnLevel(DisplayReturnLevel_t level){
+	if (level > DISPLAY_RETURN_ALL){return DISPLAY_ERR_PARSE;}
+
+	// Replies to the commands in flight may not come at the new level
+	Display_DropInFlight();
+	returnLevel = level;
+	levelSet = true;
+
+	char out[DISPLAY_VALUE_MAX_LEN(&RETURN_LEVEL)];
+	uint32_t len = DisplayFormat_Value(out, &RETURN_LEVEL, level);
+	if (level == DISPLAY_RETURN_ALL){Display_Track(len);}
+	Display_Write(out, len);
+	return DISPLAY_ERR_NONE;
+}
 
-		BSP_UART_Write(DISP_OUT, cmd.compOrCmd, strlen(cmd.compOrCmd));
-		BSP_UART_Write(DISP_OUT, ".", 1);
-		BSP_UART_Write(DISP_OUT, cmd.attr, strlen(cmd.attr));
-		BSP_UART_Write(DISP_OUT, cmd.op, strlen(cmd.op));
+const DisplayStats_t *Display_GetStats(){
+	return &stats;
+}
+
+/**
+ * @brief Appends a string to a command, leaving room for the terminator
+ * @returns false if it doesn't fit
+ */
+static bool Display_AppendStr(char *out, uint32_t *n, const char *str){
+	uint32_t room = MAX_CMD_LEN - DISPLAY_TERMINATOR_LEN - *n;
+	uint32_t len = DisplayFormat_Str(&out[*n], str, room);
+	if (len > room){return false;}
+	*n += len;
+	return true;
+}
+
+/**
+ * @brief Appends one of a command's arguments, leaving room for the terminator
+ * @returns false if it doesn't fit or is a NULL string
+ */
+static bool Display_AppendArg(char *out, uint32_t *n, const DisplayCmd_t *cmd, int i){
+	if (cmd->argTypes[i] == INT_ARG){
+		if (*n + DISPLAY_INT_LEN > MAX_CMD_LEN - DISPLAY_TERMINATOR_LEN){return false;}
+		*n += DisplayFormat_Int(&out[*n], (int32_t)cmd->args[i].num);
+		return true;
+	}
+	return cmd->args[i].str != NULL && Display_AppendStr(out, n, cmd->args[i].str);
+}
+
+/**
+ * @brief Formats a command and its terminator
+ * @param cmd the command
+ * @param out at least MAX_CMD_LEN bytes
+ * @param len set to the formatted length
+ * @returns DisplayError_t
+ */
+static DisplayError_t Display_Format(DisplayCmd_t cmd, char *out, uint32_t *len){
+	uint32_t n = 0;
+	if (isAssignCmd(cmd)){ // <comp>.<attr><op><arg>
+		if (!Display_AppendStr(out, &n, cmd.compOrCmd) || !Display_AppendStr(out, &n, ".")
+			|| !Display_AppendStr(out, &n, cmd.attr) || !Display_AppendStr(out, &n, cmd.op)
+			|| !Display_AppendArg(out, &n, &cmd, 0)){
+			return DISPLAY_ERR_PARSE;
+		}
 	}
-	else if (isOpCmd(cmd)){
-		msgArgs[0] = ' '; // No args
-		msgArgs[1] = '\0';
+	else if (isOpCmd(cmd)){ // <cmd> <arg>,<arg>
 		if (cmd.numArgs > MAX_ARGS){return DISPLAY_ERR_OTHER;}
-		if (cmd.numArgs >= 1){ // If there are arguments
-			for (int i = 0; i < cmd.numArgs; i++){
-				char arg[MAX_ARG_LEN];
-				if (cmd.argTypes[i] == INT_ARG){
-					sprintf(arg, "%d", (int)cmd.args[i].num);
-				}
-				else{
-					sprintf(arg, "%s", cmd.args[i].str);
-				}
-
-				strcat(msgArgs, arg);
-
-				if (i < cmd.numArgs - 1){ // delimiter
-					strcat(msgArgs, ",");
-				}
+		if (cmd.compOrCmd == NULL || !Display_AppendStr(out, &n, cmd.compOrCmd)){return DISPLAY_ERR_PARSE;}
+		for (int i = 0; i < cmd.numArgs; i++){
+			if (!Display_AppendStr(out, &n, (i == 0) ? " " : ",") || !Display_AppendArg(out, &n, &cmd, i)){
+				return DISPLAY_ERR_PARSE;
 			}
 		}
-		BSP_UART_Write(DISP_OUT, cmd.compOrCmd, strlen(cmd.compOrCmd));
 	}
 	else{ // Error parsing command struct
 		return DISPLAY_ERR_PARSE;
 	}
 
-	if (cmd.numArgs >= 1){ // If there are arguments
-		BSP_UART_Write(DISP_OUT, msgArgs, strlen(msgArgs));
+	memcpy(&out[n], DISPLAY_TERMINATOR, DISPLAY_TERMINATOR_LEN);
+	*len = n + DISPLAY_TERMINATOR_LEN;
+	return DISPLAY_ERR_NONE;
+}
+
+DisplayError_t Display_Send(DisplayCmd_t cmd){
+	char out[MAX_CMD_LEN];
+	uint32_t len;
+	DisplayError_t err = Display_Format(cmd, out, &len);
+	if (err != DISPLAY_ERR_NONE){return err;}
+
+	Display_Track(len);
+	Display_Write(out, len);
+	return DISPLAY_ERR_NONE;
+}
+
+DisplayError_t Display_Queue(DisplayCmd_t cmd){
+	if (frameLen + MAX_CMD_LEN > FRAME_LEN || frameCmds == FRAME_MAX_CMDS){ // Might not fit, send what is queued so far
+		Display_Flush();
+	}
+
+	uint32_t len;
+	DisplayError_t err = Display_Format(cmd, &frame[frameLen], &len);
+	if (err != DISPLAY_ERR_NONE){return err;}
+
+	frameLen += len;
+	frameCmdLens[frameCmds++] = (uint16_t)len;
+	return DISPLAY_ERR_NONE;
+}
+
+DisplayError_t Display_QueueValue(const DisplayTemplate_t *tmpl, int32_t val){
+	if (DISPLAY_VALUE_MAX_LEN(tmpl) > FRAME_LEN){return DISPLAY_ERR_PARSE;}
+	if (frameLen + DISPLAY_VALUE_MAX_LEN(tmpl) > FRAME_LEN || frameCmds == FRAME_MAX_CMDS){ // Might not fit, send what is queued so far
+		Display_Flush();
 	}
 
-	BSP_UART_Write(DISP_OUT, (char *)TERMINATOR, strlen(TERMINATOR));
+	uint32_t len = DisplayFormat_Value(&frame[frameLen], tmpl, val);
+	frameLen += len;
+	frameCmdLens[frameCmds++] = (uint16_t)len;
+	return DISPLAY_ERR_NONE;
+}
 
+DisplayError_t Display_Flush(){
+	if (frameLen > 0){
+		for (uint32_t i = 0; i < frameCmds; i++){
+			Display_Track(frameCmdLens[i]);
+		}
+		Display_Write(frame, frameLen);
+		frameLen = 0;
+		frameCmds = 0;
+	}
 	return DISPLAY_ERR_NONE;
 }
 
+uint32_t Display_GetBytesSent(){
+	return bytesSent;
+}
+
 DisplayError_t Display_Reset(){
 	DisplayCmd_t restCmd = {
 		.compOrCmd = "rest",
@@ -87,60 +439,56 @@ DisplayError_t Display_Reset(){
 		.op = NULL,
 		.numArgs = 0};
 
-	BSP_UART_Write(DISP_OUT, (char *)TERMINATOR, strlen(TERMINATOR)); // Terminates any in progress command
+	Display_Write(DISPLAY_TERMINATOR, DISPLAY_TERMINATOR_LEN); // Terminates any in progress command
+
+	// Nothing sent before it restarts will be answered, and it forgets its return level
+	OS_ERR err;
+	Display_DropInFlight();
+	levelSet = false;
+	resetAt = OSTimeGet(&err);
+	replyLen = replyEnd = 0;
 
 	return Display_Send(restCmd);
 }
 
 DisplayError_t Display_Error(){
+	const uint16_t codes[] = {
+		(uint16_t)Error_OS,
+		(uint16_t)Error_ReadCarCAN,
+		(uint16_t)Error_ReadTritium,
+		(uint16_t)Error_UpdateDisplay
+	};
 
-	BSP_UART_Write(DISP_OUT, (char *)TERMINATOR, strlen(TERMINATOR)); // Terminates any in progress command
-
-	char faultPage[7] = "page 2";
-	BSP_UART_Write(DISP_OUT, faultPage, strlen(faultPage));
-	BSP_UART_Write(DISP_OUT, (char *)TERMINATOR, strlen(TERMINATOR));
-
-    char setFaultCode[20];
-    
-    sprintf(setFaultCode, "%s%d", "oserr.val=", (uint16_t)Error_OS);
-    BSP_UART_Write(DISP_OUT, setFaultCode, strlen(setFaultCode));
-    memset(setFaultCode, 0, strlen(setFaultCode) * sizeof(char));
-
-    sprintf(setFaultCode, "%s%d", "rccerr.val=", (uint16_t)Error_ReadCarCAN);
-    BSP_UART_Write(DISP_OUT, setFaultCode, strlen(setFaultCode));
-    memset(setFaultCode, 0, strlen(setFaultCode) * sizeof(char));
-
-    sprintf(setFaultCode, "%s%d", "merr.val=", (uint16_t)Error_ReadTritium);
-    BSP_UART_Write(DISP_OUT, setFaultCode, strlen(setFaultCode));
-    memset(setFaultCode, 0, strlen(setFaultCode) * sizeof(char));
-
-    sprintf(setFaultCode, "%s%d", "disperr.val=", (uint16_t)Error_UpdateDisplay);
-    BSP_UART_Write(DISP_OUT, setFaultCode, strlen(setFaultCode));
-    memset(setFaultCode, 0, strlen(setFaultCode) * sizeof(char));
-	
-	
-	// BSP_UART_Write(DISP_OUT, setFaultCode, strlen(setFaultCode));
-	BSP_UART_Write(DISP_OUT, (char *)TERMINATOR, strlen(TERMINATOR));
+	// Built on the stack and sent in one write, so it is safe from any context
+	// The leading terminator cuts short whatever the display was receiving, so the
+	// commands in flight are written off and each command of the screen is tracked
+	char out[ERROR_SCREEN_LEN];
+	Display_DropInFlight();
+	uint32_t len = DisplayFormat_Value(out, &INTERRUPT_PAGE, FAULT);
+	Display_Track(len);
+	for (int i = 0; i < (int)(sizeof(codes) / sizeof(codes[0])); i++){
+		uint32_t cmdLen = DisplayFormat_Value(&out[len], &ERROR_CODES[i], codes[i]);
+		Display_Track(cmdLen);
+		len += cmdLen;
+	}
 
+	Display_Write(out, len);
 	return DISPLAY_ERR_NONE;
 }
 
 DisplayError_t Display_Evac(uint8_t SOC_percent, uint32_t supp_mv){
-	BSP_UART_Write(DISP_OUT, (char *)TERMINATOR, strlen(TERMINATOR)); // Terminates any in progress command
-
-	char evacPage[7] = "page 3";
-	BSP_UART_Write(DISP_OUT, evacPage, strlen(evacPage));
-	BSP_UART_Write(DISP_OUT, (char *)TERMINATOR, strlen(TERMINATOR));
-
-	char soc[13];
-	sprintf(soc, "%s%d", "soc.val=", (int)SOC_percent);
-	BSP_UART_Write(DISP_OUT, soc, strlen(soc));
-	BSP_UART_Write(DISP_OUT, (char *)TERMINATOR, strlen(TERMINATOR));
-
-	char supp[18];
-	sprintf(supp, "%s%d", "supp.val=", (int)supp_mv);
-	BSP_UART_Write(DISP_OUT, supp, strlen(supp));
-	BSP_UART_Write(DISP_OUT, (char *)TERMINATOR, strlen(TERMINATOR));
+	// Tracked like the fault screen
+	char out[EVAC_SCREEN_LEN];
+	Display_DropInFlight();
+	uint32_t len = DisplayFormat_Value(out, &INTERRUPT_PAGE, EVAC_PAGE);
+	Display_Track(len);
+	uint32_t cmdLen = DisplayFormat_Value(&out[len], &EVAC_SOC, SOC_percent);
+	Display_Track(cmdLen);
+	len += cmdLen;
+	cmdLen = DisplayFormat_Value(&out[len], &EVAC_SUPP, (int32_t)supp_mv);
+	Display_Track(cmdLen);
+	len += cmdLen;
 
+	Display_Write(out, len);
 	return DISPLAY_ERR_NONE;
 }
@@ -6,7 +6,9 @@
  */
 
 #include "Pedals.h"
+#include "BSP_Cycles.h"
 #include "stm32f4xx_gpio.h"
+#include "os.h"
 
 // Constants used to tune the pedals
 // Indexed using pedal_t
@@ -21,6 +23,34 @@ static const int16_t UpperBound[NUMBER_OF_PEDALS] = {
     3300, // Brake upper bound
 };
 
+// Debounced brake switch, written by the interrupt and by Pedals_Read
+static volatile bool brakePressed = false;
+static volatile uint32_t brakeChangedAt = 0;
+static uint32_t brakeDebounceCycles;
+static Pedals_BrakeHandler_t brakeHandler = NULL;
+
+/**
+ * @brief   Accepts a brake switch level if it differs from the debounced one and
+ *          the switch has been quiet for BRAKE_DEBOUNCE_US. Call with interrupts off.
+ * @return  true if the level was accepted
+ */
+static bool brakeSettle(bool level, uint32_t timestamp){
+    if (level == brakePressed || timestamp - brakeChangedAt < brakeDebounceCycles) return false;
+    brakePressed = level;
+    brakeChangedAt = timestamp;
+    return true;
+}
+
+/**
+ * @brief   Brake switch edge interrupt. The first edge after a quiet period is
+ *          taken right away; the bounces that follow it are ignored.
+ */
+static void brakeEdge(bool level, uint32_t timestamp){
+    if (brakeSettle(level, timestamp) && brakeHandler != NULL){
+        brakeHandler(level, timestamp);
+    }
+}
+
 /**
  * @brief   Initializes the brake and accelerator by using the 
  *          BSP_ADC_Init function with parameters ACCELERATOR
@@ -31,6 +61,19 @@ static const int16_t UpperBound[NUMBER_OF_PEDALS] = {
 void Pedals_Init(){
     BSP_ADC_Init();
     BSP_GPIO_Init(PORTC, GPIO_Pin_15, INPUT, true);
+
+    brakeDebounceCycles = BRAKE_DEBOUNCE_US * (SystemCoreClock / 1000000);
+    brakeChangedAt = BSP_Cycles_Get() - brakeDebounceCycles;
+    brakePressed = BSP_GPIO_Read_Pin(PORTC, GPIO_Pin_15);
+    BSP_GPIO_Init_Interrupt(PORTC, GPIO_Pin_15, brakeEdge);
+}
+
+void Pedals_SetBrakeHandler(Pedals_BrakeHandler_t handler){
+    brakeHandler = handler;
+}
+
+uint32_t Pedals_BrakeChangedAt(void){
+    return brakeChangedAt;
 }
 
 /**
@@ -43,7 +86,13 @@ void Pedals_Init(){
  */
 int8_t Pedals_Read(pedal_t pedal){
     if (pedal == BRAKE){
-        return (BSP_GPIO_Read_Pin(PORTC, GPIO_Pin_15))?100:0;
+        // Catch up with a change the interrupt ignored as a bounce
+        CPU_SR_ALLOC();
+        CPU_CRITICAL_ENTER();
+        brakeSettle(BSP_GPIO_Read_Pin(PORTC, GPIO_Pin_15), BSP_Cycles_Get());
+        bool pressed = brakePressed;
+        CPU_CRITICAL_EXIT();
+        return pressed?100:0;
     }
     
     if (pedal >= NUMBER_OF_PEDALS) return 0;
@@ -27,6 +27,7 @@ namespace Antmicro.Renode.Peripherals.Analog
    // * Single conversion
    // * Scan mode with regular group
    // * Continuous conversion
+   // * External trigger on the regular group, at a fixed rate (the source is not modelled)
    // * Modes of use
    //   - Polling (read EOC status flag)
    //   - Interrupt (enable ADC interrupt for EOC)
@@ -35,7 +36,7 @@ namespace Antmicro.Renode.Peripherals.Analog
    // Not Implemented:
    // * Analog watchdog
    // * Overrun detection
-   // * External triggers
+   // * External trigger source selection and edges
    // * Injected channels
    // * Sampling time (time is fixed)
    // * Discontinuous mode
@@ -59,6 +60,17 @@ namespace Antmicro.Renode.Peripherals.Analog
                autoUpdate: false,
                workMode: WorkMode.OneShot);
          samplingTimer.LimitReached += OnConversionFinished;
+
+         // Stands in for whichever timer the firmware selected as the trigger
+         triggerTimer = new LimitTimer(
+               machine.ClockSource, 1000000, this, "triggerClock",
+               limit: 1000000 / ExternalTriggerHz,
+               eventEnabled: true,
+               direction: Direction.Ascending,
+               enabled: false,
+               autoUpdate: true,
+               workMode: WorkMode.Periodic);
+         triggerTimer.LimitReached += StartConversion;
       }
 
       public void FeedSample(uint value, uint channelIdx, int repeat = 1)
@@ -133,7 +145,7 @@ namespace Antmicro.Renode.Peripherals.Analog
          Registers.Control2.Define(this, name: "Control2")
             .WithFlag(0, out adcOn,
                   name: "A/D Converter ON/OFF",
-                  changeCallback: (_, val) => { if(val) { EnableADC(); }})
+                  changeCallback: (_, val) => { if(val) { EnableADC(); } UpdateExternalTrigger(); })
             .WithFlag(1, out continuousConversion, name: "Continous conversion")
             .WithReservedBits(2, 6)
             .WithFlag(8, out dmaEnabled, name: "Direct memory access mode")
@@ -146,7 +158,9 @@ namespace Antmicro.Renode.Peripherals.Analog
             .WithTaggedFlag("Start conversion of injected channels", 22)
             .WithReservedBits(23, 1)
             .WithTag("External event select for regular group", 24, 4)
-            .WithTag("External trigger enable for regular channels", 28, 2)
+            .WithValueField(28, 2, out externalTriggerEnable,
+                  name: "External trigger enable for regular channels",
+                  changeCallback: (_, __) => UpdateExternalTrigger())
             .WithFlag(30,
                   name: "Start Conversion Of Regular Channels",
                   writeCallback: (_, value) => { if(value) StartConversion(); },
@@ -232,6 +246,11 @@ namespace Antmicro.Renode.Peripherals.Analog
           currentChannel = channels[regularSequence[currentChannelIdx].Value];
       }
 
+      private void UpdateExternalTrigger()
+      {
+         triggerTimer.Enabled = adcOn.Value && externalTriggerEnable.Value != 0;
+      }
+
       private void StartConversion()
       {
          if(adcOn.Value)
@@ -293,6 +312,7 @@ namespace Antmicro.Renode.Peripherals.Analog
       private IFlagRegisterField endOfConversionSelect;
       private IFlagRegisterField eocInterruptEnable;
       private IFlagRegisterField continuousConversion;
+      private IValueRegisterField externalTriggerEnable;
 
       private IFlagRegisterField dmaEnabled;
       private IFlagRegisterField dmaIssueRequest;
@@ -301,6 +321,10 @@ namespace Antmicro.Renode.Peripherals.Analog
       // regular channel sequence.
       private readonly LimitTimer samplingTimer;
 
+      // Trigger timer. Starts a conversion of the regular group at a fixed
+      // rate while an external trigger is enabled.
+      private readonly LimitTimer triggerTimer;
+
       // Data sample to be returned from data register when read.
       private uint adcData;
 
@@ -316,6 +340,9 @@ namespace Antmicro.Renode.Peripherals.Analog
 
       public const int NumberOfChannels = 19;
 
+      // Matches ADC_SAMPLE_HZ in BSP_ADC.h
+      private const int ExternalTriggerHz = 2000;
+
       private enum Registers
       {
          Status = 0x0,
@@ -0,0 +1,347 @@
+# Generates Config/Inc/CANSignals.h, the pack/unpack functions for every CAN
+# message, from the signal schema in Config/CAN/Controls.dbc.
+# Usage: python3 Scripts/can_codegen.py [--check]
+#   --check  exit with an error if the checked in header is out of date
+#
+# Only the parts of the DBC format we use are supported: little-endian (@1)
+# signals, SIG_VALTYPE_ 1 for 32-bit floats, and factors/offsets that can be
+# applied in fixed point (the factor is turned into a fraction, the offset
+# must be a whole number).
+#
+# Scaling is done in 32-bit integers when every value can be converted without
+# overflowing them, and in 64-bit integers otherwise, which the Cortex-M4 can
+# only divide with a library call. Getters must handle every raw value; setters
+# only need to handle values within the signal's [min|max] range, when it has one.
+import os
+import re
+import sys
+from fractions import Fraction
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+SCHEMA = os.path.join(ROOT, 'Config', 'CAN', 'Controls.dbc')
+TABLE = os.path.join(ROOT, 'Drivers', 'Inc', 'CANMessages.h')
+OUTPUT = os.path.join(ROOT, 'Config', 'Inc', 'CANSignals.h')
+
+BO_RE = re.compile(r'^BO_\s+(\d+)\s+(\w+)\s*:\s*(\d+)\s+\w+')
+SG_RE = re.compile(r'^\s*SG_\s+(\w+)\s*:\s*(\d+)\|(\d+)@([01])([+-])\s*'
+                   r'\(([^,]+),([^)]+)\)\s*\[([^|\]]*)\|([^\]]*)\]\s*"([^"]*)"')
+VALTYPE_RE = re.compile(r'^SIG_VALTYPE_\s+(\d+)\s+(\w+)\s*:\s*(\d)\s*;')
+TABLE_RE = re.compile(r'X\(\s*(\w+),\s*(0x[0-9A-Fa-f]+),\s*(\w+)')
+SIZES = {'BYTE': 1, 'HALFWORD': 2, 'WORD': 4, 'DOUBLE': 8}
+INT32 = (-(1 << 31), (1 << 31) - 1)
+UINT32 = (0, (1 << 32) - 1)
+
+
+def fits(values, limits):
+    return all(limits[0] <= v <= limits[1] for v in values)
+
+
+def divide(value, den):
+    """C integer division, which rounds toward zero"""
+    return -(-value // den) if value < 0 else value // den
+
+
+class Signal:
+    def __init__(self, name, start, length, signed, factor, offset, minimum, maximum, unit):
+        self.name = name
+        self.start = start
+        self.length = length
+        self.signed = signed
+        self.factor = Fraction(factor)
+        self.offset = Fraction(offset)
+        self.minimum = Fraction(minimum)
+        self.maximum = Fraction(maximum)
+        self.unit = unit
+        self.is_float = False
+
+    def check(self, msg):
+        where = f'{msg.name}.{self.name}'
+        if self.start + self.length > msg.dlc * 8:
+            sys.exit(f'{where} does not fit in {msg.dlc} bytes')
+        if self.is_float:
+            if self.length != 32 or self.factor != 1 or self.offset != 0:
+                sys.exit(f'{where}: floats must be 32 bits with no scaling')
+        if self.offset.denominator != 1:
+            sys.exit(f'{where}: offsets must be whole numbers')
+        if self.length > 32:
+            sys.exit(f'{where}: signals are limited to 32 bits')
+
+    @property
+    def scaled(self):
+        return self.factor != 1 or self.offset != 0
+
+    @property
+    def raw_type(self):
+        bits = 8 if self.length <= 8 else 16 if self.length <= 16 else 32
+        return f'{"int" if self.signed else "uint"}{bits}_t'
+
+    @property
+    def raw_range(self):
+        if self.signed:
+            return -(1 << (self.length - 1)), (1 << (self.length - 1)) - 1
+        return 0, (1 << self.length) - 1
+
+    @property
+    def get_type(self):
+        """32-bit type to scale raw values in, or None if some need 64 bits"""
+        num, den, off = self.factor.numerator, self.factor.denominator, int(self.offset)
+        t, limits = ('int32_t', INT32) if self.signed else ('uint32_t', UINT32)
+        products = [v * num for v in self.raw_range]
+        results = [divide(v, den) for v in products]
+        if fits(products, limits) and fits(results, INT32) and fits([v + off for v in results], INT32):
+            return t
+        return None
+
+    @property
+    def set_type(self):
+        """32-bit type to scale values in the signal's range in, or None if some need 64 bits"""
+        num, den, off = self.factor.numerator, self.factor.denominator, int(self.offset)
+        if self.maximum > self.minimum:
+            values = [int(self.minimum), int(self.maximum)]
+        else:
+            values = list(INT32)
+        shifted = [v - off for v in values]
+        t, limits = ('uint32_t', UINT32) if min(shifted) >= 0 else ('int32_t', INT32)
+        if fits(shifted, INT32) and fits([v * den for v in shifted], limits):
+            return t
+        return None
+
+    @property
+    def c_type(self):
+        if self.is_float:
+            return 'float'
+        if self.length == 1 and not self.scaled:
+            return 'bool'
+        if self.scaled:
+            return 'int32_t'
+        return self.raw_type
+
+    @property
+    def aligned(self):
+        return self.start % 8 == 0 and self.length in (8, 16, 32)
+
+    @property
+    def span(self):
+        """Bytes the signal touches, so unaligned signals never read past the message."""
+        return (self.start + self.length - 1) // 8 - self.start // 8 + 1
+
+    @property
+    def shift(self):
+        return self.start % 8
+
+
+class Message:
+    def __init__(self, can_id, name, dlc):
+        self.id = can_id
+        self.name = name
+        self.dlc = dlc
+        self.signals = []
+
+
+def parse(path):
+    messages = []
+    by_id = {}
+    with open(path) as f:
+        for line in f:
+            m = BO_RE.match(line)
+            if m:
+                msg = Message(int(m.group(1)), m.group(2), int(m.group(3)))
+                messages.append(msg)
+                by_id[msg.id] = msg
+                continue
+            m = SG_RE.match(line)
+            if m:
+                name, start, length, order, sign, factor, offset, minimum, maximum, unit = m.groups()
+                if order != '1':
+                    sys.exit(f'{messages[-1].name}.{name}: only little-endian signals are supported')
+                messages[-1].signals.append(Signal(name, int(start), int(length), sign == '-',
+                                                   factor.strip(), offset.strip(), minimum.strip(),
+                                                   maximum.strip(), unit))
+                continue
+            m = VALTYPE_RE.match(line)
+            if m:
+                sig = [s for s in by_id[int(m.group(1))].signals if s.name == m.group(2)]
+                if not sig or m.group(3) != '1':
+                    sys.exit(f'Unsupported value type: {line.strip()}')
+                sig[0].is_float = True
+    for msg in messages:
+        for sig in msg.signals:
+            sig.check(msg)
+    return messages
+
+
+def check_table(messages):
+    """Every CANId_t must have a schema entry with the same ID and length."""
+    with open(TABLE) as f:
+        table = {name: (int(can_id, 16), SIZES[size]) for name, can_id, size in TABLE_RE.findall(f.read())}
+    schema = {msg.name: msg for msg in messages}
+    for name, (can_id, size) in table.items():
+        if name not in schema:
+            sys.exit(f'{name} is in CANMessages.h but not in the schema')
+        if schema[name].id != can_id or schema[name].dlc != size:
+            sys.exit(f'{name}: schema ID/length do not match CANMessages.h')
+    for name in schema:
+        if name not in table:
+            sys.exit(f'{name} is in the schema but not in CANMessages.h')
+
+
+def getter(msg, sig):
+    fn = f'CAN_{msg.name}_Get{sig.name}'
+    byte = sig.start // 8
+    lines = [f'static inline {sig.c_type} {fn}(const uint8_t* data){{']
+    if sig.is_float:
+        lines.append(f'    float value;')
+        lines.append(f'    memcpy(&value, &data[{byte}], sizeof value);')
+        lines.append(f'    return value;')
+        lines.append('}')
+        return lines
+
+    if sig.aligned:
+        lines.append(f'    {sig.raw_type} raw;')
+        lines.append(f'    memcpy(&raw, &data[{byte}], sizeof raw);')
+    else:
+        mask = (1 << sig.length) - 1
+        lines.append(f'    uint64_t bits = 0;')
+        lines.append(f'    memcpy(&bits, &data[{byte}], {sig.span});')
+        if sig.signed:
+            left = 64 - sig.length - sig.shift
+            lines.append(f'    {sig.raw_type} raw = ({sig.raw_type})((int64_t)(bits << {left}) >> {64 - sig.length});')
+        elif sig.shift:
+            lines.append(f'    {sig.raw_type} raw = ({sig.raw_type})((bits >> {sig.shift}) & 0x{mask:X}u);')
+        else:
+            lines.append(f'    {sig.raw_type} raw = ({sig.raw_type})(bits & 0x{mask:X}u);')
+
+    if sig.scaled:
+        num, den, off = sig.factor.numerator, sig.factor.denominator, int(sig.offset)
+        t = sig.get_type or 'int64_t'
+        u = 'u' if t == 'uint32_t' else ''
+        expr = f'({t})raw'
+        if num != 1:
+            expr = f'{expr} * {num}{u}'
+        if den != 1:
+            expr = f'({expr}) / {den}{u}'
+        if off != 0:
+            expr = f'(int32_t)({expr}) + {off}' if t == 'uint32_t' else f'{expr} + {off}'
+        lines.append(f'    return (int32_t)({expr});')
+    elif sig.c_type == 'bool':
+        lines.append(f'    return raw != 0;')
+    else:
+        lines.append(f'    return raw;')
+    lines.append('}')
+    return lines
+
+
+def setter(msg, sig):
+    fn = f'CAN_{msg.name}_Set{sig.name}'
+    byte = sig.start // 8
+    lines = [f'static inline void {fn}(uint8_t* data, {sig.c_type} value){{']
+    if sig.is_float:
+        lines.append(f'    memcpy(&data[{byte}], &value, sizeof value);')
+        lines.append('}')
+        return lines
+
+    if sig.scaled:
+        num, den, off = sig.factor.numerator, sig.factor.denominator, int(sig.offset)
+        t = sig.set_type
+        if t is None:
+            expr = '(int64_t)value'
+            if off != 0:
+                expr = f'({expr} - {off})'
+        else:
+            expr = f'({t})(value - {off})' if off != 0 else f'({t})value'
+        u = 'u' if t == 'uint32_t' else ''
+        if den != 1:
+            expr = f'{expr} * {den}{u}'
+        if num != 1:
+            expr = f'({expr}) / {num}{u}'
+        lines.append(f'    {sig.raw_type} raw = ({sig.raw_type})({expr});')
+    else:
+        lines.append(f'    {sig.raw_type} raw = ({sig.raw_type})value;')
+
+    if sig.aligned:
+        lines.append(f'    memcpy(&data[{byte}], &raw, sizeof raw);')
+    else:
+        mask = ((1 << sig.length) - 1) << sig.shift
+        value = f'((uint64_t)raw << {sig.shift})' if sig.shift else '(uint64_t)raw'
+        lines.append(f'    uint64_t bits = 0;')
+        lines.append(f'    memcpy(&bits, &data[{byte}], {sig.span});')
+        lines.append(f'    bits = (bits & ~0x{mask:X}ull) | ({value} & 0x{mask:X}ull);')
+        lines.append(f'    memcpy(&data[{byte}], &bits, {sig.span});')
+    lines.append('}')
+    return lines
+
+
+def generate(messages):
+    out = ['/**',
+           ' * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar',
+           ' * @file CANSignals.h',
+           ' * @brief Pack/unpack functions for the signals of every CAN message.',
+           ' *',
+           ' * GENERATED by Scripts/can_codegen.py from Config/CAN/Controls.dbc. Do not edit by hand.',
+           ' *',
+           ' * Getters read a signal straight out of a message\'s data bytes, setters write one into them.',
+           ' * Every access goes through memcpy, so the data does not need to be aligned; the compiler',
+           ' * turns each one into a single load or store. Scaled signals are converted with integer math,',
+           ' * in 32 bits unless a value could overflow them. Setters of scaled signals expect values',
+           ' * within the signal\'s range in the DBC.',
+           ' * Only depends on the C standard library so host tools can include it too.',
+           ' * Assumes a little-endian target, like CAN payloads.',
+           ' *',
+           ' * @defgroup CANSignals',
+           ' * @addtogroup CANSignals',
+           ' * @{',
+           ' */',
+           '',
+           '#ifndef CAN_SIGNALS_H',
+           '#define CAN_SIGNALS_H',
+           '',
+           '#include <stdbool.h>',
+           '#include <stdint.h>',
+           '#include <string.h>',
+           '']
+    for msg in messages:
+        out.append(f'// {msg.name} (0x{msg.id:03X}), {msg.dlc} byte{"s" if msg.dlc != 1 else ""}')
+        if not msg.signals:
+            out.append('// No signals')
+            out.append('')
+            continue
+
+        out.append('typedef struct {')
+        for sig in msg.signals:
+            unit = f' // {sig.unit}' if sig.unit else ''
+            out.append(f'    {sig.c_type} {sig.name};{unit}')
+        out.append(f'}} CAN_{msg.name}_t;')
+        out.append('')
+        for sig in msg.signals:
+            out.extend(getter(msg, sig))
+            out.extend(setter(msg, sig))
+        out.append(f'static inline void CAN_{msg.name}_Unpack(const uint8_t* data, CAN_{msg.name}_t* out){{')
+        for sig in msg.signals:
+            out.append(f'    out->{sig.name} = CAN_{msg.name}_Get{sig.name}(data);')
+        out.append('}')
+        out.append(f'static inline void CAN_{msg.name}_Pack(uint8_t* data, const CAN_{msg.name}_t* in){{')
+        for sig in msg.signals:
+            out.append(f'    CAN_{msg.name}_Set{sig.name}(data, in->{sig.name});')
+        out.append('}')
+        out.append('')
+    out.append('#endif')
+    out.append('')
+    out.append('/* @} */')
+    return '\n'.join(out) + '\n'
+
+
+def main():
+    messages = parse(SCHEMA)
+    check_table(messages)
+    header = generate(messages)
+    if '--check' in sys.argv:
+        with open(OUTPUT) as f:
+            if f.read() != header:
+                sys.exit(f'{os.path.relpath(OUTPUT, ROOT)} is out of date, run Scripts/can_codegen.py')
+        return
+    with open(OUTPUT, 'w') as f:
+        f.write(header)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,27 @@
+# Finds a multiplier for CAN_HASH in Drivers/Inc/CANConfig.h that gives every
+# message in Drivers/Inc/CANMessages.h its own hash slot.
+# Usage: python3 Scripts/can_hash.py [hash bits]
+import os
+import random
+import re
+import sys
+
+bits = int(sys.argv[1]) if len(sys.argv) > 1 else 6
+table = os.path.join(os.path.dirname(__file__), '..', 'Drivers', 'Inc', 'CANMessages.h')
+
+with open(table) as f:
+    ids = [int(m, 16) for m in re.findall(r'X\(\s*\w+,\s*(0x[0-9A-Fa-f]+)', f.read())]
+
+if len(ids) > (1 << bits):
+    sys.exit(f'{len(ids)} messages do not fit in {1 << bits} slots, use more bits')
+
+random.seed(0)
+for tries in range(1, 10_000_001):
+    mult = random.getrandbits(32) | 1
+    slots = {((i * mult) & 0xFFFFFFFF) >> (32 - bits) for i in ids}
+    if len(slots) == len(ids):
+        print(f'#define CAN_HASH_BITS {bits}')
+        print(f'#define CAN_HASH_MULT 0x{mult:08X}u')
+        break
+else:
+    sys.exit(f'No multiplier found, try {bits + 1} bits')
@@ -0,0 +1,146 @@
+# Decodes a CAN capture dumped by the controls board (CANbus_Capture dump) and
+# prints it or replays it into the Renode carCan/motorCan hubs.
+#
+# Usage:
+#   python3 Scripts/can_replay.py capture.bin                 print the frames
+#   python3 Scripts/can_replay.py --port /dev/ttyUSB0 -o capture.bin
+#                                                             ask the board for a dump over USB UART and save it
+#   python3 Scripts/can_replay.py capture.bin --car vcan0 --motor vcan1
+#                                                             replay the received frames with their original timing
+#
+# Replay goes through SocketCAN (Linux only). Create the interfaces with
+#   sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+# (and the same for vcan1), then run the bridge_can macro in Renode/startup.resc
+# to connect them to the hubs.
+#
+# Stream format (little-endian), written by CANbus_CaptureDump:
+#   header  "CANC", version (1 byte), reserved (1 byte), record count (2 bytes),
+#           core clock in Hz (4 bytes), frames overwritten before the dump (4 bytes)
+#   record  cycle count (4 bytes), ID | MotorCAN << 11 | TX << 12 (2 bytes),
+#           length (1 byte), data (length bytes)
+import argparse
+import socket
+import struct
+import sys
+import time
+
+MAGIC = b'CANC'
+VERSION = 1
+HEADER = struct.Struct('<4sBxHII')
+RECORD = struct.Struct('<IHB')
+
+
+class Frame:
+    def __init__(self, seconds, can_id, motor, tx, data):
+        self.seconds = seconds
+        self.id = can_id
+        self.motor = motor
+        self.tx = tx
+        self.data = data
+
+    def __str__(self):
+        bus = 'motor' if self.motor else 'car'
+        direction = 'tx' if self.tx else 'rx'
+        return f'({self.seconds:12.6f}) {bus:5} {direction} {self.id:03X}#{self.data.hex().upper()}'
+
+
+def decode(stream):
+    """Finds the capture in a stream that may also hold console text and decodes it."""
+    start = stream.find(MAGIC)
+    if start < 0:
+        sys.exit('No capture found')
+    magic, version, count, clock, lost = HEADER.unpack_from(stream, start)
+    if version != VERSION:
+        sys.exit(f'Unsupported capture version {version}')
+
+    frames = []
+    pos = start + HEADER.size
+    first = None
+    elapsed = 0
+    for _ in range(count):
+        if pos + RECORD.size > len(stream):
+            sys.exit(f'Capture is truncated after {len(frames)} of {count} frames')
+        cycles, tag, length = RECORD.unpack_from(stream, pos)
+        pos += RECORD.size
+        data = stream[pos:pos + length]
+        pos += length
+        # Cycle counts wrap every 2^32 cycles, so accumulate the differences
+        if first is not None:
+            elapsed += (cycles - first) & 0xFFFFFFFF
+        first = cycles
+        frames.append(Frame(elapsed / clock, tag & 0x7FF, bool(tag & (1 << 11)),
+                            bool(tag & (1 << 12)), data))
+    return frames, lost
+
+
+def read_port(port, timeout):
+    import serial
+    ser = serial.Serial(port=port, baudrate=115200, timeout=timeout)
+    ser.reset_input_buffer()
+    ser.write(b'CANbus_Capture dump\r')
+    stream = b''
+    while True:
+        chunk = ser.read(4096)
+        if not chunk:
+            break
+        stream += chunk
+    return stream
+
+
+def replay(frames, interfaces, speed, include_tx):
+    sockets = {}
+    for motor, name in interfaces.items():
+        if name:
+            sock = socket.socket(socket.AF_CAN, socket.SOCK_RAW, socket.CAN_RAW)
+            sock.bind((name,))
+            sockets[motor] = sock
+
+    start = time.monotonic()
+    for frame in frames:
+        if frame.tx and not include_tx:
+            continue  # the firmware sends these itself
+        if frame.motor not in sockets:
+            continue
+        delay = frame.seconds / speed - (time.monotonic() - start)
+        if delay > 0:
+            time.sleep(delay)
+        sockets[frame.motor].send(struct.pack('=IB3x8s', frame.id, len(frame.data), frame.data))
+        print(frame)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode and replay a controls CAN capture')
+    parser.add_argument('file', nargs='?', help='capture file to read')
+    parser.add_argument('--port', help='serial port to request a dump from instead of reading a file')
+    parser.add_argument('--timeout', type=float, default=2.0, help='seconds of silence that end a dump')
+    parser.add_argument('-o', '--output', help='save the raw capture to this file')
+    parser.add_argument('--car', help='SocketCAN interface bridged to the carCan hub')
+    parser.add_argument('--motor', help='SocketCAN interface bridged to the motorCan hub')
+    parser.add_argument('--speed', type=float, default=1.0, help='replay speed multiplier')
+    parser.add_argument('--tx', action='store_true', help='also replay frames the board sent')
+    args = parser.parse_args()
+
+    if args.port:
+        stream = read_port(args.port, args.timeout)
+    elif args.file:
+        with open(args.file, 'rb') as f:
+            stream = f.read()
+    else:
+        parser.error('give a capture file or --port')
+
+    frames, lost = decode(stream)
+    if args.output:
+        start = stream.find(MAGIC)
+        with open(args.output, 'wb') as f:
+            f.write(stream[start:])
+
+    print(f'{len(frames)} frames, {lost} older frames were overwritten', file=sys.stderr)
+    if args.car or args.motor:
+        replay(frames, {False: args.car, True: args.motor}, args.speed, args.tx)
+    elif not args.output:
+        for frame in frames:
+            print(frame)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,187 @@
+# Checks Drivers/Inc/DisplayFormat.h against sprintf and times it on the host.
+# Usage: python3 Scripts/display_bench.py [--quick]
+#   --quick  only check the output, without timing
+#
+# Builds the commands UpdateDisplay sends, "vis <comp>,<n>" and "<comp>.val=<n>",
+# and the fault screen, both with the templates and the way Display_Send used to:
+# sprintf and strcat into a buffer, then one write per piece, measured with
+# strlen. Writes go to a buffer here instead of the UART. Every templated
+# command must match the old bytes. Then each is timed, in nanoseconds and,
+# on x86, in timestamp counter cycles.
+import os
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+INCLUDE = os.path.join(ROOT, 'Drivers', 'Inc')
+
+SOURCE = r'''
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "DisplayFormat.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() 0
+#endif
+
+#define ROUNDS 200000
+
+static char sink[4096];
+static uint32_t sinkLen;
+static volatile uint32_t keep;
+
+// Stands in for BSP_UART_Write
+static void write_out(const char *str, uint32_t len) {
+    if (sinkLen + len > sizeof(sink)) sinkLen = 0;
+    memcpy(&sink[sinkLen], str, len);
+    sinkLen += len;
+}
+
+static const char *TERMINATOR = "\xff\xff\xff";
+
+// The old Display_Send, for the two command shapes UpdateDisplay used
+static void old_vis(const char *comp, uint32_t val) {
+    char msgArgs[32];
+    msgArgs[0] = ' ';
+    msgArgs[1] = '\0';
+    char arg[16];
+    sprintf(arg, "%s", comp);
+    strcat(msgArgs, arg);
+    strcat(msgArgs, ",");
+    sprintf(arg, "%d", (int)val);
+    strcat(msgArgs, arg);
+    write_out("vis", strlen("vis"));
+    write_out(msgArgs, strlen(msgArgs));
+    write_out(TERMINATOR, strlen(TERMINATOR));
+}
+
+static void old_val(const char *comp, uint32_t val) {
+    char msgArgs[32];
+    sprintf(msgArgs, "%d", (int)val);
+    write_out(comp, strlen(comp));
+    write_out(".", 1);
+    write_out("val", strlen("val"));
+    write_out("=", strlen("="));
+    write_out(msgArgs, strlen(msgArgs));
+    write_out(TERMINATOR, strlen(TERMINATOR));
+}
+
+// The old Display_Error, one write per piece, plus the terminator it left out after each code
+static void old_error(const uint16_t *codes) {
+    static const char *names[] = {"oserr.val=", "rccerr.val=", "merr.val=", "disperr.val="};
+    write_out(TERMINATOR, strlen(TERMINATOR));
+    char faultPage[7] = "page 2";
+    write_out(faultPage, strlen(faultPage));
+    write_out(TERMINATOR, strlen(TERMINATOR));
+    char setFaultCode[20];
+    for (int i = 0; i < 4; i++) {
+        sprintf(setFaultCode, "%s%d", names[i], codes[i]);
+        write_out(setFaultCode, strlen(setFaultCode));
+        memset(setFaultCode, 0, strlen(setFaultCode) * sizeof(char));
+        write_out(TERMINATOR, strlen(TERMINATOR));
+    }
+}
+
+static const DisplayTemplate_t VIS = DISPLAY_TEMPLATE("vis brake,");
+static const DisplayTemplate_t VAL = DISPLAY_TEMPLATE("heatsink.val=");
+static const DisplayTemplate_t PAGE = DISPLAY_TEMPLATE(DISPLAY_TERMINATOR "page ");
+static const DisplayTemplate_t CODES[] = {
+    DISPLAY_TEMPLATE("oserr.val="), DISPLAY_TEMPLATE("rccerr.val="),
+    DISPLAY_TEMPLATE("merr.val="), DISPLAY_TEMPLATE("disperr.val="),
+};
+
+static void new_value(const DisplayTemplate_t *tmpl, uint32_t val) {
+    char out[64];
+    write_out(out, DisplayFormat_Value(out, tmpl, (int32_t)val));
+}
+
+static void new_error(const uint16_t *codes) {
+    char out[128];
+    uint32_t len = DisplayFormat_Value(out, &PAGE, 2);
+    for (int i = 0; i < 4; i++) len += DisplayFormat_Value(&out[len], &CODES[i], codes[i]);
+    write_out(out, len);
+}
+
+static const uint32_t VALUES[] = {0, 1, 9, 10, 99, 100, 12345, 999999999, 2147483647u,
+                                  2147483648u, 4294967295u, 4294967196u};
+#define NUM_VALUES (sizeof(VALUES) / sizeof(VALUES[0]))
+
+static int check(void) {
+    int failures = 0;
+    char old[64], new[64];
+    for (unsigned i = 0; i < NUM_VALUES; i++) {
+        for (int shape = 0; shape < 2; shape++) {
+            sinkLen = 0;
+            if (shape == 0) old_vis("brake", VALUES[i]); else old_val("heatsink", VALUES[i]);
+            uint32_t oldLen = sinkLen;
+            memcpy(old, sink, oldLen);
+            sinkLen = 0;
+            new_value(shape == 0 ? &VIS : &VAL, VALUES[i]);
+            memcpy(new, sink, sinkLen);
+            if (oldLen != sinkLen || memcmp(old, new, oldLen) != 0) {
+                printf("%s %u: got \"%.*s\", expected \"%.*s\"\n", shape == 0 ? "vis" : "val",
+                       (unsigned)VALUES[i], (int)sinkLen, new, (int)oldLen, old);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+#define TIME(label, call) do { \
+        double start = now(); \
+        uint64_t cycles = CYCLES(); \
+        for (uint32_t n = 0; n < ROUNDS; n++) { call; } \
+        cycles = CYCLES() - cycles; \
+        double ns = (now() - start) * 1e9 / ROUNDS; \
+        keep = sinkLen; \
+        printf("%-28s %10.1f %12.1f\n", label, ns, (double)cycles / ROUNDS); \
+    } while (0)
+
+int main(int argc, char **argv) {
+    int failures = check();
+    if (failures) {
+        printf("%d commands differ from sprintf\n", failures);
+        return 1;
+    }
+    printf("Templated commands match sprintf for %d values\n", (int)NUM_VALUES);
+    if (argc > 1) return 0;
+
+    uint16_t codes[4] = {3, 1024, 17, 65535};
+    printf("%-28s %10s %12s\n", "per command", "ns", "cycles");
+    TIME("vis <comp>,<n>  sprintf", old_vis("brake", VALUES[n % NUM_VALUES]));
+    TIME("vis <comp>,<n>  template", new_value(&VIS, VALUES[n % NUM_VALUES]));
+    TIME("<comp>.val=<n>  sprintf", old_val("heatsink", VALUES[n % NUM_VALUES]));
+    TIME("<comp>.val=<n>  template", new_value(&VAL, VALUES[n % NUM_VALUES]));
+    TIME("fault screen    sprintf", (codes[0] = n, old_error(codes)));
+    TIME("fault screen    template", (codes[0] = n, new_error(codes)));
+    return 0;
+}
+'''
+
+
+def main():
+    quick = '--quick' in sys.argv
+    cc = os.environ.get('CC', 'cc')
+    with tempfile.TemporaryDirectory() as tmp:
+        src = os.path.join(tmp, 'display_bench.c')
+        exe = os.path.join(tmp, 'display_bench')
+        with open(src, 'w') as f:
+            f.write(SOURCE)
+        subprocess.run([cc, '-O2', '-std=gnu11', '-Wall', '-Werror', '-I', INCLUDE, src, '-o', exe], check=True)
+        sys.exit(subprocess.run([exe] + (['quick'] if quick else [])).returncode)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,431 @@
+# Checks the SendTritium transition table against the state deciders it replaced.
+# Usage: python3 Scripts/fsm_check.py
+#
+# Takes the transition table, compilePlan, readTransitionInputs and decideState
+# out of Apps/Src/SendTritium.c and builds them on the host with the C compiler
+# ($CC, cc by default), next to the nine else-if deciders the table replaced.
+# For every state and every combination of the FSM inputs, both are run from
+# the same inputs and must agree on the next state, on cruiseEnable and on the
+# brake light and display calls, in order. Gear is one of forward, neutral and
+# reverse, so combinations with both gear bits set are skipped.
+#
+# Transitions that are meant to differ from the old deciders should be added to
+# the reference below in the same change, so the check keeps passing.
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+SOURCE = os.path.join(ROOT, 'Apps', 'Src', 'SendTritium.c')
+HEADER = os.path.join(ROOT, 'Apps', 'Inc', 'SendTritium.h')
+
+PRELUDE = r"""
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define GENERATE_ENUM(ENUM) ENUM
+%(enums)s
+
+#define SENDTRITIUM_EXPOSE_VARS
+#define SENDTRITIUM_TRACE_DEPTH 32
+typedef struct {
+    uint32_t timestamp;
+    uint16_t inputs;
+    uint8_t from;
+    uint8_t to;
+} TritiumTransition_t;
+
+#define BRAKE_PEDAL_THRESHOLD 50
+#define ACCEL_PEDAL_THRESHOLD 15
+#define MIN_CRUISE_VELOCITY 20.0f
+#define CPU_SR_ALLOC()
+#define CPU_CRITICAL_ENTER()
+#define CPU_CRITICAL_EXIT()
+
+// Side effects are logged so both sides can be compared
+enum {BRAKELIGHT};
+static int effects[8];
+static int numEffects;
+static void Minions_Write(int pin, bool on) { (void)pin; effects[numEffects++] = 10 + on; }
+static void UpdateDisplay_SetBrake(bool on) { effects[numEffects++] = 20 + on; }
+static uint32_t BSP_Cycles_Get(void) { return 0; }
+
+static bool cruiseEnable, cruiseSet, onePedalEnable;
+static uint8_t brakePedalPercent, accelPedalPercent;
+static Gear_t gear;
+static float velocityObserved, cruiseVelSetpoint;
+"""
+
+# The deciders as they were before the transition table, unchanged
+DECIDERS = r"""
+/**
+ * @brief Forward Drive State Decider. Determines transitions out of
+ * forward drive state (brake, record velocity, one pedal, neutral drive).
+ */
+static void ForwardDriveDecider()
+{
+    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
+    {
+        state = FSM[BRAKE_STATE];
+    }
+    else if (cruiseSet && cruiseEnable && velocityObserved >= MIN_CRUISE_VELOCITY)
+    {
+        state = FSM[RECORD_VELOCITY];
+    }
+    else if (onePedalEnable)
+    {
+        state = FSM[ONEPEDAL];
+    }
+    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
+    {
+        state = FSM[NEUTRAL_DRIVE];
+    }
+}
+
+/**
+ * @brief Neutral Drive State Decider. Determines transitions out of
+ * neutral drive state (brake, forward drive, reverse drive).
+ */
+static void NeutralDriveDecider()
+{
+    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
+    {
+        state = FSM[BRAKE_STATE];
+    }
+    else if (gear == FORWARD_GEAR)
+    {
+        state = FSM[FORWARD_DRIVE];
+    }
+    else if (gear == REVERSE_GEAR)
+    {
+        state = FSM[REVERSE_DRIVE];
+    }
+}
+
+/**
+ * @brief Reverse Drive State Decider. Determines transitions out of
+ * reverse drive state (brake, neutral drive).
+ */
+static void ReverseDriveDecider()
+{
+    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
+    {
+        state = FSM[BRAKE_STATE];
+    }
+    else if (gear == NEUTRAL_GEAR || gear == FORWARD_GEAR)
+    {
+        state = FSM[NEUTRAL_DRIVE];
+    }
+}
+
+/**
+ * @brief Record Velocity State Decider. Determines transitions out of record velocity
+ * state (brake, neutral drive, one pedal, forward drive, powered cruise).
+ */
+static void RecordVelocityDecider()
+{
+    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
+    {
+        state = FSM[BRAKE_STATE];
+    }
+    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
+    {
+        state = FSM[NEUTRAL_DRIVE];
+    }
+    else if (onePedalEnable)
+    {
+        cruiseEnable = false;
+        state = FSM[ONEPEDAL];
+    }
+    else if (!cruiseEnable)
+    {
+        state = FSM[FORWARD_DRIVE];
+    }
+    else if (cruiseEnable && !cruiseSet)
+    {
+        state = FSM[POWERED_CRUISE];
+    }
+}
+
+/**
+ * @brief Powered Cruise State Decider. Determines transitions out of powered
+ * cruise state (brake, neutral drive, one pedal, forward drive, record velocity,
+ * accelerate cruise, coasting cruise).
+ */
+static void PoweredCruiseDecider()
+{
+    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
+    {
+        state = FSM[BRAKE_STATE];
+    }
+    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
+    {
+        state = FSM[NEUTRAL_DRIVE];
+    }
+    else if (onePedalEnable)
+    {
+        cruiseEnable = false;
+        state = FSM[ONEPEDAL];
+    }
+    else if (!cruiseEnable)
+    {
+        state = FSM[FORWARD_DRIVE];
+    }
+    else if (cruiseSet && velocityObserved >= MIN_CRUISE_VELOCITY)
+    {
+        state = FSM[RECORD_VELOCITY];
+    }
+    else if (accelPedalPercent >= ACCEL_PEDAL_THRESHOLD)
+    {
+        state = FSM[ACCELERATE_CRUISE];
+    }
+    else if (velocityObserved > cruiseVelSetpoint)
+    {
+        state = FSM[COASTING_CRUISE];
+    }
+}
+
+/**
+ * @brief Coasting Cruise State Decider. Determines transitions out of coasting
+ * cruise state (brake, neutral drive, one pedal, forward drive, record velocity,
+ * accelerate cruise, powered cruise).
+ */
+static void CoastingCruiseDecider()
+{
+    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
+    {
+        state = FSM[BRAKE_STATE];
+    }
+    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
+    {
+        state = FSM[NEUTRAL_DRIVE];
+    }
+    else if (onePedalEnable)
+    {
+        cruiseEnable = false;
+        state = FSM[ONEPEDAL];
+    }
+    else if (!cruiseEnable)
+    {
+        state = FSM[FORWARD_DRIVE];
+    }
+    else if (cruiseSet && velocityObserved >= MIN_CRUISE_VELOCITY)
+    {
+        state = FSM[RECORD_VELOCITY];
+    }
+    else if (accelPedalPercent >= ACCEL_PEDAL_THRESHOLD)
+    {
+        state = FSM[ACCELERATE_CRUISE];
+    }
+    else if (velocityObserved <= cruiseVelSetpoint)
+    {
+        state = FSM[POWERED_CRUISE];
+    }
+}
+
+/**
+ * @brief Accelerate Cruise State Decider. Determines transitions out of accelerate
+ * cruise state (brake, neutral drive, one pedal, forward drive, record velocity,
+ * coasting cruise).
+ */
+static void AccelerateCruiseDecider()
+{
+    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
+    {
+        state = FSM[BRAKE_STATE];
+    }
+    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
+    {
+        state = FSM[NEUTRAL_DRIVE];
+    }
+    else if (onePedalEnable)
+    {
+        cruiseEnable = false;
+        state = FSM[ONEPEDAL];
+    }
+    else if (!cruiseEnable)
+    {
+        state = FSM[FORWARD_DRIVE];
+    }
+    else if (cruiseSet && velocityObserved >= MIN_CRUISE_VELOCITY)
+    {
+        state = FSM[RECORD_VELOCITY];
+    }
+    else if (accelPedalPercent < ACCEL_PEDAL_THRESHOLD)
+    {
+        state = FSM[COASTING_CRUISE];
+    }
+}
+
+/**
+ * @brief One Pedal Drive State Decider. Determines transitions out of one pedal
+ * drive state (brake, record velocity, neutral drive).
+ */
+static void OnePedalDriveDecider()
+{
+    if (brakePedalPercent >= BRAKE_PEDAL_THRESHOLD)
+    {
+        state = FSM[BRAKE_STATE];
+    }
+    else if (cruiseSet && cruiseEnable && velocityObserved >= MIN_CRUISE_VELOCITY)
+    {
+        state = FSM[RECORD_VELOCITY];
+        Minions_Write(BRAKELIGHT, false);
+    }
+    else if (gear == NEUTRAL_GEAR || gear == REVERSE_GEAR)
+    {
+        state = FSM[NEUTRAL_DRIVE];
+        Minions_Write(BRAKELIGHT, false);
+    }
+}
+
+/**
+ * @brief Brake State Decider. Determines transitions out of brake state (forward drive,
+ * neutral drive).
+ */
+static void BrakeDecider()
+{
+    if (brakePedalPercent < BRAKE_PEDAL_THRESHOLD)
+    {
+        if (gear == FORWARD_GEAR)
+        {
+            state = FSM[FORWARD_DRIVE];
+            Minions_Write(BRAKELIGHT, false);
+            UpdateDisplay_SetBrake(false);
+        }
+        else if (gear == NEUTRAL_GEAR)
+        {
+            state = FSM[NEUTRAL_DRIVE];
+            Minions_Write(BRAKELIGHT, false);
+            UpdateDisplay_SetBrake(false);
+        }
+        else if (gear == REVERSE_GEAR)
+        {
+            state = FSM[REVERSE_DRIVE];
+            Minions_Write(BRAKELIGHT, false);
+            UpdateDisplay_SetBrake(false);
+        }
+    }
+}
+"""
+
+# Builds the deciders so they set a plain TritiumStateName_t instead of the whole state
+REFERENCE = r"""
+static TritiumStateName_t refState;
+static const TritiumStateName_t REF_FSM[NUM_TRITIUM_STATES] = {
+    FORWARD_DRIVE, NEUTRAL_DRIVE, REVERSE_DRIVE, RECORD_VELOCITY, POWERED_CRUISE,
+    COASTING_CRUISE, BRAKE_STATE, ONEPEDAL, ACCELERATE_CRUISE,
+};
+#define state refState
+#define FSM REF_FSM
+
+%(deciders)s
+#undef state
+#undef FSM
+
+static void (*const deciders[NUM_TRITIUM_STATES])(void) = {
+    [FORWARD_DRIVE] = ForwardDriveDecider,
+    [NEUTRAL_DRIVE] = NeutralDriveDecider,
+    [REVERSE_DRIVE] = ReverseDriveDecider,
+    [RECORD_VELOCITY] = RecordVelocityDecider,
+    [POWERED_CRUISE] = PoweredCruiseDecider,
+    [COASTING_CRUISE] = CoastingCruiseDecider,
+    [BRAKE_STATE] = BrakeDecider,
+    [ONEPEDAL] = OnePedalDriveDecider,
+    [ACCELERATE_CRUISE] = AccelerateCruiseDecider,
+};
+
+static TritiumStateName_t state;
+"""
+
+MAIN = r"""
+// Sets the inputs so that readTransitionInputs returns mask
+static void setInputs(uint16_t mask) {
+    brakePedalPercent = (mask & IN(BRAKE)) ? BRAKE_PEDAL_THRESHOLD : BRAKE_PEDAL_THRESHOLD - 1;
+    gear = (mask & IN(FORWARD)) ? FORWARD_GEAR : (mask & IN(REVERSE)) ? REVERSE_GEAR : NEUTRAL_GEAR;
+    onePedalEnable = (mask & IN(ONEPEDAL)) != 0;
+    cruiseEnable = (mask & IN(CRUISE_EN)) != 0;
+    cruiseSet = (mask & IN(CRUISE_SET)) != 0;
+    velocityObserved = (mask & IN(CRUISE_VEL)) ? MIN_CRUISE_VELOCITY : MIN_CRUISE_VELOCITY - 1;
+    cruiseVelSetpoint = (mask & IN(OVER_CRUISE)) ? velocityObserved - 1 : velocityObserved;
+    accelPedalPercent = (mask & IN(ACCEL)) ? ACCEL_PEDAL_THRESHOLD : ACCEL_PEDAL_THRESHOLD - 1;
+}
+
+int main(void) {
+    compilePlan();
+    int cases = 0, mismatches = 0;
+    for (int from = 0; from < NUM_TRITIUM_STATES; from++) {
+        for (uint16_t mask = 0; mask < (1 << NUM_INPUTS); mask++) {
+            if ((mask & IN(FORWARD)) && (mask & IN(REVERSE))) continue;
+
+            setInputs(mask);
+            if (readTransitionInputs() != mask) {
+                printf("inputs 0x%%03x read back as 0x%%03x\n", mask, readTransitionInputs());
+                return 1;
+            }
+            refState = (TritiumStateName_t)from;
+            numEffects = 0;
+            deciders[from]();
+            int refEffects[8], numRefEffects = numEffects;
+            for (int i = 0; i < numEffects; i++) refEffects[i] = effects[i];
+            bool refCruise = cruiseEnable;
+
+            setInputs(mask);
+            state = (TritiumStateName_t)from;
+            numEffects = 0;
+            decideState();
+            cases++;
+
+            bool same = state == refState && cruiseEnable == refCruise && numEffects == numRefEffects;
+            for (int i = 0; same && i < numEffects; i++) same = effects[i] == refEffects[i];
+            if (!same) {
+                if (mismatches++ < 10) {
+                    printf("state %%d, inputs 0x%%03x: deciders go to %%d (cruise %%d, %%d effects), "
+                           "table to %%d (cruise %%d, %%d effects)\n", from, mask, refState, refCruise,
+                           numRefEffects, state, cruiseEnable, numEffects);
+                }
+            }
+        }
+    }
+    printf("%%d cases, %%d mismatches\n", cases, mismatches);
+    return mismatches != 0;
+}
+"""
+
+
+def extract():
+    """Gets the enums from the header and the table code from SendTritium.c"""
+    with open(HEADER) as f:
+        header = f.read()
+    enums = '\n'.join(re.search(r'#define FOREACH_%s.*?\} %s;' % (name, t), header, re.S).group(0)
+                      for name, t in (('Gear', 'Gear_t'), ('TritiumState', 'TritiumStateName_t')))
+
+    with open(SOURCE) as f:
+        source = f.read()
+    start = source.index('// Transitions\n')
+    decide = source.index('static void decideState(void)', start)
+    end = source.index('\n}\n', decide) + 3
+    return enums, source[start:end]
+
+
+def main():
+    enums, table = extract()
+    cc = os.environ.get('CC', 'cc')
+    with tempfile.TemporaryDirectory() as tmp:
+        src = os.path.join(tmp, 'fsm_check.c')
+        exe = os.path.join(tmp, 'fsm_check')
+        with open(src, 'w') as f:
+            f.write(PRELUDE % {'enums': enums})
+            f.write(REFERENCE % {'deciders': DECIDERS})
+            f.write(table)
+            f.write(MAIN % {})
+        subprocess.run([cc, '-O1', '-std=gnu11', '-Wall', '-Werror', '-Wno-unused-variable',
+                        '-Wno-unused-function', src, '-o', exe], check=True)
+        sys.exit(subprocess.run([exe]).returncode)
+
+
+if __name__ == '__main__':
+    main()
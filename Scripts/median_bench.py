@@ -0,0 +1,172 @@
+# Checks Apps/Inc/MedianFilter.h against a sort and times it on the host.
+# Usage: python3 Scripts/median_bench.py [--quick]
+#   --quick  only check the results, without timing
+#
+# Builds one filter per depth and channel count below with the host C compiler
+# ($CC, cc by default). Each filter is fed random values with many repeats and
+# every median it reports is compared with a sorted copy of its window. Then
+# each put is timed against the selection sort the filter used to do, which
+# sorted every channel's whole window on every put.
+import os
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+INCLUDE = os.path.join(ROOT, 'Apps', 'Inc')
+
+DEPTHS = [3, 5, 7, 8, 9, 15, 16, 31, 32, 63, 64]
+CHANNELS = [1, 2, 4, 8, 16, 32]
+CHECK_PUTS = 3000
+TIMED_VALUES = 400000   # values per timing run, over all channels
+
+PRELUDE = r'''
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define LOW (-1000)
+#define HIGH 1000
+
+static uint32_t rng = 12345;
+static int32_t next_value(void) {
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    // Mostly a narrow range so windows have plenty of repeats, sometimes a spike
+    return (rng & 0xF00) ? (int32_t)(rng % 64) : (int32_t)(rng % 2001) - 1000;
+}
+
+static int cmp(const void *a, const void *b) {
+    int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int32_t sorted_median(const int32_t *window, int depth) {
+    int32_t copy[depth];
+    for (int i = 0; i < depth; i++) copy[i] = window[i];
+    qsort(copy, depth, sizeof(int32_t), cmp);
+    return copy[depth / 2];
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int32_t values[400000];
+static volatile int32_t sink;
+'''
+
+CASE = r'''
+#define MEDIAN_FILTER_TYPE int32_t
+#define MEDIAN_FILTER_DEPTH {d}
+#define MEDIAN_FILTER_CHANNELS {c}
+#define MEDIAN_FILTER_NAME mf_{d}_{c}
+#include "MedianFilter.h"
+
+static mf_{d}_{c}_t filter_{d}_{c};
+
+// What every put used to cost: a selection sort of each channel's window
+static int32_t old_raw_{d}_{c}[{c}][{d}];
+static int32_t old_filtered_{d}_{c}[{c}];
+static uint32_t old_index_{d}_{c};
+static void old_put_{d}_{c}(const int32_t *channels) {{
+    static int32_t sorted[{d}];
+    for (int ch = 0; ch < {c}; ch++) old_raw_{d}_{c}[ch][old_index_{d}_{c}] = channels[ch];
+    old_index_{d}_{c} = (old_index_{d}_{c} + 1) % {d};
+    for (int ch = 0; ch < {c}; ch++) {{
+        for (int i = 0; i < {d}; i++) sorted[i] = old_raw_{d}_{c}[ch][i];
+        for (int i = 0; i < {d}; i++) {{
+            int32_t min = sorted[i];
+            int minIdx = i;
+            for (int j = i + 1; j < {d}; j++) {{
+                if (sorted[j] < min) {{ min = sorted[j]; minIdx = j; }}
+            }}
+            sorted[minIdx] = sorted[i];
+            sorted[i] = min;
+        }}
+        old_filtered_{d}_{c}[ch] = sorted[{d} >> 1];
+    }}
+}}
+
+static int run_{d}_{c}(int timed) {{
+    int failures = 0;
+    int32_t window[{c}][{d}];
+    mf_{d}_{c}_init(&filter_{d}_{c}, LOW, HIGH);
+    for (int ch = 0; ch < {c}; ch++)
+        for (int i = 0; i < {d}; i++) window[ch][i] = (i & 1) ? HIGH : LOW;
+
+    for (int n = 0; n < {check}; n++) {{
+        int32_t in[{c}];
+        for (int ch = 0; ch < {c}; ch++) in[ch] = window[ch][n % {d}] = next_value();
+        mf_{d}_{c}_put(&filter_{d}_{c}, in);
+        for (int ch = 0; ch < {c}; ch++) {{
+            int32_t expected = sorted_median(window[ch], {d});
+            int32_t got = mf_{d}_{c}_getSingle(&filter_{d}_{c}, ch);
+            if (got != expected && failures++ < 3)
+                printf("depth %d channels %d put %d channel %d: median %d, expected %d\n",
+                       {d}, {c}, n, ch, (int)got, (int)expected);
+        }}
+    }}
+    if (!timed) {{
+        return failures;
+    }}
+
+    int puts = (int)(sizeof(values) / sizeof(values[0])) / {c};
+    for (int i = 0; i < puts * {c}; i++) values[i] = next_value();
+
+    double start = now();
+    for (int n = 0; n < puts; n++) {{
+        mf_{d}_{c}_put(&filter_{d}_{c}, &values[n * {c}]);
+        sink = filter_{d}_{c}.filtered[0];
+    }}
+    double filter = (now() - start) / puts;
+
+    start = now();
+    for (int n = 0; n < puts; n++) {{
+        old_put_{d}_{c}(&values[n * {c}]);
+        sink = old_filtered_{d}_{c}[0];
+    }}
+    double old = (now() - start) / puts;
+
+    printf("%5d %8d %12.1f %12.1f %8.1fx %10d\n", {d}, {c}, filter * 1e9, old * 1e9, old / filter,
+           (int)sizeof(filter_{d}_{c}));
+    return failures;
+}}
+'''
+
+
+def source(timed):
+    out = [PRELUDE.replace('400000', str(TIMED_VALUES))]
+    for d in DEPTHS:
+        for c in CHANNELS:
+            out.append(CASE.format(d=d, c=c, check=CHECK_PUTS))
+    out.append('int main(void) {')
+    out.append('    int failures = 0;')
+    if timed:
+        out.append('    printf("depth channels  ns per put   old ns/put  speedup      bytes\\n");')
+    for d in DEPTHS:
+        for c in CHANNELS:
+            out.append(f'    failures += run_{d}_{c}({int(timed)});')
+    out.append('    if (failures) printf("%d medians were wrong\\n", failures);')
+    out.append(f'    else printf("All {len(DEPTHS) * len(CHANNELS)} filters match a sort\\n");')
+    out.append('    return failures != 0;')
+    out.append('}')
+    return '\n'.join(out)
+
+
+def main():
+    timed = '--quick' not in sys.argv
+    cc = os.environ.get('CC', 'cc')
+    with tempfile.TemporaryDirectory() as tmp:
+        src = os.path.join(tmp, 'median_bench.c')
+        exe = os.path.join(tmp, 'median_bench')
+        with open(src, 'w') as f:
+            f.write(source(timed))
+        subprocess.run([cc, '-O2', '-std=gnu11', '-Wall', '-Werror', '-I', INCLUDE, src, '-o', exe], check=True)
+        sys.exit(subprocess.run([exe]).returncode)
+
+
+if __name__ == '__main__':
+    main()
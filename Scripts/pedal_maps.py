@@ -0,0 +1,182 @@
+# Generates Apps/Src/PedalMaps.c, the pedal to current lookup tables, from the
+# thresholds and throttle curves declared in Apps/Inc/PedalMaps.h.
+# Usage: python3 Scripts/pedal_maps.py [--check] [--test]
+#   --check  exit with an error if the checked in tables are out of date
+#   --test   compare the checked in tables against the reference curves
+#
+# Tables are computed with exact fractions and rounded to the nearest Q15 step,
+# so every entry is within half a step of the curve. --test recomputes the curves
+# independently in floating point, and also checks the end points and that
+# every table only ever rises as the pedal moves away from its dead zone.
+import os
+import re
+import sys
+from fractions import Fraction
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+HEADER = os.path.join(ROOT, 'Apps', 'Inc', 'PedalMaps.h')
+OUTPUT = os.path.join(ROOT, 'Apps', 'Src', 'PedalMaps.c')
+
+DEFINE_RE = re.compile(r'^#define\s+(\w+)\s+(\d+)\b', re.M)
+CURVE_RE = re.compile(r'^\s+CURVE\((\w+)\)', re.M)
+TABLE_RE = re.compile(r'\[PEDAL_CURVE_(\w+)\]\s*=\s*\{([^}]*)\}')
+
+# Shape of each throttle curve over the accelerating part of the travel, x from 0 to 1
+CURVES = {
+    'LINEAR': lambda x: x,
+    'PROGRESSIVE': lambda x: x * x,
+    'AGGRESSIVE': lambda x: x * (2 - x),
+}
+
+PARAMS = ['PEDAL_MIN', 'PEDAL_MAX', 'ACCEL_PEDAL_THRESHOLD', 'ONEPEDAL_BRAKE_THRESHOLD',
+          'ONEPEDAL_NEUTRAL_THRESHOLD', 'PEDAL_MAP_ONE']
+
+
+def parse():
+    with open(HEADER) as f:
+        text = f.read()
+    defines = {name: int(value) for name, value in DEFINE_RE.findall(text)}
+    params = {}
+    for name in PARAMS:
+        if name not in defines:
+            sys.exit(f'{name} is missing from {os.path.relpath(HEADER, ROOT)}')
+        params[name] = defines[name]
+    curves = CURVE_RE.findall(text[text.index('FOREACH_PedalCurve'):])
+    for curve in curves:
+        if curve not in CURVES:
+            sys.exit(f'No shape for curve {curve}, add it to CURVES in Scripts/pedal_maps.py')
+    p = params
+    if not p['PEDAL_MIN'] < p['ONEPEDAL_BRAKE_THRESHOLD'] <= p['ONEPEDAL_NEUTRAL_THRESHOLD'] < p['PEDAL_MAX']:
+        sys.exit('One pedal thresholds must be in order between PEDAL_MIN and PEDAL_MAX')
+    if not p['PEDAL_MIN'] <= p['ACCEL_PEDAL_THRESHOLD'] < p['PEDAL_MAX']:
+        sys.exit('ACCEL_PEDAL_THRESHOLD must be between PEDAL_MIN and PEDAL_MAX')
+    return params, curves
+
+
+def ramp(percent, start, end):
+    """Where percent is between start and end, from 0 to 1."""
+    return min(max(Fraction(percent - start, end - start), Fraction(0)), Fraction(1))
+
+
+def throttle(p, shape, percent):
+    return shape(ramp(percent, p['ACCEL_PEDAL_THRESHOLD'], p['PEDAL_MAX']))
+
+
+def one_pedal(p, shape, percent):
+    if percent <= p['ONEPEDAL_BRAKE_THRESHOLD']:
+        return 1 - ramp(percent, p['PEDAL_MIN'], p['ONEPEDAL_BRAKE_THRESHOLD'])
+    return shape(ramp(percent, p['ONEPEDAL_NEUTRAL_THRESHOLD'], p['PEDAL_MAX']))
+
+
+MAPS = [('Throttle', throttle), ('OnePedal', one_pedal)]
+
+
+def q15(p, value):
+    return int(value * p['PEDAL_MAP_ONE'] + Fraction(1, 2))
+
+
+def tables(p, curves):
+    return {name: {curve: [q15(p, fn(p, CURVES[curve], percent)) for percent in range(p['PEDAL_MAX'] + 1)]
+                   for curve in curves}
+            for name, fn in MAPS}
+
+
+def generate(p, curves):
+    out = ['/**',
+           ' * @copyright Copyright (c) 2018-2023 UT Longhorn Racing Solar',
+           ' * @file PedalMaps.c',
+           ' * @brief Pedal to current lookup tables.',
+           ' *',
+           ' * GENERATED by Scripts/pedal_maps.py from Apps/Inc/PedalMaps.h. Do not edit by hand.',
+           ' */',
+           '',
+           '#include "common.h"',
+           '#include "PedalMaps.h"',
+           '',
+           '#if ' + ' || '.join(f'{name} != {p[name]}' for name in PARAMS),
+           '#error "PedalMaps.c is out of date, run make pedalmaps"',
+           '#endif',
+           '']
+    for name, curve_tables in tables(p, curves).items():
+        out.append(f'const int16_t PedalMap_{name}[NUM_PEDAL_CURVES][PEDAL_MAP_SIZE] = {{')
+        for curve in curves:
+            out.append(f'    [PEDAL_CURVE_{curve}] = {{')
+            values = curve_tables[curve]
+            for i in range(0, len(values), 10):
+                out.append('        ' + ' '.join(f'{v:5d},' for v in values[i:i + 10]))
+            out.append('    },')
+        out.append('};')
+        out.append('')
+    return '\n'.join(out)
+
+
+def reference(p, name, shape, percent):
+    """The curve a table should follow, in floating point."""
+    def clamp(x):
+        return min(max(x, 0.0), 1.0)
+    if name == 'Throttle':
+        return shape(clamp((percent - p['ACCEL_PEDAL_THRESHOLD']) / (p['PEDAL_MAX'] - p['ACCEL_PEDAL_THRESHOLD'])))
+    if percent <= p['ONEPEDAL_BRAKE_THRESHOLD']:
+        return 1.0 - (percent - p['PEDAL_MIN']) / (p['ONEPEDAL_BRAKE_THRESHOLD'] - p['PEDAL_MIN'])
+    return shape(clamp((percent - p['ONEPEDAL_NEUTRAL_THRESHOLD']) / (p['PEDAL_MAX'] - p['ONEPEDAL_NEUTRAL_THRESHOLD'])))
+
+
+def test(p, curves):
+    """Checks the checked in tables against the curves, computed again in floating point."""
+    with open(OUTPUT) as f:
+        text = f.read()
+    one = p['PEDAL_MAP_ONE']
+    failures = 0
+    for name, _ in MAPS:
+        body = text[text.index(f'PedalMap_{name}['):]
+        body = body[:body.index('};')]
+        found = {curve: [int(v) for v in values.split(',') if v.strip()] for curve, values in TABLE_RE.findall(body)}
+        for curve in curves:
+            table = found.get(curve)
+            if table is None or len(table) != p['PEDAL_MAX'] + 1:
+                print(f'{name} {curve}: missing or wrong length')
+                failures += 1
+                continue
+            shape = CURVES[curve]
+            for percent, value in enumerate(table):
+                expected = reference(p, name, shape, percent) * one
+                if abs(value - expected) > 0.5 + 1e-9:
+                    print(f'{name} {curve}[{percent}] = {value}, expected {expected:.2f}')
+                    failures += 1
+            if table[-1] != one:
+                print(f'{name} {curve}: full pedal gives {table[-1]}, not full current')
+                failures += 1
+            start = p['ACCEL_PEDAL_THRESHOLD'] if name == 'Throttle' else p['ONEPEDAL_NEUTRAL_THRESHOLD']
+            if any(v != 0 for v in table[p['ONEPEDAL_BRAKE_THRESHOLD'] if name == 'OnePedal' else 0:start + 1]):
+                print(f'{name} {curve}: current in the dead zone')
+                failures += 1
+            if any(b < a for a, b in zip(table[start:], table[start + 1:])):
+                print(f'{name} {curve}: not rising above {start}%')
+                failures += 1
+            if name == 'OnePedal':
+                regen = table[:p['ONEPEDAL_BRAKE_THRESHOLD'] + 1]
+                if regen[0] != one or any(b > a for a, b in zip(regen, regen[1:])):
+                    print(f'{name} {curve}: regen does not fall from full current')
+                    failures += 1
+    if failures:
+        sys.exit(f'{failures} failures')
+    print(f'{len(MAPS) * len(curves)} tables match their curves')
+
+
+def main():
+    params, curves = parse()
+    source = generate(params, curves)
+    if '--check' in sys.argv:
+        with open(OUTPUT) as f:
+            if f.read() != source:
+                sys.exit(f'{os.path.relpath(OUTPUT, ROOT)} is out of date, run Scripts/pedal_maps.py')
+    if '--test' in sys.argv:
+        test(params, curves)
+    if '--check' in sys.argv or '--test' in sys.argv:
+        return
+    with open(OUTPUT, 'w') as f:
+        f.write(source)
+
+
+if __name__ == '__main__':
+    main()
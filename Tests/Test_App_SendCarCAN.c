@@ -1,7 +1,7 @@
 /**
  * This test file for SendCarCAN checks if messages added to the queue are sent on CarCAN.
  * It does this by starting the SendTritium, SendCarCAN, and ReadTritium tasks,
- * which place messages into the SendCarCAN_Q, and then counting the CarCAN messages it receives in msgReadCount.
+ * which place messages into SendCarCAN's forwarding table, and then counting the CarCAN messages it receives in msgReadCount.
  * It also prints the IO State and, if the SendTritium macro SENDTRITIUM_PRINT_MES is defined, the control mode
  * for comparison to see if the data received on CarCAN is accurate.
  * 
@@ -48,7 +48,7 @@ typedef struct {
     uint32_t lastReceiveTime_ms;
     uint16_t lastMsgReceived;
     msgInfo msgArray[NUM_MOTOR_MSGS + NUM_NONMOTOR_MSGS + 1]; // Message types we send plus an extra space 
-    uint8_t SpaceLeftInQ;
+    uint8_t PendingForward;
 } CANInfo;
 
 
@@ -107,7 +107,7 @@ void Task_ReadCAN(void *arg)
             // Other CAN stats
             msgReadCount.lastReceiveTime_ms = (OSTimeGet(&err) / OS_CFG_TICK_RATE_HZ);
             msgReadCount.lastMsgReceived = dataBuf.ID;
-            msgReadCount.SpaceLeftInQ = get_SendCarCAN_Q_Space();
+            msgReadCount.PendingForward = get_SendCarCAN_Pending();
 
         } else {
             // CANbus read is unsuccessful
@@ -595,6 +595,13 @@ void Task1(void *arg)
 
     OS_TaskSuspend(&SendTritium_TCB, &err);
     assertOSError(err);
+
+    // The transition lookup should make every state cost about the same
+    printf("\n\rLongest FSM iteration per state (cycles):\n\r");
+    for (TritiumStateName_t s = 0; s < NUM_TRITIUM_STATES; s++){
+        printf("  %d: %d\n\r", s, (int)SendTritium_GetMaxCycles(s));
+    }
+
     while (1){
         printf("\n\r\n\rSUCCESS! ALL TESTS PASSED\n\r\n\r");
         OSTimeDlyHMSM(0, 0, 1, 0, OS_OPT_TIME_HMSM_STRICT, &err);
@@ -67,6 +67,7 @@ void Task1(void *arg)
     DisplayError_t error;
 
     CPU_Init();
+    BSP_UART_Init(UART_2);
     error = Display_Init();
     UpdateDisplay_Init();
     
@@ -92,6 +93,7 @@ void Task1(void *arg)
     assertOSError(e);
 
     OSTimeDlyHMSM(0, 0, 7, 0, OS_OPT_TIME_HMSM_STRICT, &e);
+    printf("Idle display traffic: %d bytes/s\n\r", (int)UpdateDisplay_GetStats()->bytesPerSecond);
     
     testTriStateComp(&UpdateDisplay_SetGear);
     
@@ -131,6 +133,13 @@ void Task1(void *arg)
     
     while (1) {
         OSTimeDlyHMSM(0, 0, 0, 500, OS_OPT_TIME_HMSM_STRICT, &e);
+        const UpdateDisplayStats_t *stats = UpdateDisplay_GetStats();
+        const DisplayStats_t *link = Display_GetStats();
+        printf("Display traffic: %d bytes/s, fast latency max %d ms, %d deferred, %d busy\n\r",
+            (int)stats->bytesPerSecond, (int)stats->maxFastLatencyMs, (int)stats->deferred, (int)stats->displayBusy);
+        printf("Display replies: %d acks, %d unanswered, %d overflows, %d restarts, %d stray, page %d\n\r",
+            (int)link->acks, (int)link->errors[DISPLAY_ERR_NO_ACK], (int)link->errors[DISPLAY_ERR_OVERFLOW],
+            (int)link->restarts, (int)link->stray, (int)link->page);
     }
 };
 
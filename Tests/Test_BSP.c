@@ -85,7 +85,7 @@ int main() {
         uint32_t id;
         BSP_CAN_Write(CAN_1, 0x221, txData, LEN);
         
-        uint8_t len = BSP_CAN_Read(CAN_1, &id, rxData);
+        uint8_t len = BSP_CAN_Read(CAN_1, &id, rxData, NULL);
 
         // printf("ID: 0x%x\nData: ", id);
         // for (uint8_t i = 0; i < len; i++) {
@@ -106,7 +106,7 @@ int main() {
         }
 
 
-        uint8_t can2len = BSP_CAN_Read(CAN_2, &id2, rxData2);
+        uint8_t can2len = BSP_CAN_Read(CAN_2, &id2, rxData2, NULL);
         printf("Values read from CAN_2\n");
         printf("ID: 0x%x length: %d\n", id2, can2len);
         for(int i = 0; i < can2len; i++){
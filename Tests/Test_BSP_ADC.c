@@ -4,7 +4,8 @@
  * Run this test in conjunction with the simulator 
  * GUI. As you move the accelerator and brake on the GUI, the respective
  * pressed/slided percentage will change from '0' to '100' on the terminal and display
- * to show that sliding the pedals is read by the BSP
+ * to show that sliding the pedals is read by the BSP. The age of the filtered
+ * values should stay below 12000 us (one and a half blocks of samples).
  * 
  * Uncomment the "individual tests for each function" to determine the output of individual functions
  * of the ADC module
@@ -32,7 +33,8 @@ int main() {
     */
 
     while(1) {
-        printf("Accelerator: %5.1d\tBrake: %5.1d\r", 
-            BSP_ADC_Get_Millivoltage(Accelerator_ADC), BSP_ADC_Get_Millivoltage(Brake_ADC));
+        printf("Accelerator: %5.1d\tBrake: %5.1d\tAge: %5d us\r", 
+            BSP_ADC_Get_Millivoltage(Accelerator_ADC), BSP_ADC_Get_Millivoltage(Brake_ADC),
+            (int)BSP_ADC_Get_Age());
     }
 }
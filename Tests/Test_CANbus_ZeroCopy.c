@@ -0,0 +1,117 @@
+/**
+ * Compares the cycle cost of the copying CANbus API (CANbus_Send/CANbus_Read)
+ * with the zero-copy API (CANbus_SendPtr/CANbus_ReadBorrow/CANbus_Release).
+ *
+ * Run with car CAN in loopback mode: make leader TEST=CANbus_ZeroCopy CAR_LOOPBACK=1
+ * Prints the average cycles per call of each function.
+ */
+
+#include "Tasks.h"
+#include "CANbus.h"
+#include "BSP_UART.h"
+#include "BSP_Cycles.h"
+#include "CANConfig.h"
+
+static OS_TCB Task1_TCB;
+static CPU_STK Task1_Stk[DEFAULT_STACK_SIZE];
+
+#define ROUNDS 200
+
+static void assert(bool);
+
+// Lets the frame loop back into the receive queue, so reads never wait
+static void waitForLoopback(void) {
+    OS_ERR err;
+    OSTimeDly(1, OS_OPT_TIME_DLY, &err);
+    assertOSError(err);
+}
+
+void Task1(void *p_arg) {
+    (void) p_arg;
+
+    CPU_Init();
+    OS_CPU_SysTickInit(SystemCoreClock / (CPU_INT32U) OSCfg_TickRate_Hz);
+
+    CANbus_Init(CARCAN, (CANId_t*)carCANFilterList, NUM_CARCAN_FILTERS);
+
+    CANDATA_t tx = {.ID = STATE_OF_CHARGE, .data = {1, 2, 3, 4, 5, 6, 7, 8}};
+    CANDATA_t rx;
+    const CAN_Frame_t *frame;
+    uint32_t sendCycles = 0, sendPtrCycles = 0, readCycles = 0, borrowCycles = 0;
+
+    for (int i = 0; i < ROUNDS; i++) {
+        tx.data[0] = i;
+
+        // Copying API
+        uint32_t start = BSP_Cycles_Get();
+        assert(CANbus_Send(tx, CAN_NON_BLOCKING, CARCAN) == SUCCESS);
+        sendCycles += BSP_Cycles_Get() - start;
+        waitForLoopback();
+
+        start = BSP_Cycles_Get();
+        assert(CANbus_Read(&rx, CAN_NON_BLOCKING, CARCAN) == SUCCESS);
+        readCycles += BSP_Cycles_Get() - start;
+        assert(rx.ID == STATE_OF_CHARGE && memcmp(rx.data, tx.data, sizeof tx.data) == 0);
+
+        // Zero-copy API
+        start = BSP_Cycles_Get();
+        assert(CANbus_SendPtr(&tx, CAN_NON_BLOCKING, CARCAN) == SUCCESS);
+        sendPtrCycles += BSP_Cycles_Get() - start;
+        waitForLoopback();
+
+        start = BSP_Cycles_Get();
+        assert(CANbus_ReadBorrow(&frame, CAN_NON_BLOCKING, CARCAN) == SUCCESS);
+        uint8_t first = frame->data[0];
+        CANbus_Release(CARCAN);
+        borrowCycles += BSP_Cycles_Get() - start;
+        assert(frame->id == STATE_OF_CHARGE && first == tx.data[0]);
+    }
+
+    printf("Average cycles over %d frames:\n\r", ROUNDS);
+    printf("  CANbus_Send:                     %d\n\r", (int)(sendCycles / ROUNDS));
+    printf("  CANbus_SendPtr:                  %d\n\r", (int)(sendPtrCycles / ROUNDS));
+    printf("  CANbus_Read:                     %d\n\r", (int)(readCycles / ROUNDS));
+    printf("  CANbus_ReadBorrow + Release:     %d\n\r", (int)(borrowCycles / ROUNDS));
+
+    printf("Success!\r\n");
+    for (;;);
+}
+
+int main(void){ //initialize things and spawn task
+    OS_ERR err;
+    OSInit(&err);
+    if(err != OS_ERR_NONE){
+        printf("OS error code %d\n\r",err);
+    }
+
+    BSP_UART_Init(UART_2);
+
+    OSTaskCreate(
+        (OS_TCB*)&Task1_TCB,
+        (CPU_CHAR*)"Task1",
+        (OS_TASK_PTR)Task1,
+        (void*)NULL,
+        (OS_PRIO)4,
+        (CPU_STK*)Task1_Stk,
+        (CPU_STK_SIZE)DEFAULT_STACK_SIZE/10,
+        (CPU_STK_SIZE)DEFAULT_STACK_SIZE,
+        (OS_MSG_QTY)0,
+        (OS_TICK)NULL,
+        (void*)NULL,
+        (OS_OPT)(OS_OPT_TASK_STK_CLR|OS_OPT_TASK_STK_CHK),
+        (OS_ERR*)&err
+    );
+
+    if (err != OS_ERR_NONE) {
+        printf("Task1 error code %d\n\r", err);
+    }
+    OSStart(&err);
+    if (err != OS_ERR_NONE) {
+        printf("OS error code %d\n\r", err);
+    }
+    return 0;
+}
+
+static void assert(bool cond) {
+    if (!cond) __asm("bkpt");
+}
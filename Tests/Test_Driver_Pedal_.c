@@ -6,6 +6,9 @@
  * pressed/slided percentage will change from '0' to '100' on the terminal and display
  * to show that sliding the pedals is read by the BSP
  * 
+ * Each debounced brake press and release is also counted from the brake interrupt.
+ * Tapping the brake once should count one press, however much the switch bounces.
+ * 
  */ 
 
 #include "common.h"
@@ -13,13 +16,23 @@
 #include "Pedals.h"
 #include <bsp.h>
 
+static volatile uint32_t presses = 0;
+static volatile uint32_t releases = 0;
+
+static void brakeEdge(bool pressed, uint32_t timestamp) {
+    (void) timestamp;
+    if (pressed) presses++;
+    else releases++;
+}
+
 
 int main() {
     Pedals_Init();
+    Pedals_SetBrakeHandler(brakeEdge);
 
     while(1) {
-        printf("Accelerator: %5.1d%%\tBrake: %5.1d%%\r", 
-            Pedals_Read(ACCELERATOR),Pedals_Read(BRAKE));
+        printf("Accelerator: %5.1d%%\tBrake: %5.1d%%\tPresses: %d\tReleases: %d\r", 
+            Pedals_Read(ACCELERATOR),Pedals_Read(BRAKE), (int)presses, (int)releases);
     }
 }
 
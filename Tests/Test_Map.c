@@ -1,7 +1,9 @@
 /**
- * Test file for testing floating point register restoration on context switch
- * 
- * To be tested on hardware, if it doesn't hard fault then it worked!
+ * Test file for the pedal maps (PedalMaps.h) used by SendTritium.
+ *
+ * Compares every entry of every table against its curve computed in floating point,
+ * and prints the entries that are off by more than one Q15 step.
+ * The same check runs on a PC with python3 Scripts/pedal_maps.py --test
  */
 
 
@@ -10,40 +12,69 @@
 #include "stm32f4xx.h"
 #include <bsp.h>
 #include "SendTritium.h"
+#include "PedalMaps.h"
 
 static OS_TCB Task1_TCB;
 static CPU_STK Task1_Stk[128];
 
+static float ramp(int percent, int start, int end) {
+    float x = (float)(percent - start) / (end - start);
+    return (x < 0) ? 0 : (x > 1) ? 1 : x;
+}
+
+static float shape(PedalCurve_t curve, float x) {
+    switch (curve) {
+        case PEDAL_CURVE_PROGRESSIVE: return x * x;
+        case PEDAL_CURVE_AGGRESSIVE: return x * (2 - x);
+        default: return x;
+    }
+}
+
+static int check(const char *name, PedalCurve_t curve, const int16_t *map, bool onePedal) {
+    int failures = 0;
+    for (int percent = 0; percent <= PEDAL_MAX; percent++) {
+        float expected;
+        if (!onePedal) {
+            expected = shape(curve, ramp(percent, ACCEL_PEDAL_THRESHOLD, PEDAL_MAX));
+        } else if (percent <= ONEPEDAL_BRAKE_THRESHOLD) {
+            expected = 1 - ramp(percent, PEDAL_MIN, ONEPEDAL_BRAKE_THRESHOLD);
+        } else {
+            expected = shape(curve, ramp(percent, ONEPEDAL_NEUTRAL_THRESHOLD, PEDAL_MAX));
+        }
+
+        float error = PedalMap_Lookup(map, percent) - expected;
+        if (error > 1.0f / PEDAL_MAP_ONE || error < -1.0f / PEDAL_MAP_ONE) {
+            printf("%s curve %d at %d%%: %d, expected %d\n\r", name, curve, percent,
+                map[percent], (int)(expected * PEDAL_MAP_ONE));
+            failures++;
+        }
+    }
+    return failures;
+}
 
 void Task1(void *p_arg) {
     CPU_Init();
-    // OS_CPU_SysTickInit();
     OS_CPU_SysTickInit(SystemCoreClock / (CPU_INT32U) OSCfg_TickRate_Hz);
 
-    // These test cases are based on the actual uses of mapToPercent in SendTritium.c
-    printf("\n\r============ Testing mapToPercent ============\n\r");
-    printf("\n\rInput (0-100) Output (0-100)\n\r");
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 0, mapToPercent(0, 0, 100, 0, 100), 0.0);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 15, mapToPercent(15, 0, 100, 0, 100), 0.15);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 74, mapToPercent(74, 0, 100, 0, 100), 0.74);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 100, mapToPercent(100, 0, 100, 0, 100), 1.0);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 115, mapToPercent(115, 0, 100, 0, 100), 1.0);
+    printf("\n\r============ Testing pedal maps ============\n\r");
+    int failures = 0;
+    for (PedalCurve_t curve = 0; curve < NUM_PEDAL_CURVES; curve++) {
+        failures += check("Throttle", curve, PedalMap_Throttle[curve], false);
+        failures += check("OnePedal", curve, PedalMap_OnePedal[curve], true);
+    }
 
-    printf("\n\rInput (15-100) Output (0-100)\n\r");
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 0, mapToPercent(0, 15, 100, 0, 100), 0.0);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 15, mapToPercent(15, 15, 100, 0, 100), 0.0);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 16, mapToPercent(16, 15, 100, 0, 100), 0.01);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 74, mapToPercent(74, 15, 100, 0, 100), 0.69);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 100, mapToPercent(100, 15, 100, 0, 100), 1.0);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 115, mapToPercent(115, 15, 100, 0, 100), 1.0);
+    // Out of range pedal readings clamp to full pedal
+    if (PedalMap_Lookup(PedalMap_Throttle[PEDAL_CURVE_LINEAR], 115) != 1.0f) {
+        printf("Lookup above PEDAL_MAX does not clamp\n\r");
+        failures++;
+    }
 
-    printf("\n\rInput (35-100) Output (0-100)\n\r");
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 0, mapToPercent(0, 35, 100, 0, 100), 0.0);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 35, mapToPercent(35, 35, 100, 0, 100), 0.0);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 48, mapToPercent(48, 35, 100, 0, 100), 0.2);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 76, mapToPercent(76, 35, 100, 0, 100), 0.63);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 100, mapToPercent(100, 35, 100, 0, 100), 1.0);
-    printf("Input Value: %d, Output Value: %f, Expected Value: %f\n", 115, mapToPercent(115, 35, 100, 0, 100), 1.0);
+    if (failures == 0) {
+        printf("Success!\n\r");
+    } else {
+        printf("%d failures\n\r", failures);
+    }
+    while (1);
 }
 
 int main(void) {
@@ -0,0 +1,145 @@
+/**
+ * Measures the cycle cost of VehicleState reads and writes, and checks that reads
+ * are never torn while a higher priority task is writing.
+ *
+ * Run with: make leader TEST=VehicleState
+ * Prints the average cycles per call, then how many writes happened during the
+ * reads and how many reads were inconsistent (there should be none).
+ */
+
+#include "Tasks.h"
+#include "VehicleState.h"
+#include "BSP_UART.h"
+#include "BSP_Cycles.h"
+
+static OS_TCB Task1_TCB;
+static CPU_STK Task1_Stk[DEFAULT_STACK_SIZE];
+static OS_TCB Writer_TCB;
+static CPU_STK Writer_Stk[DEFAULT_STACK_SIZE];
+
+#define ROUNDS 1000
+#define CHECK_READS 200000
+
+// Writes control values that all come from the same counter, every tick
+static void Writer(void *p_arg) {
+    (void) p_arg;
+    OS_ERR err;
+    for (uint32_t n = 0;; n++) {
+        VehicleState_SetControl(&(VehicleControl_t){
+            .accelPedalPercent = n & 0xFF,
+            .brakePedalPercent = n & 0xFF,
+            .currentSetpoint = n,
+            .velocitySetpoint = n,
+            .cruiseVelSetpoint = n,
+        });
+        OSTimeDly(1, OS_OPT_TIME_DLY, &err);
+        assertOSError(err);
+    }
+}
+
+static void createWriter(void) {
+    OS_ERR err;
+    OSTaskCreate(
+        (OS_TCB*)&Writer_TCB,
+        (CPU_CHAR*)"Writer",
+        (OS_TASK_PTR)Writer,
+        (void*)NULL,
+        (OS_PRIO)3,
+        (CPU_STK*)Writer_Stk,
+        (CPU_STK_SIZE)DEFAULT_STACK_SIZE/10,
+        (CPU_STK_SIZE)DEFAULT_STACK_SIZE,
+        (OS_MSG_QTY)0,
+        (OS_TICK)NULL,
+        (void*)NULL,
+        (OS_OPT)(OS_OPT_TASK_STK_CLR|OS_OPT_TASK_STK_CHK|OS_OPT_TASK_SAVE_FP),
+        (OS_ERR*)&err
+    );
+    assertOSError(err);
+}
+
+void Task1(void *p_arg) {
+    (void) p_arg;
+
+    CPU_Init();
+    OS_CPU_SysTickInit(SystemCoreClock / (CPU_INT32U) OSCfg_TickRate_Hz);
+    BSP_Cycles_Init();
+
+    // Cost of each call with no contention
+    VehicleMotor_t motor = {.rpm = 1, .velocity = 2};
+    VehicleControl_t control = {0};
+    uint32_t motorWrite = 0, motorRead = 0, controlWrite = 0, controlRead = 0;
+    for (int i = 0; i < ROUNDS; i++) {
+        uint32_t start = BSP_Cycles_Get();
+        VehicleState_SetMotor(&motor);
+        motorWrite += BSP_Cycles_Get() - start;
+
+        start = BSP_Cycles_Get();
+        VehicleState_GetMotor(&motor);
+        motorRead += BSP_Cycles_Get() - start;
+
+        start = BSP_Cycles_Get();
+        VehicleState_SetControl(&control);
+        controlWrite += BSP_Cycles_Get() - start;
+
+        start = BSP_Cycles_Get();
+        VehicleState_GetControl(&control);
+        controlRead += BSP_Cycles_Get() - start;
+    }
+
+    printf("Average cycles over %d calls:\n\r", ROUNDS);
+    printf("  VehicleState_SetMotor (%d bytes):    %d\n\r", (int)sizeof(VehicleMotor_t), (int)(motorWrite / ROUNDS));
+    printf("  VehicleState_GetMotor:               %d\n\r", (int)(motorRead / ROUNDS));
+    printf("  VehicleState_SetControl (%d bytes): %d\n\r", (int)sizeof(VehicleControl_t), (int)(controlWrite / ROUNDS));
+    printf("  VehicleState_GetControl:             %d\n\r", (int)(controlRead / ROUNDS));
+
+    // Read continuously while a higher priority task keeps writing
+    createWriter();
+    uint32_t torn = 0, first = VehicleState_GetControl(&control), version = first;
+    for (int i = 0; i < CHECK_READS; i++) {
+        version = VehicleState_GetControl(&control);
+        uint32_t n = (uint32_t)control.currentSetpoint;
+        if ((uint32_t)control.velocitySetpoint != n || (uint32_t)control.cruiseVelSetpoint != n
+                || control.accelPedalPercent != (n & 0xFF) || control.brakePedalPercent != (n & 0xFF)) {
+            torn++;
+        }
+    }
+
+    printf("%d reads during %d writes, %d inconsistent\n\r", CHECK_READS, (int)(version - first), (int)torn);
+    printf(torn == 0 ? "Success!\r\n" : "FAILED\r\n");
+    for (;;);
+}
+
+int main(void){ //initialize things and spawn task
+    OS_ERR err;
+    OSInit(&err);
+    if(err != OS_ERR_NONE){
+        printf("OS error code %d\n\r",err);
+    }
+
+    BSP_UART_Init(UART_2);
+
+    OSTaskCreate(
+        (OS_TCB*)&Task1_TCB,
+        (CPU_CHAR*)"Task1",
+        (OS_TASK_PTR)Task1,
+        (void*)NULL,
+        (OS_PRIO)4,
+        (CPU_STK*)Task1_Stk,
+        (CPU_STK_SIZE)DEFAULT_STACK_SIZE/10,
+        (CPU_STK_SIZE)DEFAULT_STACK_SIZE,
+        (OS_MSG_QTY)0,
+        (OS_TICK)NULL,
+        (void*)NULL,
+        (OS_OPT)(OS_OPT_TASK_STK_CLR|OS_OPT_TASK_STK_CHK|OS_OPT_TASK_SAVE_FP),
+        (OS_ERR*)&err
+    );
+
+    if (err != OS_ERR_NONE) {
+        printf("Task1 error code %d\n\r", err);
+    }
+    OSStart(&err);
+    if (err != OS_ERR_NONE) {
+        printf("OS error code %d\n\r", err);
+    }
+    return 0;
+}